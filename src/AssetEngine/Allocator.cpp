@@ -0,0 +1,416 @@
+#include "pch.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    UINT64 AlignUp(UINT64 value, UINT64 alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Huge-page sized and aligned region straight from the system
+    void* MapRegion(UINT64 size)
+    {
+#if defined(_WIN32)
+        // Large pages need SeLockMemoryPrivilege: fall back to regular pages without it
+        SIZE_T largePage = GetLargePageMinimum();
+        if (largePage != 0 && size % largePage == 0)
+        {
+            void* region = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (region != nullptr)
+                return region;
+        }
+        return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        // Over-map, then trim both ends down to an aligned region
+        const UINT64 hugePage = AlignedAllocator::HUGE_PAGE_SIZE;
+        UINT64 mapSize = size + hugePage;
+        void* base = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return nullptr;
+
+        UINT8* start = static_cast<UINT8*>(base);
+        UINT8* region = reinterpret_cast<UINT8*>(AlignUp(reinterpret_cast<UINT64>(start), hugePage));
+        UINT64 head = region - start;
+        if (head != 0)
+            munmap(start, head);
+        UINT64 tail = mapSize - head - size;
+        if (tail != 0)
+            munmap(region + size, tail);
+
+#if defined(MADV_HUGEPAGE)
+        madvise(region, size, MADV_HUGEPAGE);
+#endif
+        return region;
+#endif
+    }
+
+    void UnmapRegion(void* region, UINT64 size)
+    {
+#if defined(_WIN32)
+        VirtualFree(region, 0, MEM_RELEASE);
+#else
+        munmap(region, size);
+#endif
+    }
+}
+
+// === Allocator ===
+
+Allocator::Allocator() :
+    mAllocations(0),
+    mFrees(0),
+    mOutstanding(0),
+    mPeak(0)
+{
+}
+
+void* Allocator::Reallocate(void* block, UINT64 capacity, UINT64 usedBytes, UINT64 newSize, UINT64& outCapacity)
+{
+    void* newBlock = Allocate(newSize, outCapacity);
+    if (newBlock == nullptr)
+        return nullptr;
+
+    if (block != nullptr)
+    {
+        memcpy(newBlock, block, (std::min)(usedBytes, newSize));
+        Free(block, capacity);
+    }
+    return newBlock;
+}
+
+AllocatorStats Allocator::GetStats() const
+{
+    AllocatorStats stats = {};
+    stats.allocations = mAllocations.load();
+    stats.frees = mFrees.load();
+    stats.outstanding = mOutstanding.load();
+    stats.peak = mPeak.load();
+    return stats;
+}
+
+void Allocator::OnAllocate(UINT64 capacity)
+{
+    mAllocations++;
+    UINT64 outstanding = mOutstanding.fetch_add(capacity) + capacity;
+    UINT64 peak = mPeak.load();
+    while (outstanding > peak && !mPeak.compare_exchange_weak(peak, outstanding))
+    {
+    }
+}
+
+void Allocator::OnFree(UINT64 capacity)
+{
+    mFrees++;
+    mOutstanding -= capacity;
+}
+
+Allocator*& Allocator::Current()
+{
+    thread_local Allocator* current = nullptr;
+    return current;
+}
+
+Allocator& Allocator::GetHeap()
+{
+    // Never destroyed: Blobs with static storage may outlive any other static
+    static HeapAllocator* heap = new HeapAllocator();
+    return *heap;
+}
+
+Allocator& Allocator::GetCurrent()
+{
+    Allocator* current = Current();
+    return current != nullptr ? *current : GetHeap();
+}
+
+// === HeapAllocator ===
+
+void* HeapAllocator::Allocate(UINT64 size, UINT64& outCapacity)
+{
+    void* block = malloc(size);
+    if (block == nullptr)
+        return nullptr;
+
+    outCapacity = size;
+    OnAllocate(size);
+    return block;
+}
+
+void HeapAllocator::Free(void* block, UINT64 capacity)
+{
+    if (block == nullptr)
+        return;
+
+    free(block);
+    OnFree(capacity);
+}
+
+void* HeapAllocator::Reallocate(void* block, UINT64 capacity, UINT64, UINT64 newSize, UINT64& outCapacity)
+{
+    // realloc can grow in place
+    void* newBlock = realloc(block, newSize);
+    if (newBlock == nullptr)
+        return nullptr;
+
+    if (block != nullptr)
+        OnFree(capacity);
+    outCapacity = newSize;
+    OnAllocate(newSize);
+    return newBlock;
+}
+
+// === PoolAllocator ===
+
+PoolAllocator::PoolAllocator(UINT64 maxCachedBytes) :
+    mMaxCachedBytes(maxCachedBytes),
+    mCachedBytes(0),
+    mReused(0)
+{
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    Trim();
+}
+
+PoolAllocator& PoolAllocator::Get()
+{
+    static PoolAllocator* pool = new PoolAllocator();
+    return *pool;
+}
+
+int PoolAllocator::GetClass(UINT64 size)
+{
+    if (size > MAX_CLASS)
+        return -1;
+
+    int sizeClass = 0;
+    UINT64 classSize = MIN_CLASS;
+    while (classSize < size)
+    {
+        classSize <<= 1;
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+void* PoolAllocator::Allocate(UINT64 size, UINT64& outCapacity)
+{
+    int sizeClass = GetClass(size);
+    UINT64 capacity = sizeClass < 0 ? size : MIN_CLASS << sizeClass;
+
+    // A class larger than the cache could never be reused: rounding up would only waste memory
+    if (capacity > mMaxCachedBytes)
+    {
+        sizeClass = -1;
+        capacity = size;
+    }
+
+    void* block = nullptr;
+    if (sizeClass >= 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& freeBlocks = mFreeBlocks[sizeClass];
+        if (!freeBlocks.empty())
+        {
+            block = freeBlocks.back();
+            freeBlocks.pop_back();
+            mCachedBytes -= capacity;
+            mReused++;
+        }
+    }
+
+    if (block == nullptr)
+        block = malloc(capacity);
+    if (block == nullptr)
+        return nullptr;
+
+    outCapacity = capacity;
+    OnAllocate(capacity);
+    return block;
+}
+
+void PoolAllocator::Free(void* block, UINT64 capacity)
+{
+    if (block == nullptr)
+        return;
+
+    OnFree(capacity);
+
+    // Only exact class sizes are cached: anything else came from the heap as is
+    int sizeClass = GetClass(capacity);
+    if (sizeClass >= 0 && (MIN_CLASS << sizeClass) == capacity)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCachedBytes + capacity <= mMaxCachedBytes)
+        {
+            mFreeBlocks[sizeClass].push_back(block);
+            mCachedBytes += capacity;
+            return;
+        }
+    }
+
+    free(block);
+}
+
+AllocatorStats PoolAllocator::GetStats() const
+{
+    AllocatorStats stats = Allocator::GetStats();
+    std::lock_guard<std::mutex> lock(mMutex);
+    stats.reused = mReused;
+    stats.cached = mCachedBytes;
+    return stats;
+}
+
+void PoolAllocator::Trim()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& freeBlocks : mFreeBlocks)
+    {
+        for (void* block : freeBlocks)
+            free(block);
+        freeBlocks.clear();
+    }
+    mCachedBytes = 0;
+}
+
+// === ArenaAllocator ===
+
+ArenaAllocator::ArenaAllocator(UINT64 chunkSize) :
+    mChunkSize(chunkSize),
+    mpCursor(nullptr),
+    mRemaining(0)
+{
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    Reset();
+}
+
+void* ArenaAllocator::Allocate(UINT64 size, UINT64& outCapacity)
+{
+    UINT64 capacity = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (capacity > mRemaining)
+    {
+        // Oversized requests get a chunk of their own
+        UINT64 chunkSize = (std::max)(mChunkSize, capacity);
+        UINT8* chunk = static_cast<UINT8*>(malloc(chunkSize));
+        if (chunk == nullptr)
+            return nullptr;
+
+        mChunks.push_back(chunk);
+        mpCursor = chunk;
+        mRemaining = chunkSize;
+    }
+
+    void* block = mpCursor;
+    mpCursor += capacity;
+    mRemaining -= capacity;
+
+    outCapacity = capacity;
+    OnAllocate(capacity);
+    return block;
+}
+
+void ArenaAllocator::Free(void* block, UINT64 capacity)
+{
+    if (block != nullptr)
+        OnFree(capacity);
+}
+
+void ArenaAllocator::Reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (UINT8* chunk : mChunks)
+        free(chunk);
+    mChunks.clear();
+    mpCursor = nullptr;
+    mRemaining = 0;
+}
+
+// === AlignedAllocator ===
+
+AlignedAllocator::AlignedAllocator(UINT64 alignment, UINT64 hugePageThreshold, bool prefault) :
+    mAlignment(alignment),
+    mHugePageThreshold(hugePageThreshold),
+    mPrefault(prefault)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "[ERROR][ALLOCATOR] Alignment must be a power of two");
+}
+
+AlignedAllocator& AlignedAllocator::GetCacheLine()
+{
+    static AlignedAllocator* allocator = new AlignedAllocator(CACHE_LINE);
+    return *allocator;
+}
+
+AlignedAllocator& AlignedAllocator::GetPage()
+{
+    static AlignedAllocator* allocator = new AlignedAllocator(PAGE_SIZE, 64 * 1024 * 1024);
+    return *allocator;
+}
+
+void* AlignedAllocator::Allocate(UINT64 size, UINT64& outCapacity)
+{
+    UINT64 capacity = AlignUp((std::max)(size, (UINT64)1), mAlignment);
+
+    void* block = nullptr;
+    if (IsMapped(capacity))
+    {
+        capacity = AlignUp(capacity, HUGE_PAGE_SIZE);
+        block = MapRegion(capacity);
+    }
+    else
+    {
+#if defined(_WIN32)
+        block = _aligned_malloc(capacity, mAlignment);
+#else
+        if (posix_memalign(&block, (std::max)(mAlignment, (UINT64)sizeof(void*)), capacity) != 0)
+            block = nullptr;
+#endif
+    }
+
+    if (block == nullptr)
+        return nullptr;
+
+    // One write per page: the faults are taken now, not in the middle of the work
+    if (mPrefault)
+    {
+        volatile UINT8* bytes = static_cast<UINT8*>(block);
+        for (UINT64 offset = 0; offset < capacity; offset += PAGE_SIZE)
+            bytes[offset] = 0;
+    }
+
+    outCapacity = capacity;
+    OnAllocate(capacity);
+    return block;
+}
+
+void AlignedAllocator::Free(void* block, UINT64 capacity)
+{
+    if (block == nullptr)
+        return;
+
+    if (IsMapped(capacity))
+        UnmapRegion(block, capacity);
+    else
+    {
+#if defined(_WIN32)
+        _aligned_free(block);
+#else
+        free(block);
+#endif
+    }
+    OnFree(capacity);
+}
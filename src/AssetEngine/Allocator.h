@@ -0,0 +1,166 @@
+#ifndef ALLOCATOR_H__
+#define ALLOCATOR_H__
+
+struct AllocatorStats
+{
+    UINT64   allocations;
+    UINT64   frees;
+    UINT64   outstanding;   // bytes handed out and not freed yet
+    UINT64   peak;          // highest outstanding
+    UINT64   reused;        // allocations served from freed blocks
+    UINT64   cached;        // bytes kept for reuse
+};
+
+// Where Blob gets its memory. Blocks are freed with the capacity they were given.
+class Allocator
+{
+public:
+    Allocator();
+    virtual ~Allocator() = default;
+
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+
+    //At least size bytes; outCapacity is what the block can really hold
+    virtual void* Allocate(UINT64 size, UINT64& outCapacity) = 0;
+    virtual void Free(void* block, UINT64 capacity) = 0;
+    //Moves the first usedBytes to a block of at least newSize bytes (default: allocate + copy + free)
+    virtual void* Reallocate(void* block, UINT64 capacity, UINT64 usedBytes, UINT64 newSize, UINT64& outCapacity);
+
+    virtual AllocatorStats GetStats() const;
+    //false: even the smallest Blob takes a block (the inline bytes have no alignment guarantee)
+    virtual bool AllowsInline() const { return true; }
+
+    //malloc / realloc / free
+    static Allocator& GetHeap();
+    //Used by the Blobs constructed on this thread (see AllocatorScope)
+    static Allocator& GetCurrent();
+
+protected:
+    void OnAllocate(UINT64 capacity);
+    void OnFree(UINT64 capacity);
+
+    std::atomic<UINT64> mAllocations;
+    std::atomic<UINT64> mFrees;
+    std::atomic<UINT64> mOutstanding;
+    std::atomic<UINT64> mPeak;
+
+private:
+    friend class AllocatorScope;
+    static Allocator*& Current();
+};
+
+// Makes allocator the current one of this thread until the scope ends
+class AllocatorScope
+{
+public:
+    explicit AllocatorScope(Allocator& allocator) : mpPrevious(Allocator::Current()) { Allocator::Current() = &allocator; }
+    ~AllocatorScope() { Allocator::Current() = mpPrevious; }
+
+    AllocatorScope(const AllocatorScope&) = delete;
+    AllocatorScope& operator=(const AllocatorScope&) = delete;
+
+private:
+    Allocator* mpPrevious;
+};
+
+class HeapAllocator : public Allocator
+{
+public:
+    void* Allocate(UINT64 size, UINT64& outCapacity) override;
+    void Free(void* block, UINT64 capacity) override;
+    void* Reallocate(void* block, UINT64 capacity, UINT64 usedBytes, UINT64 newSize, UINT64& outCapacity) override;
+};
+
+// Power-of-two size classes with free lists: a freed block serves the next request of
+// its class. Blocks outside [MIN_CLASS, MAX_CLASS], or whose class is larger than the
+// cache (maxCachedBytes), go straight to the heap at their exact size.
+class PoolAllocator : public Allocator
+{
+public:
+    static const UINT64 MIN_CLASS = 4 * 1024;
+    static const UINT64 MAX_CLASS = 256 * 1024 * 1024;
+
+    explicit PoolAllocator(UINT64 maxCachedBytes = 64 * 1024 * 1024);
+    ~PoolAllocator() override;
+
+    //Process-wide pool used by the bulk archive operations (never destroyed)
+    static PoolAllocator& Get();
+
+    void* Allocate(UINT64 size, UINT64& outCapacity) override;
+    void Free(void* block, UINT64 capacity) override;
+    AllocatorStats GetStats() const override;
+
+    //Gives every cached block back to the heap
+    void Trim();
+
+private:
+    static const UINT32 CLASS_COUNT = 17;   // 4 KB .. 256 MB
+
+    static int GetClass(UINT64 size);
+
+    std::vector<void*> mFreeBlocks[CLASS_COUNT];
+    UINT64 mMaxCachedBytes;
+    UINT64 mCachedBytes;
+    UINT64 mReused;
+    mutable std::mutex mMutex;
+};
+
+// Bump allocation in large chunks. Free only updates the statistics: the memory comes
+// back all at once with Reset (or the destructor), so Blobs using it must be gone by then.
+class ArenaAllocator : public Allocator
+{
+public:
+    explicit ArenaAllocator(UINT64 chunkSize = 1024 * 1024);
+    ~ArenaAllocator() override;
+
+    void* Allocate(UINT64 size, UINT64& outCapacity) override;
+    void Free(void* block, UINT64 capacity) override;
+
+    void Reset();
+
+private:
+    static const UINT64 ALIGNMENT = 16;
+
+    UINT64 mChunkSize;
+    std::vector<UINT8*> mChunks;
+    UINT8* mpCursor;
+    UINT64 mRemaining;
+    std::mutex mMutex;
+};
+
+// Blocks aligned for SIMD kernels (64 B) or unbuffered I/O (4 KB). Blocks of at least
+// hugePageThreshold bytes are mapped straight from the system, 2 MB aligned and flagged
+// for transparent huge pages (MADV_HUGEPAGE, or large pages on Windows when the process
+// may lock memory). Pre-faulting touches every page up front instead of on first access.
+class AlignedAllocator : public Allocator
+{
+public:
+    static const UINT64 CACHE_LINE = 64;
+    static const UINT64 PAGE_SIZE = 4 * 1024;
+    static const UINT64 HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    //alignment: power of two; hugePageThreshold 0: never mapped
+    explicit AlignedAllocator(UINT64 alignment = CACHE_LINE, UINT64 hugePageThreshold = 0, bool prefault = false);
+
+    //Shared instances: 64 B aligned, and 4 KB aligned with huge pages from 64 MB up
+    static AlignedAllocator& GetCacheLine();
+    static AlignedAllocator& GetPage();
+
+    void* Allocate(UINT64 size, UINT64& outCapacity) override;
+    void Free(void* block, UINT64 capacity) override;
+    bool AllowsInline() const override { return false; }
+
+    UINT64 GetAlignment() const { return mAlignment; }
+    UINT64 GetHugePageThreshold() const { return mHugePageThreshold; }
+    bool IsPrefaulting() const { return mPrefault; }
+
+private:
+    bool IsMapped(UINT64 capacity) const { return mHugePageThreshold != 0 && capacity >= mHugePageThreshold; }
+
+    UINT64 mAlignment;
+    UINT64 mHugePageThreshold;
+    bool mPrefault;
+};
+
+#endif // !ALLOCATOR_H__
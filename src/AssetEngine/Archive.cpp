@@ -9,6 +9,179 @@ namespace
         Blob data;
         UINT64 id;
     };
+
+    struct SolidGroupData
+    {
+        SolidGroupHeader header;
+        Blob stored;
+        UINT64 newOffset;
+    };
+
+    struct SharedExtentData
+    {
+        SharedExtentHeader header;
+        Blob stored;
+        UINT64 newOffset;
+        UINT32 checksum;
+        UINT32 refCount;
+    };
+
+    struct DuplicateSet
+    {
+        UINT8 hash[SafeFormat::SHA256_SIZE];
+        UINT32 checksum;
+        UINT32 refCount;        // SharedEntry records written so far
+        UINT64 extentOffset;
+        FileHeader content;
+    };
+
+    //Stored bytes are the file itself (the XOR layer aside)
+    bool IsRawEntry(const FileHeader& header)
+    {
+        return !(header.flags & (FILE_COMPRESSED | FILE_SOLID | FILE_SHARED | FILE_CHUNKED | FILE_FILTERED));
+    }
+
+    //size bytes of stream into outData, IoBuffer::GetChunkSize() per call. False, with outData
+    //empty, if size runs past the end of the stream (forged header), can't be allocated or comes short
+    bool ReadChunked(Stream& stream, Blob& outData, UINT64 size)
+    {
+        outData.Clear();
+        INT64 position = stream.Seek(0, SEEK_CUR);
+        UINT64 streamSize = stream.GetSize();
+        if (position < 0 || static_cast<UINT64>(position) > streamSize || size > streamSize - position)
+            return false;
+        if (!outData.Resize(size))
+            return false;
+
+        const UINT64 chunkSize = IoBuffer::GetChunkSize();
+        UINT64 done = 0;
+        while (done < size)
+        {
+            UINT64 bytesRead = stream.Read(outData.GetData() + done, (std::min)(size - done, chunkSize), 1);
+            if (bytesRead == 0)
+                break;
+            done += bytesRead;
+        }
+
+        if (done != size)
+        {
+            outData.Clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadSourceFile(const std::string& path, Blob& outData)
+    {
+        File file;
+        if (!file.OpenRead(path))
+            return false;
+
+        bool complete = ReadChunked(file, outData, file.GetSize());
+        file.Close();
+
+        return complete;
+    }
+
+    //Sets of byte-identical files: same size, then same CRC32, then same SHA-256.
+    //Maps each member path to its set.
+    std::unordered_map<std::string, size_t> FindDuplicateFiles(const std::vector<std::string>& filePaths, std::vector<DuplicateSet>& outSets)
+    {
+        std::unordered_map<std::string, size_t> setOf;
+
+        std::unordered_map<UINT64, std::vector<std::string>> bySize;
+        for (const auto& path : filePaths)
+        {
+            std::error_code error;
+            UINT64 size = std::filesystem::file_size(path, error);
+            if (!error && size > 0)
+                bySize[size].push_back(path);
+        }
+
+        Blob data;
+        for (const auto& [size, sameSize] : bySize)
+        {
+            if (sameSize.size() < 2)
+                continue;
+
+            std::unordered_map<UINT32, std::vector<std::string>> byChecksum;
+            for (const auto& path : sameSize)
+            {
+                if (ReadSourceFile(path, data))
+                    byChecksum[SafeFormat::CalculateCRC32(data.GetData(), data.GetSize())].push_back(path);
+            }
+
+            for (const auto& [checksum, sameChecksum] : byChecksum)
+            {
+                if (sameChecksum.size() < 2)
+                    continue;
+
+                std::unordered_map<std::string, std::vector<std::string>> byHash;
+                for (const auto& path : sameChecksum)
+                {
+                    UINT8 hash[SafeFormat::SHA256_SIZE];
+                    if (!ReadSourceFile(path, data))
+                        continue;
+                    SafeFormat::CalculateSHA256(data.GetData(), data.GetSize(), hash);
+                    byHash[std::string((const char*)hash, SafeFormat::SHA256_SIZE)].push_back(path);
+                }
+
+                for (const auto& [hash, members] : byHash)
+                {
+                    if (members.size() < 2)
+                        continue;
+
+                    DuplicateSet set = {};
+                    memcpy(set.hash, hash.data(), SafeFormat::SHA256_SIZE);
+                    set.checksum = checksum;
+                    for (const auto& path : members)
+                        setOf[path] = outSets.size();
+                    outSets.push_back(set);
+                }
+            }
+        }
+
+        return setOf;
+    }
+
+    // Above this, sampled data is treated as random unless it repeats
+    const double STORE_ENTROPY = 7.5;
+    const double STORE_REPEAT_RATIO = 0.05;
+    // Above this, Huffman-coded literals gain too little to pay for the slower decode
+    const double HIGH_RATIO_ENTROPY = 7.0;
+
+    //Lowercase, without the dot ("" if none)
+    std::string GetExtension(const std::string& filename)
+    {
+        size_t dot = filename.find_last_of('.');
+        size_t slash = filename.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return "";
+
+        std::string extension = filename.substr(dot + 1);
+        for (auto& c : extension)
+            c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return extension;
+    }
+
+    bool IsPrecompressedFile(const std::string& filename)
+    {
+        static const char* extensions[] = { "png", "jpg", "jpeg", "webp", "ogg", "mp3", "mp4", "webm", "zip", "gz", "7z" };
+
+        std::string extension = GetExtension(filename);
+        for (const char* known : extensions)
+        {
+            if (extension == known)
+                return true;
+        }
+        return false;
+    }
+
+    //Filters and blocks must line up for a block to be reverted on its own
+    UINT64 GetFilterSegment(UINT64 size, UINT32 blockSize)
+    {
+        return (blockSize == 0 || size <= blockSize) ? 0 : blockSize;
+    }
 }
 
 Archive::~Archive()
@@ -28,8 +201,10 @@ bool Archive::Open(const std::string& archivePath, Mode mode)
         Close();
 
     m_archivePath = archivePath;
+    m_packSummary = PackSummary();
 
     File* file = new File();
+    file->EnableBlockCache(true);
     if (!file->Open(archivePath, mode))
     {
         delete file;
@@ -38,6 +213,7 @@ bool Archive::Open(const std::string& archivePath, Mode mode)
 
     m_stream = file;
     m_ownsStream = true;
+    m_mode = mode;
 
     if (mode == Mode::READ)
     {
@@ -47,16 +223,30 @@ bool Archive::Open(const std::string& archivePath, Mode mode)
             return false;
         }
 
-        if (!ReadMaps())
+        // Another process may have decoded the maps already: map its index instead
+        if (!m_sharedTocEnabled || !m_toc.Attach(archivePath, m_header.fileCount, m_header.dataOffset))
         {
-            Close();
-            return false;
+            if (!ReadMaps())
+            {
+                Close();
+                return false;
+            }
+
+            if (m_sharedTocEnabled)
+                SharedToc::Publish(archivePath, m_header.fileCount, m_header.dataOffset, m_nameToOffset, m_idToOffset);
         }
+
+        ReadDictionary();
     }
     else
     {
+        // About to change: an index left by readers would describe the old maps
+        std::error_code error;
+        std::filesystem::remove(SharedToc::GetPath(archivePath), error);
+
         if (ReadArchiveHeader() && ReadMaps())
         {
+            ReadDictionary();
         }
         else
         {
@@ -73,19 +263,29 @@ bool Archive::Open(const std::string& archivePath, Mode mode)
     return true;
 }
 
-bool Archive::OpenStream(Stream* stream)
+bool Archive::OpenStream(Stream* stream, Mode mode)
 {
     if (stream == nullptr || !stream->IsOpen())
         return false;
 
+    Memory* memory = dynamic_cast<Memory*>(stream);
+    if (mode == Mode::WRITE && memory != nullptr && memory->IsReadOnly())
+    {
+        std::cerr << "[ERROR] Read-only Memory can't be opened for writing\n";
+        return false;
+    }
+
     if (IsOpen())
         Close();
 
     m_stream = stream;
     m_ownsStream = false;  
+    m_mode = mode;
+    m_stream->Seek(0, SEEK_SET);
 
     if (ReadArchiveHeader() && ReadMaps())
     {
+        ReadDictionary();
     }
     else
     {
@@ -101,6 +301,98 @@ bool Archive::OpenStream(Stream* stream)
     return true;
 }
 
+bool Archive::Load(const std::string& archivePath, Mode mode)
+{
+    File file;
+    if (!file.OpenRead(archivePath))
+        return false;
+
+    // One read for the whole archive
+    Memory* memory = new Memory();
+    UINT64 size = file.GetSize();
+    Blob* image = memory->GetBlob();
+    image->Resize(size);
+    bool loaded = image->GetSize() == size && (size == 0 || file.Read(image->GetData(), size, 1) == size);
+    file.Close();
+
+    if (!loaded || !OpenStream(memory, mode))
+    {
+        delete memory;
+        return false;
+    }
+
+    m_ownsStream = true;
+    m_archivePath = archivePath;
+    return true;
+}
+
+bool Archive::Save(const std::string& outputPath) const
+{
+    const Memory* memory = dynamic_cast<const Memory*>(m_stream);
+    if (memory == nullptr || !memory->IsOpen())
+    {
+        std::cerr << "[ERROR] Save needs an archive held in memory\n";
+        return false;
+    }
+
+    // File opens for writing without truncating
+    std::error_code error;
+    std::filesystem::remove(outputPath, error);
+
+    File file;
+    if (!file.OpenWrite(outputPath))
+    {
+        std::cerr << "[ERROR] Failed to create: " << outputPath << "\n";
+        return false;
+    }
+
+    // One write for the whole archive (one per segment when chunked)
+    if (memory->GetChunks() != nullptr)
+    {
+        bool saved = memory->GetChunks()->WriteTo(file);
+        file.Close();
+        return saved;
+    }
+
+    UINT64 size = memory->GetByteCount();
+    UINT64 written = (size > 0) ? file.Write(memory->GetBytes(), size, 1) : 0;
+    file.Close();
+    return written == size;
+}
+
+bool Archive::IsInMemory() const
+{
+    return dynamic_cast<const Memory*>(m_stream) != nullptr;
+}
+
+bool Archive::RestartStream(const std::string& filePath)
+{
+    File* file = dynamic_cast<File*>(m_stream);
+    if (file != nullptr)
+    {
+        file->Close();
+        if (!file->OpenWrite(filePath))
+            return false;
+    }
+    else
+    {
+        Memory* memory = dynamic_cast<Memory*>(m_stream);
+        if (memory == nullptr || memory->IsReadOnly())
+            return false;
+
+        if (memory->GetChunks() != nullptr)
+            memory->GetChunks()->Clear();
+        else if (memory->GetBlob() != nullptr)
+            memory->GetBlob()->Resize(0);
+        else
+            return false;
+        memory->ResetPos();
+    }
+
+    m_mode = Mode::WRITE;
+    return true;
+}
+
 void Archive::Close()
 {
     if (m_stream != nullptr)
@@ -109,7 +401,16 @@ void Archive::Close()
     }
     m_nameToOffset.clear();
     m_idToOffset.clear();
+    m_toc.Detach();
     m_archivePath.clear();
+    m_dictionary.data.Resize(0);
+    m_dictionary.table.clear();
+    ClearSolidCache();
+    m_contentIndex.clear();
+    m_contentIndexed = false;
+    m_chunkIndex.clear();
+    m_chunkIndexed = false;
+    ClearEntryCache();
 }
 
 bool Archive::IsOpen() const
@@ -242,6 +543,8 @@ bool Archive::WriteMaps()
 bool Archive::RebuildArchive()
 {
     std::vector<FileData> allFiles;
+    std::unordered_map<UINT64, SolidGroupData> groups;
+    std::unordered_map<UINT64, SharedExtentData> extents;
 
     for (const auto& [name, oldOffset] : m_nameToOffset)
     {
@@ -255,28 +558,73 @@ bool Archive::RebuildArchive()
         UINT64 blobOffset = oldOffset + sizeof(FileHeader);
         m_stream->Seek(blobOffset, SEEK_SET);
 
-        fd.data.Reserve(fd.header.dataSize);
-        UINT64 remaining = fd.header.dataSize;
-        UINT64 offset = 0;
+        if (!ReadChunked(*m_stream, fd.data, fd.header.dataSize))
+            continue;
 
-        while (remaining > 0)
+        if (fd.header.flags & FILE_SOLID)
         {
-            UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-            UINT64 bytesRead = m_stream->Read(fd.data.GetData() + offset, chunkSize, 1);
-            if (bytesRead == 0)
-                break;
-            offset += bytesRead;
-            remaining -= bytesRead;
+            SolidEntry entry;
+            if (fd.data.GetSize() != sizeof(SolidEntry))
+                continue;
+            memcpy(&entry, fd.data.GetData(), sizeof(SolidEntry));
+
+            if (groups.find(entry.groupOffset) == groups.end())
+            {
+                SolidGroupData group;
+                if (!ReadSolidGroup(*m_stream, entry.groupOffset, group.header, group.stored))
+                    continue;
+                groups.emplace(entry.groupOffset, std::move(group));
+            }
+        }
+        else if (fd.header.flags & FILE_SHARED)
+        {
+            SharedEntry entry;
+            if (fd.data.GetSize() != sizeof(SharedEntry))
+                continue;
+            memcpy(&entry, fd.data.GetData(), sizeof(SharedEntry));
+
+            if (extents.find(entry.extentOffset) == extents.end())
+            {
+                SharedExtentData extent = {};
+                if (!ReadSharedExtent(*m_stream, entry.extentOffset, extent.header, &extent.stored))
+                    continue;
+                extents.emplace(entry.extentOffset, std::move(extent));
+            }
+        }
+        else if (fd.header.flags & FILE_CHUNKED)
+        {
+            std::vector<ChunkRef> chunks;
+            if (!ReadChunkList(fd.header, fd.data, chunks))
+                continue;
+
+            bool readable = true;
+            for (const auto& chunk : chunks)
+            {
+                if (extents.find(chunk.extentOffset) != extents.end())
+                    continue;
+
+                SharedExtentData extent = {};
+                readable = ReadSharedExtent(*m_stream, chunk.extentOffset, extent.header, &extent.stored);
+                if (!readable)
+                    break;
+                extents.emplace(chunk.extentOffset, std::move(extent));
+            }
+            if (!readable)
+                continue;
         }
-        fd.data.Resize(fd.header.dataSize);
 
         fd.id = fd.header.id;
         allFiles.push_back(std::move(fd));
     }
 
     m_stream->Close();
+    ClearSolidCache();
+    m_contentIndex.clear();
+    m_contentIndexed = false;
+    m_chunkIndex.clear();
+    m_chunkIndexed = false;
 
-    if (!static_cast<File*>(m_stream)->OpenWrite(m_archivePath))
+    if (!RestartStream(m_archivePath))
         return false;
 
     UINT64 newMapSize = m_header.fileCount * sizeof(MapEntry) * 2;
@@ -287,6 +635,50 @@ bool Archive::RebuildArchive()
     m_stream->Seek(newMapSize, SEEK_CUR);
     m_header.dataOffset = m_stream->Seek(0, SEEK_CUR);
 
+    if (GetDictionary() != nullptr && !WriteDictionary(*m_stream))
+        return false;
+
+    // Groups and extents go first, then their entries are pointed at the new locations
+    for (auto& [oldOffset, group] : groups)
+    {
+        group.newOffset = m_stream->Seek(0, SEEK_CUR);
+        m_stream->Write((const UINT8*)&group.header, sizeof(SolidGroupHeader), 1);
+        m_stream->Write(group.stored.GetData(), group.stored.GetSize(), 1);
+    }
+
+    for (auto& [oldOffset, extent] : extents)
+    {
+        extent.newOffset = m_stream->Seek(0, SEEK_CUR);
+        m_stream->Write((const UINT8*)&extent.header, sizeof(SharedExtentHeader), 1);
+        m_stream->Write(extent.stored.GetData(), extent.stored.GetSize(), 1);
+    }
+
+    for (auto& fd : allFiles)
+    {
+        if (fd.header.flags & FILE_SOLID)
+        {
+            SolidEntry entry;
+            memcpy(&entry, fd.data.GetData(), sizeof(SolidEntry));
+            entry.groupOffset = groups[entry.groupOffset].newOffset;
+            memcpy(fd.data.GetData(), &entry, sizeof(SolidEntry));
+        }
+        else if (fd.header.flags & FILE_SHARED)
+        {
+            SharedEntry entry;
+            memcpy(&entry, fd.data.GetData(), sizeof(SharedEntry));
+            entry.extentOffset = extents[entry.extentOffset].newOffset;
+            memcpy(fd.data.GetData(), &entry, sizeof(SharedEntry));
+        }
+        else if (fd.header.flags & FILE_CHUNKED)
+        {
+            std::vector<ChunkRef> chunks;
+            ReadChunkList(fd.header, fd.data, chunks);
+            for (auto& chunk : chunks)
+                chunk.extentOffset = extents[chunk.extentOffset].newOffset;
+            memcpy(fd.data.GetData(), chunks.data(), fd.data.GetSize());
+        }
+    }
+
     m_nameToOffset.clear();
     m_idToOffset.clear();
 
@@ -294,7 +686,8 @@ bool Archive::RebuildArchive()
     {
         UINT64 newFileOffset = m_stream->Seek(0, SEEK_CUR);
 
-        if (!WriteFileHeader(fd.filename, fd.id, fd.data.GetSize(), fd.header.flags, fd.header.checksum))
+        FilterSpec filter = { fd.header.filter, fd.header.filterWidth };
+        if (!WriteFileHeader(fd.filename, fd.id, fd.data.GetSize(), fd.header.flags, fd.header.checksum, fd.header.codec, filter))
             continue;
 
         m_stream->Write(fd.data.GetData(), fd.data.GetSize(), 1);
@@ -329,7 +722,8 @@ bool Archive::RebuildArchive()
 
 bool Archive::ReadFileHeader(UINT64 offset, FileHeader& header, std::string& filename) const
 {
-    return ReadFileHeader(*m_stream, offset, header, filename);
+    LockedStream archive(m_stream, m_readMutex);
+    return ReadFileHeader(archive, offset, header, filename);
 }
 
 bool Archive::ReadFileHeader(Stream& stream, UINT64 offset, FileHeader& header, std::string& filename) const
@@ -349,7 +743,8 @@ bool Archive::ReadFileHeader(Stream& stream, UINT64 offset, FileHeader& header,
     return true;
 }
 
-bool Archive::WriteFileHeader(const std::string& filename, UINT64 id, UINT64 dataSize, UINT8 flags, UINT32 checksum)
+bool Archive::WriteFileHeader(const std::string& filename, UINT64 id, UINT64 dataSize, UINT8 flags, UINT32 checksum,
+                              UINT8 codec, const FilterSpec& filter)
 {
     if (filename.length() >= 256)
     {
@@ -370,7 +765,9 @@ bool Archive::WriteFileHeader(const std::string& filename, UINT64 id, UINT64 dat
 
     header.flags = flags;
     header.checksum = checksum;
-    memset(header.padding, 0, sizeof(header.padding));
+    header.codec = codec;
+    header.filter = filter.type;
+    header.filterWidth = filter.width;
 
     UINT64 headerWritten = m_stream->Write((UINT8*)&header, sizeof(FileHeader), 1);
     if (headerWritten != sizeof(FileHeader))
@@ -379,6 +776,209 @@ bool Archive::WriteFileHeader(const std::string& filename, UINT64 id, UINT64 dat
     return true;
 }
 
+PackDecision Archive::ChooseCodec(const std::string& filename, const Blob& data, UINT8& codec) const
+{
+    codec = CODEC_NONE;
+
+    if (IsPrecompressedFile(filename))
+        return PACK_STORED_PRECOMPRESSED;
+
+    Codec::Estimate estimate = Codec::EstimateData(data.GetData(), data.GetSize());
+    if (estimate.entropy > STORE_ENTROPY && estimate.repeatRatio < STORE_REPEAT_RATIO)
+        return PACK_STORED_ENTROPY;
+
+    bool highRatioFits = m_decodeBudget == 0 || Codec::GetDecodeSpeed(CODEC_LZH) >= m_decodeBudget;
+    if (highRatioFits && estimate.entropy <= HIGH_RATIO_ENTROPY)
+    {
+        codec = CODEC_LZH;
+        return PACK_HIGH_RATIO;
+    }
+
+    if (m_decodeBudget == 0 || Codec::GetDecodeSpeed(CODEC_LZ) >= m_decodeBudget)
+    {
+        codec = CODEC_LZ;
+        return PACK_FAST;
+    }
+
+    return PACK_STORED_BUDGET;
+}
+
+FilterSpec Archive::FindFilter(const std::string& filePath) const
+{
+    auto entry = m_entryFilters.find(filePath);
+    if (entry != m_entryFilters.end())
+        return entry->second;
+
+    auto extension = m_extensionFilters.find(GetExtension(filePath));
+    if (extension != m_extensionFilters.end())
+        return extension->second;
+
+    return FilterSpec();
+}
+
+const Blob& Archive::PackFileData(const std::string& filename, const Blob& fileData, Blob& packed, UINT8& flags, UINT8& codec, FilterSpec& filter)
+{
+    codec = CODEC_NONE;
+
+    if (!m_compressionEnabled || !Filter::IsValid(filter) || IsPrecompressedFile(filename))
+        filter = FilterSpec();
+
+    if (!m_compressionEnabled)
+        return fileData;
+
+    // The codecs see the filtered bytes; the filter is dropped if the entry ends up stored raw
+    Blob filtered;
+    const Blob* input = &fileData;
+    if (Filter::IsValid(filter))
+    {
+        filtered.Resize(fileData.GetSize());
+        Filter::Apply(filter, fileData.GetData(), filtered.GetData(), fileData.GetSize(),
+                      GetFilterSegment(fileData.GetSize(), m_blockSize));
+        input = &filtered;
+    }
+
+    UINT8 chosen;
+    PackDecision decision = ChooseCodec(filename, *input, chosen);
+
+    // The fast codec is the fallback when the high-ratio one can't shrink the data
+    if (chosen != CODEC_NONE && !Codec::Pack(input->GetData(), input->GetSize(), packed, m_blockSize, GetDictionary(), chosen))
+    {
+        chosen = (chosen == CODEC_LZH) ? CODEC_LZ : CODEC_NONE;
+        decision = PACK_FAST;
+        if (chosen == CODEC_NONE || !Codec::Pack(input->GetData(), input->GetSize(), packed, m_blockSize, GetDictionary(), chosen))
+        {
+            chosen = CODEC_NONE;
+            decision = PACK_STORED_NO_GAIN;
+        }
+    }
+
+    m_packSummary.counts[decision]++;
+    m_packSummary.rawBytes += fileData.GetSize();
+
+    if (chosen == CODEC_NONE)
+    {
+        filter = FilterSpec();
+        m_packSummary.storedBytes += fileData.GetSize();
+        return fileData;
+    }
+
+    m_packSummary.storedBytes += packed.GetSize();
+    flags |= FILE_COMPRESSED;
+    if (Filter::IsValid(filter))
+        flags |= FILE_FILTERED;
+    codec = chosen;
+    return packed;
+}
+
+bool Archive::UnpackFileData(const FileHeader& header, Blob& data) const
+{
+    if (header.flags & FILE_SOLID)
+    {
+        SolidEntry entry;
+        if (data.GetSize() != sizeof(SolidEntry))
+            return false;
+        memcpy(&entry, data.GetData(), sizeof(SolidEntry));
+
+        SharedBlob group;
+        if (!LoadSolidGroup(entry.groupOffset, group) || entry.offset > group.GetSize() || entry.size > group.GetSize() - entry.offset)
+            return false;
+
+        if (!data.Resize(entry.size))
+            return false;
+        memcpy(data.GetData(), group.GetData() + entry.offset, entry.size);
+        return true;
+    }
+
+    if (header.flags & FILE_CHUNKED)
+    {
+        std::vector<ChunkRef> chunks;
+        if (!ReadChunkList(header, data, chunks))
+            return false;
+
+        UINT64 originalSize = 0;
+        for (const auto& chunk : chunks)
+            originalSize += chunk.size;
+
+        Blob assembled;
+        if (!assembled.Resize(originalSize))
+            return false;
+
+        LockedStream archive(m_stream, m_readMutex);
+        Blob stored;
+        SharedExtentHeader extent;
+        UINT64 position = 0;
+        for (const auto& chunk : chunks)
+        {
+            if (!ReadSharedExtent(archive, chunk.extentOffset, extent, &stored) ||
+                !DecodeChunk(chunk, stored, assembled.GetData() + position))
+                return false;
+            position += chunk.size;
+        }
+
+        data = std::move(assembled);
+        return true;
+    }
+
+    if (header.flags & FILE_SHARED)
+    {
+        SharedEntry entry;
+        if (data.GetSize() != sizeof(SharedEntry))
+            return false;
+        memcpy(&entry, data.GetData(), sizeof(SharedEntry));
+
+        LockedStream archive(m_stream, m_readMutex);
+        SharedExtentHeader extent;
+        if (!ReadSharedExtent(archive, entry.extentOffset, extent, &data))
+            return false;
+    }
+
+    if (!(header.flags & FILE_COMPRESSED))
+        return true;
+
+    Blob decoded;
+    if (!DecodeFileData(header, data, decoded))
+        return false;
+
+    data = std::move(decoded);
+    return true;
+}
+
+bool Archive::DecodeFileData(const FileHeader& header, const Blob& stored, Blob& outData) const
+{
+    if (!Codec::IsSupported(header.codec))
+        return false;
+
+    if (!Codec::Unpack(stored.GetData(), stored.GetSize(), outData, GetDictionary(), header.codec))
+        return false;
+
+    if (!(header.flags & FILE_FILTERED))
+        return true;
+
+    FilterSpec filter = { header.filter, header.filterWidth };
+    if (!Filter::IsValid(filter))
+        return false;
+
+    // Blocked payloads were filtered block by block
+    Stream::Header streamHeader;
+    memcpy(&streamHeader, stored.GetData(), sizeof(Stream::Header));
+
+    UINT64 segmentSize = 0;
+    if (streamHeader.flags & Stream::BLOCKED)
+    {
+        BlockTableHeader table;
+        memcpy(&table, stored.GetData() + sizeof(Stream::Header), sizeof(BlockTableHeader));
+        segmentSize = table.blockSize;
+    }
+
+    Blob reverted;
+    if (!reverted.Resize(outData.GetSize()))
+        return false;
+    Filter::Revert(filter, outData.GetData(), reverted.GetData(), outData.GetSize(), segmentSize);
+
+    outData = std::move(reverted);
+    return true;
+}
+
 bool Archive::WriteFileWithHeader(const std::string& filePath, UINT64& outID, UINT64& outSize)
 {
     File inputFile;
@@ -390,22 +990,10 @@ bool Archive::WriteFileWithHeader(const std::string& filePath, UINT64& outID, UI
     inputFile.Seek(0, SEEK_SET);
 
     Blob fileData;
-    fileData.Reserve(fileSize);
-
-    UINT8 buffer[MAX_BUFFER_SIZE];
-    UINT64 remaining = fileSize;
-
-    while (remaining > 0)
-    {
-        UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-        UINT64 bytesRead = inputFile.Read(buffer, chunkSize, 1);
-        if (bytesRead == 0)
-            break;
-        fileData.Append(buffer, bytesRead);
-        remaining -= bytesRead;
-    }
-
+    bool complete = ReadChunked(inputFile, fileData, fileSize);
     inputFile.Close();
+    if (!complete)
+        return false;
 
     UINT32 checksum = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
 
@@ -434,10 +1022,11 @@ bool Archive::Create(const std::vector<std::string>& filePaths)
         m_stream = file;
         m_ownsStream = true;
     }
-    else if (!static_cast<File*>(m_stream)->OpenWrite("temp_archive.asset"))
+    else if (!RestartStream("temp_archive.asset"))
     {
         return false;
     }
+    m_mode = Mode::WRITE;
 
     m_header.magic[0] = 'A';
     m_header.magic[1] = 'S';
@@ -454,8 +1043,44 @@ bool Archive::Create(const std::vector<std::string>& filePaths)
 
     m_header.dataOffset = m_stream->Seek(0, SEEK_CUR);
 
-    for (const auto& filePath : filePaths)
+    m_packSummary = PackSummary();
+    m_chunkIndex.clear();
+    m_chunkIndexed = true;
+    m_dictionary.data.Resize(0);
+    m_dictionary.table.clear();
+    if (m_compressionEnabled && m_dictionaryEnabled && TrainDictionary(filePaths))
+    {
+        if (!WriteDictionary(*m_stream))
+            return false;
+    }
+
+    std::vector<std::vector<std::string>> units = PlanSolidGroups(filePaths);
+
+    // Solid group members are not shared: their bytes already live in one stream
+    std::vector<DuplicateSet> duplicateSets;
+    std::unordered_map<std::string, size_t> duplicates;
+    if (m_dedupEnabled)
+    {
+        std::vector<std::string> singles;
+        for (const auto& unit : units)
+        {
+            std::error_code error;
+            bool chunked = m_chunkingEnabled && std::filesystem::file_size(unit.front(), error) >= CHUNKED_FILE_MIN && !error;
+            if (unit.size() == 1 && !chunked)
+                singles.push_back(unit.front());
+        }
+        duplicates = FindDuplicateFiles(singles, duplicateSets);
+    }
+
+    for (const auto& unit : units)
     {
+        if (unit.size() > 1)
+        {
+            WriteSolidGroup(unit);
+            continue;
+        }
+
+        const std::string& filePath = unit.front();
         UINT64 fileHeaderOffset = m_stream->Seek(0, SEEK_CUR);
         std::string basename = GetBasename(filePath);
         std::string uniqueName = GetUniqueFilename(basename);
@@ -469,36 +1094,90 @@ bool Archive::Create(const std::vector<std::string>& filePaths)
         inputFile.Seek(0, SEEK_SET);
 
         Blob fileData;
-        fileData.Reserve(fileSize);
-
-        UINT8 buffer[MAX_BUFFER_SIZE];
-        UINT64 remaining = fileSize;
-
-        while (remaining > 0)
-        {
-            UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-            UINT64 bytesRead = inputFile.Read(buffer, chunkSize, 1);
-            if (bytesRead == 0)
-                break;
-            fileData.Append(buffer, bytesRead);
-            remaining -= bytesRead;
-        }
-
+        bool complete = ReadChunked(inputFile, fileData, fileSize);
         inputFile.Close();
+        if (!complete)
+            continue;
 
         UINT32 checksum = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
         UINT64 id = GenerateFileID(uniqueName);
 
-        if (!WriteFileHeader(uniqueName, id, fileData.GetSize(), FILE_ACTIVE, checksum))
-            continue;
+        if (m_chunkingEnabled && fileData.GetSize() >= CHUNKED_FILE_MIN)
+        {
+            if (!WriteChunkedEntry(uniqueName, id, fileData, checksum, fileHeaderOffset))
+                continue;
 
-        UINT64 dataWritten = m_stream->Write(fileData.GetData(), fileData.GetSize(), 1);
-        if (dataWritten != fileData.GetSize())
+            m_nameToOffset[uniqueName] = fileHeaderOffset;
+            m_idToOffset[id] = fileHeaderOffset;
             continue;
+        }
 
-        m_nameToOffset[uniqueName] = fileHeaderOffset;
-        m_idToOffset[id] = fileHeaderOffset;
-    }
+        UINT8 flags = FILE_ACTIVE;
+        UINT8 codec;
+        FilterSpec filter = FindFilter(filePath);
+
+        auto duplicate = duplicates.find(filePath);
+        if (duplicate != duplicates.end() && duplicateSets[duplicate->second].checksum == checksum)
+        {
+            // The first member writes the extent, every member gets a SharedEntry. Members that
+            // can't be read or changed since FindDuplicateFiles took the plain path: the refCount
+            // is patched once the entries are written
+            DuplicateSet& set = duplicateSets[duplicate->second];
+            if (set.extentOffset == 0)
+            {
+                Blob packed;
+                const Blob& stored = PackFileData(uniqueName, fileData, packed, flags, codec, filter);
+
+                if (!WriteSharedExtent(stored.GetData(), stored.GetSize(), fileData.GetSize(), set.hash, 0))
+                    continue;
+
+                set.extentOffset = fileHeaderOffset;
+                set.content.flags = flags | FILE_SHARED;
+                set.content.checksum = checksum;
+                set.content.codec = codec;
+                set.content.filter = filter.type;
+                set.content.filterWidth = filter.width;
+                fileHeaderOffset = m_stream->Seek(0, SEEK_CUR);
+            }
+            else
+            {
+                m_packSummary.counts[PACK_DEDUPLICATED]++;
+                m_packSummary.rawBytes += fileData.GetSize();
+            }
+
+            if (!WriteSharedEntry(uniqueName, id, set.content, set.extentOffset))
+                continue;
+
+            set.refCount++;
+            m_nameToOffset[uniqueName] = fileHeaderOffset;
+            m_idToOffset[id] = fileHeaderOffset;
+            continue;
+        }
+
+        Blob packed;
+        const Blob& stored = PackFileData(uniqueName, fileData, packed, flags, codec, filter);
+
+        if (!WriteFileHeader(uniqueName, id, stored.GetSize(), flags, checksum, codec, filter))
+            continue;
+
+        UINT64 dataWritten = m_stream->Write(stored.GetData(), stored.GetSize(), 1);
+        if (dataWritten != stored.GetSize())
+            continue;
+
+        m_nameToOffset[uniqueName] = fileHeaderOffset;
+        m_idToOffset[id] = fileHeaderOffset;
+    }
+
+    for (const DuplicateSet& set : duplicateSets)
+    {
+        SharedExtentHeader extent;
+        if (set.extentOffset == 0 || !ReadSharedExtent(*m_stream, set.extentOffset, extent))
+            continue;
+
+        extent.refCount = set.refCount;
+        m_stream->Seek(set.extentOffset, SEEK_SET);
+        m_stream->Write((const UINT8*)&extent, sizeof(SharedExtentHeader), 1);
+    }
 
     m_stream->Seek(sizeof(ArchiveHeader), SEEK_SET);
     WriteMaps();
@@ -515,10 +1194,12 @@ bool Archive::List() const
     std::cout << "==========================================\n";
     std::cout << "Archive: " << m_archivePath << "\n";
     std::cout << "Files: " << m_header.fileCount << " active\n";
+    if (GetDictionary() != nullptr)
+        std::cout << "Dictionary: " << m_dictionary.data.GetSize() << " bytes\n";
     std::cout << "==========================================\n";
 
     UINT32 index = 1;
-    for (const auto& [name, offset] : m_nameToOffset)
+    for (const auto& [name, offset] : GetEntriesByOffset())
     {
         FileHeader header;
         std::string filename;
@@ -528,6 +1209,11 @@ bool Archive::List() const
         std::cout << "[" << index << "] " << filename
             << " (ID: " << header.id
             << ", " << header.dataSize << " bytes"
+            << ((header.flags & FILE_COMPRESSED) ? std::string(", compressed (") + Codec::GetName(header.codec) + ")" : "")
+            << ((header.flags & FILE_FILTERED) ? ", " + Filter::GetName({ header.filter, header.filterWidth }) : "")
+            << ((header.flags & FILE_SOLID) ? ", solid" : "")
+            << ((header.flags & FILE_SHARED) ? ", shared" : "")
+            << ((header.flags & FILE_CHUNKED) ? ", " + std::to_string(header.dataSize / sizeof(ChunkRef)) + " chunks" : "")
             << ", CRC32: 0x" << std::hex << std::uppercase << header.checksum << std::dec << ")\n";
         index++;
     }
@@ -537,10 +1223,56 @@ bool Archive::List() const
     return true;
 }
 
-bool Archive::Extract(UINT64 fileID, const std::string& outputPath) const
+bool Archive::ReadFile(UINT64 fileID, Blob& outData) const
 {
-    auto it = m_idToOffset.find(fileID);
-    if (it == m_idToOffset.end())
+    if (ReadCachedEntry(fileID, 0, ~0ull, outData))
+        return true;
+
+    if (!LoadEntry(fileID, outData))
+        return false;
+
+    if (m_entryCacheBudget > 0)
+    {
+        {
+            std::lock_guard<std::mutex> cacheLock(m_entryCacheMutex);
+            m_entryCacheStats.misses++;
+        }
+        if (outData.GetSize() <= m_entryCacheBudget)
+            CacheEntry(fileID, SharedBlob::Copy(outData.GetData(), outData.GetSize()));
+    }
+
+    return true;
+}
+
+bool Archive::ReadFile(UINT64 fileID, SharedBlob& outData) const
+{
+    if (FindCachedEntry(fileID, outData))
+        return true;
+
+    Blob data;
+    if (!LoadEntry(fileID, data))
+        return false;
+
+    // Shared with the entry cache, which outlives the caller's allocator scope
+    if (m_entryCacheBudget > 0)
+        data.Reserve(data.GetSize(), Allocator::GetHeap());
+    outData = SharedBlob(std::move(data));
+    if (m_entryCacheBudget > 0)
+    {
+        {
+            std::lock_guard<std::mutex> cacheLock(m_entryCacheMutex);
+            m_entryCacheStats.misses++;
+        }
+        CacheEntry(fileID, outData);
+    }
+
+    return true;
+}
+
+bool Archive::LoadEntry(UINT64 fileID, Blob& outData) const
+{
+    UINT64 entryOffset;
+    if (!FindEntryByID(fileID, entryOffset))
     {
         std::cerr << "[ERROR] File ID " << fileID << " not found in archive\n";
         return false;
@@ -548,7 +1280,7 @@ bool Archive::Extract(UINT64 fileID, const std::string& outputPath) const
 
     FileHeader header;
     std::string filename;
-    if (!ReadFileHeader(it->second, header, filename))
+    if (!ReadFileHeader(entryOffset, header, filename))
     {
         std::cerr << "[ERROR] Failed to read file header for ID " << fileID << "\n";
         return false;
@@ -560,46 +1292,31 @@ bool Archive::Extract(UINT64 fileID, const std::string& outputPath) const
         return false;
     }
 
-    UINT64 blobOffset = it->second + sizeof(FileHeader);
-    m_stream->Seek(blobOffset, SEEK_SET);
-
     bool isEncrypted = (header.flags & FILE_ENCRYPTED) != 0;
-    if (isEncrypted)
+    if (isEncrypted && m_encryptionKey.empty())
     {
-        if (m_encryptionKey.empty())
-        {
-            std::cerr << "[ERROR] File is encrypted but no decryption key provided\n";
-            return false;
-        }
-
-        File* fileStream = static_cast<File*>(m_stream);
-        fileStream->EnableEncryption(true);
-        fileStream->SetKey(m_encryptionKey);
+        std::cerr << "[ERROR] File is encrypted but no decryption key provided\n";
+        return false;
     }
 
-    Blob fileData;
-    fileData.Reserve(header.dataSize);
-
-    UINT8 buffer[MAX_BUFFER_SIZE];
-    UINT64 remaining = header.dataSize;
+    // Only the reads take the stream's lock; unpacking and the CRC32 run alongside other readers
+    LockedStream archive(m_stream, m_readMutex);
+    archive.Seek(entryOffset + sizeof(FileHeader), SEEK_SET);
+    CipherStream cipher(&archive, isEncrypted ? m_encryptionKey : std::string());
 
-    while (remaining > 0)
+    if (!ReadChunked(cipher, outData, header.dataSize))
     {
-        UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-        UINT64 bytesRead = m_stream->Read(buffer, chunkSize, 1);
-        if (bytesRead == 0)
-            break;
-        fileData.Append(buffer, bytesRead);
-        remaining -= bytesRead;
+        std::cerr << "[ERROR] Entry of file ID " << fileID << " runs past the end of the archive\n";
+        return false;
     }
 
-    if (isEncrypted)
+    if (!UnpackFileData(header, outData))
     {
-        File* fileStream = static_cast<File*>(m_stream);
-        fileStream->EnableEncryption(false);
+        std::cerr << "[ERROR] Failed to decompress file ID " << fileID << "\n";
+        return false;
     }
 
-    UINT32 calculatedCRC = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
+    UINT32 calculatedCRC = SafeFormat::CalculateCRC32(outData.GetData(), outData.GetSize());
     if (calculatedCRC != header.checksum)
     {
         std::cerr << "[ERROR] CRC32 mismatch for file ID " << fileID << " (expected 0x"
@@ -607,6 +1324,45 @@ bool Archive::Extract(UINT64 fileID, const std::string& outputPath) const
         return false;
     }
 
+    return true;
+}
+
+bool Archive::ReadFileByName(const std::string& filename, Blob& outData) const
+{
+    UINT64 entryOffset;
+    if (!FindEntryByName(filename, entryOffset))
+        return false;
+
+    FileHeader header;
+    std::string name;
+    if (!ReadFileHeader(entryOffset, header, name))
+        return false;
+
+    return ReadFile(header.id, outData);
+}
+
+bool Archive::ReadFileByName(const std::string& filename, SharedBlob& outData) const
+{
+    UINT64 entryOffset;
+    if (!FindEntryByName(filename, entryOffset))
+        return false;
+
+    FileHeader header;
+    std::string name;
+    if (!ReadFileHeader(entryOffset, header, name))
+        return false;
+
+    return ReadFile(header.id, outData);
+}
+
+bool Archive::Extract(UINT64 fileID, const std::string& outputPath) const
+{
+    if (!Contains(fileID))
+    {
+        std::cerr << "[ERROR] File ID " << fileID << " not found in archive\n";
+        return false;
+    }
+
     File outputFile;
     if (!outputFile.OpenWrite(outputPath))
     {
@@ -614,31 +1370,363 @@ bool Archive::Extract(UINT64 fileID, const std::string& outputPath) const
         return false;
     }
 
-    UINT64 written = outputFile.Write(fileData.GetData(), fileData.GetSize(), 1);
+    bool extracted = ExtractTo(fileID, outputFile);
     outputFile.Close();
 
-    return (written == fileData.GetSize());
+    // No partial or unchecked output is left behind
+    if (!extracted)
+        remove(outputPath.c_str());
+    return extracted;
+}
+
+bool Archive::ExtractTo(UINT64 fileID, Stream& output) const
+{
+    SharedBlob cached;
+    if (FindCachedEntry(fileID, cached))
+        return output.Write(cached.GetData(), cached.GetSize(), 1) == cached.GetSize();
+
+    UINT64 entryOffset;
+    FileHeader header;
+    std::string filename;
+    if (!FindEntryByID(fileID, entryOffset) || !ReadFileHeader(entryOffset, header, filename) ||
+        !(header.flags & FILE_ACTIVE))
+    {
+        std::cerr << "[ERROR] File ID " << fileID << " not found in archive\n";
+        return false;
+    }
+
+    // Entries pointing elsewhere (solid group, extents, chunks) or filtered after decoding
+    if (header.flags & (FILE_SOLID | FILE_SHARED | FILE_CHUNKED | FILE_FILTERED))
+    {
+        Blob data;
+        if (!LoadEntry(fileID, data))
+            return false;
+        return output.Write(data.GetData(), data.GetSize(), 1) == data.GetSize();
+    }
+
+    bool isEncrypted = (header.flags & FILE_ENCRYPTED) != 0;
+    if (isEncrypted && m_encryptionKey.empty())
+    {
+        std::cerr << "[ERROR] File is encrypted but no decryption key provided\n";
+        return false;
+    }
+
+    // The stream is locked for each read only: decoding and the output writes run unlocked
+    LockedStream archive(m_stream, m_readMutex);
+    archive.Seek(entryOffset + sizeof(FileHeader), SEEK_SET);
+    std::string key = isEncrypted ? m_encryptionKey : std::string();
+    UINT32 checksum = 0;
+
+    if (header.flags & FILE_COMPRESSED)
+    {
+        // stored bytes -> cipher -> codec -> CRC32 -> output
+        CipherStream cipher(&archive, key);
+        CodecStream codec(&cipher, header.codec, GetDictionary());
+        CrcStream crc(&codec);
+
+        IoBuffer buffer;
+        UINT64 bytesRead = 0;
+        while ((bytesRead = crc.Read(buffer.GetData(), buffer.GetSize(), 1)) > 0)
+        {
+            if (output.Write(buffer.GetData(), bytesRead, 1) != bytesRead)
+                return false;
+        }
+
+        if (codec.IsCorrupt())
+        {
+            std::cerr << "[ERROR] Failed to decompress file ID " << fileID << "\n";
+            return false;
+        }
+        checksum = crc.GetCRC32();
+    }
+    else
+    {
+        // Raw bytes: one fused loop, no virtual call per stage
+        Pipeline pipeline{ StreamSource(archive), XorStage(key), Crc32Stage(), StreamSink(output) };
+        if (pipeline.Run(header.dataSize) != header.dataSize)
+        {
+            std::cerr << "[ERROR] Failed to read file ID " << fileID << "\n";
+            return false;
+        }
+        checksum = pipeline.GetStage<1>().GetCRC32();
+    }
+
+    if (checksum != header.checksum)
+    {
+        std::cerr << "[ERROR] CRC32 mismatch for file ID " << fileID << " (expected 0x"
+                  << std::hex << header.checksum << ", got 0x" << checksum << std::dec << ")\n";
+        return false;
+    }
+
+    return true;
 }
 
 bool Archive::ExtractByName(const std::string& filename, const std::string& outputPath) const
 {
-    auto it = m_nameToOffset.find(filename);
-    if (it == m_nameToOffset.end())
+    UINT64 entryOffset;
+    if (!FindEntryByName(filename, entryOffset))
         return false;
 
     FileHeader header;
     std::string name;
-    if (!ReadFileHeader(it->second, header, name))
+    if (!ReadFileHeader(entryOffset, header, name))
         return false;
 
     return Extract(header.id, outputPath);
 }
 
+bool Archive::ReadStoredRange(UINT64 dataStart, const FileHeader& header, UINT64 offset, UINT64 size, Blob& outData) const
+{
+    if (offset + size > header.dataSize)
+        return false;
+
+    bool isEncrypted = (header.flags & FILE_ENCRYPTED) != 0;
+    if (isEncrypted && m_encryptionKey.empty())
+    {
+        std::cerr << "[ERROR] File is encrypted but no decryption key provided\n";
+        return false;
+    }
+
+    // The keystream follows the position in the stored data, any offset reads directly
+    LockedStream archive(m_stream, m_readMutex);
+    archive.Seek(dataStart, SEEK_SET);
+    CipherStream cipher(&archive, isEncrypted ? m_encryptionKey : std::string());
+    cipher.Seek(dataStart + offset, SEEK_SET);
+
+    if (!outData.Resize(size))
+        return false;
+    return cipher.Read(outData.GetData(), size, 1) == size;
+}
+
+bool Archive::ReadRange(UINT64 fileID, UINT64 offset, UINT64 size, Blob& outData) const
+{
+    if (ReadCachedEntry(fileID, offset, size, outData))
+        return true;
+
+    UINT64 entryOffset;
+    if (!FindEntryByID(fileID, entryOffset))
+        return false;
+
+    FileHeader header;
+    std::string filename;
+    if (!ReadFileHeader(entryOffset, header, filename))
+        return false;
+
+    if (!(header.flags & FILE_ACTIVE))
+        return false;
+
+    outData.Clear();
+
+    // Shared entries read their stored bytes from the extent
+    LockedStream archive(m_stream, m_readMutex);
+    UINT64 dataStart = entryOffset + sizeof(FileHeader);
+    if (header.flags & FILE_SHARED)
+    {
+        SharedEntry entry;
+        SharedExtentHeader extent;
+        if (!ReadSharedEntry(entryOffset, header, entry) || !ReadSharedExtent(archive, entry.extentOffset, extent))
+            return false;
+
+        dataStart = entry.extentOffset + sizeof(SharedExtentHeader);
+        header.dataSize = extent.dataSize;
+    }
+
+    // Chunked entries: only the chunks covering the range are read and decoded
+    if (header.flags & FILE_CHUNKED)
+    {
+        Blob stored;
+        std::vector<ChunkRef> chunks;
+        if (!ReadStoredRange(dataStart, header, 0, header.dataSize, stored) || !ReadChunkList(header, stored, chunks))
+            return false;
+
+        UINT64 originalSize = 0;
+        for (const auto& chunk : chunks)
+            originalSize += chunk.size;
+
+        if (offset > originalSize)
+            return false;
+        if (size > originalSize - offset)
+            size = originalSize - offset;
+        if (size == 0)
+            return true;
+
+        outData.Reserve(size);
+
+        Blob decoded;
+        SharedExtentHeader extent;
+        UINT64 chunkStart = 0;
+        for (const auto& chunk : chunks)
+        {
+            UINT64 chunkEnd = chunkStart + chunk.size;
+            if (chunkEnd > offset && chunkStart < offset + size)
+            {
+                if (!decoded.Resize(chunk.size) ||
+                    !ReadSharedExtent(archive, chunk.extentOffset, extent, &stored) ||
+                    !DecodeChunk(chunk, stored, decoded.GetData()))
+                    return false;
+
+                UINT64 copyStart = (offset > chunkStart) ? offset - chunkStart : 0;
+                UINT64 copyEnd = (offset + size < chunkEnd) ? offset + size - chunkStart : chunk.size;
+                outData.Append(decoded.GetData() + copyStart, copyEnd - copyStart);
+            }
+            chunkStart = chunkEnd;
+        }
+        return true;
+    }
+
+    // Solid entries are small: slice the whole entry out of its (cached) group
+    if (header.flags & FILE_SOLID)
+    {
+        Blob entryData;
+        if (!ReadStoredRange(dataStart, header, 0, header.dataSize, entryData) || !UnpackFileData(header, entryData))
+            return false;
+
+        if (offset > entryData.GetSize())
+            return false;
+        if (size > entryData.GetSize() - offset)
+            size = entryData.GetSize() - offset;
+
+        if (size > 0)
+        {
+            outData.Reserve(size);
+            outData.Append(entryData.GetData() + offset, size);
+        }
+        return true;
+    }
+
+    if (!(header.flags & FILE_COMPRESSED))
+    {
+        if (offset > header.dataSize)
+            return false;
+        if (size > header.dataSize - offset)
+            size = header.dataSize - offset;
+        return ReadStoredRange(dataStart, header, offset, size, outData);
+    }
+
+    if (!Codec::IsSupported(header.codec))
+        return false;
+
+    Blob stored;
+    if (!ReadStoredRange(dataStart, header, 0, sizeof(Stream::Header), stored))
+        return false;
+
+    Stream::Header streamHeader;
+    memcpy(&streamHeader, stored.GetData(), sizeof(Stream::Header));
+
+    // More than MAX_RATIO x the stored size is forged (divided, a forged dataSize can't wrap the product)
+    if (streamHeader.originalSize / Codec::MAX_RATIO > header.dataSize)
+        return false;
+
+    if (offset > streamHeader.originalSize)
+        return false;
+    if (size > streamHeader.originalSize - offset)
+        size = streamHeader.originalSize - offset;
+    if (size == 0)
+        return true;
+
+    outData.Reserve(size);
+
+    // Single stream: nothing to seek into, decode everything
+    if (!(streamHeader.flags & Stream::BLOCKED))
+    {
+        Blob decoded;
+        if (!ReadStoredRange(dataStart, header, 0, header.dataSize, stored) ||
+            !DecodeFileData(header, stored, decoded))
+            return false;
+
+        outData.Append(decoded.GetData() + offset, size);
+        return true;
+    }
+
+    if (!ReadStoredRange(dataStart, header, sizeof(Stream::Header), sizeof(BlockTableHeader), stored))
+        return false;
+
+    BlockTableHeader table;
+    memcpy(&table, stored.GetData(), sizeof(BlockTableHeader));
+    // Pack only blocks entries larger than a block, so a block never outgrows the entry
+    if (table.blockSize == 0 || table.blockSize > streamHeader.originalSize ||
+        (streamHeader.originalSize + table.blockSize - 1) / table.blockSize != table.blockCount)
+        return false;
+
+    UINT64 firstBlock = offset / table.blockSize;
+    UINT64 lastBlock = (offset + size - 1) / table.blockSize;
+    if (lastBlock >= table.blockCount)
+        return false;
+
+    UINT64 offsetsStart = sizeof(Stream::Header) + sizeof(BlockTableHeader);
+    UINT64 blocksStart = sizeof(Stream::Header) + Codec::GetBlockTableSize(table.blockCount);
+
+    std::vector<UINT64> offsets(lastBlock - firstBlock + 2);
+    if (!ReadStoredRange(dataStart, header, offsetsStart + firstBlock * sizeof(UINT64), offsets.size() * sizeof(UINT64), stored))
+        return false;
+    memcpy(offsets.data(), stored.GetData(), offsets.size() * sizeof(UINT64));
+
+    if (offsets.front() > offsets.back())
+        return false;
+
+    if (!ReadStoredRange(dataStart, header, blocksStart + offsets.front(), offsets.back() - offsets.front(), stored))
+        return false;
+
+    FilterSpec filter = { header.filter, header.filterWidth };
+    if ((header.flags & FILE_FILTERED) && !Filter::IsValid(filter))
+        return false;
+
+    Blob block;
+    Blob reverted;
+    if (!block.Resize(table.blockSize) || ((header.flags & FILE_FILTERED) && !reverted.Resize(table.blockSize)))
+        return false;
+
+    for (UINT64 i = firstBlock; i <= lastBlock; i++)
+    {
+        UINT64 begin = offsets[i - firstBlock] - offsets.front();
+        UINT64 end = offsets[i - firstBlock + 1] - offsets.front();
+        if (begin > end || end > stored.GetSize())
+            return false;
+
+        UINT64 rawOffset = i * table.blockSize;
+        UINT64 rawSize = (streamHeader.originalSize - rawOffset < table.blockSize) ? streamHeader.originalSize - rawOffset : table.blockSize;
+
+        if (!Codec::DecodeBlock(stored.GetData() + begin, end - begin, block.GetData(), rawSize, header.codec))
+            return false;
+
+        const Blob* raw = &block;
+        if (header.flags & FILE_FILTERED)
+        {
+            Filter::Revert(filter, block.GetData(), reverted.GetData(), rawSize);
+            raw = &reverted;
+        }
+
+        UINT64 copyStart = (offset > rawOffset) ? offset - rawOffset : 0;
+        UINT64 copyEnd = (offset + size < rawOffset + rawSize) ? offset + size - rawOffset : rawSize;
+        outData.Append(raw->GetData() + copyStart, copyEnd - copyStart);
+    }
+
+    return true;
+}
+
+bool Archive::ReadRangeByName(const std::string& filename, UINT64 offset, UINT64 size, Blob& outData) const
+{
+    UINT64 entryOffset;
+    if (!FindEntryByName(filename, entryOffset))
+        return false;
+
+    FileHeader header;
+    std::string name;
+    if (!ReadFileHeader(entryOffset, header, name))
+        return false;
+
+    return ReadRange(header.id, offset, size, outData);
+}
+
 bool Archive::ExtractAll(const std::string& outputDir) const
 {
+    // The per-entry buffers (and the decoders' scratch) come back from the pool
+    // instead of one heap round trip per file
+    AllocatorScope pooled(PoolAllocator::Get());
+
     _mkdir(outputDir.c_str());
 
-    for (const auto& [name, offset] : m_nameToOffset)
+    for (const auto& [name, offset] : GetEntriesByOffset())
     {
         FileHeader header;
         std::string filename;
@@ -650,20 +1738,36 @@ bool Archive::ExtractAll(const std::string& outputDir) const
         UINT64 blobOffset = offset + sizeof(FileHeader);
         m_stream->Seek(blobOffset, SEEK_SET);
 
-        Blob fileData;
-        fileData.Reserve(header.dataSize);
+        // Raw entries go straight from the archive to the output file
+        if (IsRawEntry(header))
+        {
+            File outputFile;
+            if (!outputFile.OpenWrite(outputPath))
+                continue;
+
+            Pipeline pipeline{ StreamSource(*m_stream), Crc32Stage(), StreamSink(outputFile) };
+            bool copied = pipeline.Run(header.dataSize) == header.dataSize;
+            outputFile.Close();
 
-        UINT8 buffer[MAX_BUFFER_SIZE];
-        UINT64 remaining = header.dataSize;
+            if (!copied || pipeline.GetStage<0>().GetCRC32() != header.checksum)
+            {
+                remove(outputPath.c_str());
+                std::cout << "[SKIP] " << filename << (copied ? " (CRC32 mismatch)\n" : " (read failed)\n");
+            }
+            continue;
+        }
 
-        while (remaining > 0)
+        Blob fileData;
+        if (!ReadChunked(*m_stream, fileData, header.dataSize))
         {
-            UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-            UINT64 bytesRead = m_stream->Read(buffer, chunkSize, 1);
-            if (bytesRead == 0)
-                break;
-            fileData.Append(buffer, bytesRead);
-            remaining -= bytesRead;
+            std::cout << "[SKIP] " << filename << " (read failed)\n";
+            continue;
+        }
+
+        if (!UnpackFileData(header, fileData))
+        {
+            std::cout << "[SKIP] " << filename << " (decompression failed)\n";
+            continue;
         }
 
         UINT32 calculatedCRC = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
@@ -686,12 +1790,14 @@ bool Archive::ExtractAll(const std::string& outputDir) const
 
 bool Archive::Validate() const
 {
+    AllocatorScope pooled(PoolAllocator::Get());
+
     std::cout << "Validating archive: " << m_archivePath << "\n";
     std::cout << "Files to check: " << m_header.fileCount << "\n";
 
     bool allValid = true;
 
-    for (const auto& [name, offset] : m_nameToOffset)
+    for (const auto& [name, offset] : GetEntriesByOffset())
     {
         FileHeader header;
         std::string filename;
@@ -705,23 +1811,33 @@ bool Archive::Validate() const
         UINT64 blobOffset = offset + sizeof(FileHeader);
         m_stream->Seek(blobOffset, SEEK_SET);
 
-        Blob fileData;
-        fileData.Reserve(header.dataSize);
-
-        UINT8 buffer[MAX_BUFFER_SIZE];
-        UINT64 remaining = header.dataSize;
-
-        while (remaining > 0)
+        UINT32 calculatedCRC = 0;
+        if (IsRawEntry(header))
         {
-            UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-            UINT64 bytesRead = m_stream->Read(buffer, chunkSize, 1);
-            if (bytesRead == 0)
-                break;
-            fileData.Append(buffer, bytesRead);
-            remaining -= bytesRead;
+            // Checked as it streams by, never held in memory
+            Pipeline pipeline{ StreamSource(*m_stream), Crc32Stage() };
+            pipeline.Run(header.dataSize);
+            calculatedCRC = pipeline.GetStage<0>().GetCRC32();
+        }
+        else
+        {
+            Blob fileData;
+            if (!ReadChunked(*m_stream, fileData, header.dataSize))
+            {
+                std::cout << "[FAIL] " << filename << " (read failed)\n";
+                allValid = false;
+                continue;
+            }
+
+            if (!UnpackFileData(header, fileData))
+            {
+                std::cout << "[FAIL] " << filename << " (decompression failed)\n";
+                allValid = false;
+                continue;
+            }
+
+            calculatedCRC = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
         }
-
-        UINT32 calculatedCRC = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
 
         if (calculatedCRC == header.checksum)
         {
@@ -748,7 +1864,7 @@ bool Archive::AddFile(const std::string& filePath)
 
 bool Archive::AddFile(const std::string& filePath, UINT64& outGeneratedID)
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     m_stream->Seek(0, SEEK_END);
@@ -764,20 +1880,10 @@ bool Archive::AddFile(const std::string& filePath, UINT64& outGeneratedID)
 
     UINT64 sourceSize = sourceFile.GetSize();
     Blob fileData;
-    fileData.Reserve(sourceSize);
-    UINT8 buffer[MAX_BUFFER_SIZE];
-    UINT64 remaining = sourceSize;
-
-    while (remaining > 0)
-    {
-        UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-        UINT64 bytesRead = sourceFile.Read(buffer, chunkSize, 1);
-        if (bytesRead == 0)
-            break;
-        fileData.Append(buffer, bytesRead);
-        remaining -= bytesRead;
-    }
+    bool complete = ReadChunked(sourceFile, fileData, sourceSize);
     sourceFile.Close();
+    if (!complete)
+        return false;
 
     UINT32 checksum = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
 
@@ -785,24 +1891,41 @@ bool Archive::AddFile(const std::string& filePath, UINT64& outGeneratedID)
     if (m_encryptionEnabled)
         flags |= FILE_ENCRYPTED;
 
-    if (!WriteFileHeader(uniqueName, fileID, fileData.GetSize(), flags, checksum))
-        return false;
-
-    if (m_encryptionEnabled && !m_encryptionKey.empty())
+    FileHeader content;
+    UINT64 extentOffset;
+    bool chunked = m_chunkingEnabled && !m_encryptionEnabled && fileData.GetSize() >= CHUNKED_FILE_MIN;
+    if (chunked)
+    {
+        if (!WriteChunkedEntry(uniqueName, fileID, fileData, checksum, newFileOffset))
+            return false;
+    }
+    else if (m_dedupEnabled && !m_encryptionEnabled && ShareContent(fileData, checksum, content, extentOffset))
     {
-        File* fileStream = static_cast<File*>(m_stream);
-        fileStream->EnableEncryption(true);
-        fileStream->SetKey(m_encryptionKey);
+        // ShareContent may have appended an extent
+        m_stream->Seek(0, SEEK_END);
+        newFileOffset = m_stream->Seek(0, SEEK_CUR);
+
+        if (!WriteSharedEntry(uniqueName, fileID, content, extentOffset))
+            return false;
     }
+    else
+    {
+        m_stream->Seek(newFileOffset, SEEK_SET);
+        UINT8 codec;
+        FilterSpec filter = FindFilter(filePath);
+        Blob packed;
+        const Blob& stored = PackFileData(uniqueName, fileData, packed, flags, codec, filter);
 
-    m_stream->Write(fileData.GetData(), fileData.GetSize(), 1);
+        if (!WriteFileHeader(uniqueName, fileID, stored.GetSize(), flags, checksum, codec, filter))
+            return false;
 
-    if (m_encryptionEnabled)
-    {
-        File* fileStream = static_cast<File*>(m_stream);
-        fileStream->EnableEncryption(false);
+        CipherStream cipher(m_stream, m_encryptionEnabled ? m_encryptionKey : std::string());
+        cipher.Write(stored.GetData(), stored.GetSize(), 1);
     }
 
+    if (m_contentIndexed && !m_encryptionEnabled && !chunked)
+        m_contentIndex.emplace(checksum, newFileOffset);
+
     m_nameToOffset[uniqueName] = newFileOffset;
     m_idToOffset[fileID] = newFileOffset;
     m_header.fileCount++;
@@ -817,7 +1940,7 @@ bool Archive::AddFile(const std::string& filePath, UINT64& outGeneratedID)
 
 bool Archive::AddFile(const std::vector<std::string>& filePaths)
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     if (filePaths.empty())
@@ -838,27 +1961,46 @@ bool Archive::AddFile(const std::vector<std::string>& filePaths)
 
         UINT64 sourceSize = sourceFile.GetSize();
         Blob fileData;
-        fileData.Reserve(sourceSize);
-        UINT8 buffer[MAX_BUFFER_SIZE];
-        UINT64 remaining = sourceSize;
+        bool complete = ReadChunked(sourceFile, fileData, sourceSize);
+        sourceFile.Close();
+        if (!complete)
+            continue;
+
+        UINT32 checksum = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
 
-        while (remaining > 0)
+        UINT8 flags = FILE_ACTIVE;
+        FileHeader content;
+        UINT64 extentOffset;
+        bool chunked = m_chunkingEnabled && fileData.GetSize() >= CHUNKED_FILE_MIN;
+        if (chunked)
         {
-            UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-            UINT64 bytesRead = sourceFile.Read(buffer, chunkSize, 1);
-            if (bytesRead == 0)
-                break;
-            fileData.Append(buffer, bytesRead);
-            remaining -= bytesRead;
+            if (!WriteChunkedEntry(uniqueName, fileID, fileData, checksum, newFileOffset))
+                continue;
         }
-        sourceFile.Close();
+        else if (m_dedupEnabled && ShareContent(fileData, checksum, content, extentOffset))
+        {
+            m_stream->Seek(0, SEEK_END);
+            newFileOffset = m_stream->Seek(0, SEEK_CUR);
 
-        UINT32 checksum = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
+            if (!WriteSharedEntry(uniqueName, fileID, content, extentOffset))
+                continue;
+        }
+        else
+        {
+            m_stream->Seek(newFileOffset, SEEK_SET);
+            UINT8 codec;
+            FilterSpec filter = FindFilter(filePath);
+            Blob packed;
+            const Blob& stored = PackFileData(uniqueName, fileData, packed, flags, codec, filter);
 
-        if (!WriteFileHeader(uniqueName, fileID, fileData.GetSize(), FILE_ACTIVE, checksum))
-            continue;
+            if (!WriteFileHeader(uniqueName, fileID, stored.GetSize(), flags, checksum, codec, filter))
+                continue;
 
-        m_stream->Write(fileData.GetData(), fileData.GetSize(), 1);
+            m_stream->Write(stored.GetData(), stored.GetSize(), 1);
+        }
+
+        if (m_contentIndexed && !chunked)
+            m_contentIndex.emplace(checksum, newFileOffset);
 
         m_nameToOffset[uniqueName] = newFileOffset;
         m_idToOffset[fileID] = newFileOffset;
@@ -874,7 +2016,7 @@ bool Archive::AddFile(const std::vector<std::string>& filePaths)
 
 bool Archive::RemoveFile(UINT64 fileID)
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     auto it = m_idToOffset.find(fileID);
@@ -888,6 +2030,9 @@ bool Archive::RemoveFile(UINT64 fileID)
     if (!ReadFileHeader(offset, header, filename))
         return false;
 
+    if (header.flags & (FILE_SHARED | FILE_CHUNKED))
+        ReleaseSharedExtents(offset, header);
+
     header.flags &= ~FILE_ACTIVE;
     header.flags |= FILE_DELETED;
 
@@ -897,6 +2042,7 @@ bool Archive::RemoveFile(UINT64 fileID)
     m_nameToOffset.erase(filename);
     m_idToOffset.erase(fileID);
     m_header.fileCount--;
+    EvictEntry(fileID);
 
     m_stream->Seek(0, SEEK_SET);
     WriteArchiveHeader();
@@ -907,7 +2053,7 @@ bool Archive::RemoveFile(UINT64 fileID)
 
 bool Archive::RemoveFileByName(const std::string& filename)
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     auto it = m_nameToOffset.find(filename);
@@ -926,7 +2072,7 @@ bool Archive::RemoveFileByName(const std::string& filename)
 
 bool Archive::RemoveAll()
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     if (m_nameToOffset.empty())
@@ -944,6 +2090,9 @@ bool Archive::RemoveAll()
         if (!(header.flags & FILE_ACTIVE))
             continue;
 
+        if (header.flags & (FILE_SHARED | FILE_CHUNKED))
+            ReleaseSharedExtents(offset, header);
+
         header.flags &= ~FILE_ACTIVE;
         header.flags |= FILE_DELETED;
 
@@ -959,6 +2108,7 @@ bool Archive::RemoveAll()
     WriteMaps();
 
     std::cout << removedCount << " file(s) soft-deleted\n";
+    ClearEntryCache();
 
     if (!Compact())
     {
@@ -972,7 +2122,7 @@ bool Archive::RemoveAll()
 
 bool Archive::RenameFile(UINT64 fileID, const std::string& newName)
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     if (newName.length() >= 256)
@@ -1009,7 +2159,7 @@ bool Archive::RenameFile(UINT64 fileID, const std::string& newName)
 
 bool Archive::RenameFileByName(const std::string& oldName, const std::string& newName)
 {
-    if (m_stream == nullptr || static_cast<File*>(m_stream)->GetMode() != Mode::WRITE)
+    if (m_stream == nullptr || m_mode != Mode::WRITE)
         return false;
 
     auto it = m_nameToOffset.find(oldName);
@@ -1028,11 +2178,31 @@ bool Archive::RenameFileByName(const std::string& oldName, const std::string& ne
 
 bool Archive::Compact()
 {
-    m_stream->Close();
+    AllocatorScope pooled(PoolAllocator::Get());
 
-    File oldArchive;
-    if (!oldArchive.OpenRead(m_archivePath))
+    // Held in memory: the new image is built in a second Blob that then replaces the first
+    File* fileStream = dynamic_cast<File*>(m_stream);
+    Memory* memoryStream = dynamic_cast<Memory*>(m_stream);
+    if (fileStream == nullptr && (memoryStream == nullptr || memoryStream->IsReadOnly()))
+    {
+        std::cerr << "[ERROR] Compact needs an archive file or a writable Memory\n";
         return false;
+    }
+
+    File oldFile;
+    File newFile;
+    Blob newImage;
+    Memory newMemory(&newImage);
+    std::string tempPath = m_archivePath + ".tmp";
+
+    if (fileStream != nullptr)
+    {
+        m_stream->Close();
+        if (!oldFile.OpenRead(m_archivePath))
+            return false;
+    }
+    Stream& oldArchive = (fileStream != nullptr) ? static_cast<Stream&>(oldFile) : *m_stream;
+    oldArchive.Seek(0, SEEK_SET);
 
     ArchiveHeader oldHeader;
     UINT64 bytesRead = oldArchive.Read((UINT8*)&oldHeader, sizeof(ArchiveHeader), 1);
@@ -1042,13 +2212,12 @@ bool Archive::Compact()
         return false;
     }
 
-    std::string tempPath = m_archivePath + ".tmp";
-    File newArchive;
-    if (!newArchive.OpenWrite(tempPath))
+    if (fileStream != nullptr && !newFile.OpenWrite(tempPath))
     {
         oldArchive.Close();
         return false;
     }
+    Stream& newArchive = (fileStream != nullptr) ? static_cast<Stream&>(newFile) : newMemory;
 
     ArchiveHeader newHeader;
     newHeader.magic[0] = 'A';
@@ -1064,15 +2233,34 @@ bool Archive::Compact()
     UINT64 estimatedMapSize = m_header.fileCount * sizeof(MapEntry) * 2;
     newArchive.Seek(estimatedMapSize, SEEK_CUR);
 
+    UINT64 dataStart = newArchive.Seek(0, SEEK_CUR);
+    if (GetDictionary() != nullptr && !WriteDictionary(newArchive))
+    {
+        oldArchive.Close();
+        newArchive.Close();
+        if (fileStream != nullptr)
+            remove(tempPath.c_str());
+        return false;
+    }
+
     std::unordered_map<std::string, UINT64> newNameToOffset;
     std::unordered_map<UINT64, UINT64> newIdToOffset;
     int skippedCorrupted = 0;
     int skippedDeleted = 0;
 
-    for (const auto& [name, oldOffset] : m_nameToOffset)
-    {
-        UINT64 newOffset = newArchive.Seek(0, SEEK_CUR);
+    // Solid groups are copied once, ahead of their first surviving entry
+    std::unordered_map<UINT64, UINT64> movedGroups;
+    UINT64 currentGroup = 0;
+    bool currentGroupValid = false;
+    SolidGroupHeader groupHeader;
+    Blob groupStored;
+    Blob groupData;
+
+    // Shared extents too; their reference counts are recounted from the surviving entries
+    std::unordered_map<UINT64, SharedExtentData> movedExtents;
 
+    for (const auto& [name, oldOffset] : GetEntriesByOffset())
+    {
         FileHeader header;
         std::string filename;
         if (!ReadFileHeader(oldArchive, oldOffset, header, filename))
@@ -1089,22 +2277,153 @@ bool Archive::Compact()
 
         oldArchive.Seek(blobOffset, SEEK_SET);
 
+        // A raw entry is checked as it streams by, then copied the same way below; never held in memory
         Blob blob;
-        blob.Reserve(blobSize);
-        UINT8 buffer[MAX_BUFFER_SIZE];
-        UINT64 remaining = blobSize;
+        bool rawEntry = IsRawEntry(header);
+        UINT32 rawCRC = 0;
+        if (rawEntry)
+        {
+            Pipeline pipeline{ StreamSource(oldArchive), Crc32Stage() };
+            if (pipeline.Run(blobSize) != blobSize)
+            {
+                std::cout << "[SKIP] " << filename << " (read failed)\n";
+                skippedCorrupted++;
+                continue;
+            }
+            rawCRC = pipeline.GetStage<0>().GetCRC32();
+        }
+        else if (!ReadChunked(oldArchive, blob, blobSize))
+        {
+            std::cout << "[SKIP] " << filename << " (read failed)\n";
+            skippedCorrupted++;
+            continue;
+        }
 
-        while (remaining > 0)
+        const Blob* content = &blob;
+        Blob decoded;
+        SolidEntry solidEntry = {};
+        SharedEntry sharedEntry = {};
+        std::vector<ChunkRef> chunks;
+        auto extent = movedExtents.end();
+        if (header.flags & FILE_SOLID)
         {
-            UINT64 chunkSize = (remaining > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remaining;
-            UINT64 bytesRead = oldArchive.Read(buffer, chunkSize, 1);
-            if (bytesRead == 0)
-                break;
-            blob.Append(buffer, bytesRead);
-            remaining -= bytesRead;
+            if (blob.GetSize() == sizeof(SolidEntry))
+                memcpy(&solidEntry, blob.GetData(), sizeof(SolidEntry));
+
+            if (!currentGroupValid || solidEntry.groupOffset != currentGroup)
+            {
+                currentGroup = solidEntry.groupOffset;
+                currentGroupValid = blob.GetSize() == sizeof(SolidEntry) &&
+                    ReadSolidGroup(oldArchive, currentGroup, groupHeader, groupStored) &&
+                    DecodeSolidGroup(groupHeader, groupStored, groupData);
+            }
+
+            if (!currentGroupValid || solidEntry.offset > groupData.GetSize() ||
+                solidEntry.size > groupData.GetSize() - solidEntry.offset)
+            {
+                std::cout << "[SKIP] " << filename << " (solid group unreadable)\n";
+                skippedCorrupted++;
+                continue;
+            }
+
+            if (!decoded.Resize(solidEntry.size))
+            {
+                skippedCorrupted++;
+                continue;
+            }
+            memcpy(decoded.GetData(), groupData.GetData() + solidEntry.offset, solidEntry.size);
+            content = &decoded;
+        }
+        else if (header.flags & FILE_SHARED)
+        {
+            if (blob.GetSize() == sizeof(SharedEntry))
+                memcpy(&sharedEntry, blob.GetData(), sizeof(SharedEntry));
+
+            // The content is checked once, by the first surviving entry
+            extent = movedExtents.find(sharedEntry.extentOffset);
+            if (extent == movedExtents.end())
+            {
+                SharedExtentData data = {};
+                bool readable = blob.GetSize() == sizeof(SharedEntry) &&
+                    ReadSharedExtent(oldArchive, sharedEntry.extentOffset, data.header, &data.stored);
+                if (readable && (header.flags & FILE_COMPRESSED))
+                    readable = DecodeFileData(header, data.stored, decoded);
+
+                if (!readable)
+                {
+                    std::cout << "[SKIP] " << filename << " (shared data unreadable)\n";
+                    skippedCorrupted++;
+                    continue;
+                }
+
+                const Blob& original = (header.flags & FILE_COMPRESSED) ? decoded : data.stored;
+                data.checksum = SafeFormat::CalculateCRC32(original.GetData(), original.GetSize());
+                extent = movedExtents.emplace(sharedEntry.extentOffset, std::move(data)).first;
+            }
+        }
+        else if (header.flags & FILE_CHUNKED)
+        {
+            // The chunks are checked through the CRC32 of the whole entry
+            bool readable = ReadChunkList(header, blob, chunks);
+
+            UINT64 originalSize = 0;
+            for (const auto& chunk : chunks)
+                originalSize += chunk.size;
+            readable = readable && decoded.Resize(originalSize);
+
+            UINT64 position = 0;
+            Blob chunkStored;
+            for (const auto& chunk : chunks)
+            {
+                if (!readable)
+                    break;
+
+                auto data = movedExtents.find(chunk.extentOffset);
+                if (data == movedExtents.end())
+                {
+                    SharedExtentData newData = {};
+                    readable = ReadSharedExtent(oldArchive, chunk.extentOffset, newData.header, &newData.stored);
+                    if (!readable)
+                        break;
+                    data = movedExtents.emplace(chunk.extentOffset, std::move(newData)).first;
+                }
+
+                // Extents already copied have given their bytes back
+                const Blob* stored = &data->second.stored;
+                if (data->second.refCount > 0)
+                {
+                    SharedExtentHeader chunkHeader;
+                    readable = ReadSharedExtent(oldArchive, chunk.extentOffset, chunkHeader, &chunkStored);
+                    stored = &chunkStored;
+                }
+
+                readable = readable && DecodeChunk(chunk, *stored, decoded.GetData() + position);
+                if (!readable)
+                    break;
+                position += chunk.size;
+            }
+
+            if (!readable)
+            {
+                std::cout << "[SKIP] " << filename << " (chunk unreadable)\n";
+                skippedCorrupted++;
+                continue;
+            }
+            content = &decoded;
+        }
+        else if (header.flags & FILE_COMPRESSED)
+        {
+            if (!DecodeFileData(header, blob, decoded))
+            {
+                std::cout << "[SKIP] " << filename << " (decompression failed)\n";
+                skippedCorrupted++;
+                continue;
+            }
+            content = &decoded;
         }
 
-        UINT32 calculatedCRC = SafeFormat::CalculateCRC32(blob.GetData(), blob.GetSize());
+        UINT32 calculatedCRC = (extent != movedExtents.end()) ? extent->second.checksum :
+            rawEntry ? rawCRC : SafeFormat::CalculateCRC32(content->GetData(), content->GetSize());
         if (calculatedCRC != header.checksum)
         {
             std::cout << "[SKIP] " << filename << " (CRC32 mismatch)\n";
@@ -1112,22 +2431,92 @@ bool Archive::Compact()
             continue;
         }
 
+        if (extent != movedExtents.end())
+        {
+            if (extent->second.refCount == 0)
+            {
+                extent->second.newOffset = newArchive.Seek(0, SEEK_CUR);
+                newArchive.Write((const UINT8*)&extent->second.header, sizeof(SharedExtentHeader), 1);
+                newArchive.Write(extent->second.stored.GetData(), extent->second.stored.GetSize(), 1);
+                extent->second.stored = Blob();
+            }
+
+            extent->second.refCount++;
+            sharedEntry.extentOffset = extent->second.newOffset;
+            memcpy(blob.GetData(), &sharedEntry, sizeof(SharedEntry));
+        }
+
+        if (header.flags & FILE_CHUNKED)
+        {
+            for (auto& chunk : chunks)
+            {
+                SharedExtentData& data = movedExtents[chunk.extentOffset];
+                if (data.refCount == 0)
+                {
+                    data.newOffset = newArchive.Seek(0, SEEK_CUR);
+                    newArchive.Write((const UINT8*)&data.header, sizeof(SharedExtentHeader), 1);
+                    newArchive.Write(data.stored.GetData(), data.stored.GetSize(), 1);
+                    data.stored = Blob();
+                }
+
+                data.refCount++;
+                chunk.extentOffset = data.newOffset;
+            }
+
+            if (!chunks.empty())
+                memcpy(blob.GetData(), chunks.data(), blob.GetSize());
+        }
+
+        if (header.flags & FILE_SOLID)
+        {
+            auto moved = movedGroups.find(solidEntry.groupOffset);
+            if (moved == movedGroups.end())
+            {
+                UINT64 newGroupOffset = newArchive.Seek(0, SEEK_CUR);
+                newArchive.Write((const UINT8*)&groupHeader, sizeof(SolidGroupHeader), 1);
+                newArchive.Write(groupStored.GetData(), groupStored.GetSize(), 1);
+                moved = movedGroups.emplace(solidEntry.groupOffset, newGroupOffset).first;
+            }
+
+            solidEntry.groupOffset = moved->second;
+            memcpy(blob.GetData(), &solidEntry, sizeof(SolidEntry));
+        }
+
+        UINT64 newOffset = newArchive.Seek(0, SEEK_CUR);
         newArchive.Write((UINT8*)&header, sizeof(FileHeader), 1);
-        newArchive.Write(blob.GetData(), blob.GetSize(), 1);
+        if (rawEntry)
+        {
+            oldArchive.Seek(blobOffset, SEEK_SET);
+            Pipeline(StreamSource(oldArchive), StreamSink(newArchive)).Run(blobSize);
+        }
+        else
+        {
+            newArchive.Write(blob.GetData(), blob.GetSize(), 1);
+        }
 
         newNameToOffset[name] = newOffset;
         newIdToOffset[header.id] = newOffset;
         newHeader.fileCount++; 
     }
 
+    for (auto& [oldOffset, data] : movedExtents)
+    {
+        if (data.refCount == 0)
+            continue;
+
+        data.header.refCount = data.refCount;
+        newArchive.Seek(data.newOffset, SEEK_SET);
+        newArchive.Write((const UINT8*)&data.header, sizeof(SharedExtentHeader), 1);
+    }
+
     if (skippedDeleted > 0)
         std::cout << skippedDeleted << " deleted file(s) removed during compact\n";
 
     if (skippedCorrupted > 0)
         std::cout <<  skippedCorrupted << " corrupted file(s) skipped during compact\n";
 
-    UINT64 finalMapSize = newHeader.fileCount * sizeof(MapEntry) * 2;
-    newHeader.dataOffset = sizeof(ArchiveHeader) + finalMapSize;
+    // Data starts after the reserved map space, where the dictionary (if any) was written
+    newHeader.dataOffset = dataStart;
 
     newArchive.Seek(sizeof(ArchiveHeader), SEEK_SET);
 
@@ -1152,18 +2541,31 @@ bool Archive::Compact()
 
     oldArchive.Close();
     newArchive.Close();
+    ClearSolidCache();
+    m_contentIndex.clear();
+    m_contentIndexed = false;
+    m_chunkIndex.clear();
+    m_chunkIndexed = false;
 
-    remove(m_archivePath.c_str());
-    rename(tempPath.c_str(), m_archivePath.c_str());
-
-    if (m_stream != nullptr && static_cast<File*>(m_stream)->GetMode() == Mode::READ)
+    if (memoryStream != nullptr)
     {
-        if (!static_cast<File*>(m_stream)->OpenRead(m_archivePath))
-            return false;
+        if (memoryStream->GetChunks() != nullptr)
+        {
+            memoryStream->GetChunks()->Clear();
+            memoryStream->GetChunks()->Append(newImage.GetData(), newImage.GetSize());
+        }
+        else
+        {
+            *memoryStream->GetBlob() = std::move(newImage);
+        }
+        memoryStream->ResetPos();
     }
-    else if (m_stream != nullptr && static_cast<File*>(m_stream)->GetMode() == Mode::WRITE)
+    else
     {
-        if (!static_cast<File*>(m_stream)->OpenWrite(m_archivePath))
+        remove(m_archivePath.c_str());
+        rename(tempPath.c_str(), m_archivePath.c_str());
+
+        if (!fileStream->Open(m_archivePath, m_mode))
             return false;
     }
 
@@ -1173,6 +2575,8 @@ bool Archive::Compact()
     if (!ReadMaps())
         return false;
 
+    ReadDictionary();
+
     return true;
 }
 
@@ -1190,3 +2594,1036 @@ bool Archive::IsEncryptionEnabled() const
 {
     return m_encryptionEnabled;
 }
+
+void Archive::EnableCompression(bool enable)
+{
+    m_compressionEnabled = enable;
+}
+
+bool Archive::IsCompressionEnabled() const
+{
+    return m_compressionEnabled;
+}
+
+void Archive::SetBlockSize(UINT32 blockSize)
+{
+    m_blockSize = blockSize;
+}
+
+UINT32 Archive::GetBlockSize() const
+{
+    return m_blockSize;
+}
+
+void Archive::SetDecodeBudget(UINT32 megabytesPerSecond)
+{
+    m_decodeBudget = megabytesPerSecond;
+}
+
+UINT32 Archive::GetDecodeBudget() const
+{
+    return m_decodeBudget;
+}
+
+void Archive::SetFilter(const std::string& extension, const FilterSpec& filter)
+{
+    std::string key = GetExtension("." + extension);
+    if (Filter::IsValid(filter))
+        m_extensionFilters[key] = filter;
+    else
+        m_extensionFilters.erase(key);
+}
+
+void Archive::SetEntryFilter(const std::string& filePath, const FilterSpec& filter)
+{
+    if (Filter::IsValid(filter))
+        m_entryFilters[filePath] = filter;
+    else
+        m_entryFilters.erase(filePath);
+}
+
+const PackSummary& Archive::GetPackSummary() const
+{
+    return m_packSummary;
+}
+
+void Archive::PrintPackSummary() const
+{
+    static const char* labels[PACK_DECISION_COUNT] =
+    {
+        "stored (precompressed)",
+        "stored (high entropy)",
+        "stored (decode budget)",
+        "stored (no gain)",
+        "fast (lz)",
+        "high ratio (lzh)",
+        "deduplicated"
+    };
+
+    UINT32 total = 0;
+    for (UINT32 i = 0; i < PACK_DECISION_COUNT; i++)
+        total += m_packSummary.counts[i];
+
+    std::cout << "Pack summary: " << total << " entries, "
+        << m_packSummary.rawBytes << " -> " << m_packSummary.storedBytes << " bytes";
+    if (m_decodeBudget > 0)
+        std::cout << " (decode budget " << m_decodeBudget << " MB/s)";
+    std::cout << "\n";
+
+    for (UINT32 i = 0; i < PACK_DECISION_COUNT; i++)
+    {
+        if (m_packSummary.counts[i] > 0)
+            std::cout << "  " << labels[i] << ": " << m_packSummary.counts[i] << "\n";
+    }
+
+    if (m_packSummary.chunks > 0)
+        std::cout << "  chunks: " << m_packSummary.chunks << " (" << m_packSummary.reusedChunks << " already stored)\n";
+}
+
+void Archive::EnableDictionary(bool enable)
+{
+    m_dictionaryEnabled = enable;
+}
+
+bool Archive::IsDictionaryEnabled() const
+{
+    return m_dictionaryEnabled;
+}
+
+bool Archive::HasDictionary() const
+{
+    return GetDictionary() != nullptr;
+}
+
+const Codec::Dictionary* Archive::GetDictionary() const
+{
+    return (m_dictionary.data.GetSize() > 0) ? &m_dictionary : nullptr;
+}
+
+bool Archive::TrainDictionary(const std::vector<std::string>& filePaths)
+{
+    // Only the small files are sampled, spread evenly over the sample budget
+    std::vector<std::string> candidates;
+    UINT64 candidateBytes = 0;
+
+    for (const auto& filePath : filePaths)
+    {
+        std::error_code error;
+        UINT64 size = std::filesystem::file_size(filePath, error);
+        if (error || size == 0 || size > Codec::DICTIONARY_ENTRY_LIMIT)
+            continue;
+
+        candidates.push_back(filePath);
+        candidateBytes += size;
+    }
+
+    if (candidates.size() < Codec::DICTIONARY_MIN_SAMPLES)
+        return false;
+
+    UINT64 stride = candidateBytes / Codec::DICTIONARY_SAMPLE_BUDGET + 1;
+
+    std::vector<Blob> samples;
+    for (UINT64 i = 0; i < candidates.size(); i += stride)
+    {
+        Blob data;
+        if (ReadSourceFile(candidates[i], data))
+            samples.push_back(std::move(data));
+    }
+
+    Blob trained;
+    if (!Codec::TrainDictionary(samples, Codec::DICTIONARY_MAX_SIZE, trained))
+    {
+        std::cout << "[SKIP] Dictionary training (" << samples.size() << " sample(s) with too little in common)\n";
+        return false;
+    }
+
+    if (!Codec::LoadDictionary(trained.GetData(), trained.GetSize(), m_dictionary))
+        return false;
+
+    std::cout << "Dictionary: " << trained.GetSize() << " bytes trained on " << samples.size() << " file(s)\n";
+    return true;
+}
+
+bool Archive::ReadDictionary()
+{
+    m_dictionary.data.Resize(0);
+    m_dictionary.table.clear();
+
+    Stream::Header header;
+    m_stream->Seek(m_header.dataOffset, SEEK_SET);
+    if (m_stream->Read((UINT8*)&header, sizeof(Stream::Header), 1) != sizeof(Stream::Header))
+        return false;
+
+    if (header.magic[0] != 'D' || header.magic[1] != 'I' ||
+        header.magic[2] != 'C' || header.magic[3] != 'T')
+        return false;
+
+    if (header.dataSize != header.originalSize || header.dataSize > Codec::DICTIONARY_MAX_SIZE)
+        return false;
+
+    Blob data;
+    data.Resize(header.dataSize);
+    if (m_stream->Read(data.GetData(), data.GetSize(), 1) != data.GetSize())
+        return false;
+
+    if (SafeFormat::CalculateCRC32(data.GetData(), data.GetSize()) != header.checksum)
+    {
+        std::cerr << "[ERROR] Dictionary CRC32 mismatch\n";
+        return false;
+    }
+
+    return Codec::LoadDictionary(data.GetData(), data.GetSize(), m_dictionary);
+}
+
+bool Archive::WriteDictionary(Stream& stream) const
+{
+    Stream::Header header = {};
+    header.magic[0] = 'D';
+    header.magic[1] = 'I';
+    header.magic[2] = 'C';
+    header.magic[3] = 'T';
+    header.version = 1;
+    header.flags = Stream::NONE;
+    header.dataSize = m_dictionary.data.GetSize();
+    header.originalSize = m_dictionary.data.GetSize();
+    header.checksum = SafeFormat::CalculateCRC32(m_dictionary.data.GetData(), m_dictionary.data.GetSize());
+
+    if (stream.Write((const UINT8*)&header, sizeof(Stream::Header), 1) != sizeof(Stream::Header))
+        return false;
+
+    return stream.Write(m_dictionary.data.GetData(), m_dictionary.data.GetSize(), 1) == m_dictionary.data.GetSize();
+}
+
+void Archive::EnableSolidGroups(bool enable)
+{
+    m_solidEnabled = enable;
+}
+
+bool Archive::IsSolidGroupsEnabled() const
+{
+    return m_solidEnabled;
+}
+
+void Archive::AddSolidGroup(const std::vector<std::string>& filePaths)
+{
+    if (!filePaths.empty())
+        m_solidGroups.push_back(filePaths);
+}
+
+std::vector<std::vector<std::string>> Archive::PlanSolidGroups(const std::vector<std::string>& filePaths) const
+{
+    std::unordered_map<std::string, UINT64> explicitGroup;
+    for (UINT64 g = 0; g < m_solidGroups.size(); g++)
+    {
+        for (const auto& path : m_solidGroups[g])
+            explicitGroup.emplace(path, g);
+    }
+
+    std::unordered_map<std::string, bool> requested;
+    for (const auto& path : filePaths)
+        requested[path] = true;
+
+    std::vector<std::vector<std::string>> units;
+    std::vector<bool> groupWritten(m_solidGroups.size(), false);
+
+    std::vector<std::string> run;
+    std::string runDirectory;
+    UINT64 runSize = 0;
+
+    auto flushRun = [&]()
+    {
+        if (!run.empty())
+            units.push_back(std::move(run));
+        run.clear();
+        runSize = 0;
+    };
+
+    for (const auto& path : filePaths)
+    {
+        // An explicit group is written whole where its first file appears
+        auto group = explicitGroup.find(path);
+        if (group != explicitGroup.end())
+        {
+            flushRun();
+            if (!groupWritten[group->second])
+            {
+                groupWritten[group->second] = true;
+
+                std::vector<std::string> members;
+                for (const auto& member : m_solidGroups[group->second])
+                {
+                    if (requested.find(member) != requested.end())
+                        members.push_back(member);
+                }
+                units.push_back(std::move(members));
+            }
+            continue;
+        }
+
+        std::error_code error;
+        UINT64 size = std::filesystem::file_size(path, error);
+        // Already-compressed files would only cost the group CPU on every load,
+        // and a group is not filtered: filtered files stay plain entries
+        if (!m_solidEnabled || error || size > SOLID_ENTRY_LIMIT || IsPrecompressedFile(path) ||
+            Filter::IsValid(FindFilter(path)))
+        {
+            flushRun();
+            units.push_back({ path });
+            continue;
+        }
+
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        if (!run.empty() && (directory != runDirectory || runSize + size > SOLID_GROUP_LIMIT))
+            flushRun();
+
+        run.push_back(path);
+        runDirectory = directory;
+        runSize += size;
+    }
+    flushRun();
+
+    return units;
+}
+
+bool Archive::WriteSolidGroup(const std::vector<std::string>& filePaths)
+{
+    struct Member
+    {
+        std::string path;
+        UINT64 offset;
+        UINT64 size;
+        UINT32 checksum;
+    };
+
+    UINT64 totalSize = 0;
+    for (const auto& path : filePaths)
+    {
+        std::error_code error;
+        UINT64 size = std::filesystem::file_size(path, error);
+        if (!error)
+            totalSize += size;
+    }
+
+    Blob groupData;
+    groupData.Reserve(totalSize);
+    std::vector<Member> members;
+
+    for (const auto& path : filePaths)
+    {
+        Blob fileData;
+        if (!ReadSourceFile(path, fileData))
+            continue;
+
+        Member member;
+        member.path = path;
+        member.offset = groupData.GetSize();
+        member.size = fileData.GetSize();
+        member.checksum = SafeFormat::CalculateCRC32(fileData.GetData(), fileData.GetSize());
+        members.push_back(member);
+
+        if (fileData.GetSize() > 0)
+        {
+            groupData.Reserve(groupData.GetSize() + fileData.GetSize());
+            groupData.Append(fileData.GetData(), fileData.GetSize());
+        }
+    }
+
+    if (members.empty())
+        return false;
+
+    SolidGroupHeader groupHeader = {};
+    groupHeader.magic[0] = 'S';
+    groupHeader.magic[1] = 'O';
+    groupHeader.magic[2] = 'L';
+    groupHeader.magic[3] = 'D';
+    groupHeader.entryCount = static_cast<UINT32>(members.size());
+    groupHeader.originalSize = groupData.GetSize();
+    groupHeader.codec = CODEC_NONE;
+
+    // The group is compressed whatever m_compressionEnabled says: that is its purpose
+    UINT8 codec;
+    PackDecision decision = ChooseCodec("", groupData, codec);
+
+    Blob packed;
+    const Blob* stored = &groupData;
+    if (codec == CODEC_LZH && !Codec::Pack(groupData.GetData(), groupData.GetSize(), packed, m_blockSize, GetDictionary(), codec))
+    {
+        codec = CODEC_LZ;
+        decision = PACK_FAST;
+    }
+    if (codec == CODEC_LZ && !Codec::Pack(groupData.GetData(), groupData.GetSize(), packed, m_blockSize, GetDictionary(), codec))
+    {
+        codec = CODEC_NONE;
+        decision = PACK_STORED_NO_GAIN;
+    }
+    if (codec != CODEC_NONE)
+    {
+        stored = &packed;
+        groupHeader.codec = codec;
+    }
+    groupHeader.dataSize = stored->GetSize();
+
+    m_packSummary.counts[decision] += static_cast<UINT32>(members.size());
+    m_packSummary.rawBytes += groupData.GetSize();
+    m_packSummary.storedBytes += stored->GetSize();
+
+    UINT64 groupOffset = m_stream->Seek(0, SEEK_CUR);
+    m_stream->Write((const UINT8*)&groupHeader, sizeof(SolidGroupHeader), 1);
+    if (stored->GetSize() > 0 && m_stream->Write(stored->GetData(), stored->GetSize(), 1) != stored->GetSize())
+        return false;
+
+    for (const auto& member : members)
+    {
+        UINT64 fileHeaderOffset = m_stream->Seek(0, SEEK_CUR);
+        std::string uniqueName = GetUniqueFilename(GetBasename(member.path));
+        UINT64 id = GenerateFileID(uniqueName);
+
+        SolidEntry entry;
+        entry.groupOffset = groupOffset;
+        entry.offset = member.offset;
+        entry.size = member.size;
+
+        if (!WriteFileHeader(uniqueName, id, sizeof(SolidEntry), FILE_ACTIVE | FILE_SOLID, member.checksum))
+            continue;
+
+        m_stream->Write((const UINT8*)&entry, sizeof(SolidEntry), 1);
+
+        m_nameToOffset[uniqueName] = fileHeaderOffset;
+        m_idToOffset[id] = fileHeaderOffset;
+    }
+
+    return true;
+}
+
+bool Archive::ReadSolidGroup(Stream& stream, UINT64 groupOffset, SolidGroupHeader& header, Blob& stored) const
+{
+    stream.Seek(groupOffset, SEEK_SET);
+    if (stream.Read((UINT8*)&header, sizeof(SolidGroupHeader), 1) != sizeof(SolidGroupHeader))
+        return false;
+
+    if (header.magic[0] != 'S' || header.magic[1] != 'O' ||
+        header.magic[2] != 'L' || header.magic[3] != 'D')
+        return false;
+
+    if (header.dataSize > stream.GetSize())
+        return false;
+
+    if (!stored.Resize(header.dataSize))
+        return false;
+    if (header.dataSize > 0 && stream.Read(stored.GetData(), header.dataSize, 1) != header.dataSize)
+        return false;
+
+    return true;
+}
+
+bool Archive::DecodeSolidGroup(const SolidGroupHeader& header, const Blob& stored, Blob& outData) const
+{
+    if (header.codec == CODEC_NONE)
+    {
+        if (stored.GetSize() != header.originalSize)
+            return false;
+
+        outData.Resize(stored.GetSize());
+        memcpy(outData.GetData(), stored.GetData(), stored.GetSize());
+        return true;
+    }
+
+    if (!Codec::IsSupported(header.codec))
+        return false;
+
+    return Codec::Unpack(stored.GetData(), stored.GetSize(), outData, GetDictionary(), header.codec) &&
+           outData.GetSize() == header.originalSize;
+}
+
+bool Archive::LoadSolidGroup(UINT64 groupOffset, SharedBlob& outGroup) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_solidCacheMutex);
+        auto cached = m_solidCacheIndex.find(groupOffset);
+        if (cached != m_solidCacheIndex.end())
+        {
+            m_solidCache.splice(m_solidCache.begin(), m_solidCache, cached->second);
+            outGroup = cached->second->second;
+            return true;
+        }
+    }
+
+    // Decoded outside both locks; two readers missing the same group both decode it
+    LockedStream archive(m_stream, m_readMutex);
+    SolidGroupHeader header;
+    Blob stored;
+    Blob decoded;
+    if (!ReadSolidGroup(archive, groupOffset, header, stored) || !DecodeSolidGroup(header, stored, decoded))
+        return false;
+
+    // The cache outlives the caller's allocator scope
+    decoded.Reserve(decoded.GetSize(), Allocator::GetHeap());
+    outGroup = SharedBlob(std::move(decoded));
+
+    std::lock_guard<std::mutex> lock(m_solidCacheMutex);
+    if (m_solidCacheIndex.count(groupOffset) > 0)
+        return true;
+
+    if (m_solidCache.size() >= SOLID_CACHE_GROUPS)
+    {
+        m_solidCacheIndex.erase(m_solidCache.back().first);
+        m_solidCache.pop_back();
+    }
+
+    m_solidCache.emplace_front(groupOffset, outGroup);
+    m_solidCacheIndex[groupOffset] = m_solidCache.begin();
+
+    return true;
+}
+
+void Archive::ClearSolidCache() const
+{
+    std::lock_guard<std::mutex> lock(m_solidCacheMutex);
+    m_solidCache.clear();
+    m_solidCacheIndex.clear();
+}
+
+void Archive::SetEntryCacheBudget(UINT64 bytes)
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+    m_entryCacheBudget = bytes;
+    m_entryCacheStats = EntryCacheStats();
+    m_entryCache.clear();
+    m_entryCacheIndex.clear();
+}
+
+UINT64 Archive::GetEntryCacheBudget() const
+{
+    return m_entryCacheBudget;
+}
+
+EntryCacheStats Archive::GetEntryCacheStats() const
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+    return m_entryCacheStats;
+}
+
+void Archive::ClearEntryCache() const
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+    m_entryCache.clear();
+    m_entryCacheIndex.clear();
+    m_entryCacheStats.bytes = 0;
+    m_entryCacheStats.entries = 0;
+}
+
+bool Archive::ReadCachedEntry(UINT64 fileID, UINT64 offset, UINT64 size, Blob& outData) const
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+
+    auto cached = m_entryCacheIndex.find(fileID);
+    if (cached == m_entryCacheIndex.end())
+        return false;
+
+    // Past the end: let the caller fail the usual way
+    const SharedBlob& data = cached->second->second;
+    if (offset > data.GetSize())
+        return false;
+
+    m_entryCache.splice(m_entryCache.begin(), m_entryCache, cached->second);
+    m_entryCacheStats.hits++;
+
+    if (size > data.GetSize() - offset)
+        size = data.GetSize() - offset;
+
+    outData.Resize(size);
+    if (size > 0)
+        memcpy(outData.GetData(), data.GetData() + offset, size);
+    return true;
+}
+
+bool Archive::FindCachedEntry(UINT64 fileID, SharedBlob& outData) const
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+
+    auto cached = m_entryCacheIndex.find(fileID);
+    if (cached == m_entryCacheIndex.end())
+        return false;
+
+    m_entryCache.splice(m_entryCache.begin(), m_entryCache, cached->second);
+    m_entryCacheStats.hits++;
+    outData = cached->second->second;
+    return true;
+}
+
+// Holds a reference: bytes still used by a reader after an eviction stay alive
+void Archive::CacheEntry(UINT64 fileID, const SharedBlob& data) const
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+
+    if (data.GetSize() > m_entryCacheBudget || m_entryCacheIndex.find(fileID) != m_entryCacheIndex.end())
+        return;
+
+    while (m_entryCacheStats.bytes + data.GetSize() > m_entryCacheBudget)
+    {
+        m_entryCacheStats.bytes -= m_entryCache.back().second.GetSize();
+        m_entryCacheStats.entries--;
+        m_entryCacheStats.evictions++;
+        m_entryCacheIndex.erase(m_entryCache.back().first);
+        m_entryCache.pop_back();
+    }
+
+    m_entryCache.emplace_front(fileID, data);
+    m_entryCacheIndex[fileID] = m_entryCache.begin();
+    m_entryCacheStats.bytes += data.GetSize();
+    m_entryCacheStats.entries++;
+}
+
+void Archive::EvictEntry(UINT64 fileID) const
+{
+    std::lock_guard<std::mutex> lock(m_entryCacheMutex);
+
+    auto cached = m_entryCacheIndex.find(fileID);
+    if (cached == m_entryCacheIndex.end())
+        return;
+
+    m_entryCacheStats.bytes -= cached->second->second.GetSize();
+    m_entryCacheStats.entries--;
+    m_entryCache.erase(cached->second);
+    m_entryCacheIndex.erase(cached);
+}
+
+void Archive::EnableDeduplication(bool enable)
+{
+    m_dedupEnabled = enable;
+}
+
+bool Archive::IsDeduplicationEnabled() const
+{
+    return m_dedupEnabled;
+}
+
+bool Archive::WriteSharedExtent(const UINT8* stored, UINT64 storedSize, UINT64 originalSize, const UINT8* hash, UINT32 refCount)
+{
+    SharedExtentHeader header = {};
+    header.magic[0] = 'S';
+    header.magic[1] = 'H';
+    header.magic[2] = 'R';
+    header.magic[3] = 'D';
+    header.refCount = refCount;
+    header.dataSize = storedSize;
+    header.originalSize = originalSize;
+    memcpy(header.hash, hash, SafeFormat::SHA256_SIZE);
+
+    if (m_stream->Write((const UINT8*)&header, sizeof(SharedExtentHeader), 1) != sizeof(SharedExtentHeader))
+        return false;
+
+    return storedSize == 0 || m_stream->Write(stored, storedSize, 1) == storedSize;
+}
+
+bool Archive::ReadSharedExtent(Stream& stream, UINT64 extentOffset, SharedExtentHeader& header, Blob* stored) const
+{
+    stream.Seek(extentOffset, SEEK_SET);
+    if (stream.Read((UINT8*)&header, sizeof(SharedExtentHeader), 1) != sizeof(SharedExtentHeader))
+        return false;
+
+    if (header.magic[0] != 'S' || header.magic[1] != 'H' ||
+        header.magic[2] != 'R' || header.magic[3] != 'D')
+        return false;
+
+    if (header.dataSize > stream.GetSize())
+        return false;
+
+    if (stored == nullptr)
+        return true;
+
+    if (!stored->Resize(header.dataSize))
+        return false;
+    if (header.dataSize > 0 && stream.Read(stored->GetData(), header.dataSize, 1) != header.dataSize)
+        return false;
+
+    return true;
+}
+
+bool Archive::ReadSharedEntry(UINT64 fileOffset, const FileHeader& header, SharedEntry& entry) const
+{
+    if (!(header.flags & FILE_SHARED) || header.dataSize != sizeof(SharedEntry))
+        return false;
+
+    LockedStream archive(m_stream, m_readMutex);
+    archive.Seek(fileOffset + sizeof(FileHeader), SEEK_SET);
+    return archive.Read((UINT8*)&entry, sizeof(SharedEntry), 1) == sizeof(SharedEntry);
+}
+
+bool Archive::WriteSharedEntry(const std::string& filename, UINT64 id, const FileHeader& content, UINT64 extentOffset)
+{
+    FilterSpec filter = { content.filter, content.filterWidth };
+    if (!WriteFileHeader(filename, id, sizeof(SharedEntry), content.flags, content.checksum, content.codec, filter))
+        return false;
+
+    SharedEntry entry = { extentOffset };
+    return m_stream->Write((const UINT8*)&entry, sizeof(SharedEntry), 1) == sizeof(SharedEntry);
+}
+
+bool Archive::ShareContent(const Blob& fileData, UINT32 checksum, FileHeader& outContent, UINT64& outExtentOffset)
+{
+    if (!m_contentIndexed)
+    {
+        for (const auto& [name, offset] : m_nameToOffset)
+        {
+            FileHeader header;
+            std::string filename;
+            if (ReadFileHeader(offset, header, filename) && (header.flags & FILE_ACTIVE) &&
+                !(header.flags & (FILE_SOLID | FILE_ENCRYPTED | FILE_CHUNKED)))
+                m_contentIndex.emplace(header.checksum, offset);
+        }
+        m_contentIndexed = true;
+    }
+
+    UINT8 hash[SafeFormat::SHA256_SIZE];
+    bool hashed = false;
+
+    auto candidates = m_contentIndex.equal_range(checksum);
+    for (auto it = candidates.first; it != candidates.second; ++it)
+    {
+        UINT64 entryOffset = it->second;
+        FileHeader header;
+        std::string filename;
+        if (!ReadFileHeader(entryOffset, header, filename) || !(header.flags & FILE_ACTIVE) ||
+            (header.flags & FILE_CHUNKED) || header.checksum != checksum)
+            continue;
+
+        // Same size and CRC32 first; only then is anything hashed
+        SharedEntry entry = {};
+        SharedExtentHeader extent;
+        Blob stored;
+        UINT64 originalSize = header.dataSize;
+        if (header.flags & FILE_SHARED)
+        {
+            if (!ReadSharedEntry(entryOffset, header, entry) || !ReadSharedExtent(*m_stream, entry.extentOffset, extent))
+                continue;
+            originalSize = extent.originalSize;
+        }
+        else if (header.flags & FILE_COMPRESSED)
+        {
+            if (!ReadStoredRange(entryOffset + sizeof(FileHeader), header, 0, sizeof(Stream::Header), stored))
+                continue;
+
+            Stream::Header streamHeader;
+            memcpy(&streamHeader, stored.GetData(), sizeof(Stream::Header));
+            originalSize = streamHeader.originalSize;
+        }
+
+        if (originalSize != fileData.GetSize())
+            continue;
+
+        if (!hashed)
+        {
+            SafeFormat::CalculateSHA256(fileData.GetData(), fileData.GetSize(), hash);
+            hashed = true;
+        }
+
+        if (header.flags & FILE_SHARED)
+        {
+            if (memcmp(extent.hash, hash, SafeFormat::SHA256_SIZE) != 0)
+                continue;
+
+            extent.refCount++;
+            m_stream->Seek(entry.extentOffset, SEEK_SET);
+            m_stream->Write((const UINT8*)&extent, sizeof(SharedExtentHeader), 1);
+        }
+        else
+        {
+            // A plain entry: compare its content, then move its stored bytes into an extent
+            Blob decoded;
+            if (!ReadStoredRange(entryOffset + sizeof(FileHeader), header, 0, header.dataSize, stored))
+                continue;
+            if ((header.flags & FILE_COMPRESSED) && !DecodeFileData(header, stored, decoded))
+                continue;
+
+            const Blob& original = (header.flags & FILE_COMPRESSED) ? decoded : stored;
+            UINT8 entryHash[SafeFormat::SHA256_SIZE];
+            SafeFormat::CalculateSHA256(original.GetData(), original.GetSize(), entryHash);
+            if (memcmp(entryHash, hash, SafeFormat::SHA256_SIZE) != 0)
+                continue;
+
+            m_stream->Seek(0, SEEK_END);
+            entry.extentOffset = m_stream->Seek(0, SEEK_CUR);
+            if (!WriteSharedExtent(stored.GetData(), stored.GetSize(), fileData.GetSize(), hash, 2))
+                return false;
+
+            // Its old bytes are left as dead space until Compact
+            header.flags |= FILE_SHARED;
+            header.dataSize = sizeof(SharedEntry);
+            m_stream->Seek(entryOffset, SEEK_SET);
+            m_stream->Write((const UINT8*)&header, sizeof(FileHeader), 1);
+            m_stream->Write((const UINT8*)&entry, sizeof(SharedEntry), 1);
+        }
+
+        m_packSummary.counts[PACK_DEDUPLICATED]++;
+        m_packSummary.rawBytes += fileData.GetSize();
+
+        outContent = header;
+        outExtentOffset = entry.extentOffset;
+        return true;
+    }
+
+    return false;
+}
+
+void Archive::ReleaseSharedExtents(UINT64 fileOffset, const FileHeader& header)
+{
+    std::vector<UINT64> extentOffsets;
+    if (header.flags & FILE_SHARED)
+    {
+        SharedEntry entry;
+        if (ReadSharedEntry(fileOffset, header, entry))
+            extentOffsets.push_back(entry.extentOffset);
+    }
+    else if (header.flags & FILE_CHUNKED)
+    {
+        Blob stored;
+        std::vector<ChunkRef> chunks;
+        if (ReadStoredRange(fileOffset + sizeof(FileHeader), header, 0, header.dataSize, stored) &&
+            ReadChunkList(header, stored, chunks))
+        {
+            for (const auto& chunk : chunks)
+                extentOffsets.push_back(chunk.extentOffset);
+        }
+    }
+
+    // An extent nobody points at is dropped by the next Compact
+    for (UINT64 extentOffset : extentOffsets)
+    {
+        SharedExtentHeader extent;
+        if (!ReadSharedExtent(*m_stream, extentOffset, extent))
+            continue;
+
+        if (extent.refCount > 0)
+            extent.refCount--;
+
+        m_stream->Seek(extentOffset, SEEK_SET);
+        m_stream->Write((const UINT8*)&extent, sizeof(SharedExtentHeader), 1);
+    }
+}
+
+void Archive::EnableChunking(bool enable)
+{
+    m_chunkingEnabled = enable;
+}
+
+bool Archive::IsChunkingEnabled() const
+{
+    return m_chunkingEnabled;
+}
+
+bool Archive::WriteChunkedEntry(const std::string& filename, UINT64 id, const Blob& fileData, UINT32 checksum, UINT64& outOffset)
+{
+    // One codec for the whole file, each chunk falls back to raw if it does not shrink
+    UINT8 codec = CODEC_NONE;
+    if (m_compressionEnabled)
+        m_packSummary.counts[ChooseCodec(filename, fileData, codec)]++;
+    m_packSummary.rawBytes += fileData.GetSize();
+
+    std::vector<UINT64> ends;
+    Chunker::Split(fileData.GetData(), fileData.GetSize(), ends);
+
+    std::vector<ChunkRef> chunks(ends.size());
+    Blob packed;
+    packed.Resize(Codec::CompressBound(Chunker::MAX_SIZE));
+
+    // FindChunk moves the stream: new chunks go from here on, then the entry
+    UINT64 position = m_stream->Seek(0, SEEK_CUR);
+    UINT64 start = 0;
+    for (size_t i = 0; i < ends.size(); i++)
+    {
+        const UINT8* chunk = fileData.GetData() + start;
+        ChunkRef& ref = chunks[i];
+        ref.size = static_cast<UINT32>(ends[i] - start);
+        ref.checksum = SafeFormat::CalculateCRC32(chunk, ref.size);
+        start = ends[i];
+
+        UINT8 hash[SafeFormat::SHA256_SIZE];
+        SafeFormat::CalculateSHA256(chunk, ref.size, hash);
+
+        m_packSummary.chunks++;
+        if (FindChunk(hash, ref))
+        {
+            m_packSummary.reusedChunks++;
+            continue;
+        }
+
+        const UINT8* stored = chunk;
+        UINT64 storedSize = ref.size;
+        ref.codec = CODEC_NONE;
+        if (codec != CODEC_NONE)
+        {
+            UINT64 packedSize = Codec::Encode(codec, chunk, ref.size, packed.GetData(), packed.GetSize());
+            if (packedSize > 0 && packedSize < ref.size)
+            {
+                stored = packed.GetData();
+                storedSize = packedSize;
+                ref.codec = codec;
+            }
+        }
+
+        ref.extentOffset = position;
+        m_stream->Seek(position, SEEK_SET);
+        if (!WriteSharedExtent(stored, storedSize, ref.size, hash, 1))
+            return false;
+        position = m_stream->Seek(0, SEEK_CUR);
+
+        m_packSummary.storedBytes += storedSize;
+        m_chunkIndex.emplace(ref.checksum, ref);
+    }
+
+    m_stream->Seek(position, SEEK_SET);
+    outOffset = position;
+
+    UINT64 listSize = chunks.size() * sizeof(ChunkRef);
+    if (!WriteFileHeader(filename, id, listSize, FILE_ACTIVE | FILE_CHUNKED, checksum))
+        return false;
+
+    return m_stream->Write((const UINT8*)chunks.data(), listSize, 1) == listSize;
+}
+
+bool Archive::FindChunk(const UINT8* hash, ChunkRef& ref)
+{
+    if (!m_chunkIndexed)
+    {
+        for (const auto& [name, offset] : m_nameToOffset)
+        {
+            FileHeader header;
+            std::string filename;
+            if (!ReadFileHeader(offset, header, filename) || !(header.flags & FILE_ACTIVE) || !(header.flags & FILE_CHUNKED))
+                continue;
+
+            Blob stored;
+            std::vector<ChunkRef> chunks;
+            if (!ReadStoredRange(offset + sizeof(FileHeader), header, 0, header.dataSize, stored) ||
+                !ReadChunkList(header, stored, chunks))
+                continue;
+
+            for (const auto& chunk : chunks)
+                m_chunkIndex.emplace(chunk.checksum, chunk);
+        }
+        m_chunkIndexed = true;
+    }
+
+    auto candidates = m_chunkIndex.equal_range(ref.checksum);
+    for (auto it = candidates.first; it != candidates.second; ++it)
+    {
+        const ChunkRef& candidate = it->second;
+        SharedExtentHeader extent;
+        if (candidate.size != ref.size || !ReadSharedExtent(*m_stream, candidate.extentOffset, extent) ||
+            memcmp(extent.hash, hash, SafeFormat::SHA256_SIZE) != 0)
+            continue;
+
+        extent.refCount++;
+        m_stream->Seek(candidate.extentOffset, SEEK_SET);
+        m_stream->Write((const UINT8*)&extent, sizeof(SharedExtentHeader), 1);
+
+        ref.extentOffset = candidate.extentOffset;
+        ref.codec = candidate.codec;
+        return true;
+    }
+
+    return false;
+}
+
+bool Archive::ReadChunkList(const FileHeader& header, const Blob& stored, std::vector<ChunkRef>& outChunks) const
+{
+    if (!(header.flags & FILE_CHUNKED) || stored.GetSize() != header.dataSize || header.dataSize % sizeof(ChunkRef) != 0)
+        return false;
+
+    outChunks.resize(header.dataSize / sizeof(ChunkRef));
+    if (!outChunks.empty())
+        memcpy(outChunks.data(), stored.GetData(), header.dataSize);
+    return true;
+}
+
+bool Archive::DecodeChunk(const ChunkRef& ref, const Blob& stored, UINT8* outData) const
+{
+    if (ref.codec == CODEC_NONE)
+    {
+        if (stored.GetSize() != ref.size)
+            return false;
+
+        memcpy(outData, stored.GetData(), ref.size);
+        return true;
+    }
+
+    if (!Codec::IsSupported(ref.codec))
+        return false;
+
+    return Codec::Decode(ref.codec, stored.GetData(), stored.GetSize(), outData, ref.size) == ref.size;
+}
+
+std::vector<std::pair<std::string, UINT64>> Archive::GetEntriesByOffset() const
+{
+    std::vector<std::pair<std::string, UINT64>> entries(m_nameToOffset.begin(), m_nameToOffset.end());
+    for (UINT64 i = 0; i < m_toc.GetNameCount(); i++)
+        entries.emplace_back(m_toc.GetName(i), m_toc.GetNameOffset(i));
+    std::sort(entries.begin(), entries.end(),
+        [](const std::pair<std::string, UINT64>& a, const std::pair<std::string, UINT64>& b) { return a.second < b.second; });
+    return entries;
+}
+
+bool Archive::Contains(const std::string& filename) const
+{
+    UINT64 offset;
+    return FindEntryByName(filename, offset);
+}
+
+bool Archive::Contains(UINT64 fileID) const
+{
+    UINT64 offset;
+    return FindEntryByID(fileID, offset);
+}
+
+std::vector<std::string> Archive::GetFileNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(m_nameToOffset.size() + m_toc.GetNameCount());
+    for (const auto& [name, offset] : m_nameToOffset)
+        names.push_back(name);
+    for (UINT64 i = 0; i < m_toc.GetNameCount(); i++)
+        names.push_back(m_toc.GetName(i));
+    return names;
+}
+
+bool Archive::FindEntryByName(const std::string& filename, UINT64& outOffset) const
+{
+    if (m_toc.IsAttached())
+        return m_toc.FindName(filename, outOffset);
+
+    auto it = m_nameToOffset.find(filename);
+    if (it == m_nameToOffset.end())
+        return false;
+
+    outOffset = it->second;
+    return true;
+}
+
+bool Archive::FindEntryByID(UINT64 fileID, UINT64& outOffset) const
+{
+    if (m_toc.IsAttached())
+        return m_toc.FindID(fileID, outOffset);
+
+    auto it = m_idToOffset.find(fileID);
+    if (it == m_idToOffset.end())
+        return false;
+
+    outOffset = it->second;
+    return true;
+}
+
+void Archive::EnableSharedToc(bool enable)
+{
+    m_sharedTocEnabled = enable;
+}
+
+bool Archive::IsSharedTocEnabled() const
+{
+    return m_sharedTocEnabled;
+}
+
+bool Archive::IsTocShared() const
+{
+    return m_toc.IsAttached();
+}
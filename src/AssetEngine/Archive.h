@@ -6,7 +6,11 @@ enum FileFlags : UINT8
     FILE_ACTIVE = 0x01,
     FILE_DELETED = 0x02,
     FILE_COMPRESSED = 0x04,
-    FILE_ENCRYPTED = 0x08
+    FILE_ENCRYPTED = 0x08,
+    FILE_SOLID = 0x10,
+    FILE_FILTERED = 0x20,
+    FILE_SHARED = 0x40,
+    FILE_CHUNKED = 0x80
 };
 
 struct ArchiveHeader
@@ -25,7 +29,87 @@ struct FileHeader
     char     filename[256];   
     UINT8    flags;
     UINT32   checksum;       
-    UINT8    padding[3];
+    UINT8    codec;
+    UINT8    filter;       // FilterSpec of a FILE_FILTERED entry
+    UINT8    filterWidth;
+};
+
+// Stored data of a FILE_SOLID entry: where its bytes live in a solid group
+struct SolidEntry
+{
+    UINT64   groupOffset;
+    UINT64   offset;
+    UINT64   size;
+};
+
+// Files packed as one stream; written before the FileHeaders pointing into it
+struct SolidGroupHeader
+{
+    char     magic[4];
+    UINT32   entryCount;
+    UINT64   dataSize;
+    UINT64   originalSize;
+    UINT8    codec;
+    UINT8    padding[7];
+};
+
+// Stored data of a FILE_SHARED entry: the extent holding its bytes.
+// The entry header keeps the codec / filter the extent was packed with.
+struct SharedEntry
+{
+    UINT64   extentOffset;
+};
+
+// Stored bytes of byte-identical files; written before the first FileHeader pointing at it
+struct SharedExtentHeader
+{
+    char     magic[4];
+    UINT32   refCount;     // active entries pointing here
+    UINT64   dataSize;
+    UINT64   originalSize;
+    UINT8    hash[32];     // SHA-256 of the original data
+};
+
+// Stored data of a FILE_CHUNKED entry is an array of these, in file order.
+// Each chunk is a shared extent, compressed on its own.
+struct ChunkRef
+{
+    UINT64   extentOffset;
+    UINT32   size;         // original bytes
+    UINT32   checksum;     // CRC32 of the original bytes
+    UINT8    codec;
+    UINT8    padding[7];
+};
+
+// Why PackFileData stored an entry the way it did
+enum PackDecision : UINT8
+{
+    PACK_STORED_PRECOMPRESSED,  // known compressed format (png, ogg, zip...)
+    PACK_STORED_ENTROPY,        // sampled data looks random
+    PACK_STORED_BUDGET,         // no codec decodes fast enough for the budget
+    PACK_STORED_NO_GAIN,        // compressed, but did not shrink
+    PACK_FAST,                  // CODEC_LZ
+    PACK_HIGH_RATIO,            // CODEC_LZH
+    PACK_DEDUPLICATED,          // same content as an entry already stored
+    PACK_DECISION_COUNT
+};
+
+struct PackSummary
+{
+    UINT32   counts[PACK_DECISION_COUNT];
+    UINT64   rawBytes;
+    UINT64   storedBytes;
+    UINT32   chunks;
+    UINT32   reusedChunks;  // already stored in the archive
+};
+
+struct EntryCacheStats
+{
+    UINT64   hits;
+    UINT64   misses;
+    UINT64   evictions;
+    UINT64   bytes;        // held right now
+    UINT32   entries;
 };
 
 struct MapEntry
@@ -37,11 +121,18 @@ struct MapEntry
 class Archive
 {
 public:
-    Archive() : m_stream(nullptr), m_ownsStream(false), m_encryptionEnabled(false), m_encryptionKey("") {}
+    Archive() : m_stream(nullptr), m_ownsStream(false), m_mode(Mode::READ), m_encryptionEnabled(false), m_encryptionKey(""), m_compressionEnabled(false), m_blockSize(Codec::DEFAULT_BLOCK_SIZE), m_decodeBudget(0), m_packSummary(), m_dictionaryEnabled(false), m_solidEnabled(false), m_dedupEnabled(false), m_contentIndexed(false), m_chunkingEnabled(false), m_chunkIndexed(false), m_entryCacheBudget(0), m_entryCacheStats(), m_sharedTocEnabled(false) {}
     ~Archive();
 
     bool Open(const std::string& archivePath, Mode mode);
-    bool OpenStream(Stream* stream);
+    //Over a stream owned by the caller, e.g. a read-only Memory over a mapped archive,
+    //or a Memory to build an archive in RAM (Create, AddFile... then Save)
+    bool OpenStream(Stream* stream, Mode mode = Mode::READ);
+    //Whole archive read with one read; everything then happens in RAM until Save
+    bool Load(const std::string& archivePath, Mode mode = Mode::READ);
+    //Archive held in memory written with one write
+    bool Save(const std::string& outputPath) const;
+    bool IsInMemory() const;
     void Close();
     bool IsOpen() const;
 
@@ -49,11 +140,31 @@ public:
 
     bool List() const;
     bool Validate() const;
+    //Active entry lookups, without the error message of a failed read
+    bool Contains(const std::string& filename) const;
+    bool Contains(UINT64 fileID) const;
+    std::vector<std::string> GetFileNames() const;
+
+    //Decoded, CRC32-checked content of a file. Safe to call from several threads
+    //(as are Extract and ReadRange); hits in the entry cache don't touch the stream.
+    bool ReadFile(UINT64 fileID, Blob& outData) const;
+    bool ReadFileByName(const std::string& filename, Blob& outData) const;
+    //Same content shared with the entry cache: a hit hands out a reference, not a copy
+    bool ReadFile(UINT64 fileID, SharedBlob& outData) const;
+    bool ReadFileByName(const std::string& filename, SharedBlob& outData) const;
 
     bool Extract(UINT64 fileID, const std::string& outputPath) const;
+    //Decoded content written to output as it is read: deciphered, decoded and CRC32-checked
+    //in one pass, so plain and compressed entries are never held whole in memory
+    bool ExtractTo(UINT64 fileID, Stream& output) const;
     bool ExtractByName(const std::string& filename, const std::string& outputPath) const;
     bool ExtractAll(const std::string& outputDir) const;
 
+    //Reads [offset, offset + size) of a file; only the covering blocks are decompressed
+    //Note: the whole-file CRC32 can't be checked on a partial read
+    bool ReadRange(UINT64 fileID, UINT64 offset, UINT64 size, Blob& outData) const;
+    bool ReadRangeByName(const std::string& filename, UINT64 offset, UINT64 size, Blob& outData) const;
+
     bool AddFile(const std::string& filePath);
     bool AddFile(const std::string& filePath, UINT64& outGeneratedID);
     bool AddFile(const std::vector<std::string>& filePaths);
@@ -68,20 +179,130 @@ public:
     void SetEncryptionKey(const std::string& key);
     bool IsEncryptionEnabled() const;
 
+    void EnableCompression(bool enable);
+    bool IsCompressionEnabled() const;
+    //Files larger than blockSize are compressed in independent blocks (0: single stream)
+    void SetBlockSize(UINT32 blockSize);
+    UINT32 GetBlockSize() const;
+    //Each entry gets the best-ratio codec that still decodes at this many MB/s (0: no limit)
+    void SetDecodeBudget(UINT32 megabytesPerSecond);
+    UINT32 GetDecodeBudget() const;
+    //Entries with this extension (no dot, any case) are filtered before compression
+    void SetFilter(const std::string& extension, const FilterSpec& filter);
+    //Same for one source file; takes precedence over its extension
+    void SetEntryFilter(const std::string& filePath, const FilterSpec& filter);
+    //Codec decisions since Open / Create
+    const PackSummary& GetPackSummary() const;
+    void PrintPackSummary() const;
+    //Create trains a dictionary on the small files and stores it once; needs compression
+    void EnableDictionary(bool enable);
+    bool IsDictionaryEnabled() const;
+    bool HasDictionary() const;
+    //Create packs runs of small files from the same directory as solid groups
+    void EnableSolidGroups(bool enable);
+    bool IsSolidGroupsEnabled() const;
+    //Create packs these files as one solid group, in this order, whatever their size
+    void AddSolidGroup(const std::vector<std::string>& filePaths);
+    //ReadFile keeps up to this many bytes of decoded entries, least recently used out first
+    //(0: no cache). Resets the statistics.
+    void SetEntryCacheBudget(UINT64 bytes);
+    UINT64 GetEntryCacheBudget() const;
+    EntryCacheStats GetEntryCacheStats() const;
+    void ClearEntryCache() const;
+    //Byte-identical files share one stored extent (size and CRC32 first, then SHA-256).
+    //Encrypted entries are never shared.
+    void EnableDeduplication(bool enable);
+    bool IsDeduplicationEnabled() const;
+    //Files of at least CHUNKED_FILE_MIN bytes are split in content-defined chunks, and a chunk
+    //already stored anywhere in the archive is referenced instead of written again
+    void EnableChunking(bool enable);
+    bool IsChunkingEnabled() const;
+    //Read-only opens share the decoded maps through SharedToc (archive path + ".toc"):
+    //the first one writes the index, the next ones map it instead of reading the maps
+    void EnableSharedToc(bool enable);
+    bool IsSharedTocEnabled() const;
+    //This open looks entries up in a mapped index
+    bool IsTocShared() const;
+
 private:
     static UINT64 GenerateFileID(const std::string& filename);
 
     bool ReadMaps();
     bool WriteMaps();
+    //Entry offset from the mapped index, or from the maps
+    bool FindEntryByName(const std::string& filename, UINT64& outOffset) const;
+    bool FindEntryByID(UINT64 fileID, UINT64& outOffset) const;
     bool RebuildArchive(); 
+    //Ready for a rewrite from offset 0: the file reopened for writing, or the Memory emptied
+    bool RestartStream(const std::string& filePath);
 
     bool ReadFileHeader(UINT64 offset, FileHeader& header, std::string& filename) const;
     bool ReadFileHeader(Stream& stream, UINT64 offset, FileHeader& header, std::string& filename) const;
-    bool WriteFileHeader(const std::string& filename, UINT64 id, UINT64 dataSize, UINT8 flags, UINT32 checksum);
+    bool WriteFileHeader(const std::string& filename, UINT64 id, UINT64 dataSize, UINT8 flags, UINT32 checksum,
+                         UINT8 codec = CODEC_NONE, const FilterSpec& filter = FilterSpec());
+
+    //Picks a codec from the file type, sampled entropy and decode budget (CODEC_NONE: store)
+    PackDecision ChooseCodec(const std::string& filename, const Blob& data, UINT8& codec) const;
+    FilterSpec FindFilter(const std::string& filePath) const;
+    //Returns the bytes to store: fileData itself, or packed when compression pays off.
+    //filter is cleared if the entry is not stored filtered.
+    const Blob& PackFileData(const std::string& filename, const Blob& fileData, Blob& packed, UINT8& flags, UINT8& codec, FilterSpec& filter);
+    bool UnpackFileData(const FileHeader& header, Blob& data) const;
+    //Decompresses a non-solid entry and reverts its filter
+    bool DecodeFileData(const FileHeader& header, const Blob& stored, Blob& outData) const;
+    //Reads part of the stored data of a file (starting at dataStart), decrypting it if needed
+    bool ReadStoredRange(UINT64 dataStart, const FileHeader& header, UINT64 offset, UINT64 size, Blob& outData) const;
 
     bool ReadArchiveHeader();
     bool WriteArchiveHeader();
 
+    //Dictionary record ("DICT" Stream::Header + data) sits at dataOffset, before the files
+    bool TrainDictionary(const std::vector<std::string>& filePaths);
+    bool ReadDictionary();
+    bool WriteDictionary(Stream& stream) const;
+    const Codec::Dictionary* GetDictionary() const;
+
+    //Each unit is written as a solid group, or as a plain entry if it holds a single file
+    std::vector<std::vector<std::string>> PlanSolidGroups(const std::vector<std::string>& filePaths) const;
+    bool WriteSolidGroup(const std::vector<std::string>& filePaths);
+    bool ReadSolidGroup(Stream& stream, UINT64 groupOffset, SolidGroupHeader& header, Blob& stored) const;
+    bool DecodeSolidGroup(const SolidGroupHeader& header, const Blob& stored, Blob& outData) const;
+    //Decoded group, served from the LRU cache when possible (shared with it, so eviction can't pull it away)
+    bool LoadSolidGroup(UINT64 groupOffset, SharedBlob& outGroup) const;
+    void ClearSolidCache() const;
+
+    //Reads, unpacks and checks an entry; takes m_readMutex for each read of the stream only
+    bool LoadEntry(UINT64 fileID, Blob& outData) const;
+
+    //Copies [offset, offset + size) of a cached entry, clamped to its size; false on a miss
+    bool ReadCachedEntry(UINT64 fileID, UINT64 offset, UINT64 size, Blob& outData) const;
+    bool FindCachedEntry(UINT64 fileID, SharedBlob& outData) const;
+    void CacheEntry(UINT64 fileID, const SharedBlob& data) const;
+    void EvictEntry(UINT64 fileID) const;
+
+    bool WriteSharedExtent(const UINT8* stored, UINT64 storedSize, UINT64 originalSize, const UINT8* hash, UINT32 refCount);
+    bool ReadSharedExtent(Stream& stream, UINT64 extentOffset, SharedExtentHeader& header, Blob* stored = nullptr) const;
+    bool ReadSharedEntry(UINT64 fileOffset, const FileHeader& header, SharedEntry& entry) const;
+    //content gives the flags, codec, filter and checksum of the extent's entries
+    bool WriteSharedEntry(const std::string& filename, UINT64 id, const FileHeader& content, UINT64 extentOffset);
+    //Finds an active entry with the same content and takes a reference on its extent,
+    //turning a plain entry into a shared one first
+    bool ShareContent(const Blob& fileData, UINT32 checksum, FileHeader& outContent, UINT64& outExtentOffset);
+    //Drops the references of a shared or chunked entry
+    void ReleaseSharedExtents(UINT64 fileOffset, const FileHeader& header);
+
+    //Writes the new chunks, then the entry; outOffset is where the entry starts
+    bool WriteChunkedEntry(const std::string& filename, UINT64 id, const Blob& fileData, UINT32 checksum, UINT64& outOffset);
+    //Looks for a stored chunk with ref.size, ref.checksum and this SHA-256; on a match
+    //takes a reference on it and fills in ref.extentOffset / ref.codec
+    bool FindChunk(const UINT8* hash, ChunkRef& ref);
+    bool ReadChunkList(const FileHeader& header, const Blob& stored, std::vector<ChunkRef>& outChunks) const;
+    //Decodes ref.size bytes to outData
+    bool DecodeChunk(const ChunkRef& ref, const Blob& stored, UINT8* outData) const;
+
+    //Map entries in archive order, for sequential passes
+    std::vector<std::pair<std::string, UINT64>> GetEntriesByOffset() const;
+
     bool WriteFileWithHeader(const std::string& filePath, UINT64& outID, UINT64& outSize);
 
     static std::string GetBasename(const std::string& path);
@@ -89,6 +310,7 @@ private:
 
     mutable Stream* m_stream;
     bool m_ownsStream;
+    Mode m_mode;
     ArchiveHeader m_header;
     std::unordered_map<std::string, UINT64> m_nameToOffset;
     std::unordered_map<UINT64, UINT64> m_idToOffset;
@@ -96,6 +318,50 @@ private:
 
     bool m_encryptionEnabled;
     std::string m_encryptionKey;
+
+    bool m_compressionEnabled;
+    UINT32 m_blockSize;
+    UINT32 m_decodeBudget;
+    PackSummary m_packSummary;
+    std::unordered_map<std::string, FilterSpec> m_extensionFilters;
+    std::unordered_map<std::string, FilterSpec> m_entryFilters;
+
+    bool m_dictionaryEnabled;
+    Codec::Dictionary m_dictionary;
+
+    static const UINT64 SOLID_ENTRY_LIMIT = 64 * 1024;
+    static const UINT64 SOLID_GROUP_LIMIT = 4 * 1024 * 1024;
+    static const UINT32 SOLID_CACHE_GROUPS = 4;
+
+    bool m_solidEnabled;
+    std::vector<std::vector<std::string>> m_solidGroups;
+    mutable std::list<std::pair<UINT64, SharedBlob>> m_solidCache;
+    mutable std::unordered_map<UINT64, std::list<std::pair<UINT64, SharedBlob>>::iterator> m_solidCacheIndex;
+    mutable std::mutex m_solidCacheMutex;
+
+    bool m_dedupEnabled;
+    //CRC32 -> entry offset of the shareable entries, built on the first AddFile that needs it
+    std::unordered_multimap<UINT32, UINT64> m_contentIndex;
+    bool m_contentIndexed;
+
+    static const UINT64 CHUNKED_FILE_MIN = 1024 * 1024;
+
+    bool m_chunkingEnabled;
+    //CRC32 -> stored chunk, built on the first chunked write that needs it
+    std::unordered_multimap<UINT32, ChunkRef> m_chunkIndex;
+    bool m_chunkIndexed;
+
+    UINT64 m_entryCacheBudget;
+    mutable EntryCacheStats m_entryCacheStats;
+    mutable std::list<std::pair<UINT64, SharedBlob>> m_entryCache;
+    mutable std::unordered_map<UINT64, std::list<std::pair<UINT64, SharedBlob>>::iterator> m_entryCacheIndex;
+    mutable std::mutex m_entryCacheMutex;
+    //Held by readers for each seek + read of the stream (see LockedStream), never while decoding
+    mutable std::mutex m_readMutex;
+
+    //When attached, m_nameToOffset and m_idToOffset stay empty
+    bool m_sharedTocEnabled;
+    SharedToc m_toc;
 };
 
 #endif // !ARCHIVE_H__
@@ -0,0 +1,220 @@
+#include "pch.h"
+
+const char* const ArchiveSet::TOMBSTONE_LIST = ".tombstones";
+
+bool ArchiveSet::Outranks(const Layer& a, const Layer& b)
+{
+    if (a.priority != b.priority)
+        return a.priority > b.priority;
+    return a.handle > b.handle;
+}
+
+UINT32 ArchiveSet::Mount(const std::string& archivePath, INT32 priority)
+{
+    std::shared_ptr<Archive> archive(new Archive());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mEncryptionKey.empty())
+            archive->SetEncryptionKey(mEncryptionKey);
+    }
+
+    if (!archive->Open(archivePath, Mode::READ))
+    {
+        std::cerr << "[ERROR] Failed to mount archive: " << archivePath << "\n";
+        return 0;
+    }
+
+    // Everything read from the archive before taking the lock
+    std::unique_ptr<Layer> layer(new Layer());
+    layer->priority = priority;
+    layer->archive = archive;
+    layer->names = archive->GetFileNames();
+    layer->names.erase(std::remove(layer->names.begin(), layer->names.end(), TOMBSTONE_LIST), layer->names.end());
+
+    Blob list;
+    if (archive->Contains(TOMBSTONE_LIST) && archive->ReadFileByName(TOMBSTONE_LIST, list))
+    {
+        std::string text(reinterpret_cast<const char*>(list.GetData()), list.GetSize());
+        size_t start = 0;
+        while (start < text.size())
+        {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos)
+                end = text.size();
+
+            std::string name = text.substr(start, end - start);
+            if (!name.empty() && name.back() == '\r')
+                name.pop_back();
+            if (!name.empty())
+                layer->tombstones.insert(name);
+            start = end + 1;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    layer->handle = mNextLayer++;
+    const Layer* mounted = layer.get();
+    auto position = std::find_if(mLayers.begin(), mLayers.end(),
+        [mounted](const std::unique_ptr<Layer>& other) { return Outranks(*mounted, *other); });
+    mLayers.insert(position, std::move(layer));
+
+    // Its own files win over its own tombstones
+    auto claim = [this, mounted](const std::string& name, bool hidden)
+    {
+        auto it = mIndex.find(name);
+        if (it == mIndex.end())
+        {
+            mIndex.emplace(name, Entry{ mounted, hidden });
+            if (!hidden)
+                mVisibleCount++;
+            return;
+        }
+
+        if (it->second.layer != mounted && !Outranks(*mounted, *it->second.layer))
+            return;
+
+        if (it->second.hidden && !hidden)
+            mVisibleCount++;
+        else if (!it->second.hidden && hidden)
+            mVisibleCount--;
+        it->second = Entry{ mounted, hidden };
+    };
+
+    for (const auto& name : mounted->tombstones)
+        claim(name, true);
+    for (const auto& name : mounted->names)
+        claim(name, false);
+
+    return mounted->handle;
+}
+
+bool ArchiveSet::Unmount(UINT32 layer)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto position = std::find_if(mLayers.begin(), mLayers.end(),
+        [layer](const std::unique_ptr<Layer>& other) { return other->handle == layer; });
+    if (position == mLayers.end())
+        return false;
+
+    // Kept alive until the names it won are resolved again
+    std::unique_ptr<Layer> removed = std::move(*position);
+    mLayers.erase(position);
+
+    std::vector<std::string> affected;
+    for (const auto& name : removed->names)
+    {
+        auto it = mIndex.find(name);
+        if (it != mIndex.end() && it->second.layer == removed.get())
+            affected.push_back(name);
+    }
+    for (const auto& name : removed->tombstones)
+    {
+        auto it = mIndex.find(name);
+        if (it != mIndex.end() && it->second.layer == removed.get())
+            affected.push_back(name);
+    }
+
+    for (const auto& name : affected)
+        Resolve(name);
+    return true;
+}
+
+void ArchiveSet::UnmountAll()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIndex.clear();
+    mLayers.clear();
+    mVisibleCount = 0;
+}
+
+void ArchiveSet::SetEncryptionKey(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEncryptionKey = key;
+}
+
+void ArchiveSet::Resolve(const std::string& name)
+{
+    auto it = mIndex.find(name);
+    if (it != mIndex.end())
+    {
+        if (!it->second.hidden)
+            mVisibleCount--;
+        mIndex.erase(it);
+    }
+
+    for (const auto& layer : mLayers)
+    {
+        bool hasFile = name != TOMBSTONE_LIST && layer->archive->Contains(name);
+        if (!hasFile && layer->tombstones.find(name) == layer->tombstones.end())
+            continue;
+
+        mIndex.emplace(name, Entry{ layer.get(), !hasFile });
+        if (hasFile)
+            mVisibleCount++;
+        return;
+    }
+}
+
+UINT32 ArchiveSet::GetLayerCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return static_cast<UINT32>(mLayers.size());
+}
+
+UINT64 ArchiveSet::GetFileCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mVisibleCount;
+}
+
+std::vector<std::string> ArchiveSet::GetFileNames() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<std::string> names;
+    names.reserve(mVisibleCount);
+    for (const auto& [name, entry] : mIndex)
+    {
+        if (!entry.hidden)
+            names.push_back(name);
+    }
+    return names;
+}
+
+bool ArchiveSet::Contains(const std::string& filename) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mIndex.find(filename);
+    return it != mIndex.end() && !it->second.hidden;
+}
+
+std::shared_ptr<Archive> ArchiveSet::Find(const std::string& filename) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mIndex.find(filename);
+    if (it == mIndex.end() || it->second.hidden)
+        return nullptr;
+    return it->second.layer->archive;
+}
+
+// The archive is held while reading: an Unmount meanwhile doesn't close it under us
+bool ArchiveSet::ReadFile(const std::string& filename, Blob& outData) const
+{
+    std::shared_ptr<Archive> archive = Find(filename);
+    return archive != nullptr && archive->ReadFileByName(filename, outData);
+}
+
+bool ArchiveSet::ReadRange(const std::string& filename, UINT64 offset, UINT64 size, Blob& outData) const
+{
+    std::shared_ptr<Archive> archive = Find(filename);
+    return archive != nullptr && archive->ReadRangeByName(filename, offset, size, outData);
+}
+
+bool ArchiveSet::Extract(const std::string& filename, const std::string& outputPath) const
+{
+    std::shared_ptr<Archive> archive = Find(filename);
+    return archive != nullptr && archive->ExtractByName(filename, outputPath);
+}
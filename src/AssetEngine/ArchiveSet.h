@@ -0,0 +1,70 @@
+#ifndef ARCHIVESET_H__
+#define ARCHIVESET_H__
+
+// Archives mounted as layers of one file system (base game, then DLCs and patches).
+// A single name index points every name at the layer that wins it, so a lookup is
+// one probe whatever the number of layers.
+// A layer can hide names of the layers below it: its TOMBSTONE_LIST entry holds
+// one name per line.
+class ArchiveSet
+{
+public:
+    static const char* const TOMBSTONE_LIST;
+
+    ArchiveSet() : mNextLayer(1) {}
+
+    ArchiveSet(const ArchiveSet&) = delete;
+    ArchiveSet& operator=(const ArchiveSet&) = delete;
+
+    //Higher priority wins; equal priorities: the latest mount wins.
+    //Returns the layer handle for Unmount (0: the archive could not be opened).
+    UINT32 Mount(const std::string& archivePath, INT32 priority = 0);
+    bool Unmount(UINT32 layer);
+    void UnmountAll();
+    //Used to open the archives mounted after this call
+    void SetEncryptionKey(const std::string& key);
+
+    UINT32 GetLayerCount() const;
+    //Visible files
+    UINT64 GetFileCount() const;
+    std::vector<std::string> GetFileNames() const;
+
+    bool Contains(const std::string& filename) const;
+    //Archive holding the visible version of filename (nullptr if none)
+    std::shared_ptr<Archive> Find(const std::string& filename) const;
+
+    bool ReadFile(const std::string& filename, Blob& outData) const;
+    bool ReadRange(const std::string& filename, UINT64 offset, UINT64 size, Blob& outData) const;
+    bool Extract(const std::string& filename, const std::string& outputPath) const;
+
+private:
+    struct Layer
+    {
+        UINT32                              handle;
+        INT32                               priority;
+        std::shared_ptr<Archive>            archive;
+        std::vector<std::string>            names;
+        std::unordered_set<std::string>     tombstones;
+    };
+
+    // Winner of a name: a file of layer, or a tombstone of layer
+    struct Entry
+    {
+        const Layer*    layer;
+        bool            hidden;
+    };
+
+    //Layers sorted highest first
+    static bool Outranks(const Layer& a, const Layer& b);
+    //Recomputes the winner of name from the mounted layers
+    void Resolve(const std::string& name);
+
+    std::vector<std::unique_ptr<Layer>> mLayers;
+    std::unordered_map<std::string, Entry> mIndex;
+    UINT64 mVisibleCount = 0;
+    UINT32 mNextLayer;
+    std::string mEncryptionKey;
+    mutable std::mutex mMutex;
+};
+
+#endif // !ARCHIVESET_H__
@@ -0,0 +1,833 @@
+#include "pch.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const UINT64 INVALID_CONNECTION = ~0ull;
+    // Largest single send / recv (Winsock takes an int)
+    const UINT64 MAX_TRANSFER = 1024 * 1024;
+
+#if defined(_WIN32)
+    typedef SOCKET NativeSocket;
+    const int SEND_FLAGS = 0;
+
+    NativeSocket ToNative(UINT64 connection) { return static_cast<NativeSocket>(connection); }
+    UINT64 FromNative(NativeSocket socket) { return socket == INVALID_SOCKET ? INVALID_CONNECTION : static_cast<UINT64>(socket); }
+
+    bool InitSockets()
+    {
+        static bool ready = []()
+        {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return ready;
+    }
+
+    void CloseConnection(UINT64 connection) { closesocket(ToNative(connection)); }
+    void ShutdownConnection(UINT64 connection) { shutdown(ToNative(connection), SD_BOTH); }
+
+    bool WaitReadable(UINT64 connection, int timeoutMs)
+    {
+        WSAPOLLFD entry = {};
+        entry.fd = ToNative(connection);
+        entry.events = POLLRDNORM;
+        return WSAPoll(&entry, 1, timeoutMs) > 0;
+    }
+#else
+    typedef int NativeSocket;
+    // A client gone mid-response must not kill the server with SIGPIPE
+    const int SEND_FLAGS = MSG_NOSIGNAL;
+
+    NativeSocket ToNative(UINT64 connection) { return static_cast<NativeSocket>(connection); }
+    UINT64 FromNative(NativeSocket socket) { return socket < 0 ? INVALID_CONNECTION : static_cast<UINT64>(socket); }
+
+    bool InitSockets() { return true; }
+
+    void CloseConnection(UINT64 connection) { close(ToNative(connection)); }
+    void ShutdownConnection(UINT64 connection) { shutdown(ToNative(connection), SHUT_RDWR); }
+
+    bool WaitReadable(UINT64 connection, int timeoutMs)
+    {
+        pollfd entry = {};
+        entry.fd = ToNative(connection);
+        entry.events = POLLIN;
+        return poll(&entry, 1, timeoutMs) > 0;
+    }
+#endif
+
+    bool SendAll(UINT64 connection, const void* data, UINT64 size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0)
+        {
+            int sent = send(ToNative(connection), bytes, static_cast<int>(std::min(size, MAX_TRANSFER)), SEND_FLAGS);
+            if (sent <= 0)
+                return false;
+            bytes += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    bool RecvAll(UINT64 connection, void* data, UINT64 size)
+    {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0)
+        {
+            int received = recv(ToNative(connection), bytes, static_cast<int>(std::min(size, MAX_TRANSFER)), 0);
+            if (received <= 0)
+                return false;
+            bytes += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    bool FillAddress(const std::string& path, sockaddr_un& address)
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path))
+            return false;
+        memcpy(address.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+    UINT64 Listen(const std::string& path)
+    {
+        sockaddr_un address;
+        if (!InitSockets() || !FillAddress(path, address))
+            return INVALID_CONNECTION;
+
+        UINT64 listener = FromNative(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (listener == INVALID_CONNECTION)
+            return INVALID_CONNECTION;
+
+        // A socket file left by a previous server would make bind fail
+        remove(path.c_str());
+        if (bind(ToNative(listener), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(ToNative(listener), SOMAXCONN) != 0)
+        {
+            CloseConnection(listener);
+            return INVALID_CONNECTION;
+        }
+        return listener;
+    }
+
+    UINT64 ConnectTo(const std::string& path)
+    {
+        sockaddr_un address;
+        if (!InitSockets() || !FillAddress(path, address))
+            return INVALID_CONNECTION;
+
+        UINT64 connection = FromNative(socket(AF_UNIX, SOCK_STREAM, 0));
+        if (connection == INVALID_CONNECTION)
+            return INVALID_CONNECTION;
+
+        if (connect(ToNative(connection), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            CloseConnection(connection);
+            return INVALID_CONNECTION;
+        }
+        return connection;
+    }
+
+    // === Shared payloads ===
+#if defined(_WIN32)
+    // Process of the client: sections are duplicated into it
+    void* OpenPeer(UINT64 connection)
+    {
+        ULONG pid = 0;
+        DWORD returned = 0;
+        if (WSAIoctl(ToNative(connection), SIO_AF_UNIX_GETPEERPID, nullptr, 0, &pid, sizeof(pid), &returned, nullptr, nullptr) != 0)
+            return nullptr;
+        return OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid);
+    }
+
+    void ClosePeer(void* peer)
+    {
+        if (peer != nullptr)
+            CloseHandle(peer);
+    }
+
+    // Pagefile-backed section of size bytes, mapped for writing
+    void* CreateSection(UINT64 size, UINT64& outSection)
+    {
+        HANDLE section = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                            static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+        if (section == nullptr)
+            return nullptr;
+
+        void* view = MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, size);
+        if (view == nullptr)
+        {
+            CloseHandle(section);
+            return nullptr;
+        }
+        outSection = reinterpret_cast<UINT64>(section);
+        return view;
+    }
+
+    void CloseSection(void* view, UINT64, UINT64 section)
+    {
+        UnmapViewOfFile(view);
+        CloseHandle(reinterpret_cast<HANDLE>(section));
+    }
+
+    // Hands a read-only handle to the section holding the payload to the client
+    bool SendShared(UINT64 connection, void* peer, ServerResponse& response, UINT64 section)
+    {
+        HANDLE remote = nullptr;
+        if (peer == nullptr ||
+            !DuplicateHandle(GetCurrentProcess(), reinterpret_cast<HANDLE>(section), static_cast<HANDLE>(peer), &remote, FILE_MAP_READ, FALSE, 0))
+            return false;
+
+        response.shared = 1;
+        response.handle = reinterpret_cast<UINT64>(remote);
+        return SendAll(connection, &response, sizeof(ServerResponse));
+    }
+
+    bool ReceiveHeader(UINT64 connection, ServerResponse& response, UINT64& outSection)
+    {
+        if (!RecvAll(connection, &response, sizeof(ServerResponse)))
+            return false;
+        outSection = response.shared ? response.handle : 0;
+        return true;
+    }
+
+    // The view stays mapped as long as the SharedBlob is referenced
+    bool ReadSection(UINT64 section, UINT64 size, SharedBlob& outData)
+    {
+        HANDLE handle = reinterpret_cast<HANDLE>(section);
+        const void* view = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+        CloseHandle(handle);
+        if (view == nullptr)
+            return false;
+
+        outData = SharedBlob(static_cast<const UINT8*>(view), size, [view]() { UnmapViewOfFile(view); });
+        return true;
+    }
+#else
+    void* OpenPeer(UINT64) { return nullptr; }
+    void ClosePeer(void*) {}
+
+    // memfd of size bytes, mapped for writing
+    void* CreateSection(UINT64 size, UINT64& outSection)
+    {
+        int section = memfd_create("asset_payload", MFD_CLOEXEC);
+        if (section < 0)
+            return nullptr;
+
+        void* view = MAP_FAILED;
+        if (ftruncate(section, static_cast<off_t>(size)) == 0)
+            view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, section, 0);
+        if (view == MAP_FAILED)
+        {
+            close(section);
+            return nullptr;
+        }
+        outSection = static_cast<UINT64>(section);
+        return view;
+    }
+
+    void CloseSection(void* view, UINT64 size, UINT64 section)
+    {
+        munmap(view, size);
+        close(static_cast<int>(section));
+    }
+
+    // Passes the memfd holding the payload with the response
+    bool SendShared(UINT64 connection, void*, ServerResponse& response, UINT64 section)
+    {
+        int descriptor = static_cast<int>(section);
+        response.shared = 1;
+
+        iovec data = { &response, sizeof(ServerResponse) };
+        char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+
+        ssize_t sent = sendmsg(ToNative(connection), &message, SEND_FLAGS);
+
+        // The descriptor went with the first byte: the rest is plain data
+        if (sent <= 0)
+            return false;
+        return SendAll(connection, reinterpret_cast<const char*>(&response) + sent, sizeof(ServerResponse) - sent);
+    }
+
+    bool ReceiveHeader(UINT64 connection, ServerResponse& response, UINT64& outSection)
+    {
+        iovec data = { &response, sizeof(ServerResponse) };
+        char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(ToNative(connection), &message, MSG_CMSG_CLOEXEC);
+        if (received <= 0)
+            return false;
+
+        int section = -1;
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (header != nullptr && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+            memcpy(&section, CMSG_DATA(header), sizeof(int));
+
+        bool complete = RecvAll(connection, reinterpret_cast<char*>(&response) + received, sizeof(ServerResponse) - received);
+        if (!complete || !response.shared || section < 0)
+        {
+            if (section >= 0)
+                close(section);
+            return complete && !response.shared;
+        }
+
+        outSection = static_cast<UINT64>(section);
+        return true;
+    }
+
+    // The mapping stays as long as the SharedBlob is referenced
+    bool ReadSection(UINT64 section, UINT64 size, SharedBlob& outData)
+    {
+        // A memfd shorter than announced would fault on access instead of failing here
+        int descriptor = static_cast<int>(section);
+        struct stat info;
+        void* view = MAP_FAILED;
+        if (size > 0 && fstat(descriptor, &info) == 0 && static_cast<UINT64>(info.st_size) >= size)
+            view = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (view == MAP_FAILED)
+            return false;
+
+        outData = SharedBlob(static_cast<const UINT8*>(view), size, [view, size]() { munmap(view, size); });
+        return true;
+    }
+#endif
+
+    // Large blocks live in sections the server can hand over as they are: an entry decoded
+    // into a Blob of this allocator is decoded straight into the client's shared memory.
+    // Smaller ones come from the heap. One per connection, used by its worker only.
+    class SectionAllocator : public Allocator
+    {
+    public:
+        ~SectionAllocator() override
+        {
+            for (const auto& [view, section] : mSections)
+                CloseSection(view, section.first, section.second);
+        }
+
+        void* Allocate(UINT64 size, UINT64& outCapacity) override
+        {
+            if (size < AssetServer::SHARED_PAYLOAD_MIN)
+                return Allocator::GetHeap().Allocate(size, outCapacity);
+
+            UINT64 section = 0;
+            void* view = CreateSection(size, section);
+            if (view == nullptr)
+                return nullptr;
+
+            mSections[view] = { size, section };
+            outCapacity = size;
+            OnAllocate(size);
+            return view;
+        }
+
+        void Free(void* block, UINT64 capacity) override
+        {
+            auto found = mSections.find(block);
+            if (found == mSections.end())
+            {
+                Allocator::GetHeap().Free(block, capacity);
+                return;
+            }
+
+            CloseSection(block, found->second.first, found->second.second);
+            mSections.erase(found);
+            OnFree(capacity);
+        }
+
+        //Section holding exactly the size bytes at data (false: a heap block, or only part of a section)
+        bool FindSection(const void* data, UINT64 size, UINT64& outSection) const
+        {
+            auto found = mSections.find(const_cast<void*>(data));
+            if (found == mSections.end() || found->second.first != size)
+                return false;
+            outSection = found->second.second;
+            return true;
+        }
+
+    private:
+        // view -> (mapped size, handle or descriptor)
+        std::unordered_map<void*, std::pair<UINT64, UINT64>> mSections;
+    };
+}
+
+// === AssetServer ===
+
+AssetServer::AssetServer() :
+    mEntryCacheBudget(0),
+    mWorkerCount(0),
+    mListener(INVALID_CONNECTION),
+    mRunning(false),
+    mConnections(0),
+    mRequests(0),
+    mFound(0),
+    mNotFound(0),
+    mErrors(0),
+    mBytesServed(0),
+    mSharedPayloads(0)
+{
+}
+
+AssetServer::~AssetServer()
+{
+    Stop();
+}
+
+bool AssetServer::Mount(const std::string& archivePath)
+{
+    if (mRunning)
+        return false;
+
+    std::unique_ptr<Archive> archive(new Archive());
+    if (!archive->Open(archivePath, Mode::READ))
+    {
+        std::cerr << "[ERROR] Failed to open archive: " << archivePath << "\n";
+        return false;
+    }
+
+    archive->SetEntryCacheBudget(mEntryCacheBudget);
+    mArchives.push_back(std::move(archive));
+    return true;
+}
+
+void AssetServer::SetEntryCacheBudget(UINT64 bytes)
+{
+    mEntryCacheBudget = bytes;
+    for (auto& archive : mArchives)
+        archive->SetEntryCacheBudget(bytes);
+}
+
+void AssetServer::SetWorkerCount(UINT32 count)
+{
+    mWorkerCount = count;
+}
+
+bool AssetServer::Start(const std::string& socketPath)
+{
+    if (mRunning)
+        return false;
+
+    mListener = Listen(socketPath);
+    if (mListener == INVALID_CONNECTION)
+    {
+        std::cerr << "[ERROR] Failed to listen on: " << socketPath << "\n";
+        return false;
+    }
+
+    mSocketPath = socketPath;
+    mRunning = true;
+
+    UINT32 workers = mWorkerCount != 0 ? mWorkerCount : std::max(1u, std::thread::hardware_concurrency());
+    for (UINT32 i = 0; i < workers; i++)
+        mWorkers.emplace_back(&AssetServer::WorkerLoop, this);
+    mAcceptor = std::thread(&AssetServer::AcceptLoop, this);
+    return true;
+}
+
+void AssetServer::Stop()
+{
+    if (!mRunning.exchange(false))
+        return;
+
+    mAcceptor.join();
+
+    {
+        // Unblocks the workers waiting on their client
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (UINT64 connection : mOpenConnections)
+            ShutdownConnection(connection);
+    }
+    mWake.notify_all();
+
+    for (auto& worker : mWorkers)
+        worker.join();
+    mWorkers.clear();
+
+    for (UINT64 connection : mPending)
+        CloseConnection(connection);
+    mPending.clear();
+    mOpenConnections.clear();
+
+    CloseConnection(mListener);
+    mListener = INVALID_CONNECTION;
+    remove(mSocketPath.c_str());
+}
+
+ServerStats AssetServer::GetStats() const
+{
+    ServerStats stats;
+    stats.connections = mConnections.load();
+    stats.requests = mRequests.load();
+    stats.found = mFound.load();
+    stats.notFound = mNotFound.load();
+    stats.errors = mErrors.load();
+    stats.bytesServed = mBytesServed.load();
+    stats.sharedPayloads = mSharedPayloads.load();
+    return stats;
+}
+
+void AssetServer::AcceptLoop()
+{
+    while (mRunning)
+    {
+        // Wakes up now and then to notice Stop
+        if (!WaitReadable(mListener, 100))
+            continue;
+
+        UINT64 connection = FromNative(accept(ToNative(mListener), nullptr, nullptr));
+        if (connection == INVALID_CONNECTION)
+            continue;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPending.push_back(connection);
+            mOpenConnections.push_back(connection);
+        }
+        mConnections++;
+        mWake.notify_one();
+    }
+}
+
+void AssetServer::WorkerLoop()
+{
+    while (true)
+    {
+        UINT64 connection;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return !mPending.empty() || !mRunning; });
+            if (!mRunning)
+                return;
+
+            connection = mPending.front();
+            mPending.pop_front();
+        }
+
+        ServeConnection(connection);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mOpenConnections.erase(std::find(mOpenConnections.begin(), mOpenConnections.end(), connection));
+            CloseConnection(connection);
+        }
+    }
+}
+
+void AssetServer::ServeConnection(UINT64 connection)
+{
+    void* peer = OpenPeer(connection);
+    SectionAllocator sections;
+
+    while (mRunning)
+    {
+        ServerRequest request;
+        if (!RecvAll(connection, &request, sizeof(ServerRequest)))
+            break;
+
+        mRequests++;
+
+        ServerResponse response = {};
+        memcpy(response.magic, "ASRP", 4);
+
+        if (memcmp(request.magic, "ASRQ", 4) != 0 || request.nameLength > MAX_NAME_LENGTH)
+        {
+            // The stream can't be trusted past a bad header
+            mErrors++;
+            response.status = SERVER_BAD_REQUEST;
+            SendAll(connection, &response, sizeof(ServerResponse));
+            break;
+        }
+
+        std::string name(request.nameLength, '\0');
+        if (request.nameLength > 0 && !RecvAll(connection, &name[0], request.nameLength))
+            break;
+
+        if (request.op == SERVER_STATS)
+        {
+            if (!SendStats(connection))
+                break;
+            continue;
+        }
+
+        // Every Blob the lookup builds is a section from a size that can be shared:
+        // the decoded entry ends up in one, ready to hand over
+        Blob payload(sections);
+        ServerStatus status;
+        {
+            AllocatorScope scope(sections);
+            status = Lookup(request, name, payload);
+        }
+        response.status = status;
+
+        if (status == SERVER_OK) mFound++;
+        else if (status == SERVER_NOT_FOUND) mNotFound++;
+        else mErrors++;
+
+        if (status != SERVER_OK)
+        {
+            if (!SendAll(connection, &response, sizeof(ServerResponse)))
+                break;
+            continue;
+        }
+
+        response.size = payload.GetSize();
+        UINT64 section = 0;
+        bool sent;
+        if (response.size >= SHARED_PAYLOAD_MIN && sections.FindSection(payload.GetData(), response.size, section) &&
+            SendShared(connection, peer, response, section))
+        {
+            mSharedPayloads++;
+            sent = true;
+        }
+        else
+        {
+            response.shared = 0;
+            response.handle = 0;
+            sent = SendAll(connection, &response, sizeof(ServerResponse)) &&
+                   SendAll(connection, payload.GetData(), payload.GetSize());
+        }
+
+        if (!sent)
+            break;
+        mBytesServed += response.size;
+    }
+
+    ClosePeer(peer);
+}
+
+ServerStatus AssetServer::Lookup(const ServerRequest& request, const std::string& name, Blob& payload)
+{
+    bool byName = !name.empty();
+    if ((request.op == SERVER_GET_NAME && !byName) || (request.op == SERVER_GET_ID && byName))
+        return SERVER_BAD_REQUEST;
+    if (request.op != SERVER_GET_NAME && request.op != SERVER_GET_ID && request.op != SERVER_GET_RANGE)
+        return SERVER_BAD_REQUEST;
+
+    for (const auto& archive : mArchives)
+    {
+        if (byName ? !archive->Contains(name) : !archive->Contains(request.id))
+            continue;
+
+        bool read;
+        if (request.op == SERVER_GET_RANGE)
+            read = byName ? archive->ReadRangeByName(name, request.offset, request.size, payload)
+                          : archive->ReadRange(request.id, request.offset, request.size, payload);
+        else
+            read = byName ? archive->ReadFileByName(name, payload) : archive->ReadFile(request.id, payload);
+
+        return read ? SERVER_OK : SERVER_ERROR;
+    }
+
+    return SERVER_NOT_FOUND;
+}
+
+bool AssetServer::SendStats(UINT64 connection)
+{
+    ServerStats stats = GetStats();
+
+    ServerResponse response = {};
+    memcpy(response.magic, "ASRP", 4);
+    response.status = SERVER_OK;
+    response.size = sizeof(ServerStats);
+
+    return SendAll(connection, &response, sizeof(ServerResponse)) && SendAll(connection, &stats, sizeof(ServerStats));
+}
+
+// === AssetClient ===
+
+AssetClient::AssetClient() :
+    mSocket(INVALID_CONNECTION),
+    mLastStatus(SERVER_OK)
+{
+}
+
+AssetClient::~AssetClient()
+{
+    Close();
+}
+
+bool AssetClient::Connect(const std::string& socketPath)
+{
+    Close();
+    mSocket = ConnectTo(socketPath);
+    return mSocket != INVALID_CONNECTION;
+}
+
+void AssetClient::Close()
+{
+    if (mSocket == INVALID_CONNECTION)
+        return;
+    CloseConnection(mSocket);
+    mSocket = INVALID_CONNECTION;
+}
+
+bool AssetClient::IsConnected() const
+{
+    return mSocket != INVALID_CONNECTION;
+}
+
+bool AssetClient::GetByName(const std::string& filename, Blob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_NAME;
+    return Request(request, filename, outData);
+}
+
+bool AssetClient::GetByID(UINT64 fileID, Blob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_ID;
+    request.id = fileID;
+    return Request(request, std::string(), outData);
+}
+
+bool AssetClient::GetRange(const std::string& filename, UINT64 offset, UINT64 size, Blob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_RANGE;
+    request.offset = offset;
+    request.size = size;
+    return Request(request, filename, outData);
+}
+
+bool AssetClient::GetRange(UINT64 fileID, UINT64 offset, UINT64 size, Blob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_RANGE;
+    request.id = fileID;
+    request.offset = offset;
+    request.size = size;
+    return Request(request, std::string(), outData);
+}
+
+bool AssetClient::GetByName(const std::string& filename, SharedBlob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_NAME;
+    return Request(request, filename, outData);
+}
+
+bool AssetClient::GetByID(UINT64 fileID, SharedBlob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_ID;
+    request.id = fileID;
+    return Request(request, std::string(), outData);
+}
+
+bool AssetClient::GetRange(const std::string& filename, UINT64 offset, UINT64 size, SharedBlob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_RANGE;
+    request.offset = offset;
+    request.size = size;
+    return Request(request, filename, outData);
+}
+
+bool AssetClient::GetRange(UINT64 fileID, UINT64 offset, UINT64 size, SharedBlob& outData)
+{
+    ServerRequest request = {};
+    request.op = SERVER_GET_RANGE;
+    request.id = fileID;
+    request.offset = offset;
+    request.size = size;
+    return Request(request, std::string(), outData);
+}
+
+bool AssetClient::GetStats(ServerStats& outStats)
+{
+    ServerRequest request = {};
+    request.op = SERVER_STATS;
+
+    Blob data;
+    if (!Request(request, std::string(), data) || data.GetSize() != sizeof(ServerStats))
+        return false;
+
+    memcpy(&outStats, data.GetData(), sizeof(ServerStats));
+    return true;
+}
+
+bool AssetClient::Request(const ServerRequest& request, const std::string& name, SharedBlob& outData)
+{
+    outData = SharedBlob();
+    mLastStatus = SERVER_ERROR;
+    if (mSocket == INVALID_CONNECTION || name.size() > AssetServer::MAX_NAME_LENGTH)
+        return false;
+
+    ServerRequest header = request;
+    memcpy(header.magic, "ASRQ", 4);
+    header.nameLength = static_cast<UINT32>(name.size());
+
+    ServerResponse response;
+    UINT64 section = 0;
+    if (!SendAll(mSocket, &header, sizeof(ServerRequest)) || (!name.empty() && !SendAll(mSocket, name.data(), name.size())) ||
+        !ReceiveHeader(mSocket, response, section) || memcmp(response.magic, "ASRP", 4) != 0)
+    {
+        // Out of step with the server: this connection is done
+        Close();
+        return false;
+    }
+
+    mLastStatus = static_cast<ServerStatus>(response.status);
+    if (mLastStatus != SERVER_OK)
+        return false;
+
+    if (response.shared)
+        return ReadSection(section, response.size, outData);
+
+    Blob data;
+    if (!data.Resize(response.size) || (response.size > 0 && !RecvAll(mSocket, data.GetData(), response.size)))
+    {
+        Close();
+        return false;
+    }
+    outData = SharedBlob(std::move(data));
+    return true;
+}
+
+bool AssetClient::Request(const ServerRequest& request, const std::string& name, Blob& outData)
+{
+    SharedBlob data;
+    if (!Request(request, name, data) || !outData.Resize(data.GetSize()))
+        return false;
+
+    if (data.GetSize() > 0)
+        memcpy(outData.GetData(), data.GetData(), data.GetSize());
+    return true;
+}
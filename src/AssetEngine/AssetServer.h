@@ -0,0 +1,154 @@
+#ifndef ASSETSERVER_H__
+#define ASSETSERVER_H__
+
+enum ServerOp : UINT32
+{
+    SERVER_GET_NAME  = 1,
+    SERVER_GET_ID    = 2,
+    SERVER_GET_RANGE = 3,   // by name, or by id when the name is empty
+    SERVER_STATS     = 4
+};
+
+enum ServerStatus : UINT32
+{
+    SERVER_OK          = 0,
+    SERVER_NOT_FOUND   = 1,
+    SERVER_BAD_REQUEST = 2,
+    SERVER_ERROR       = 3
+};
+
+// Followed by nameLength bytes of name
+struct ServerRequest
+{
+    char     magic[4];      // "ASRQ"
+    UINT32   op;
+    UINT64   id;
+    UINT64   offset;
+    UINT64   size;
+    UINT32   nameLength;
+    UINT32   padding;
+};
+
+// Followed by size bytes of payload, unless it is shared: the payload then sits in the
+// memory section it was decoded into, handed over with the response (memfd + SCM_RIGHTS,
+// or a duplicated section handle on Windows), which the client maps.
+struct ServerResponse
+{
+    char     magic[4];      // "ASRP"
+    UINT32   status;
+    UINT64   size;
+    UINT32   shared;
+    UINT32   padding;
+    UINT64   handle;        // Windows: section handle valid in the client process
+};
+
+struct ServerStats
+{
+    UINT64   connections;
+    UINT64   requests;
+    UINT64   found;
+    UINT64   notFound;
+    UINT64   errors;
+    UINT64   bytesServed;
+    UINT64   sharedPayloads;
+};
+
+// Serves entries of a set of archives to local processes over a Unix domain socket.
+// Every archive is opened once with the process-wide block cache and its own entry
+// cache, so all the clients share one page cache and one verified (CRC32) cache.
+class AssetServer
+{
+public:
+    //Payloads this large are handed over in a shared section instead of the socket
+    static const UINT64 SHARED_PAYLOAD_MIN = 64 * 1024;
+    static const UINT32 MAX_NAME_LENGTH = 4096;
+
+    AssetServer();
+    ~AssetServer();
+
+    AssetServer(const AssetServer&) = delete;
+    AssetServer& operator=(const AssetServer&) = delete;
+
+    //Lookups try the archives in mount order
+    bool Mount(const std::string& archivePath);
+    //Decoded entries kept per archive (0: none)
+    void SetEntryCacheBudget(UINT64 bytes);
+    //Each worker serves one connection at a time (0: one per hardware thread)
+    void SetWorkerCount(UINT32 count);
+
+    bool Start(const std::string& socketPath);
+    void Stop();
+    bool IsRunning() const { return mRunning.load(); }
+
+    ServerStats GetStats() const;
+
+private:
+    void AcceptLoop();
+    void WorkerLoop();
+    void ServeConnection(UINT64 connection);
+    //Fills payload from the first archive holding the entry
+    ServerStatus Lookup(const ServerRequest& request, const std::string& name, Blob& payload);
+    bool SendStats(UINT64 connection);
+
+    std::vector<std::unique_ptr<Archive>> mArchives;
+    UINT64 mEntryCacheBudget;
+    UINT32 mWorkerCount;
+
+    std::string mSocketPath;
+    UINT64 mListener;
+    std::atomic<bool> mRunning;
+    std::thread mAcceptor;
+    std::vector<std::thread> mWorkers;
+
+    std::deque<UINT64> mPending;
+    std::vector<UINT64> mOpenConnections;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+
+    std::atomic<UINT64> mConnections;
+    std::atomic<UINT64> mRequests;
+    std::atomic<UINT64> mFound;
+    std::atomic<UINT64> mNotFound;
+    std::atomic<UINT64> mErrors;
+    std::atomic<UINT64> mBytesServed;
+    std::atomic<UINT64> mSharedPayloads;
+};
+
+// Client side of AssetServer; one request at a time per client
+class AssetClient
+{
+public:
+    AssetClient();
+    ~AssetClient();
+
+    AssetClient(const AssetClient&) = delete;
+    AssetClient& operator=(const AssetClient&) = delete;
+
+    bool Connect(const std::string& socketPath);
+    void Close();
+    bool IsConnected() const;
+
+    bool GetByName(const std::string& filename, Blob& outData);
+    bool GetByID(UINT64 fileID, Blob& outData);
+    bool GetRange(const std::string& filename, UINT64 offset, UINT64 size, Blob& outData);
+    bool GetRange(UINT64 fileID, UINT64 offset, UINT64 size, Blob& outData);
+    //A shared payload is handed out as the mapping itself, without a copy (unmapped with
+    //the last reference); smaller ones are received from the socket
+    bool GetByName(const std::string& filename, SharedBlob& outData);
+    bool GetByID(UINT64 fileID, SharedBlob& outData);
+    bool GetRange(const std::string& filename, UINT64 offset, UINT64 size, SharedBlob& outData);
+    bool GetRange(UINT64 fileID, UINT64 offset, UINT64 size, SharedBlob& outData);
+    bool GetStats(ServerStats& outStats);
+
+    //Status of the last request
+    ServerStatus GetLastStatus() const { return mLastStatus; }
+
+private:
+    bool Request(const ServerRequest& request, const std::string& name, SharedBlob& outData);
+    bool Request(const ServerRequest& request, const std::string& name, Blob& outData);
+
+    UINT64 mSocket;
+    ServerStatus mLastStatus;
+};
+
+#endif // !ASSETSERVER_H__
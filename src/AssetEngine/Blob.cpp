@@ -2,9 +2,33 @@
 
 bool Blob::Realloc(UINT64 newCapacity)
 {
-	if (newCapacity == mCapacity) return true;
+	if (newCapacity == mCapacity && !NeedsBlock()) return true;
+
+	// Small enough for the inline buffer: give the block back
+	if (newCapacity <= INLINE_CAPACITY && mpAllocator->AllowsInline())
+	{
+		if (IsInline()) return true;
+
+		memcpy(mInline, mpData, mSize);
+		mpAllocator->Free(mpData, mCapacity);
+		mpData = mInline;
+		mCapacity = INLINE_CAPACITY;
+		return true;
+	}
+
+	UINT64 capacity = 0;
+	UINT8* temp = nullptr;
+	if (IsInline())
+	{
+		temp = (UINT8*)mpAllocator->Allocate(newCapacity * sizeof(UINT8), capacity);
+		if (temp != nullptr)
+			memcpy(temp, mInline, mSize);
+	}
+	else
+	{
+		temp = (UINT8*)mpAllocator->Reallocate(mpData, mCapacity, mSize, newCapacity * sizeof(UINT8), capacity);
+	}
 
-	UINT8* temp = (UINT8*)realloc(mpData, newCapacity * sizeof(UINT8));
 	if (temp == nullptr)
 	{
 		std::cout << "[ERROR][BLOB] Realloc failed" << std::endl;
@@ -12,38 +36,54 @@ bool Blob::Realloc(UINT64 newCapacity)
 	}
 
 	mpData = temp;
-	mCapacity = newCapacity;
+	mCapacity = capacity;
 
 	return true;
 }
 
+bool Blob::Grow(UINT64 required)
+{
+	if (required <= mCapacity && !NeedsBlock()) return true;
+
+	UINT64 newCapacity = mCapacity + mCapacity / 2;
+	if (newCapacity < required)
+		newCapacity = required;
+	return Realloc(newCapacity);
+}
+
+void Blob::ResetInline()
+{
+	mpData = mInline;
+	mCapacity = INLINE_CAPACITY;
+	mSize = 0;
+}
+
 Blob::Blob() :
-	mpData(nullptr),
-	mCapacity(256),
-	mSize(0)
+	mpData(mInline),
+	mCapacity(INLINE_CAPACITY),
+	mSize(0),
+	mpAllocator(&Allocator::GetCurrent())
+{
+}
+
+Blob::Blob(Allocator& allocator) :
+	mpData(mInline),
+	mCapacity(INLINE_CAPACITY),
+	mSize(0),
+	mpAllocator(&allocator)
 {
-	mpData = (UINT8*)malloc(mCapacity * sizeof(UINT8));
-	if (mpData == nullptr)
-	{
-		std::cout << "[ERROR][BLOB] malloc failed" << std::endl;
-		mCapacity = 0;
-		return;
-	}
 }
 
 Blob::Blob(const UINT8* pData, UINT64 amount) :
-	mpData(nullptr),
-	mCapacity(amount),
-	mSize(amount)
+	mpData(mInline),
+	mCapacity(INLINE_CAPACITY),
+	mSize(0),
+	mpAllocator(&Allocator::GetCurrent())
 {
-	mpData = (UINT8*)malloc(mCapacity * sizeof(UINT8));
-	if (mpData == nullptr)
-	{
-		std::cout << "[ERROR][BLOB] malloc failed" << std::endl;
-		mSize = 0;
-		mCapacity = 0;
+	if (!Reserve(amount))
 		return;
-	}
+
+	mSize = amount;
 	if (pData != nullptr)
 	{
 		memcpy(mpData, pData, amount * sizeof(UINT8));
@@ -52,7 +92,8 @@ Blob::Blob(const UINT8* pData, UINT64 amount) :
 
 Blob::~Blob()
 {
-	free(mpData);
+	if (!IsInline())
+		mpAllocator->Free(mpData, mCapacity);
 	mpData = nullptr;
 }
 
@@ -60,12 +101,17 @@ Blob::~Blob()
 Blob::Blob(Blob&& other) noexcept :
 	mpData(other.mpData),
 	mCapacity(other.mCapacity),
-	mSize(other.mSize)
+	mSize(other.mSize),
+	mpAllocator(other.mpAllocator)
 {
-	// Steal resources from other
-	other.mpData = nullptr;
-	other.mCapacity = 0;
-	other.mSize = 0;
+	// Inline bytes are copied, heap blocks are stolen
+	if (other.IsInline())
+	{
+		mpData = mInline;
+		memcpy(mInline, other.mInline, mSize);
+	}
+
+	other.ResetInline();
 }
 
 // Move assignment
@@ -74,17 +120,22 @@ Blob& Blob::operator=(Blob&& other) noexcept
 	if (this != &other)
 	{
 		// Free existing resources
-		free(mpData);
+		if (!IsInline())
+			mpAllocator->Free(mpData, mCapacity);
 
-		// Steal resources from other
 		mpData = other.mpData;
 		mCapacity = other.mCapacity;
 		mSize = other.mSize;
+		mpAllocator = other.mpAllocator;
+
+		if (other.IsInline())
+		{
+			mpData = mInline;
+			memcpy(mInline, other.mInline, mSize);
+		}
 
 		// Leave other in valid empty state
-		other.mpData = nullptr;
-		other.mCapacity = 0;
-		other.mSize = 0;
+		other.ResetInline();
 	}
 	return *this;
 }
@@ -109,21 +160,19 @@ UINT64 Blob::GetCapacity() const
 	return mCapacity;
 }
 
-void Blob::Resize(UINT64 newSize)
+bool Blob::Resize(UINT64 newSize)
 {
-	if (newSize > mCapacity)
-	{
-		Reserve(newSize);
-	}
+	if (newSize > mCapacity && !Grow(newSize))
+		return false;
 	mSize = newSize;
+	return true;
 }
 
 bool Blob::Shrink()
 {
 	if (mSize == mCapacity) return true;
 
-	UINT64 newCapacity = (mSize > 0) ? mSize : 1;
-	return Realloc(newCapacity);
+	return Realloc(mSize);
 }
 
 void Blob::Clear()
@@ -133,6 +182,45 @@ void Blob::Clear()
 
 bool Blob::Reserve(UINT64 capacity)
 {
-	if (capacity <= mCapacity) return true;
+	if (capacity <= mCapacity && !NeedsBlock()) return true;
 	return Realloc(capacity);
 }
+
+bool Blob::Reserve(UINT64 capacity, Allocator& allocator)
+{
+	if (&allocator == mpAllocator)
+		return Reserve(capacity);
+
+	if (capacity < mSize)
+		capacity = mSize;
+
+	if (capacity <= INLINE_CAPACITY && allocator.AllowsInline())
+	{
+		if (!IsInline())
+		{
+			memcpy(mInline, mpData, mSize);
+			mpAllocator->Free(mpData, mCapacity);
+			mpData = mInline;
+			mCapacity = INLINE_CAPACITY;
+		}
+		mpAllocator = &allocator;
+		return true;
+	}
+
+	UINT64 newCapacity = 0;
+	UINT8* temp = (UINT8*)allocator.Allocate(capacity * sizeof(UINT8), newCapacity);
+	if (temp == nullptr)
+	{
+		std::cout << "[ERROR][BLOB] Reserve failed" << std::endl;
+		return false;
+	}
+
+	memcpy(temp, mpData, mSize);
+	if (!IsInline())
+		mpAllocator->Free(mpData, mCapacity);
+
+	mpData = temp;
+	mCapacity = newCapacity;
+	mpAllocator = &allocator;
+	return true;
+}
@@ -3,15 +3,29 @@
 
 class Blob
 {
+public:
+	//Payloads up to this size live inside the Blob (64 bytes in all): no heap allocation
+	static const UINT64 INLINE_CAPACITY = 32;
+
 private:
 	UINT8* mpData;
 	UINT64 mCapacity;
 	UINT64 mSize;
+	Allocator* mpAllocator;
+	UINT8 mInline[INLINE_CAPACITY];
 
 	bool Realloc(UINT64 newCapacity);
+	//Geometric growth (x1.5, at least required)
+	bool Grow(UINT64 required);
+	bool IsInline() const { return mpData == mInline; }
+	//Inline bytes the allocator doesn't accept (alignment)
+	bool NeedsBlock() const { return IsInline() && !mpAllocator->AllowsInline(); }
+	void ResetInline();
 public:
+	//Blocks come from the current allocator of the thread (see AllocatorScope)
 	Blob();
 	Blob(const UINT8* pData, UINT64 amount = 1);
+	explicit Blob(Allocator& allocator);
 	~Blob();
 
 	//Avoid copies
@@ -26,7 +40,11 @@ public:
 	const UINT8* GetData() const;
 	UINT64 GetSize() const;
 	UINT64 GetCapacity() const;
-	void Resize(UINT64 newSize);
+	bool IsHeapAllocated() const { return !IsInline(); }
+	//Moves keep the allocator with the block
+	Allocator& GetAllocator() const { return *mpAllocator; }
+	//false if the block can't grow: the size is left as it was
+	bool Resize(UINT64 newSize);
 
 	//Free unused memory
 	bool Shrink();
@@ -34,6 +52,8 @@ public:
 	void Clear();
 	//Pre-Allocate memory
 	bool Reserve(UINT64 capacity);
+	//Same, moving the content to a block of allocator (e.g. AlignedAllocator) if it isn't there already
+	bool Reserve(UINT64 capacity, Allocator& allocator);
 
 	template<typename T = UINT8>
 	bool Append(const T* pData, UINT64 amount = 1);
@@ -8,11 +8,7 @@ inline bool Blob::Append(const T* pData, UINT64 amount)
 	UINT64 bytesToAdd = amount * sizeof(T);
 	UINT64 newSize = mSize + bytesToAdd;
 
-	while (mCapacity < newSize)
-	{
-		mCapacity *= 2;
-	}
-	if (!Realloc(mCapacity)) return false;
+	if (!Grow(newSize)) return false;
 
 	memcpy(mpData + mSize, pData, bytesToAdd);
 	mSize = newSize;
@@ -36,21 +32,13 @@ inline bool Blob::Add(const T* pData, UINT64 atIndex, UINT64 amount)
 	assert(atByte <= mSize && "[ERROR][BLOB] Add position out of bounds: ");
 	UINT64 newSize = mSize + bytesToAdd;
 
-	while (mCapacity < newSize)
-	{
-		mCapacity *= 2;
-	}
-	if (!Realloc(mCapacity)) return false;
+	if (!Grow(newSize)) return false;
 
+	// The tail slides up in place, then the new bytes fill the gap
 	UINT64 bytesAfter = mSize - atByte;
-	UINT8* temp = (UINT8*)malloc(bytesAfter);
-	assert(temp != nullptr && "[ERROR][BLOB] Add: temp malloc failed");
-
-	memcpy(temp, mpData + atByte, bytesAfter);
+	memmove(mpData + atByte + bytesToAdd, mpData + atByte, bytesAfter);
 	memcpy(mpData + atByte, pData, bytesToAdd);
-	memcpy(mpData + atByte + bytesToAdd, temp, bytesAfter);
 
-	free(temp);
 	mSize = newSize;
 	return true;
 }
@@ -0,0 +1,226 @@
+#include "pch.h"
+
+BlockCache::BlockCache() :
+    mBudget(0),
+    mHits(0),
+    mMisses(0),
+    mEvictions(0),
+    mNextID(1)
+{
+}
+
+BlockCache& BlockCache::Get()
+{
+    static BlockCache cache;
+    return cache;
+}
+
+void BlockCache::SetBudget(UINT64 bytes)
+{
+    mBudget = bytes;
+    Clear();
+    mHits = 0;
+    mMisses = 0;
+    mEvictions = 0;
+}
+
+BlockCacheStats BlockCache::GetStats() const
+{
+    BlockCacheStats stats = {};
+    stats.hits = mHits.load();
+    stats.misses = mMisses.load();
+    stats.evictions = mEvictions.load();
+
+    for (const Shard& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.bytes += shard.bytes;
+        stats.blocks += shard.blocks.size();
+    }
+    return stats;
+}
+
+void BlockCache::Clear()
+{
+    for (Shard& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.blocks.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+    }
+}
+
+UINT64 BlockCache::Register(const std::string& path, UINT64& outSize)
+{
+    std::error_code error;
+    std::string canonical = std::filesystem::weakly_canonical(path, error).string();
+    if (error)
+        return 0;
+
+    outSize = std::filesystem::file_size(canonical, error);
+    if (error)
+        return 0;
+
+    auto writeTime = std::filesystem::last_write_time(canonical, error);
+    if (error)
+        return 0;
+
+    Version current;
+    current.size = outSize;
+    current.writeTime = writeTime.time_since_epoch().count();
+
+    std::lock_guard<std::mutex> lock(mFilesMutex);
+
+    std::vector<Version>& versions = mFiles[canonical];
+    for (const Version& version : versions)
+    {
+        if (version.size == current.size && version.writeTime == current.writeTime)
+            return version.id;
+    }
+
+    current.id = mNextID++;
+    versions.push_back(current);
+    return current.id;
+}
+
+void BlockCache::Invalidate(const std::string& path)
+{
+    std::error_code error;
+    std::string canonical = std::filesystem::weakly_canonical(path, error).string();
+    if (error)
+        return;
+
+    std::vector<Version> versions;
+    {
+        std::lock_guard<std::mutex> lock(mFilesMutex);
+        auto it = mFiles.find(canonical);
+        if (it == mFiles.end())
+            return;
+        versions = std::move(it->second);
+        mFiles.erase(it);
+    }
+
+    for (const Version& version : versions)
+        DropFile(version.id);
+}
+
+UINT64 BlockCache::Read(UINT64 fileID, std::FILE* file, UINT64 fileSize, UINT64 offset, UINT8* dst, UINT64 size)
+{
+    if (offset >= fileSize)
+        return 0;
+    if (size > fileSize - offset)
+        size = fileSize - offset;
+
+    UINT64 copied = 0;
+    while (copied < size)
+    {
+        UINT64 position = offset + copied;
+        BlockKey key = { fileID, position / BLOCK_SIZE };
+        UINT64 inBlock = position % BLOCK_SIZE;
+        UINT64 wanted = std::min<UINT64>(size - copied, BLOCK_SIZE - inBlock);
+
+        UINT64 done = 0;
+        if (CopyBlock(key, inBlock, dst + copied, wanted, done))
+        {
+            mHits++;
+            copied += done;
+            continue;
+        }
+
+        mMisses++;
+
+        // Read the whole block outside the shard lock; the stream belongs to the caller
+        UINT64 blockStart = key.index * BLOCK_SIZE;
+        UINT64 blockSize = std::min<UINT64>(BLOCK_SIZE, fileSize - blockStart);
+
+        // Cached for the whole process: never from the caller's scoped allocator
+        Blob block(Allocator::GetHeap());
+        if (!block.Resize(blockSize))
+            break;
+        if (_fseeki64(file, static_cast<INT64>(blockStart), SEEK_SET) != 0)
+            break;
+
+        UINT64 read = fread_s(block.GetData(), blockSize, 1, blockSize, file);
+        if (read <= inBlock)
+            break;
+
+        done = std::min<UINT64>(wanted, read - inBlock);
+        memcpy(dst + copied, block.GetData() + inBlock, done);
+        copied += done;
+
+        // A short read means the file changed under us: keep it out of the cache
+        if (read == blockSize && mBudget.load() > 0)
+            InsertBlock(key, std::move(block));
+
+        if (done < wanted)
+            break;
+    }
+
+    return copied;
+}
+
+bool BlockCache::CopyBlock(const BlockKey& key, UINT64 offset, UINT8* dst, UINT64 size, UINT64& outCopied)
+{
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end())
+        return false;
+
+    const Blob& data = it->second->second;
+    if (offset >= data.GetSize())
+        return false;
+
+    shard.blocks.splice(shard.blocks.begin(), shard.blocks, it->second);
+
+    outCopied = std::min<UINT64>(size, data.GetSize() - offset);
+    memcpy(dst, data.GetData() + offset, outCopied);
+    return true;
+}
+
+void BlockCache::InsertBlock(const BlockKey& key, Blob&& data)
+{
+    // Each shard gets an equal part of the budget, at least one block
+    UINT64 shardBudget = std::max<UINT64>(mBudget.load() / SHARD_COUNT, BLOCK_SIZE);
+
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // Another reader may have loaded it meanwhile
+    if (shard.index.find(key) != shard.index.end())
+        return;
+
+    while (!shard.blocks.empty() && shard.bytes + data.GetSize() > shardBudget)
+    {
+        shard.bytes -= shard.blocks.back().second.GetSize();
+        shard.index.erase(shard.blocks.back().first);
+        shard.blocks.pop_back();
+        mEvictions++;
+    }
+
+    shard.bytes += data.GetSize();
+    shard.blocks.emplace_front(key, std::move(data));
+    shard.index[key] = shard.blocks.begin();
+}
+
+void BlockCache::DropFile(UINT64 fileID)
+{
+    for (Shard& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto it = shard.blocks.begin(); it != shard.blocks.end();)
+        {
+            if (it->first.fileID != fileID)
+            {
+                ++it;
+                continue;
+            }
+
+            shard.bytes -= it->second.GetSize();
+            shard.index.erase(it->first);
+            it = shard.blocks.erase(it);
+        }
+    }
+}
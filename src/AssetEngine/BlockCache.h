@@ -0,0 +1,93 @@
+#ifndef BLOCKCACHE_H__
+#define BLOCKCACHE_H__
+
+struct BlockCacheStats
+{
+    UINT64   hits;
+    UINT64   misses;
+    UINT64   evictions;
+    UINT64   bytes;
+    UINT64   blocks;
+};
+
+// Process-wide cache of file blocks, shared by every File opened with the cache on.
+// A file is identified by its canonical path, size and last write time, so a file
+// replaced on disk gets fresh blocks. Off until a budget is set.
+class BlockCache
+{
+public:
+    static const UINT32 BLOCK_SIZE = 64 * 1024;
+    static const UINT32 SHARD_COUNT = 16;
+
+    BlockCache();
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    static BlockCache& Get();
+
+    //0 turns the cache off and drops every block; the statistics are reset
+    void SetBudget(UINT64 bytes);
+    UINT64 GetBudget() const { return mBudget.load(); }
+    BlockCacheStats GetStats() const;
+    void Clear();
+
+    //Id of the file as it is on disk now (0 if it cannot be read)
+    UINT64 Register(const std::string& path, UINT64& outSize);
+    //Drops the blocks of every version of path (called once a File has written to it)
+    void Invalidate(const std::string& path);
+
+    //Copies [offset, offset + size) of the file, reading missing blocks through file.
+    //Returns the number of bytes copied (short at the end of the file).
+    UINT64 Read(UINT64 fileID, std::FILE* file, UINT64 fileSize, UINT64 offset, UINT8* dst, UINT64 size);
+
+private:
+    struct BlockKey
+    {
+        UINT64   fileID;
+        UINT64   index;
+
+        bool operator==(const BlockKey& other) const { return fileID == other.fileID && index == other.index; }
+    };
+
+    struct BlockKeyHash
+    {
+        size_t operator()(const BlockKey& key) const
+        {
+            return std::hash<UINT64>()(key.fileID * 0x9E3779B97F4A7C15ull ^ key.index);
+        }
+    };
+
+    struct Shard
+    {
+        std::list<std::pair<BlockKey, Blob>> blocks;
+        std::unordered_map<BlockKey, std::list<std::pair<BlockKey, Blob>>::iterator, BlockKeyHash> index;
+        UINT64 bytes = 0;
+        mutable std::mutex mutex;
+    };
+
+    struct Version
+    {
+        UINT64   size;
+        INT64    writeTime;
+        UINT64   id;
+    };
+
+    Shard& GetShard(const BlockKey& key) { return mShards[BlockKeyHash()(key) % SHARD_COUNT]; }
+    bool CopyBlock(const BlockKey& key, UINT64 offset, UINT8* dst, UINT64 size, UINT64& outCopied);
+    void InsertBlock(const BlockKey& key, Blob&& data);
+    void DropFile(UINT64 fileID);
+
+    Shard mShards[SHARD_COUNT];
+    std::atomic<UINT64> mBudget;
+    std::atomic<UINT64> mHits;
+    std::atomic<UINT64> mMisses;
+    std::atomic<UINT64> mEvictions;
+
+    //canonical path -> versions seen by Register
+    std::unordered_map<std::string, std::vector<Version>> mFiles;
+    UINT64 mNextID;
+    std::mutex mFilesMutex;
+};
+
+#endif // !BLOCKCACHE_H__
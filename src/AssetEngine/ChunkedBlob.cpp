@@ -0,0 +1,217 @@
+#include "pch.h"
+
+ChunkedBlob::ChunkedBlob(UINT64 segmentSize) :
+    mSegmentSize(segmentSize > 0 ? segmentSize : DEFAULT_SEGMENT_SIZE),
+    mSize(0)
+{
+}
+
+Blob ChunkedBlob::NewSegment(UINT64 size) const
+{
+    // Segments live as long as the ChunkedBlob, not the caller's allocator scope
+    // and always gets a block: inline bytes would move with the segment vector
+    Blob segment(Allocator::GetHeap());
+    segment.Reserve((std::max)(size, Blob::INLINE_CAPACITY + 1));
+    return segment;
+}
+
+bool ChunkedBlob::GrowSegment(Blob& segment, UINT64 required) const
+{
+    if (required <= segment.GetCapacity())
+        return true;
+
+    // Doubles like a Blob would, but never past a full segment
+    UINT64 capacity = (std::max)(required, segment.GetCapacity() * 2);
+    return segment.Reserve((std::min)(capacity, (std::max)(required, mSegmentSize)));
+}
+
+UINT64 ChunkedBlob::FindSegment(UINT64 offset) const
+{
+    auto next = std::upper_bound(mStarts.begin(), mStarts.end(), offset);
+    return static_cast<UINT64>(next - mStarts.begin()) - 1;
+}
+
+void ChunkedBlob::UpdateStarts(UINT64 fromSegment)
+{
+    mStarts.resize(mSegments.size());
+    UINT64 start = (fromSegment == 0) ? 0 : mStarts[fromSegment - 1] + mSegments[fromSegment - 1].GetSize();
+    for (UINT64 i = fromSegment; i < mSegments.size(); i++)
+    {
+        mStarts[i] = start;
+        start += mSegments[i].GetSize();
+    }
+}
+
+bool ChunkedBlob::Append(const UINT8* pData, UINT64 size)
+{
+    if (pData == nullptr || size == 0)
+        return false;
+
+    while (size > 0)
+    {
+        if (mSegments.empty() || mSegments.back().GetSize() >= mSegmentSize)
+        {
+            mSegments.push_back(NewSegment((std::min)(size, mSegmentSize)));
+            mStarts.push_back(mSize);
+        }
+
+        Blob& last = mSegments.back();
+        UINT64 amount = (std::min)(size, mSegmentSize - last.GetSize());
+        if (!GrowSegment(last, last.GetSize() + amount) || !last.Append(pData, amount))
+            return false;
+
+        pData += amount;
+        size -= amount;
+        mSize += amount;
+    }
+    return true;
+}
+
+bool ChunkedBlob::Insert(UINT64 offset, const UINT8* pData, UINT64 size)
+{
+    if (pData == nullptr || size == 0 || offset > mSize)
+        return false;
+    if (offset == mSize)
+        return Append(pData, size);
+
+    UINT64 index = FindSegment(offset);
+    UINT64 within = offset - mStarts[index];
+    Blob& segment = mSegments[index];
+
+    // Fits: shifted inside its segment
+    if (segment.GetSize() + size <= mSegmentSize)
+    {
+        if (!GrowSegment(segment, segment.GetSize() + size) || !segment.Add(pData, within, size))
+            return false;
+        mSize += size;
+        UpdateStarts(index + 1);
+        return true;
+    }
+
+    // Otherwise the segment is split and the new bytes get segments of their own
+    std::vector<Blob> pieces;
+    for (UINT64 done = 0; done < size; done += mSegmentSize)
+    {
+        UINT64 amount = (std::min)(mSegmentSize, size - done);
+        Blob piece = NewSegment(amount);
+        piece.Append(pData + done, amount);
+        pieces.push_back(std::move(piece));
+    }
+
+    UINT64 position = index;
+    if (within > 0)
+    {
+        Blob tail = NewSegment(segment.GetSize() - within);
+        tail.Append(segment.GetData() + within, segment.GetSize() - within);
+        segment.Resize(within);
+        pieces.push_back(std::move(tail));
+        position = index + 1;
+    }
+
+    mSegments.insert(mSegments.begin() + position, std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+    mSize += size;
+    UpdateStarts(position);
+    return true;
+}
+
+UINT64 ChunkedBlob::Write(UINT64 offset, const UINT8* pData, UINT64 size)
+{
+    if (pData == nullptr || size == 0 || offset > mSize)
+        return 0;
+
+    UINT64 written = 0;
+    if (offset < mSize)
+    {
+        UINT64 index = FindSegment(offset);
+        UINT64 within = offset - mStarts[index];
+        while (written < size && index < mSegments.size())
+        {
+            Blob& segment = mSegments[index];
+            UINT64 amount = (std::min)(size - written, segment.GetSize() - within);
+            memcpy(segment.GetData() + within, pData + written, amount);
+            written += amount;
+            within = 0;
+            index++;
+        }
+    }
+
+    if (written < size && !Append(pData + written, size - written))
+        return written;
+    return size;
+}
+
+UINT64 ChunkedBlob::Read(UINT64 offset, UINT8* buffer, UINT64 size) const
+{
+    if (buffer == nullptr || offset >= mSize)
+        return 0;
+
+    size = (std::min)(size, mSize - offset);
+    UINT64 index = FindSegment(offset);
+    UINT64 within = offset - mStarts[index];
+    UINT64 done = 0;
+    while (done < size)
+    {
+        const Blob& segment = mSegments[index];
+        UINT64 amount = (std::min)(size - done, segment.GetSize() - within);
+        memcpy(buffer + done, segment.GetData() + within, amount);
+        done += amount;
+        within = 0;
+        index++;
+    }
+    return done;
+}
+
+void ChunkedBlob::Truncate(UINT64 size)
+{
+    if (size >= mSize)
+        return;
+    if (size == 0)
+    {
+        Clear();
+        return;
+    }
+
+    UINT64 index = FindSegment(size - 1);
+    mSegments[index].Resize(size - mStarts[index]);
+    mSegments.resize(index + 1);
+    mStarts.resize(index + 1);
+    mSize = size;
+}
+
+void ChunkedBlob::Clear()
+{
+    mSegments.clear();
+    mStarts.clear();
+    mSize = 0;
+}
+
+void ChunkedBlob::GetPieces(std::vector<Piece>& outPieces) const
+{
+    outPieces.clear();
+    outPieces.reserve(mSegments.size());
+    for (const Blob& segment : mSegments)
+    {
+        if (segment.GetSize() > 0)
+            outPieces.push_back({ segment.GetData(), segment.GetSize() });
+    }
+}
+
+bool ChunkedBlob::WriteTo(Stream& stream) const
+{
+    for (const Blob& segment : mSegments)
+    {
+        if (segment.GetSize() > 0 && stream.Write(segment.GetData(), segment.GetSize(), 1) != segment.GetSize())
+            return false;
+    }
+    return true;
+}
+
+bool ChunkedBlob::Flatten(Blob& outData) const
+{
+    outData.Clear();
+    if (!outData.Reserve(mSize))
+        return false;
+
+    outData.Resize(mSize);
+    return Read(0, outData.GetData(), mSize) == mSize;
+}
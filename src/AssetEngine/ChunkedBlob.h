@@ -0,0 +1,60 @@
+#ifndef CHUNKEDBLOB_H__
+#define CHUNKEDBLOB_H__
+
+// Bytes kept in a list of fixed-size segments instead of one block: appending never
+// moves what is already stored, and an insert touches a single segment (it is split
+// when the new bytes don't fit). Meant for multi-GB payloads that a Blob would
+// realloc (and copy) over and over.
+class ChunkedBlob
+{
+public:
+    static const UINT64 DEFAULT_SEGMENT_SIZE = 1024 * 1024;
+
+    // Contiguous run of bytes, in order (iovec / WSABUF material)
+    struct Piece
+    {
+        const UINT8*    data;
+        UINT64          size;
+    };
+
+    explicit ChunkedBlob(UINT64 segmentSize = DEFAULT_SEGMENT_SIZE);
+
+    ChunkedBlob(const ChunkedBlob&) = delete;
+    ChunkedBlob& operator=(const ChunkedBlob&) = delete;
+    ChunkedBlob(ChunkedBlob&&) = default;
+    ChunkedBlob& operator=(ChunkedBlob&&) = default;
+
+    UINT64 GetSize() const { return mSize; }
+    UINT64 GetSegmentSize() const { return mSegmentSize; }
+    UINT64 GetSegmentCount() const { return mSegments.size(); }
+
+    bool Append(const UINT8* pData, UINT64 size);
+    bool Insert(UINT64 offset, const UINT8* pData, UINT64 size);
+    //Overwrites from offset, appending what goes past the end (offset <= GetSize())
+    UINT64 Write(UINT64 offset, const UINT8* pData, UINT64 size);
+    UINT64 Read(UINT64 offset, UINT8* buffer, UINT64 size) const;
+    //Shrinks to size bytes (no-op if already smaller)
+    void Truncate(UINT64 size);
+    void Clear();
+
+    void GetPieces(std::vector<Piece>& outPieces) const;
+    //One Write per segment, nothing flattened
+    bool WriteTo(Stream& stream) const;
+    //Single contiguous copy
+    bool Flatten(Blob& outData) const;
+
+private:
+    //Segment holding offset (< GetSize())
+    UINT64 FindSegment(UINT64 offset) const;
+    void UpdateStarts(UINT64 fromSegment);
+    //Empty segment with room for size bytes; it grows up to mSegmentSize as bytes come in
+    Blob NewSegment(UINT64 size) const;
+    bool GrowSegment(Blob& segment, UINT64 required) const;
+
+    std::vector<Blob> mSegments;
+    std::vector<UINT64> mStarts;    // offset of each segment's first byte
+    UINT64 mSegmentSize;
+    UINT64 mSize;
+};
+
+#endif // !CHUNKEDBLOB_H__
@@ -0,0 +1,74 @@
+#include "pch.h"
+
+namespace
+{
+    // Random value per byte, fixed: boundaries must not change between builds
+    struct GearTable
+    {
+        UINT64 values[256];
+
+        constexpr GearTable() : values()
+        {
+            UINT64 state = 0x41534554u;
+            for (int i = 0; i < 256; i++)
+            {
+                // splitmix64
+                state += 0x9E3779B97F4A7C15ull;
+                UINT64 z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                values[i] = z ^ (z >> 31);
+            }
+        }
+    };
+
+    constexpr GearTable GEAR;
+
+    // Bit k of the gear hash covers the last k + 1 bytes, so the masks use the top bits.
+    // Normalized chunking: 2 bits harder than the average before it, 2 bits easier after,
+    // which keeps most chunks close to AVERAGE_SIZE.
+    const UINT64 MASK_SMALL = ~0ull << (64 - 18);
+    const UINT64 MASK_LARGE = ~0ull << (64 - 14);
+}
+
+UINT64 Chunker::NextChunk(const UINT8* data, UINT64 size)
+{
+    if (size <= MIN_SIZE)
+        return size;
+
+    UINT64 limit = (size < MAX_SIZE) ? size : MAX_SIZE;
+    UINT64 normal = (limit < AVERAGE_SIZE) ? limit : AVERAGE_SIZE;
+
+    // Nothing can be cut below MIN_SIZE, so the hash starts there
+    UINT64 hash = 0;
+    UINT64 i = MIN_SIZE;
+
+    for (; i < normal; i++)
+    {
+        hash = (hash << 1) + GEAR.values[data[i]];
+        if ((hash & MASK_SMALL) == 0)
+            return i + 1;
+    }
+
+    for (; i < limit; i++)
+    {
+        hash = (hash << 1) + GEAR.values[data[i]];
+        if ((hash & MASK_LARGE) == 0)
+            return i + 1;
+    }
+
+    return limit;
+}
+
+void Chunker::Split(const UINT8* data, UINT64 size, std::vector<UINT64>& outEnds)
+{
+    outEnds.clear();
+    outEnds.reserve(size / AVERAGE_SIZE + 1);
+
+    UINT64 offset = 0;
+    while (offset < size)
+    {
+        offset += NextChunk(data + offset, size - offset);
+        outEnds.push_back(offset);
+    }
+}
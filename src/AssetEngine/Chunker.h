@@ -0,0 +1,19 @@
+#ifndef CHUNKER_H__
+#define CHUNKER_H__
+
+// Content-defined chunking (FastCDC). A cut depends only on the bytes just before it,
+// so an edit moves the boundaries around it and every other chunk stays the same.
+class Chunker
+{
+public:
+    static const UINT32 MIN_SIZE = 16 * 1024;
+    static const UINT32 AVERAGE_SIZE = 64 * 1024;
+    static const UINT32 MAX_SIZE = 256 * 1024;
+
+    //Length of the chunk starting at data (size if the rest fits in one chunk)
+    static UINT64 NextChunk(const UINT8* data, UINT64 size);
+    //End offset of every chunk of data
+    static void Split(const UINT8* data, UINT64 size, std::vector<UINT64>& outEnds);
+};
+
+#endif // !CHUNKER_H__
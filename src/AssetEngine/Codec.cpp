@@ -0,0 +1,1181 @@
+#include "pch.h"
+
+namespace
+{
+    inline UINT32 Read32(const UINT8* p)
+    {
+        UINT32 value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline UINT64 Read64(const UINT8* p)
+    {
+        UINT64 value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline UINT32 HashSequence(UINT32 sequence, UINT32 hashLog)
+    {
+        return (sequence * 2654435761U) >> (32 - hashLog);
+    }
+
+    // Extra length bytes of a token nibble (15 + 255 + 255 + ... + rest)
+    inline UINT8* WriteLength(UINT8* op, UINT64 length)
+    {
+        while (length >= 255)
+        {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = static_cast<UINT8>(length);
+        return op;
+    }
+
+    inline bool ReadLength(const UINT8*& ip, const UINT8* iend, UINT64& length)
+    {
+        UINT8 byte;
+        do
+        {
+            if (ip >= iend)
+                return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // === Huffman (literals of CODEC_LZH) ===
+    // 128 bytes of 4-bit code lengths, then the codes packed LSB-first
+    const UINT32 HUFFMAN_MAX_BITS = 11;
+    const UINT64 HUFFMAN_TABLE_BYTES = 128;
+
+    //Code lengths are capped by flattening the counts until the tree is shallow enough
+    void BuildCodeLengths(const UINT64 counts[256], UINT8 lengths[256])
+    {
+        UINT64 weights[256];
+        memcpy(weights, counts, sizeof(weights));
+
+        while (true)
+        {
+            memset(lengths, 0, 256);
+
+            std::vector<std::pair<UINT64, UINT32>> heap;
+            for (UINT32 s = 0; s < 256; s++)
+            {
+                if (weights[s] > 0)
+                    heap.push_back(std::make_pair(weights[s], s));
+            }
+
+            if (heap.empty())
+                return;
+            if (heap.size() == 1)
+            {
+                lengths[heap[0].second] = 1;
+                return;
+            }
+
+            std::greater<std::pair<UINT64, UINT32>> order;
+            std::make_heap(heap.begin(), heap.end(), order);
+
+            UINT32 parent[512];
+            UINT32 nextNode = 256;
+            while (heap.size() > 1)
+            {
+                std::pop_heap(heap.begin(), heap.end(), order);
+                std::pair<UINT64, UINT32> a = heap.back();
+                heap.pop_back();
+                std::pop_heap(heap.begin(), heap.end(), order);
+                std::pair<UINT64, UINT32> b = heap.back();
+                heap.pop_back();
+
+                parent[a.second] = nextNode;
+                parent[b.second] = nextNode;
+                heap.push_back(std::make_pair(a.first + b.first, nextNode++));
+                std::push_heap(heap.begin(), heap.end(), order);
+            }
+
+            UINT32 root = heap[0].second;
+            UINT32 maxLength = 0;
+            for (UINT32 s = 0; s < 256; s++)
+            {
+                if (weights[s] == 0)
+                    continue;
+
+                UINT32 depth = 0;
+                for (UINT32 node = s; node != root; node = parent[node])
+                    depth++;
+
+                lengths[s] = static_cast<UINT8>(depth);
+                if (depth > maxLength)
+                    maxLength = depth;
+            }
+
+            if (maxLength <= HUFFMAN_MAX_BITS)
+                return;
+
+            for (UINT32 s = 0; s < 256; s++)
+            {
+                if (weights[s] > 0)
+                    weights[s] = (weights[s] >> 1) | 1;
+            }
+        }
+    }
+
+    //Canonical codes, bit-reversed for the LSB-first stream
+    void AssignCodes(const UINT8 lengths[256], UINT16 codes[256])
+    {
+        UINT32 lengthCount[HUFFMAN_MAX_BITS + 1] = { 0 };
+        for (UINT32 s = 0; s < 256; s++)
+            lengthCount[lengths[s]]++;
+        lengthCount[0] = 0;
+
+        UINT32 nextCode[HUFFMAN_MAX_BITS + 1] = { 0 };
+        UINT32 code = 0;
+        for (UINT32 bits = 1; bits <= HUFFMAN_MAX_BITS; bits++)
+        {
+            code = (code + lengthCount[bits - 1]) << 1;
+            nextCode[bits] = code;
+        }
+
+        for (UINT32 s = 0; s < 256; s++)
+        {
+            codes[s] = 0;
+            if (lengths[s] == 0)
+                continue;
+
+            UINT32 canonical = nextCode[lengths[s]]++;
+            UINT32 reversed = 0;
+            for (UINT32 b = 0; b < lengths[s]; b++)
+                reversed |= ((canonical >> b) & 1) << (lengths[s] - 1 - b);
+            codes[s] = static_cast<UINT16>(reversed);
+        }
+    }
+
+    //Returns 0 if the output does not fit in dstCapacity
+    UINT64 HuffmanEncode(const UINT8* src, UINT64 size, UINT8* dst, UINT64 dstCapacity)
+    {
+        if (dstCapacity < HUFFMAN_TABLE_BYTES)
+            return 0;
+
+        UINT64 counts[256] = { 0 };
+        for (UINT64 i = 0; i < size; i++)
+            counts[src[i]]++;
+
+        UINT8 lengths[256];
+        UINT16 codes[256];
+        BuildCodeLengths(counts, lengths);
+        AssignCodes(lengths, codes);
+
+        for (UINT32 i = 0; i < HUFFMAN_TABLE_BYTES; i++)
+            dst[i] = static_cast<UINT8>(lengths[2 * i] | (lengths[2 * i + 1] << 4));
+
+        UINT8* op = dst + HUFFMAN_TABLE_BYTES;
+        UINT8* oend = dst + dstCapacity;
+        UINT64 bitBuffer = 0;
+        UINT32 bitCount = 0;
+
+        for (UINT64 i = 0; i < size; i++)
+        {
+            bitBuffer |= static_cast<UINT64>(codes[src[i]]) << bitCount;
+            bitCount += lengths[src[i]];
+
+            while (bitCount >= 8)
+            {
+                if (op == oend)
+                    return 0;
+                *op++ = static_cast<UINT8>(bitBuffer);
+                bitBuffer >>= 8;
+                bitCount -= 8;
+            }
+        }
+
+        if (bitCount > 0)
+        {
+            if (op == oend)
+                return 0;
+            *op++ = static_cast<UINT8>(bitBuffer);
+        }
+
+        return op - dst;
+    }
+
+    bool HuffmanDecode(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 count)
+    {
+        if (srcSize < HUFFMAN_TABLE_BYTES)
+            return false;
+
+        UINT8 lengths[256];
+        for (UINT32 i = 0; i < HUFFMAN_TABLE_BYTES; i++)
+        {
+            lengths[2 * i] = src[i] & 0x0F;
+            lengths[2 * i + 1] = src[i] >> 4;
+        }
+
+        // Over-subscribed code lengths would not describe a prefix code
+        UINT32 kraft = 0;
+        for (UINT32 s = 0; s < 256; s++)
+        {
+            if (lengths[s] > HUFFMAN_MAX_BITS)
+                return false;
+            if (lengths[s] > 0)
+                kraft += 1U << (HUFFMAN_MAX_BITS - lengths[s]);
+        }
+        if (kraft > (1U << HUFFMAN_MAX_BITS))
+            return false;
+
+        UINT16 codes[256];
+        AssignCodes(lengths, codes);
+
+        // Every HUFFMAN_MAX_BITS-bit window maps to (symbol << 4) | length, 0 = invalid
+        UINT16 table[1 << HUFFMAN_MAX_BITS] = { 0 };
+        for (UINT32 s = 0; s < 256; s++)
+        {
+            if (lengths[s] == 0)
+                continue;
+            for (UINT32 fill = codes[s]; fill < (1U << HUFFMAN_MAX_BITS); fill += 1U << lengths[s])
+                table[fill] = static_cast<UINT16>((s << 4) | lengths[s]);
+        }
+
+        const UINT8* ip = src + HUFFMAN_TABLE_BYTES;
+        const UINT8* iend = src + srcSize;
+        UINT64 bitBuffer = 0;
+        UINT32 bitCount = 0;
+
+        for (UINT64 i = 0; i < count; i++)
+        {
+            while (bitCount <= 56 && ip < iend)
+            {
+                bitBuffer |= static_cast<UINT64>(*ip++) << bitCount;
+                bitCount += 8;
+            }
+
+            UINT16 entry = table[bitBuffer & ((1U << HUFFMAN_MAX_BITS) - 1)];
+            UINT32 length = entry & 0x0F;
+            if (length == 0 || length > bitCount)
+                return false;
+
+            dst[i] = static_cast<UINT8>(entry >> 4);
+            bitBuffer >>= length;
+            bitCount -= length;
+        }
+
+        return true;
+    }
+}
+
+UINT64 Codec::CompressBound(UINT64 size)
+{
+    return size + (size / 255) + 16;
+}
+
+UINT64 Codec::Compress(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    if (src == nullptr || dst == nullptr)
+        return 0;
+
+    UINT32 table[1 << HASH_LOG] = { 0 };
+
+    // Dictionary positions come first: the entry starts right after them
+    const UINT8* dict = nullptr;
+    UINT64 dictSize = 0;
+    if (dictionary != nullptr && dictionary->data.GetSize() > 0 && dictionary->table.size() == (1 << HASH_LOG))
+    {
+        dict = dictionary->data.GetData();
+        dictSize = dictionary->data.GetSize();
+        memcpy(table, dictionary->table.data(), sizeof(table));
+    }
+
+    const UINT8* ip = src;
+    const UINT8* anchor = src;
+    const UINT8* iend = src + srcSize;
+
+    UINT8* op = dst;
+    UINT8* oend = dst + dstCapacity;
+
+    if (srcSize > MF_LIMIT)
+    {
+        const UINT8* mflimit = iend - MF_LIMIT;
+        const UINT8* matchlimit = iend - LAST_LITERALS;
+
+        while (ip <= mflimit)
+        {
+            UINT32 sequence = Read32(ip);
+            UINT32 h = HashSequence(sequence, HASH_LOG);
+            UINT64 produced = ip - src;
+            UINT32 position = static_cast<UINT32>(dictSize + produced);
+            UINT32 distance = position - table[h];
+            table[h] = position;
+
+            // Resolved exactly as the decoder will: inside the entry, else back into the dictionary.
+            // Positions wrap past 4 GB: the byte compare below keeps any hit valid.
+            const UINT8* match = nullptr;
+            const UINT8* lowLimit = src;
+            const UINT8* highLimit = matchlimit;
+            if (distance != 0 && distance <= MAX_DISTANCE)
+            {
+                if (distance <= produced)
+                {
+                    match = ip - distance;
+                }
+                else if (distance - produced >= MIN_MATCH && distance - produced <= dictSize)
+                {
+                    match = dict + dictSize - (distance - produced);
+                    lowLimit = dict;
+                    highLimit = ip + (distance - produced);
+                    if (highLimit > matchlimit)
+                        highLimit = matchlimit;
+                }
+            }
+
+            if (match == nullptr || Read32(match) != sequence)
+            {
+                ip += 1 + ((ip - anchor) >> SKIP_TRIGGER);
+                continue;
+            }
+
+            while (ip > anchor && match > lowLimit && ip[-1] == match[-1])
+            {
+                ip--;
+                match--;
+            }
+
+            UINT64 matchLength = MIN_MATCH;
+            while (ip + matchLength + 8 <= highLimit && Read64(ip + matchLength) == Read64(match + matchLength))
+                matchLength += 8;
+            while (ip + matchLength < highLimit && ip[matchLength] == match[matchLength])
+                matchLength++;
+
+            UINT64 literalLength = ip - anchor;
+            UINT64 worstCase = 1 + literalLength + (literalLength / 255) + 1 + 2 + (matchLength / 255) + 1;
+            if (static_cast<UINT64>(oend - op) < worstCase)
+                return 0;
+
+            UINT8* token = op++;
+            if (literalLength >= 15)
+            {
+                *token = 15 << 4;
+                op = WriteLength(op, literalLength - 15);
+            }
+            else
+            {
+                *token = static_cast<UINT8>(literalLength << 4);
+            }
+
+            memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            *op++ = static_cast<UINT8>(distance & 0xFF);
+            *op++ = static_cast<UINT8>(distance >> 8);
+
+            UINT64 extraMatch = matchLength - MIN_MATCH;
+            if (extraMatch >= 15)
+            {
+                *token |= 15;
+                op = WriteLength(op, extraMatch - 15);
+            }
+            else
+            {
+                *token |= static_cast<UINT8>(extraMatch);
+            }
+
+            ip += matchLength;
+            anchor = ip;
+
+            if (ip <= mflimit)
+                table[HashSequence(Read32(ip - 2), HASH_LOG)] = static_cast<UINT32>(dictSize + (ip - 2 - src));
+        }
+    }
+
+    // Last literals (always closes the block, even when empty)
+    UINT64 literalLength = iend - anchor;
+    if (static_cast<UINT64>(oend - op) < 1 + literalLength + (literalLength / 255) + 1)
+        return 0;
+
+    UINT8* token = op++;
+    if (literalLength >= 15)
+    {
+        *token = 15 << 4;
+        op = WriteLength(op, literalLength - 15);
+    }
+    else
+    {
+        *token = static_cast<UINT8>(literalLength << 4);
+    }
+
+    memcpy(op, anchor, literalLength);
+    op += literalLength;
+
+    return op - dst;
+}
+
+UINT64 Codec::Decompress(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    return DecodeSequences(src, srcSize, nullptr, 0, dst, dstCapacity, dictionary);
+}
+
+UINT64 Codec::DecodeSequences(const UINT8* src, UINT64 srcSize, const UINT8* literals, UINT64 literalCount,
+                              UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    if (src == nullptr || dst == nullptr)
+        return 0;
+
+    const UINT8* ip = src;
+    const UINT8* iend = src + srcSize;
+    UINT8* op = dst;
+    UINT8* oend = dst + dstCapacity;
+    const UINT8* lp = literals;
+    const UINT8* lend = literals + literalCount;
+
+    while (ip < iend)
+    {
+        UINT8 token = *ip++;
+
+        UINT64 literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, iend, literalLength))
+            return 0;
+
+        if (literalLength > static_cast<UINT64>(oend - op))
+            return 0;
+
+        // Literals follow their token, or come from a separate stream (LZH)
+        if (literals == nullptr)
+        {
+            if (literalLength > static_cast<UINT64>(iend - ip))
+                return 0;
+            memcpy(op, ip, literalLength);
+            ip += literalLength;
+        }
+        else
+        {
+            if (literalLength > static_cast<UINT64>(lend - lp))
+                return 0;
+            memcpy(op, lp, literalLength);
+            lp += literalLength;
+        }
+        op += literalLength;
+
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return 0;
+
+        UINT64 distance = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (distance == 0)
+            return 0;
+
+        UINT64 matchLength = token & 0x0F;
+        if (matchLength == 15 && !ReadLength(ip, iend, matchLength))
+            return 0;
+        matchLength += MIN_MATCH;
+
+        if (matchLength > static_cast<UINT64>(oend - op))
+            return 0;
+
+        UINT64 produced = op - dst;
+        if (distance > produced)
+        {
+            // Starts in the dictionary, may run on into the beginning of the output
+            UINT64 back = distance - produced;
+            if (dictionary == nullptr || back > dictionary->data.GetSize())
+                return 0;
+
+            UINT64 fromDictionary = (back < matchLength) ? back : matchLength;
+            memcpy(op, dictionary->data.GetData() + dictionary->data.GetSize() - back, fromDictionary);
+            op += fromDictionary;
+            matchLength -= fromDictionary;
+
+            if (matchLength == 0)
+                continue;
+        }
+
+        const UINT8* match = op - distance;
+        if (distance >= matchLength)
+        {
+            memcpy(op, match, matchLength);
+        }
+        else if (distance >= 8)
+        {
+            UINT64 copied = 0;
+            for (; copied + 8 <= matchLength; copied += 8)
+                memcpy(op + copied, match + copied, 8);
+            for (; copied < matchLength; copied++)
+                op[copied] = match[copied];
+        }
+        else
+        {
+            for (UINT64 i = 0; i < matchLength; i++)
+                op[i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    if (literals != nullptr && lp != lend)
+        return 0;
+
+    return op - dst;
+}
+
+UINT64 Codec::GetBlockTableSize(UINT32 blockCount)
+{
+    return sizeof(BlockTableHeader) + (static_cast<UINT64>(blockCount) + 1) * sizeof(UINT64);
+}
+
+bool Codec::DecodeBlock(const UINT8* src, UINT64 storedSize, UINT8* dst, UINT64 rawSize, UINT8 codec)
+{
+    if (storedSize == rawSize)
+    {
+        memcpy(dst, src, rawSize);
+        return true;
+    }
+
+    return Decode(codec, src, storedSize, dst, rawSize) == rawSize;
+}
+
+bool Codec::Pack(const UINT8* data, UINT64 size, Blob& outPayload, UINT32 blockSize, const Dictionary* dictionary, UINT8 codec)
+{
+    if (data == nullptr || size <= sizeof(Stream::Header) || !IsSupported(codec))
+        return false;
+
+    Stream::Header header = {};
+    header.magic[0] = 'S';
+    header.magic[1] = 'A';
+    header.magic[2] = 'F';
+    header.magic[3] = 'E';
+    header.version = 1;
+    header.flags = Stream::COMPRESSED;
+    header.originalSize = size;
+
+    if (blockSize == 0 || size <= blockSize)
+    {
+        header.checksum = SafeFormat::CalculateCRC32(data, size);
+
+        UINT64 capacity = size - sizeof(Stream::Header) - 1;
+        UINT64 bound = CompressBound(size);
+        if (bound < capacity)
+            capacity = bound;
+
+        if (dictionary == nullptr || dictionary->data.GetSize() == 0 || size > DICTIONARY_ENTRY_LIMIT)
+            dictionary = nullptr;
+        else
+            header.flags |= Stream::DICTIONARY;
+
+        if (!outPayload.Resize(sizeof(Stream::Header) + capacity))
+            return false;
+
+        header.dataSize = Encode(codec, data, size, outPayload.GetData() + sizeof(Stream::Header), capacity, dictionary);
+        if (header.dataSize == 0)
+            return false;
+    }
+    else
+    {
+        UINT64 blockCount = (size + blockSize - 1) / blockSize;
+        if (blockCount > 0xFFFFFFFF)
+            return false;
+
+        BlockTableHeader table;
+        table.blockSize = blockSize;
+        table.blockCount = static_cast<UINT32>(blockCount);
+
+        UINT64 tableSize = GetBlockTableSize(table.blockCount);
+        if (sizeof(Stream::Header) + tableSize >= size)
+            return false;
+
+        // Blocks never grow (raw fallback), so the payload is bounded by the input
+        if (!outPayload.Resize(sizeof(Stream::Header) + tableSize + size))
+            return false;
+
+        UINT8* tableStart = outPayload.GetData() + sizeof(Stream::Header);
+        UINT8* blocksStart = tableStart + tableSize;
+        UINT64* offsets = reinterpret_cast<UINT64*>(tableStart + sizeof(BlockTableHeader));
+        memcpy(tableStart, &table, sizeof(BlockTableHeader));
+
+        std::vector<UINT64> storedSizes(blockCount);
+        std::vector<UINT32> crcs(blockCount);
+
+        // Every block compresses into its own raw-sized slot...
+        ThreadPool::Get().ParallelFor(blockCount, [&](UINT64 i)
+        {
+            UINT64 rawOffset = i * blockSize;
+            UINT64 rawSize = (size - rawOffset < blockSize) ? size - rawOffset : blockSize;
+            UINT8* slot = blocksStart + rawOffset;
+
+            crcs[i] = SafeFormat::CalculateCRC32(data + rawOffset, rawSize);
+
+            UINT64 stored = Encode(codec, data + rawOffset, rawSize, slot, rawSize - 1);
+            if (stored == 0)
+            {
+                memcpy(slot, data + rawOffset, rawSize);
+                stored = rawSize;
+            }
+            storedSizes[i] = stored;
+        });
+
+        // ...then the slots are packed in order (a block never moves past its own slot)
+        UINT64 written = 0;
+        header.checksum = 0;
+        for (UINT64 i = 0; i < blockCount; i++)
+        {
+            UINT64 rawOffset = i * blockSize;
+            UINT64 rawSize = (size - rawOffset < blockSize) ? size - rawOffset : blockSize;
+
+            memmove(blocksStart + written, blocksStart + rawOffset, storedSizes[i]);
+            memcpy(&offsets[i], &written, sizeof(UINT64));
+            written += storedSizes[i];
+
+            header.checksum = SafeFormat::CombineCRC32(header.checksum, crcs[i], rawSize);
+        }
+        memcpy(&offsets[blockCount], &written, sizeof(UINT64));
+
+        if (sizeof(Stream::Header) + tableSize + written >= size)
+            return false;
+
+        header.flags |= Stream::BLOCKED;
+        header.dataSize = tableSize + written;
+    }
+
+    memcpy(outPayload.GetData(), &header, sizeof(Stream::Header));
+    outPayload.Resize(sizeof(Stream::Header) + header.dataSize);
+
+    return true;
+}
+
+bool Codec::Unpack(const UINT8* payload, UINT64 payloadSize, Blob& outData, const Dictionary* dictionary, UINT8 codec)
+{
+    if (payload == nullptr || payloadSize < sizeof(Stream::Header) || !IsSupported(codec))
+        return false;
+
+    Stream::Header header;
+    memcpy(&header, payload, sizeof(Stream::Header));
+
+    if (header.magic[0] != 'S' || header.magic[1] != 'A' ||
+        header.magic[2] != 'F' || header.magic[3] != 'E')
+        return false;
+
+    if (!(header.flags & Stream::COMPRESSED) || header.dataSize != payloadSize - sizeof(Stream::Header))
+        return false;
+
+    // The output buffer is sized by the header: it must be plausible, then really allocated
+    if (header.originalSize > header.dataSize * MAX_RATIO || !outData.Resize(header.originalSize))
+        return false;
+
+    const UINT8* data = payload + sizeof(Stream::Header);
+
+    if (header.flags & Stream::BLOCKED)
+    {
+        BlockTableHeader table;
+        if (header.dataSize < sizeof(BlockTableHeader))
+            return false;
+        memcpy(&table, data, sizeof(BlockTableHeader));
+
+        UINT64 tableSize = GetBlockTableSize(table.blockCount);
+        if (table.blockSize == 0 || tableSize > header.dataSize ||
+            (header.originalSize + table.blockSize - 1) / table.blockSize != table.blockCount)
+            return false;
+
+        const UINT8* offsets = data + sizeof(BlockTableHeader);
+        const UINT8* blocksStart = data + tableSize;
+        UINT64 blocksSize = header.dataSize - tableSize;
+
+        std::vector<UINT64> bounds(static_cast<UINT64>(table.blockCount) + 1);
+        memcpy(bounds.data(), offsets, bounds.size() * sizeof(UINT64));
+
+        for (UINT32 i = 0; i < table.blockCount; i++)
+        {
+            if (bounds[i] > bounds[i + 1] || bounds[i + 1] > blocksSize)
+                return false;
+        }
+
+        std::vector<UINT32> crcs(table.blockCount);
+        std::atomic<bool> valid(true);
+
+        ThreadPool::Get().ParallelFor(table.blockCount, [&](UINT64 i)
+        {
+            UINT64 rawOffset = i * table.blockSize;
+            UINT64 rawSize = (header.originalSize - rawOffset < table.blockSize) ? header.originalSize - rawOffset : table.blockSize;
+
+            if (!DecodeBlock(blocksStart + bounds[i], bounds[i + 1] - bounds[i], outData.GetData() + rawOffset, rawSize, codec))
+            {
+                valid = false;
+                return;
+            }
+            crcs[i] = SafeFormat::CalculateCRC32(outData.GetData() + rawOffset, rawSize);
+        });
+
+        if (!valid)
+            return false;
+
+        UINT32 checksum = 0;
+        for (UINT32 i = 0; i < table.blockCount; i++)
+        {
+            UINT64 rawOffset = static_cast<UINT64>(i) * table.blockSize;
+            UINT64 rawSize = (header.originalSize - rawOffset < table.blockSize) ? header.originalSize - rawOffset : table.blockSize;
+            checksum = SafeFormat::CombineCRC32(checksum, crcs[i], rawSize);
+        }
+
+        return checksum == header.checksum;
+    }
+    else
+    {
+        if ((header.flags & Stream::DICTIONARY) && dictionary == nullptr)
+            return false;
+
+        UINT64 decodedSize = Decode(codec, data, header.dataSize, outData.GetData(), header.originalSize,
+                                    (header.flags & Stream::DICTIONARY) ? dictionary : nullptr);
+        if (decodedSize != header.originalSize)
+            return false;
+    }
+
+    return SafeFormat::CalculateCRC32(outData.GetData(), outData.GetSize()) == header.checksum;
+}
+
+bool Codec::TrainDictionary(const std::vector<Blob>& samples, UINT32 maxSize, Blob& outDictionary)
+{
+    if (samples.size() < DICTIONARY_MIN_SAMPLES || maxSize < TRAIN_SEGMENT)
+        return false;
+
+    // Cover-style training: a k-mer scores the number of samples holding it, each
+    // epoch of the corpus gives its best-scoring segment, and the k-mers of a kept
+    // segment stop scoring so the dictionary does not repeat itself
+    Blob corpus;
+    std::vector<UINT32> hashes;
+    std::vector<UINT32> frequencies(1 << TRAIN_HASH_LOG, 0);
+    std::vector<UINT32> lastSample(1 << TRAIN_HASH_LOG, 0xFFFFFFFF);
+    const UINT32 NO_KMER = 0xFFFFFFFF;
+
+    UINT64 totalSize = 0;
+    for (const Blob& sample : samples)
+        totalSize += sample.GetSize();
+    if (totalSize > DICTIONARY_SAMPLE_BUDGET)
+        totalSize = DICTIONARY_SAMPLE_BUDGET;
+
+    corpus.Reserve(totalSize);
+    hashes.reserve(totalSize);
+
+    for (UINT32 s = 0; s < samples.size(); s++)
+    {
+        const Blob& sample = samples[s];
+        if (sample.GetSize() < TRAIN_KMER)
+            continue;
+        if (corpus.GetSize() + sample.GetSize() > DICTIONARY_SAMPLE_BUDGET)
+            break;
+
+        const UINT8* data = sample.GetData();
+        for (UINT64 i = 0; i < sample.GetSize(); i++)
+        {
+            if (i + TRAIN_KMER > sample.GetSize())
+            {
+                hashes.push_back(NO_KMER);
+                continue;
+            }
+
+            UINT32 h = static_cast<UINT32>((Read64(data + i) * 0xCF1BBCDCB7A56463ULL) >> (64 - TRAIN_HASH_LOG));
+            hashes.push_back(h);
+            if (lastSample[h] != s)
+            {
+                lastSample[h] = s;
+                frequencies[h]++;
+            }
+        }
+        corpus.Append(data, sample.GetSize());
+    }
+
+    UINT64 corpusSize = corpus.GetSize();
+    if (corpusSize < TRAIN_SEGMENT)
+        return false;
+
+    UINT64 segmentCount = maxSize / TRAIN_SEGMENT;
+    UINT64 epochSize = corpusSize / segmentCount;
+    if (epochSize < TRAIN_SEGMENT)
+        epochSize = TRAIN_SEGMENT;
+
+    // A k-mer found in a single sample is no better than a literal
+    auto kmerScore = [&](UINT64 position) -> UINT64
+    {
+        UINT32 h = hashes[position];
+        return (h != NO_KMER && frequencies[h] >= 2) ? frequencies[h] : 0;
+    };
+
+    const UINT64 kmersPerSegment = TRAIN_SEGMENT - TRAIN_KMER + 1;
+    std::vector<std::pair<UINT64, UINT64>> segments; // (score, corpus position)
+
+    for (UINT64 start = 0; start + TRAIN_SEGMENT <= corpusSize && segments.size() < segmentCount; start += epochSize)
+    {
+        UINT64 end = (start + epochSize < corpusSize) ? start + epochSize : corpusSize;
+        if (end - start < TRAIN_SEGMENT)
+            break;
+
+        UINT64 score = 0;
+        for (UINT64 i = 0; i < kmersPerSegment; i++)
+            score += kmerScore(start + i);
+
+        UINT64 bestScore = score;
+        UINT64 bestPosition = start;
+        for (UINT64 p = start + 1; p + TRAIN_SEGMENT <= end; p++)
+        {
+            score += kmerScore(p + kmersPerSegment - 1);
+            score -= kmerScore(p - 1);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestPosition = p;
+            }
+        }
+
+        if (bestScore == 0)
+            continue;
+
+        segments.push_back(std::make_pair(bestScore, bestPosition));
+        for (UINT64 i = 0; i < kmersPerSegment; i++)
+        {
+            if (hashes[bestPosition + i] != NO_KMER)
+                frequencies[hashes[bestPosition + i]] = 0;
+        }
+    }
+
+    if (segments.size() < 2)
+        return false;
+
+    // Best segments last: closest to the entries, they stay in reach the longest
+    std::stable_sort(segments.begin(), segments.end(),
+        [](const std::pair<UINT64, UINT64>& a, const std::pair<UINT64, UINT64>& b) { return a.first < b.first; });
+
+    outDictionary.Resize(0);
+    outDictionary.Reserve(segments.size() * TRAIN_SEGMENT);
+    for (const auto& segment : segments)
+        outDictionary.Append(corpus.GetData() + segment.second, TRAIN_SEGMENT);
+
+    return true;
+}
+
+bool Codec::LoadDictionary(const UINT8* data, UINT64 size, Dictionary& outDictionary)
+{
+    if (data == nullptr || size < MIN_MATCH || size > MAX_DISTANCE)
+        return false;
+
+    if (!outDictionary.data.Resize(size))
+        return false;
+    memcpy(outDictionary.data.GetData(), data, size);
+
+    outDictionary.table.assign(1 << HASH_LOG, 0);
+    for (UINT64 i = 0; i + MIN_MATCH <= size; i++)
+        outDictionary.table[HashSequence(Read32(data + i), HASH_LOG)] = static_cast<UINT32>(i);
+
+    return true;
+}
+
+UINT64 Codec::CompressLZH(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    if (src == nullptr || dst == nullptr || dstCapacity < LZH_HEADER_SIZE)
+        return 0;
+
+    // History = dictionary then entry, so matches reach into the dictionary as the decoder expects
+    std::vector<UINT8> history;
+    const UINT8* base = src;
+    UINT64 start = 0;
+    if (dictionary != nullptr && dictionary->data.GetSize() > 0)
+    {
+        start = dictionary->data.GetSize();
+        history.resize(start + srcSize);
+        memcpy(history.data(), dictionary->data.GetData(), start);
+        if (srcSize > 0)
+            memcpy(history.data() + start, src, srcSize);
+        base = history.data();
+    }
+
+    UINT64 end = start + srcSize;
+    if (end > 0xFFFFFFFF)
+        return 0;
+
+    // Hash chains over the match window, searched deeper than the fast parser, with a one-step lazy match
+    const UINT32 NO_POSITION = 0xFFFFFFFF;
+    std::vector<UINT32> head(1 << LZH_HASH_LOG, NO_POSITION);
+    std::vector<UINT32> chain(MAX_DISTANCE + 1, NO_POSITION);
+
+    auto insert = [&](UINT64 position)
+    {
+        UINT32 h = HashSequence(Read32(base + position), LZH_HASH_LOG);
+        chain[position & MAX_DISTANCE] = head[h];
+        head[h] = static_cast<UINT32>(position);
+    };
+
+    UINT64 matchEnd = (end >= LAST_LITERALS) ? end - LAST_LITERALS : 0;
+    auto findMatch = [&](UINT64 position, UINT64& outDistance) -> UINT64
+    {
+        UINT64 best = 0;
+        UINT32 candidate = head[HashSequence(Read32(base + position), LZH_HASH_LOG)];
+
+        for (UINT32 depth = 0; depth < LZH_SEARCH_DEPTH && candidate != NO_POSITION; depth++)
+        {
+            if (candidate >= position || position - candidate > MAX_DISTANCE)
+                break;
+
+            const UINT8* match = base + candidate;
+            const UINT8* ip = base + position;
+            if (position + best < matchEnd && match[best] == ip[best] && Read32(match) == Read32(ip))
+            {
+                UINT64 length = MIN_MATCH;
+                while (position + length < matchEnd && match[length] == ip[length])
+                    length++;
+
+                if (length > best)
+                {
+                    best = length;
+                    outDistance = position - candidate;
+                    if (position + best >= matchEnd)
+                        break;
+                }
+            }
+            candidate = chain[candidate & MAX_DISTANCE];
+        }
+
+        return (best >= MIN_MATCH) ? best : 0;
+    };
+
+    std::vector<UINT8> sequences;
+    std::vector<UINT8> literals;
+    sequences.reserve(srcSize / 4 + 16);
+    literals.reserve(srcSize);
+
+    auto emit = [&](UINT64 anchor, UINT64 literalLength, UINT64 distance, UINT64 matchLength)
+    {
+        UINT8 token = static_cast<UINT8>(((literalLength >= 15) ? 15 : literalLength) << 4);
+        if (matchLength > 0)
+            token |= static_cast<UINT8>((matchLength - MIN_MATCH >= 15) ? 15 : matchLength - MIN_MATCH);
+        sequences.push_back(token);
+
+        UINT8 lengthBytes[16];
+        if (literalLength >= 15)
+        {
+            for (UINT64 rest = literalLength - 15; ; rest -= 255)
+            {
+                sequences.push_back(static_cast<UINT8>((rest >= 255) ? 255 : rest));
+                if (rest < 255)
+                    break;
+            }
+        }
+        literals.insert(literals.end(), base + anchor, base + anchor + literalLength);
+
+        if (matchLength == 0)
+            return;
+
+        lengthBytes[0] = static_cast<UINT8>(distance & 0xFF);
+        lengthBytes[1] = static_cast<UINT8>(distance >> 8);
+        sequences.insert(sequences.end(), lengthBytes, lengthBytes + 2);
+
+        if (matchLength - MIN_MATCH >= 15)
+        {
+            for (UINT64 rest = matchLength - MIN_MATCH - 15; ; rest -= 255)
+            {
+                sequences.push_back(static_cast<UINT8>((rest >= 255) ? 255 : rest));
+                if (rest < 255)
+                    break;
+            }
+        }
+    };
+
+    for (UINT64 p = 0; p + MIN_MATCH <= start; p++)
+        insert(p);
+
+    UINT64 position = start;
+    UINT64 anchor = start;
+    while (position + MF_LIMIT <= end)
+    {
+        UINT64 distance = 0;
+        UINT64 length = findMatch(position, distance);
+        insert(position);
+
+        if (length == 0)
+        {
+            position++;
+            continue;
+        }
+
+        // A longer match one byte later is worth a literal
+        if (position + 1 + MF_LIMIT <= end)
+        {
+            UINT64 nextDistance = 0;
+            UINT64 nextLength = findMatch(position + 1, nextDistance);
+            if (nextLength > length)
+            {
+                position++;
+                insert(position);
+                length = nextLength;
+                distance = nextDistance;
+            }
+        }
+
+        emit(anchor, position - anchor, distance, length);
+
+        UINT64 matchStop = position + length;
+        for (UINT64 p = position + 1; p < matchStop && p + MIN_MATCH <= end; p++)
+            insert(p);
+
+        position = matchStop;
+        anchor = position;
+    }
+    emit(anchor, end - anchor, 0, 0);
+
+    if (literals.size() > 0xFFFFFFFF)
+        return 0;
+
+    UINT8* op = dst + LZH_HEADER_SIZE;
+    UINT64 remaining = dstCapacity - LZH_HEADER_SIZE;
+
+    // Huffman only when it beats the raw literals
+    UINT64 literalSize = 0;
+    if (literals.size() > HUFFMAN_TABLE_BYTES)
+    {
+        UINT64 capacity = (remaining < literals.size() - 1) ? remaining : literals.size() - 1;
+        literalSize = HuffmanEncode(literals.data(), literals.size(), op, capacity);
+    }
+    if (literalSize == 0)
+    {
+        if (literals.size() > remaining)
+            return 0;
+        if (!literals.empty())
+            memcpy(op, literals.data(), literals.size());
+        literalSize = literals.size();
+    }
+    op += literalSize;
+    remaining -= literalSize;
+
+    if (sequences.size() > remaining)
+        return 0;
+    memcpy(op, sequences.data(), sequences.size());
+
+    UINT32 header[2] = { static_cast<UINT32>(literals.size()), static_cast<UINT32>(literalSize) };
+    memcpy(dst, header, LZH_HEADER_SIZE);
+
+    return LZH_HEADER_SIZE + literalSize + sequences.size();
+}
+
+UINT64 Codec::DecompressLZH(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    if (src == nullptr || dst == nullptr || srcSize < LZH_HEADER_SIZE)
+        return 0;
+
+    UINT32 header[2];
+    memcpy(header, src, LZH_HEADER_SIZE);
+    UINT64 literalCount = header[0];
+    UINT64 literalSize = header[1];
+
+    if (literalSize > srcSize - LZH_HEADER_SIZE || literalCount > dstCapacity)
+        return 0;
+
+    // Raw literals are stored as is (literalSize == literalCount)
+    const UINT8* literals = src + LZH_HEADER_SIZE;
+    std::vector<UINT8> decoded;
+    if (literalSize != literalCount)
+    {
+        if (literalCount == 0)
+            return 0;
+
+        decoded.resize(literalCount);
+        if (!HuffmanDecode(literals, literalSize, decoded.data(), literalCount))
+            return 0;
+        literals = decoded.data();
+    }
+
+    const UINT8* sequences = src + LZH_HEADER_SIZE + literalSize;
+    return DecodeSequences(sequences, srcSize - LZH_HEADER_SIZE - literalSize, literals, literalCount, dst, dstCapacity, dictionary);
+}
+
+UINT64 Codec::Encode(UINT8 codec, const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    switch (codec)
+    {
+    case CODEC_LZ:  return Compress(src, srcSize, dst, dstCapacity, dictionary);
+    case CODEC_LZH: return CompressLZH(src, srcSize, dst, dstCapacity, dictionary);
+    default:        return 0;
+    }
+}
+
+UINT64 Codec::Decode(UINT8 codec, const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary)
+{
+    switch (codec)
+    {
+    case CODEC_LZ:  return Decompress(src, srcSize, dst, dstCapacity, dictionary);
+    case CODEC_LZH: return DecompressLZH(src, srcSize, dst, dstCapacity, dictionary);
+    default:        return 0;
+    }
+}
+
+bool Codec::IsSupported(UINT8 codec)
+{
+    return codec == CODEC_LZ || codec == CODEC_LZH;
+}
+
+const char* Codec::GetName(UINT8 codec)
+{
+    switch (codec)
+    {
+    case CODEC_NONE: return "store";
+    case CODEC_LZ:   return "lz";
+    case CODEC_LZH:  return "lzh";
+    default:         return "unknown";
+    }
+}
+
+UINT32 Codec::GetDecodeSpeed(UINT8 codec)
+{
+    switch (codec)
+    {
+    case CODEC_NONE: return DECODE_SPEED_STORE;
+    case CODEC_LZ:   return DECODE_SPEED_LZ;
+    case CODEC_LZH:  return DECODE_SPEED_LZH;
+    default:         return 0;
+    }
+}
+
+Codec::Estimate Codec::EstimateData(const UINT8* data, UINT64 size)
+{
+    Estimate estimate = { 0.0, 0.0 };
+    if (data == nullptr || size == 0)
+        return estimate;
+
+    // A few windows spread over the data: byte histogram + how often a 4-byte
+    // sequence repeats one seen earlier in the same window
+    UINT64 windowCount = (size + ESTIMATE_WINDOW - 1) / ESTIMATE_WINDOW;
+    UINT64 step = (windowCount > ESTIMATE_WINDOWS) ? windowCount / ESTIMATE_WINDOWS : 1;
+
+    UINT64 histogram[256] = { 0 };
+    UINT64 sampled = 0;
+    UINT64 probes = 0;
+    UINT64 repeats = 0;
+
+    for (UINT64 w = 0, taken = 0; w < windowCount && taken < ESTIMATE_WINDOWS; w += step, taken++)
+    {
+        const UINT8* window = data + w * ESTIMATE_WINDOW;
+        UINT64 length = (size - w * ESTIMATE_WINDOW < ESTIMATE_WINDOW) ? size - w * ESTIMATE_WINDOW : ESTIMATE_WINDOW;
+
+        for (UINT64 i = 0; i < length; i++)
+            histogram[window[i]]++;
+        sampled += length;
+
+        UINT16 seen[1 << 10] = { 0 };
+        for (UINT64 i = 0; i + MIN_MATCH <= length; i++)
+        {
+            UINT32 sequence = Read32(window + i);
+            UINT32 h = HashSequence(sequence, 10);
+            if (seen[h] != 0 && Read32(window + seen[h] - 1) == sequence)
+                repeats++;
+            seen[h] = static_cast<UINT16>(i + 1);
+            probes++;
+        }
+    }
+
+    for (UINT32 b = 0; b < 256; b++)
+    {
+        if (histogram[b] == 0)
+            continue;
+        double p = static_cast<double>(histogram[b]) / sampled;
+        estimate.entropy -= p * std::log2(p);
+    }
+    estimate.repeatRatio = (probes > 0) ? static_cast<double>(repeats) / probes : 0.0;
+
+    return estimate;
+}
@@ -0,0 +1,115 @@
+#ifndef CODEC_H__
+#define CODEC_H__
+
+enum CodecType : UINT8
+{
+    CODEC_NONE = 0x00,
+    CODEC_LZ   = 0x01,
+    CODEC_LZH  = 0x02
+};
+
+// Follows the Stream::Header of a BLOCKED payload, then (blockCount + 1) UINT64
+// offsets of each block relative to the first one. A block whose stored size
+// equals its raw size is stored uncompressed.
+struct BlockTableHeader
+{
+    UINT32   blockSize;
+    UINT32   blockCount;
+};
+
+class Codec
+{
+public:
+    static const UINT32 DEFAULT_BLOCK_SIZE = 256 * 1024;
+    static const UINT32 DICTIONARY_MAX_SIZE = 32 * 1024;
+    //Larger entries would push the start of the dictionary out of the match window
+    static const UINT32 DICTIONARY_ENTRY_LIMIT = 32 * 1024;
+    static const UINT32 DICTIONARY_MIN_SAMPLES = 8;
+    static const UINT64 DICTIONARY_SAMPLE_BUDGET = 4 * 1024 * 1024;
+    //A stored byte never decodes to more than 255 (one length byte): a payload claiming
+    //more than MAX_RATIO x its size is forged
+    static const UINT64 MAX_RATIO = 256;
+
+    // History that precedes every entry compressed with it: matches may reach
+    // back into it. The hash table is built once at load, entries copy it.
+    struct Dictionary
+    {
+        Blob data;
+        std::vector<UINT32> table;
+    };
+
+    // Sampled statistics, cheap enough to run on every entry before packing it
+    struct Estimate
+    {
+        double entropy;      // order-0, bits per byte
+        double repeatRatio;  // share of 4-byte sequences already seen nearby
+    };
+
+    // === LZ Block Codec (LZ4 block format) ===
+    static UINT64 CompressBound(UINT64 size);
+    //Returns 0 if the output does not fit in dstCapacity
+    static UINT64 Compress(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary = nullptr);
+    //Returns the decoded size, 0 on malformed input
+    static UINT64 Decompress(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary = nullptr);
+
+    // === LZH (deeper parse, literals Huffman-coded: better ratio, slower decode) ===
+    static UINT64 CompressLZH(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary = nullptr);
+    static UINT64 DecompressLZH(const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary = nullptr);
+
+    // === Codec Selection ===
+    static UINT64 Encode(UINT8 codec, const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary = nullptr);
+    static UINT64 Decode(UINT8 codec, const UINT8* src, UINT64 srcSize, UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary = nullptr);
+    static bool IsSupported(UINT8 codec);
+    static const char* GetName(UINT8 codec);
+    //Rough single-core decode throughput in MB/s, to compare codecs against a budget
+    static UINT32 GetDecodeSpeed(UINT8 codec);
+    static Estimate EstimateData(const UINT8* data, UINT64 size);
+
+    // === Entry Payload (Stream::Header + compressed data) ===
+    //Data larger than blockSize is split in independent blocks (0: single stream)
+    //Single streams up to DICTIONARY_ENTRY_LIMIT use the dictionary when one is given
+    //Returns false if the data does not shrink: store it raw instead
+    static bool Pack(const UINT8* data, UINT64 size, Blob& outPayload, UINT32 blockSize = DEFAULT_BLOCK_SIZE,
+                     const Dictionary* dictionary = nullptr, UINT8 codec = CODEC_LZ);
+    static bool Unpack(const UINT8* payload, UINT64 payloadSize, Blob& outData,
+                       const Dictionary* dictionary = nullptr, UINT8 codec = CODEC_LZ);
+
+    // === Dictionary ===
+    //Keeps the segments most shared across samples (false if too few samples or too little in common)
+    static bool TrainDictionary(const std::vector<Blob>& samples, UINT32 maxSize, Blob& outDictionary);
+    static bool LoadDictionary(const UINT8* data, UINT64 size, Dictionary& outDictionary);
+
+    // === Blocks ===
+    static UINT64 GetBlockTableSize(UINT32 blockCount);
+    static bool DecodeBlock(const UINT8* src, UINT64 storedSize, UINT8* dst, UINT64 rawSize, UINT8 codec = CODEC_LZ);
+
+private:
+    //literals == nullptr: literals are inline after each token (LZ4 layout)
+    static UINT64 DecodeSequences(const UINT8* src, UINT64 srcSize, const UINT8* literals, UINT64 literalCount,
+                                  UINT8* dst, UINT64 dstCapacity, const Dictionary* dictionary);
+
+    static const UINT32 HASH_LOG = 12;
+    static const UINT32 MIN_MATCH = 4;
+    static const UINT32 LAST_LITERALS = 5;
+    static const UINT32 MF_LIMIT = 12;
+    static const UINT32 MAX_DISTANCE = 65535;
+    static const UINT32 SKIP_TRIGGER = 6;
+
+    //UINT32 literal count + UINT32 literal section size
+    static const UINT64 LZH_HEADER_SIZE = 8;
+    static const UINT32 LZH_HASH_LOG = 16;
+    static const UINT32 LZH_SEARCH_DEPTH = 32;
+
+    static const UINT32 DECODE_SPEED_STORE = 8000;
+    static const UINT32 DECODE_SPEED_LZ = 2000;
+    static const UINT32 DECODE_SPEED_LZH = 400;
+
+    static const UINT64 ESTIMATE_WINDOW = 4096;
+    static const UINT64 ESTIMATE_WINDOWS = 16;
+
+    static const UINT32 TRAIN_KMER = 8;
+    static const UINT32 TRAIN_SEGMENT = 64;
+    static const UINT32 TRAIN_HASH_LOG = 20;
+};
+
+#endif // !CODEC_H__
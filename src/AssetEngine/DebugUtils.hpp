@@ -145,6 +145,7 @@ namespace DebugUtils
 		double average;
 		UINT64 zeros;
 		UINT64 printable;
+		double entropy;		// order-0, bits per byte (8 = incompressible)
 	};
 	inline DataStats AnalyzeData(const UINT8* data, UINT64 size)
 	{
@@ -155,10 +156,12 @@ namespace DebugUtils
 		stats.minValue = 255;
 		stats.maxValue = 0;
 		UINT64 sum = 0;
+		UINT64 histogram[256] = { 0 };
 
 		for (UINT64 i = 0; i < size; i++)
 		{
 			UINT8 byte = data[i];
+			histogram[byte]++;
 
 			if (byte < stats.minValue) stats.minValue = byte;
 			if (byte > stats.maxValue) stats.maxValue = byte;
@@ -171,6 +174,13 @@ namespace DebugUtils
 
 		stats.average = (double)sum / size;
 
+		for (UINT32 i = 0; i < 256; i++)
+		{
+			if (histogram[i] == 0) continue;
+			double p = (double)histogram[i] / size;
+			stats.entropy -= p * std::log2(p);
+		}
+
 		return stats;
 	}
 	inline void PrintStats(const DataStats& stats)
@@ -184,6 +194,7 @@ namespace DebugUtils
 			<< (stats.size > 0 ? (stats.zeros * 100 / stats.size) : 0) << "%)\n";
 		std::cout << "  Printable: " << stats.printable << " ("
 			<< (stats.size > 0 ? (stats.printable * 100 / stats.size) : 0) << "%)\n";
+		std::cout << "  Entropy:   " << std::fixed << std::setprecision(2) << stats.entropy << " bits/byte\n";
 	}
 
 	//DATA TESTS
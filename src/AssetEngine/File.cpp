@@ -23,6 +23,24 @@ bool File::Open(const std::string& filename, Mode mode)
         return false;
 
     mMode = mode; 
+    mPath = filename;
+    mPosition = 0;
+    mWritten = false;
+
+    // The cache does the buffering: stdio would only copy every block twice
+    if (mode == READ && mUseBlockCache && BlockCache::Get().GetBudget() > 0)
+    {
+        mCacheID = BlockCache::Get().Register(filename, mCacheSize);
+        if (mCacheID != 0)
+        {
+            setvbuf(mpFile, nullptr, _IONBF, 0);
+            return true;
+        }
+    }
+
+    UINT64 bufferSize = (mBufferSize == USE_POLICY) ? IoBuffer::GetFileBufferSize() : mBufferSize;
+    if (bufferSize > 0)
+        setvbuf(mpFile, nullptr, _IOFBF, static_cast<size_t>(bufferSize));
     return true;
 }
 
@@ -35,10 +53,24 @@ UINT64 File::Read(UINT8 *buffer, UINT64 size, UINT64 count)
     UINT64 totalBytes = size * count;
     UINT64 bytesRead = 0;
 
+    if (mCacheID != 0)
+    {
+        bytesRead = BlockCache::Get().Read(mCacheID, mpFile, mCacheSize, mPosition, buffer, totalBytes);
+        mPosition += bytesRead;
+
+        // Same keystream restarts as the chunked reads below
+        if (mIsEncrypted)
+        {
+            for (UINT64 done = 0; done < bytesRead; done += MAX_BUFFER_SIZE)
+                DecryptBuffer(buffer + done, ComputeChunkSize(bytesRead - done));
+        }
+        return bytesRead;
+    }
+
     while (totalBytes > 0)
     {
         UINT64 chunkSize = ComputeChunkSize(totalBytes);
-        UINT64 read = fread_s(buffer + bytesRead, size - bytesRead, 1, chunkSize, mpFile);
+        UINT64 read = fread_s(buffer + bytesRead, size * count - bytesRead, 1, chunkSize, mpFile);
 
         if (read == 0)
         {
@@ -65,6 +97,7 @@ UINT64 File::Write(const UINT8 *buffer, UINT64 size, UINT64 count)
 
     UINT64 totalBytes = size * count;
     UINT64 bytesWritten = 0;
+    mWritten = true;
 
     while (totalBytes > 0)
     {
@@ -101,12 +134,29 @@ void File::Close()
         return;
     fclose(mpFile);
     mpFile = nullptr;
+    mCacheID = 0;
+
+    // Cached copies of what was just overwritten must not be served again
+    if (mWritten && BlockCache::Get().GetBudget() > 0)
+        BlockCache::Get().Invalidate(mPath);
+    mWritten = false;
 }
 
 INT64 File::Seek(INT64 offset, int origin)
 {
     assert(IsOpen() && "Cannot seek: file is not open.");
 
+    if (mCacheID != 0)
+    {
+        INT64 base = 0;
+        if (origin == SEEK_CUR) base = static_cast<INT64>(mPosition);
+        else if (origin == SEEK_END) base = static_cast<INT64>(mCacheSize);
+
+        assert(base + offset >= 0 && "File::Seek failed to move cursor.");
+        mPosition = static_cast<UINT64>(base + offset);
+        return static_cast<INT64>(mPosition);
+    }
+
     int result = _fseeki64(mpFile, offset, origin);
     assert(result == 0 && "File::Seek failed to move cursor.");
 
@@ -120,7 +170,7 @@ INT64 File::Seek(INT64 offset, int origin)
 UINT64 File::ComputeChunkSize(UINT64 remainingBytes) const
 {
     UINT64 chunkSize;
-    if (remainingBytes > MAX_BUFFER_SIZE) chunkSize = MAX_BUFFER_SIZE;
+    if (mIsEncrypted && remainingBytes > MAX_BUFFER_SIZE) chunkSize = MAX_BUFFER_SIZE;
     else chunkSize = remainingBytes;
     return chunkSize;
 }
@@ -145,31 +195,3 @@ UINT64 File::GetSize()
 
     return static_cast<UINT64>(fileSize);
 }
-
-std::string File::GetKey() const
-{
-    return mKey;
-}
-
-void File::SetKey(const std::string& key)
-{
-    mKey = key;
-}
-
-void File::EncryptBuffer(UINT8* buffer, UINT64 size)
-{
-    if (mKey.empty() || buffer == nullptr || size == 0)
-        return;
-
-    const UINT64 keyLength = mKey.size();
-
-    for (UINT64 i = 0; i < size; ++i)
-    {
-        buffer[i] ^= static_cast<UINT8>(mKey[i % keyLength]);
-    }
-}
-
-void File::DecryptBuffer(UINT8* buffer, UINT64 size)
-{
-    EncryptBuffer(buffer, size);    // ff c'est du XOR ;)
-}
\ No newline at end of file
@@ -10,7 +10,7 @@ enum  Mode
 class File : public Stream
 {
 public:
-    File() : mIsEncrypted(false), mMode(READ) {}
+    File() : mMode(READ), mBufferSize(USE_POLICY), mUseBlockCache(false), mCacheID(0), mCacheSize(0), mPosition(0), mWritten(false) {}
     ~File() override;
     
     bool            Open(const std::string& filename, Mode mode);
@@ -21,13 +21,15 @@ public:
 
     bool            OpenRead(const std::string& filename);
     bool            OpenWrite(const std::string& filename);
-    
-    std::string     GetKey() const;
-    void            SetKey(const std::string& key);
-    void            EncryptBuffer(UINT8* buffer, UINT64 size);
-    void            DecryptBuffer(UINT8* buffer, UINT64 size);
-    void            EnableEncryption(bool enable) { mIsEncrypted = enable; }
-    bool            IsEncryptionEnabled() const { return mIsEncrypted; }
+
+    //stdio buffer (setvbuf) from the next Open: 0 keeps the C runtime's own, USE_POLICY
+    //follows IoBuffer::GetFileBufferSize(). Block-cached files stay unbuffered.
+    static const UINT64 USE_POLICY = ~0ull;
+    void            SetBufferSize(UINT64 size) { mBufferSize = size; }
+
+    //Reads go through BlockCache (files opened for READ from the next Open, while the cache has a budget)
+    void            EnableBlockCache(bool enable) { mUseBlockCache = enable; }
+    bool            IsBlockCached() const { return mCacheID != 0; }
 
 
     bool            IsOpen() const override { return mpFile != nullptr; }
@@ -36,9 +38,17 @@ public:
     Mode            GetMode() const { return mMode; }
 
 private:
+    //MAX_BUFFER_SIZE pieces when encrypted (keystream restarts), else all at once
     UINT64          ComputeChunkSize(UINT64 remainingBytes) const;
 
-    std::string     mKey;
-    bool            mIsEncrypted;
     Mode            mMode;
+    UINT64          mBufferSize;
+
+    // === Block cache ===
+    std::string     mPath;
+    bool            mUseBlockCache;
+    UINT64          mCacheID;
+    UINT64          mCacheSize;
+    UINT64          mPosition;      // cached reads keep their own cursor
+    bool            mWritten;
 };
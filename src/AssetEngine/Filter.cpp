@@ -0,0 +1,390 @@
+#include "pch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FILTER_SSE2
+#endif
+
+#ifdef FILTER_SSE2
+namespace
+{
+    // Each pass rotates the 8-bit (row, column) address of every byte left by one,
+    // so four passes swap rows and columns
+    void Transpose16x16(__m128i x[16])
+    {
+        __m128i t[16];
+        for (int pass = 0; pass < 4; pass++)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                t[2 * i] = _mm_unpacklo_epi8(x[i], x[i + 8]);
+                t[2 * i + 1] = _mm_unpackhi_epi8(x[i], x[i + 8]);
+            }
+            for (int i = 0; i < 16; i++)
+                x[i] = t[i];
+        }
+    }
+}
+#endif
+
+bool Filter::IsValid(const FilterSpec& spec)
+{
+    return spec.type != FILTER_NONE && (spec.type & ~(FILTER_SHUFFLE | FILTER_DELTA)) == 0 && spec.width > 0;
+}
+
+std::string Filter::GetName(const FilterSpec& spec)
+{
+    if (!IsValid(spec))
+        return "none";
+
+    std::string name;
+    if (spec.type & FILTER_SHUFFLE)
+        name = "shuffle";
+    if (spec.type & FILTER_DELTA)
+        name += name.empty() ? "delta" : "+delta";
+
+    return name + ":" + std::to_string(spec.width);
+}
+
+bool Filter::Parse(const std::string& text, FilterSpec& outSpec)
+{
+    size_t colon = text.find(':');
+    if (colon == std::string::npos)
+        return false;
+
+    std::string name = text.substr(0, colon);
+    std::string width = text.substr(colon + 1);
+
+    FilterSpec spec = {};
+    if (name == "shuffle")
+        spec.type = FILTER_SHUFFLE;
+    else if (name == "delta")
+        spec.type = FILTER_DELTA;
+    else if (name == "shuffle+delta")
+        spec.type = FILTER_SHUFFLE | FILTER_DELTA;
+    else
+        return false;
+
+    char* end = nullptr;
+    unsigned long value = strtoul(width.c_str(), &end, 10);
+    if (width.empty() || *end != '\0' || value == 0 || value > 255)
+        return false;
+
+    spec.width = static_cast<UINT8>(value);
+    outSpec = spec;
+    return true;
+}
+
+void Filter::Apply(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size, UINT64 segmentSize)
+{
+    if (size == 0)
+        return;
+
+    if (segmentSize == 0 || segmentSize >= size)
+    {
+        ApplySegment(spec, src, dst, size);
+        return;
+    }
+
+    UINT64 segmentCount = (size + segmentSize - 1) / segmentSize;
+    ThreadPool::Get().ParallelFor(segmentCount, [&](UINT64 i)
+    {
+        UINT64 offset = i * segmentSize;
+        UINT64 length = (size - offset < segmentSize) ? size - offset : segmentSize;
+        ApplySegment(spec, src + offset, dst + offset, length);
+    });
+}
+
+void Filter::Revert(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size, UINT64 segmentSize)
+{
+    if (size == 0)
+        return;
+
+    if (segmentSize == 0 || segmentSize > size)
+        segmentSize = size;
+
+    UINT64 segmentCount = (size + segmentSize - 1) / segmentSize;
+    ThreadPool::Get().ParallelFor(segmentCount, [&](UINT64 i)
+    {
+        UINT64 offset = i * segmentSize;
+        UINT64 length = (size - offset < segmentSize) ? size - offset : segmentSize;
+
+        // Delta-coded planes are restored aside before being interleaved back
+        std::vector<UINT8> scratch;
+        if ((spec.type & FILTER_SHUFFLE) && (spec.type & FILTER_DELTA))
+            scratch.resize(length);
+
+        RevertSegment(spec, src + offset, dst + offset, length, scratch.data());
+    });
+}
+
+void Filter::ApplySegment(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size)
+{
+    if (!IsValid(spec))
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    if (spec.type & FILTER_SHUFFLE)
+    {
+        Shuffle(src, dst, size, spec.width);
+
+        // Within a plane, consecutive elements are next to each other
+        if (spec.type & FILTER_DELTA)
+        {
+            UINT64 count = size / spec.width;
+            for (UINT32 k = 0; k < spec.width; k++)
+                DeltaEncode(dst + k * count, dst + k * count, count, 1);
+        }
+        return;
+    }
+
+    DeltaEncode(src, dst, size, spec.width);
+}
+
+void Filter::RevertSegment(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size, UINT8* scratch)
+{
+    if (!IsValid(spec))
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    if (spec.type & FILTER_SHUFFLE)
+    {
+        const UINT8* planes = src;
+        if (spec.type & FILTER_DELTA)
+        {
+            UINT64 count = size / spec.width;
+            for (UINT32 k = 0; k < spec.width; k++)
+                DeltaDecode(src + k * count, scratch + k * count, count, 1);
+
+            UINT64 tail = count * spec.width;
+            memcpy(scratch + tail, src + tail, size - tail);
+            planes = scratch;
+        }
+
+        Unshuffle(planes, dst, size, spec.width);
+        return;
+    }
+
+    DeltaDecode(src, dst, size, spec.width);
+}
+
+void Filter::Shuffle(const UINT8* src, UINT8* dst, UINT64 size, UINT32 width)
+{
+    UINT64 count = (width > 1) ? size / width : 0;
+    UINT64 element = 0;
+
+#ifdef FILTER_SSE2
+    // 16 elements per step: isolate byte k of each lane, then narrow the lanes to bytes
+    if (width == 4)
+    {
+        const __m128i low = _mm_set1_epi32(0xFF);
+        for (; element + 16 <= count; element += 16)
+        {
+            const UINT8* in = src + element * 4;
+            __m128i v0 = _mm_loadu_si128((const __m128i*)in);
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(in + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(in + 32));
+            __m128i v3 = _mm_loadu_si128((const __m128i*)(in + 48));
+
+            for (UINT32 k = 0; k < 4; k++)
+            {
+                __m128i shift = _mm_cvtsi32_si128(static_cast<int>(k * 8));
+                __m128i a0 = _mm_and_si128(_mm_srl_epi32(v0, shift), low);
+                __m128i a1 = _mm_and_si128(_mm_srl_epi32(v1, shift), low);
+                __m128i a2 = _mm_and_si128(_mm_srl_epi32(v2, shift), low);
+                __m128i a3 = _mm_and_si128(_mm_srl_epi32(v3, shift), low);
+
+                __m128i plane = _mm_packus_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(a2, a3));
+                _mm_storeu_si128((__m128i*)(dst + k * count + element), plane);
+            }
+        }
+    }
+    else if (width >= 16)
+    {
+        // 16 elements x 16 bytes tiles; the last tile of a row overlaps the previous one
+        for (; element + 16 <= count; element += 16)
+        {
+            for (UINT32 k = 0; k < width; k += 16)
+            {
+                UINT32 column = (k + 16 <= width) ? k : width - 16;
+
+                __m128i x[16];
+                for (int r = 0; r < 16; r++)
+                    x[r] = _mm_loadu_si128((const __m128i*)(src + (element + r) * width + column));
+
+                Transpose16x16(x);
+
+                for (int c = 0; c < 16; c++)
+                    _mm_storeu_si128((__m128i*)(dst + (column + c) * count + element), x[c]);
+            }
+        }
+    }
+    else if (width == 2)
+    {
+        const __m128i low = _mm_set1_epi16(0xFF);
+        for (; element + 16 <= count; element += 16)
+        {
+            const UINT8* in = src + element * 2;
+            __m128i v0 = _mm_loadu_si128((const __m128i*)in);
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(in + 16));
+
+            _mm_storeu_si128((__m128i*)(dst + element),
+                             _mm_packus_epi16(_mm_and_si128(v0, low), _mm_and_si128(v1, low)));
+            _mm_storeu_si128((__m128i*)(dst + count + element),
+                             _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8)));
+        }
+    }
+#endif
+
+    for (UINT32 k = 0; k < width && count > 0; k++)
+    {
+        UINT8* plane = dst + k * count;
+        for (UINT64 e = element; e < count; e++)
+            plane[e] = src[e * width + k];
+    }
+
+    UINT64 tail = count * width;
+    if (size > tail)
+        memcpy(dst + tail, src + tail, size - tail);
+}
+
+void Filter::Unshuffle(const UINT8* src, UINT8* dst, UINT64 size, UINT32 width)
+{
+    UINT64 count = (width > 1) ? size / width : 0;
+    UINT64 element = 0;
+
+#ifdef FILTER_SSE2
+    // Interleave the planes back: bytes into pairs, then pairs into 4-byte elements
+    if (width == 4)
+    {
+        for (; element + 16 <= count; element += 16)
+        {
+            __m128i p0 = _mm_loadu_si128((const __m128i*)(src + element));
+            __m128i p1 = _mm_loadu_si128((const __m128i*)(src + count + element));
+            __m128i p2 = _mm_loadu_si128((const __m128i*)(src + 2 * count + element));
+            __m128i p3 = _mm_loadu_si128((const __m128i*)(src + 3 * count + element));
+
+            __m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+            __m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+            __m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+            __m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+
+            UINT8* out = dst + element * 4;
+            _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi16(lo01, lo23));
+            _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi16(lo01, lo23));
+            _mm_storeu_si128((__m128i*)(out + 32), _mm_unpacklo_epi16(hi01, hi23));
+            _mm_storeu_si128((__m128i*)(out + 48), _mm_unpackhi_epi16(hi01, hi23));
+        }
+    }
+    else if (width >= 16)
+    {
+        for (; element + 16 <= count; element += 16)
+        {
+            for (UINT32 k = 0; k < width; k += 16)
+            {
+                UINT32 column = (k + 16 <= width) ? k : width - 16;
+
+                __m128i x[16];
+                for (int c = 0; c < 16; c++)
+                    x[c] = _mm_loadu_si128((const __m128i*)(src + (column + c) * count + element));
+
+                Transpose16x16(x);
+
+                for (int r = 0; r < 16; r++)
+                    _mm_storeu_si128((__m128i*)(dst + (element + r) * width + column), x[r]);
+            }
+        }
+    }
+    else if (width == 2)
+    {
+        for (; element + 16 <= count; element += 16)
+        {
+            __m128i p0 = _mm_loadu_si128((const __m128i*)(src + element));
+            __m128i p1 = _mm_loadu_si128((const __m128i*)(src + count + element));
+
+            UINT8* out = dst + element * 2;
+            _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(p0, p1));
+            _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(p0, p1));
+        }
+    }
+#endif
+
+    for (UINT32 k = 0; k < width && count > 0; k++)
+    {
+        const UINT8* plane = src + k * count;
+        for (UINT64 e = element; e < count; e++)
+            dst[e * width + k] = plane[e];
+    }
+
+    UINT64 tail = count * width;
+    if (size > tail)
+        memcpy(dst + tail, src + tail, size - tail);
+}
+
+void Filter::DeltaEncode(const UINT8* src, UINT8* dst, UINT64 size, UINT32 distance)
+{
+    // Backwards, so that in place every byte is read before it is overwritten
+    UINT64 i = size;
+
+#ifdef FILTER_SSE2
+    while (i >= static_cast<UINT64>(distance) + 16)
+    {
+        i -= 16;
+        __m128i current = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i previous = _mm_loadu_si128((const __m128i*)(src + i - distance));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_sub_epi8(current, previous));
+    }
+#endif
+
+    while (i > distance)
+    {
+        i--;
+        dst[i] = static_cast<UINT8>(src[i] - src[i - distance]);
+    }
+
+    if (src != dst)
+        memcpy(dst, src, (size < distance) ? size : distance);
+}
+
+void Filter::DeltaDecode(const UINT8* src, UINT8* dst, UINT64 size, UINT32 distance)
+{
+    UINT64 i = (size < distance) ? size : distance;
+    if (src != dst)
+        memcpy(dst, src, i);
+
+#ifdef FILTER_SSE2
+    if (distance == 1 && size > 0)
+    {
+        // Prefix sum of 16 bytes in four shifted adds, plus the last byte decoded
+        UINT8 carry = dst[0];
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(carry)));
+            _mm_storeu_si128((__m128i*)(dst + i), x);
+            carry = dst[i + 15];
+        }
+    }
+    else if (distance >= 16)
+    {
+        // The previous element is already decoded and never overlaps the current vector
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i current = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i previous = _mm_loadu_si128((const __m128i*)(dst + i - distance));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi8(current, previous));
+        }
+    }
+#endif
+
+    for (; i < size; i++)
+        dst[i] = static_cast<UINT8>(src[i] + dst[i - distance]);
+}
@@ -0,0 +1,48 @@
+#ifndef FILTER_H__
+#define FILTER_H__
+
+enum FilterType : UINT8
+{
+    FILTER_NONE    = 0x00,
+    FILTER_SHUFFLE = 0x01,  // byte k of every element, then byte k + 1...
+    FILTER_DELTA   = 0x02   // each byte minus the same byte of the previous element
+};
+
+// Reversible transform run before compression. Both types may be combined:
+// the shuffle runs first, then each byte plane is delta-encoded.
+struct FilterSpec
+{
+    UINT8    type;
+    UINT8    width;     // element size in bytes
+};
+
+class Filter
+{
+public:
+    static bool IsValid(const FilterSpec& spec);
+    //"shuffle+delta:4"
+    static std::string GetName(const FilterSpec& spec);
+    //Parses "shuffle:4", "delta:2", "shuffle+delta:12"
+    static bool Parse(const std::string& text, FilterSpec& outSpec);
+
+    //Each segment of segmentSize bytes is filtered on its own (0: the whole buffer),
+    //so a compressed block can be reverted without its neighbours.
+    //src and dst must not overlap.
+    static void Apply(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size, UINT64 segmentSize = 0);
+    static void Revert(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size, UINT64 segmentSize = 0);
+
+    // === Kernels (SSE2 where available: widths 2, 4 and 16+) ===
+    //Bytes past the last whole element are copied as is
+    static void Shuffle(const UINT8* src, UINT8* dst, UINT64 size, UINT32 width);
+    static void Unshuffle(const UINT8* src, UINT8* dst, UINT64 size, UINT32 width);
+    //dst[i] = src[i] - src[i - distance]; src may be dst
+    static void DeltaEncode(const UINT8* src, UINT8* dst, UINT64 size, UINT32 distance);
+    //dst[i] = src[i] + dst[i - distance]; src may be dst
+    static void DeltaDecode(const UINT8* src, UINT8* dst, UINT64 size, UINT32 distance);
+
+private:
+    static void ApplySegment(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size);
+    static void RevertSegment(const FilterSpec& spec, const UINT8* src, UINT8* dst, UINT64 size, UINT8* scratch);
+};
+
+#endif // !FILTER_H__
@@ -0,0 +1,64 @@
+#include "pch.h"
+
+namespace
+{
+    std::atomic<UINT64>& ChunkSize()
+    {
+        static std::atomic<UINT64> size(IoBuffer::DEFAULT_CHUNK_SIZE);
+        return size;
+    }
+
+    std::atomic<UINT64>& FileBufferSize()
+    {
+        static std::atomic<UINT64> size(0);
+        return size;
+    }
+
+    std::vector<Blob>& GetSpares()
+    {
+        thread_local std::vector<Blob> spares;
+        return spares;
+    }
+}
+
+void IoBuffer::SetChunkSize(UINT64 size)
+{
+    size = (std::min)((std::max)(size, (UINT64)MAX_BUFFER_SIZE), (UINT64)MAX_CHUNK_SIZE);
+    ChunkSize() = (size + MAX_BUFFER_SIZE - 1) / MAX_BUFFER_SIZE * MAX_BUFFER_SIZE;
+}
+
+UINT64 IoBuffer::GetChunkSize()
+{
+    return ChunkSize().load();
+}
+
+void IoBuffer::SetFileBufferSize(UINT64 size)
+{
+    FileBufferSize() = size;
+}
+
+UINT64 IoBuffer::GetFileBufferSize()
+{
+    return FileBufferSize().load();
+}
+
+IoBuffer::IoBuffer(UINT64 size) :
+    mBlob(AlignedAllocator::GetPage())
+{
+    std::vector<Blob>& spares = GetSpares();
+    if (!spares.empty())
+    {
+        mBlob = std::move(spares.back());
+        spares.pop_back();
+    }
+
+    // Capacity is kept: a reused buffer only grows when a larger chunk is asked for
+    mBlob.Resize(size > 0 ? size : GetChunkSize());
+}
+
+IoBuffer::~IoBuffer()
+{
+    std::vector<Blob>& spares = GetSpares();
+    if (spares.size() < MAX_SPARE)
+        spares.push_back(std::move(mBlob));
+}
@@ -0,0 +1,40 @@
+#ifndef IOBUFFER_H__
+#define IOBUFFER_H__
+
+// I/O buffer policy of the bulk loops (loading, checking, copying entries):
+//  - the size of each Read / Write call, set at run time (--io-buffer). Always a
+//    multiple of MAX_BUFFER_SIZE, so the XOR keystream of Stream restarts at the
+//    same offsets as with 1 KB calls: encrypted bytes don't depend on it.
+//  - page-aligned scratch buffers, kept per thread and reused from one loop to the next
+//  - the stdio buffer (setvbuf) of the Files opened afterwards
+class IoBuffer
+{
+public:
+    static const UINT64 DEFAULT_CHUNK_SIZE = 1024 * 1024;
+    static const UINT64 MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+    static const UINT32 MAX_SPARE = 4;    // scratch buffers kept by an idle thread
+
+    //Rounded up to a multiple of MAX_BUFFER_SIZE, within [MAX_BUFFER_SIZE, MAX_CHUNK_SIZE]
+    static void    SetChunkSize(UINT64 size);
+    static UINT64  GetChunkSize();
+
+    //0 keeps the C runtime's own buffer (default)
+    static void    SetFileBufferSize(UINT64 size);
+    static UINT64  GetFileBufferSize();
+
+    //Borrows a scratch buffer of this thread, of size bytes (GetChunkSize() if 0).
+    //Nested borrows get different buffers; it goes back to the thread when destroyed.
+    explicit IoBuffer(UINT64 size = 0);
+    ~IoBuffer();
+
+    IoBuffer(const IoBuffer&) = delete;
+    IoBuffer& operator=(const IoBuffer&) = delete;
+
+    UINT8*  GetData() { return mBlob.GetData(); }
+    UINT64  GetSize() const { return mBlob.GetSize(); }
+
+private:
+    Blob mBlob;
+};
+
+#endif // !IOBUFFER_H__
@@ -8,6 +8,10 @@ Memory::Memory()
 	mPosition = 0;
 	mOwnsBlob = true;
 	mWriteMode = WriteMode::PRESERVE;
+	mpView = nullptr;
+	mViewSize = 0;
+	mReadOnly = false;
+	mpChunks = nullptr;
 }
 
 Memory::Memory(Blob* blob)
@@ -16,6 +20,47 @@ Memory::Memory(Blob* blob)
 	mPosition = 0;
 	mOwnsBlob = false;
 	mWriteMode = WriteMode::PRESERVE;
+	mpView = nullptr;
+	mViewSize = 0;
+	mReadOnly = false;
+	mpChunks = nullptr;
+}
+
+Memory::Memory(const UINT8* pData, UINT64 size)
+{
+	mpBlob = nullptr;
+	mPosition = 0;
+	mOwnsBlob = false;
+	mWriteMode = WriteMode::PRESERVE;
+	mpView = pData;
+	mViewSize = size;
+	mReadOnly = true;
+	mpChunks = nullptr;
+}
+
+Memory::Memory(const SharedBlob& shared)
+{
+	mpBlob = nullptr;
+	mPosition = 0;
+	mOwnsBlob = false;
+	mWriteMode = WriteMode::PRESERVE;
+	mpView = shared.GetData();
+	mViewSize = shared.GetSize();
+	mViewOwner = shared;
+	mReadOnly = true;
+	mpChunks = nullptr;
+}
+
+Memory::Memory(ChunkedBlob* chunks)
+{
+	mpBlob = nullptr;
+	mPosition = 0;
+	mOwnsBlob = false;
+	mWriteMode = WriteMode::PRESERVE;
+	mpView = nullptr;
+	mViewSize = 0;
+	mReadOnly = false;
+	mpChunks = chunks;
 }
 
 Memory::~Memory()
@@ -29,13 +74,24 @@ UINT64 Memory::Read(UINT8* buffer, UINT64 size, UINT64 count)
 		return 0;
 
 	UINT64 totalBytes = size * count;
-	UINT64 available = mpBlob->GetSize() - mPosition;
+	UINT64 byteCount = GetByteCount();
+	UINT64 available = (mPosition < byteCount) ? byteCount - mPosition : 0;
 	UINT64 bytesToRead = (totalBytes < available) ? totalBytes : available;
 	if (bytesToRead == 0) return 0;
 
-	memcpy(buffer, mpBlob->GetData() + mPosition, bytesToRead);
+	if (mpChunks != nullptr)
+		mpChunks->Read(mPosition, buffer, bytesToRead);
+	else
+		memcpy(buffer, GetBytes() + mPosition, bytesToRead);
 	mPosition += bytesToRead;
 
+	// Same keystream restarts as File
+	if (mIsEncrypted)
+	{
+		for (UINT64 done = 0; done < bytesToRead; done += MAX_BUFFER_SIZE)
+			DecryptBuffer(buffer + done, (std::min)(bytesToRead - done, (UINT64)MAX_BUFFER_SIZE));
+	}
+
 	return bytesToRead;
 }
 
@@ -44,8 +100,40 @@ UINT64 Memory::Write(const UINT8* buffer, UINT64 size, UINT64 count)
 	if (buffer == nullptr || size == 0)
 		return 0;
 
+	if (mReadOnly)
+	{
+		std::cerr << "[ERROR][MEMORY] Write on a read-only Memory" << std::endl;
+		return 0;
+	}
+
 	UINT64 totalBytes = size * count;
 
+	std::vector<UINT8> encrypted;
+	if (mIsEncrypted)
+	{
+		encrypted.assign(buffer, buffer + totalBytes);
+		for (UINT64 done = 0; done < totalBytes; done += MAX_BUFFER_SIZE)
+			EncryptBuffer(encrypted.data() + done, (std::min)(totalBytes - done, (UINT64)MAX_BUFFER_SIZE));
+		buffer = encrypted.data();
+	}
+
+	if (mpChunks != nullptr)
+	{
+		if (mPosition > mpChunks->GetSize())
+		{
+			std::vector<UINT8> zeros(mPosition - mpChunks->GetSize(), 0);
+			mpChunks->Append(zeros.data(), zeros.size());
+		}
+
+		bool inside = mPosition + totalBytes < mpChunks->GetSize();
+		mpChunks->Write(mPosition, buffer, totalBytes);
+		if (inside && mWriteMode == WriteMode::TRUNCATE)
+			mpChunks->Truncate(mPosition + totalBytes);
+
+		mPosition += totalBytes;
+		return totalBytes;
+	}
+
 	if (mPosition >= mpBlob->GetSize())
 	{
 		if (mPosition > mpBlob->GetSize())
@@ -78,7 +166,7 @@ UINT64 Memory::Write(const UINT8* buffer, UINT64 size, UINT64 count)
 
 INT64 Memory::Seek(INT64 offset, int origin)
 {
-	if (mpBlob == nullptr) return -1;
+	if (!IsOpen()) return -1;
 
 	INT64 newPosition = 0;
 
@@ -91,7 +179,7 @@ INT64 Memory::Seek(INT64 offset, int origin)
 		newPosition = mPosition + offset;
 		break;
 	case SEEK_END:
-		newPosition = mpBlob->GetSize() + offset;
+		newPosition = GetByteCount() + offset;
 		break;
 	default:
 		return -1;
@@ -135,6 +223,11 @@ void Memory::AttachBlob(Blob* blob, bool ownership)
 	mpBlob = blob;
 	mOwnsBlob = ownership;
 	mPosition = 0;
+	mpView = nullptr;
+	mViewSize = 0;
+	mViewOwner = SharedBlob();
+	mReadOnly = false;
+	mpChunks = nullptr;
 }
 
 Blob* Memory::DetachBlob()
@@ -153,7 +246,7 @@ void Memory::SetWriteMode(WriteMode mode)
 
 bool Memory::IsOpen() const
 {
-	return mpBlob != nullptr;
+	return mpBlob != nullptr || mReadOnly || mpChunks != nullptr;
 }
 
 void Memory::Close()
@@ -163,8 +256,22 @@ void Memory::Close()
 
 UINT64 Memory::GetSize()
 {
-	if (mpBlob == nullptr)
-		return 0;
-	return mpBlob->GetSize();
+	return GetByteCount();
+}
+
+const UINT8* Memory::GetBytes() const
+{
+	if (mpChunks != nullptr)
+		return nullptr;
+	return mReadOnly ? mpView : mpBlob->GetData();
+}
+
+UINT64 Memory::GetByteCount() const
+{
+	if (mReadOnly)
+		return mViewSize;
+	if (mpChunks != nullptr)
+		return mpChunks->GetSize();
+	return mpBlob != nullptr ? mpBlob->GetSize() : 0;
 }
 
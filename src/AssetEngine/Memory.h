@@ -1,10 +1,17 @@
 ﻿#pragma once
 
-class Memory : Stream
+class Memory : public Stream
 {
 public:
     Memory();
     Memory(Blob* blob);
+    //Read-only over bytes owned elsewhere (a mapping, a network buffer), which must
+    //outlive the Memory: nothing is copied or allocated, Write is refused
+    Memory(const UINT8* pData, UINT64 size);
+    //Read-only over shared bytes, kept alive as long as the Memory
+    Memory(const SharedBlob& shared);
+    //Over segments (not owned): growing never copies what is already written
+    Memory(ChunkedBlob* chunks);
     ~Memory() override;
     
     //Like for Blob, avoid copies
@@ -22,8 +29,14 @@ public:
 
     Blob* GetBlob();
     const Blob* GetBlob() const;
+    ChunkedBlob* GetChunks() { return mpChunks; }
+    const ChunkedBlob* GetChunks() const { return mpChunks; }
     UINT64 GetPosition() const;
     void ResetPos();
+    bool IsReadOnly() const { return mReadOnly; }
+    //Bytes read: the Blob's, or the read-only view's (nullptr over a ChunkedBlob)
+    const UINT8* GetBytes() const;
+    UINT64 GetByteCount() const;
 
     //OwnerShip, choice to move Blob from a Memory or not
     //If you attach a Blob on a Memory with a Blob already, it will delete it,
@@ -41,4 +54,9 @@ private:
     UINT64 mPosition;
     bool mOwnsBlob;
     WriteMode mWriteMode;
+    const UINT8* mpView;
+    UINT64 mViewSize;
+    SharedBlob mViewOwner;
+    bool mReadOnly;
+    ChunkedBlob* mpChunks;
 };
@@ -0,0 +1,303 @@
+#include "pch.h"
+
+namespace
+{
+    UINT64 RoundUpToPowerOfTwo(UINT64 value)
+    {
+        UINT64 result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    // Spin briefly (the other side is usually a few microseconds away), then sleep
+    void Backoff(UINT32& spins)
+    {
+        if (++spins < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+PipeStream::PipeStream(UINT64 capacity, Kind kind) :
+    mKind(kind),
+    mCapacity(0),
+    mMask(0),
+    mHead(0),
+    mTail(0),
+    mEnqueue(0),
+    mDequeue(0),
+    mClosed(false)
+{
+    if (mKind == Kind::SPSC)
+    {
+        mCapacity = RoundUpToPowerOfTwo((std::max)(capacity, (UINT64)64));
+        mMask = mCapacity - 1;
+        mRing.resize(mCapacity);
+    }
+    else
+    {
+        UINT64 cells = RoundUpToPowerOfTwo((std::max)(capacity / CHUNK_SIZE, (UINT64)2));
+        mCapacity = cells * CHUNK_SIZE;
+        mMask = cells - 1;
+        mpChunks.reset(new Chunk[cells]);
+        for (UINT64 i = 0; i < cells; i++)
+            mpChunks[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+PipeStream::~PipeStream()
+{
+}
+
+// === SPSC ===
+
+UINT64 PipeStream::TryWriteBytes(const UINT8* buffer, UINT64 size)
+{
+    UINT64 head = mHead.load(std::memory_order_relaxed);
+    UINT64 tail = mTail.load(std::memory_order_acquire);
+    UINT64 amount = (std::min)(size, mCapacity - (head - tail));
+    if (amount == 0)
+        return 0;
+
+    UINT64 start = head & mMask;
+    UINT64 first = (std::min)(amount, mCapacity - start);
+    memcpy(mRing.data() + start, buffer, first);
+    memcpy(mRing.data(), buffer + first, amount - first);
+
+    mHead.store(head + amount, std::memory_order_release);
+    return amount;
+}
+
+UINT64 PipeStream::TryReadBytes(UINT8* buffer, UINT64 size)
+{
+    UINT64 tail = mTail.load(std::memory_order_relaxed);
+    UINT64 head = mHead.load(std::memory_order_acquire);
+    UINT64 amount = (std::min)(size, head - tail);
+    if (amount == 0)
+        return 0;
+
+    UINT64 start = tail & mMask;
+    UINT64 first = (std::min)(amount, mCapacity - start);
+    memcpy(buffer, mRing.data() + start, first);
+    memcpy(buffer + first, mRing.data(), amount - first);
+
+    mTail.store(tail + amount, std::memory_order_release);
+    return amount;
+}
+
+// === MPMC ===
+// Bounded queue of chunks: a cell's sequence tells whose turn it is (producer when
+// it equals the position, consumer when it equals position + 1)
+
+UINT64 PipeStream::TryWriteChunks(const UINT8* buffer, UINT64 size)
+{
+    UINT64 done = 0;
+    while (done < size)
+    {
+        UINT64 position = mEnqueue.load(std::memory_order_relaxed);
+        Chunk* chunk = nullptr;
+        for (;;)
+        {
+            chunk = &mpChunks[position & mMask];
+            INT64 diff = (INT64)(chunk->sequence.load(std::memory_order_acquire) - position);
+            if (diff == 0)
+            {
+                if (mEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return done; // full
+            }
+            else
+            {
+                position = mEnqueue.load(std::memory_order_relaxed);
+            }
+        }
+
+        UINT64 amount = (std::min)(size - done, (UINT64)CHUNK_SIZE);
+        memcpy(chunk->data, buffer + done, amount);
+        chunk->size.store(amount, std::memory_order_relaxed);
+        chunk->sequence.store(position + 1, std::memory_order_release);
+
+        mHead.fetch_add(amount, std::memory_order_relaxed);
+        done += amount;
+    }
+    return done;
+}
+
+UINT64 PipeStream::TryReadChunks(UINT8* buffer, UINT64 size)
+{
+    UINT64 done = 0;
+    for (;;)
+    {
+        UINT64 position = mDequeue.load(std::memory_order_relaxed);
+        Chunk* chunk = nullptr;
+        for (;;)
+        {
+            chunk = &mpChunks[position & mMask];
+            INT64 diff = (INT64)(chunk->sequence.load(std::memory_order_acquire) - (position + 1));
+            if (diff == 0)
+            {
+                // A published cell keeps its size until it is taken
+                if (chunk->size.load(std::memory_order_relaxed) > size - done)
+                    return done;
+                if (mDequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return done; // empty
+            }
+            else
+            {
+                position = mDequeue.load(std::memory_order_relaxed);
+            }
+        }
+
+        UINT64 amount = chunk->size.load(std::memory_order_relaxed);
+        memcpy(buffer + done, chunk->data, amount);
+        chunk->sequence.store(position + mMask + 1, std::memory_order_release);
+
+        mTail.fetch_add(amount, std::memory_order_relaxed);
+        done += amount;
+    }
+}
+
+// === Stream ===
+
+UINT64 PipeStream::TryWrite(const UINT8* buffer, UINT64 size)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+    if (IsClosed())
+    {
+        std::cerr << "[ERROR][PIPE] Write on a closed pipe" << std::endl;
+        return 0;
+    }
+
+    return (mKind == Kind::SPSC) ? TryWriteBytes(buffer, size) : TryWriteChunks(buffer, size);
+}
+
+UINT64 PipeStream::TryRead(UINT8* buffer, UINT64 size)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+
+    return (mKind == Kind::SPSC) ? TryReadBytes(buffer, size) : TryReadChunks(buffer, size);
+}
+
+UINT64 PipeStream::Write(const UINT8* buffer, UINT64 size, UINT64 count)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+    if (IsClosed())
+    {
+        std::cerr << "[ERROR][PIPE] Write on a closed pipe" << std::endl;
+        return 0;
+    }
+
+    UINT64 totalBytes = size * count;
+
+    UINT64 written = 0;
+    UINT32 spins = 0;
+    while (written < totalBytes)
+    {
+        UINT64 amount = (mKind == Kind::SPSC) ? TryWriteBytes(buffer + written, totalBytes - written)
+                                              : TryWriteChunks(buffer + written, totalBytes - written);
+        if (amount > 0)
+        {
+            written += amount;
+            spins = 0;
+        }
+        else if (IsClosed())
+        {
+            break;
+        }
+        else
+        {
+            Backoff(spins);
+        }
+    }
+    return written;
+}
+
+UINT64 PipeStream::Read(UINT8* buffer, UINT64 size, UINT64 count)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+
+    UINT64 totalBytes = size * count;
+    if (mKind == Kind::MPMC && totalBytes < CHUNK_SIZE)
+    {
+        std::cerr << "[ERROR][PIPE] MPMC reads need room for a whole chunk" << std::endl;
+        return 0;
+    }
+
+    UINT64 bytesRead = 0;
+    UINT32 spins = 0;
+    while (bytesRead < totalBytes)
+    {
+        UINT64 amount = (mKind == Kind::SPSC) ? TryReadBytes(buffer + bytesRead, totalBytes - bytesRead)
+                                              : TryReadChunks(buffer + bytesRead, totalBytes - bytesRead);
+        if (amount > 0)
+        {
+            bytesRead += amount;
+            spins = 0;
+            if (mKind == Kind::MPMC)
+                break;
+            continue;
+        }
+
+        // Closed: whatever was written before Close is still there to drain
+        if (IsClosed())
+        {
+            amount = (mKind == Kind::SPSC) ? TryReadBytes(buffer + bytesRead, totalBytes - bytesRead)
+                                           : TryReadChunks(buffer + bytesRead, totalBytes - bytesRead);
+            bytesRead += amount;
+            if (amount == 0 || mKind == Kind::MPMC)
+                break;
+            continue;
+        }
+        Backoff(spins);
+    }
+
+    return bytesRead;
+}
+
+INT64 PipeStream::Seek(INT64 offset, int origin)
+{
+    if (offset == 0 && origin == SEEK_CUR)
+        return (INT64)mTail.load(std::memory_order_acquire);
+
+    std::cerr << "[ERROR][PIPE] A pipe can't seek" << std::endl;
+    return -1;
+}
+
+bool PipeStream::IsOpen() const
+{
+    return !IsEof();
+}
+
+void PipeStream::Close()
+{
+    mClosed.store(true, std::memory_order_release);
+}
+
+UINT64 PipeStream::GetSize()
+{
+    UINT64 tail = mTail.load(std::memory_order_acquire);
+    UINT64 head = mHead.load(std::memory_order_acquire);
+    return (head > tail) ? head - tail : 0;
+}
+
+bool PipeStream::IsEof() const
+{
+    if (!IsClosed())
+        return false;
+    if (mKind == Kind::SPSC)
+        return mTail.load(std::memory_order_acquire) == mHead.load(std::memory_order_acquire);
+    return mDequeue.load(std::memory_order_acquire) == mEnqueue.load(std::memory_order_acquire);
+}
@@ -0,0 +1,83 @@
+#ifndef PIPESTREAM_H__
+#define PIPESTREAM_H__
+
+// Stream between threads over a lock-free ring: one side writes, the other reads,
+// so any code taking a Stream can sit at either end of a pipeline stage.
+//  - SPSC: one producer, one consumer, plain bytes. A blocking Read fills the
+//    whole buffer unless the pipe reaches its end (like fread).
+//  - MPMC: any number of producers and consumers. Bytes travel in chunks of up to
+//    CHUNK_SIZE (a Write is cut in chunks, never interleaved with another one
+//    inside a chunk) and a Read only takes whole chunks, at least one when
+//    blocking: its buffer must hold CHUNK_SIZE bytes.
+// Close() marks the end of the data: reads drain what is left, then return 0.
+// Bytes go through as written: the XOR layer of Stream is not applied, since the two
+// sides don't split their calls the same way.
+class PipeStream : public Stream
+{
+public:
+    enum class Kind
+    {
+        SPSC,
+        MPMC
+    };
+
+    static const UINT64 DEFAULT_CAPACITY = 1024 * 1024;
+    static const UINT64 CHUNK_SIZE = 16 * 1024;
+
+    //capacity in bytes, rounded up to a power of two
+    explicit PipeStream(UINT64 capacity = DEFAULT_CAPACITY, Kind kind = Kind::SPSC);
+    ~PipeStream() override;
+
+    PipeStream(const PipeStream&) = delete;
+    PipeStream& operator=(const PipeStream&) = delete;
+
+    //Blocking: waits for data / room, returns less only once the pipe is closed
+    UINT64  Read(UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    UINT64  Write(const UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    //Non-blocking: moves what fits right now, possibly 0 bytes
+    UINT64  TryRead(UINT8* buffer, UINT64 size);
+    UINT64  TryWrite(const UINT8* buffer, UINT64 size);
+
+    //Not seekable: only Seek(0, SEEK_CUR) works, and returns the bytes read so far
+    INT64   Seek(INT64 offset, int origin = SEEK_SET) override;
+
+    //Open until closed and drained
+    bool    IsOpen() const override;
+    //End of the data (producer side); with several producers, the last one closes
+    void    Close() override;
+    //Bytes waiting in the pipe
+    UINT64  GetSize() override;
+
+    bool    IsClosed() const { return mClosed.load(std::memory_order_acquire); }
+    bool    IsEof() const;
+    Kind    GetKind() const { return mKind; }
+    UINT64  GetCapacity() const { return mCapacity; }
+
+private:
+    struct Chunk
+    {
+        std::atomic<UINT64> sequence;
+        std::atomic<UINT64> size;   // read before a consumer claims the cell
+        UINT8 data[CHUNK_SIZE];
+    };
+
+    UINT64 TryReadBytes(UINT8* buffer, UINT64 size);
+    UINT64 TryWriteBytes(const UINT8* buffer, UINT64 size);
+    UINT64 TryReadChunks(UINT8* buffer, UINT64 size);
+    UINT64 TryWriteChunks(const UINT8* buffer, UINT64 size);
+
+    Kind mKind;
+    UINT64 mCapacity;
+    UINT64 mMask;
+    std::vector<UINT8> mRing;               // SPSC bytes
+    std::unique_ptr<Chunk[]> mpChunks;      // MPMC cells
+
+    // Written / read byte totals (the SPSC ring positions), on separate cache lines
+    alignas(64) std::atomic<UINT64> mHead;
+    alignas(64) std::atomic<UINT64> mTail;
+    alignas(64) std::atomic<UINT64> mEnqueue;   // MPMC cell positions
+    alignas(64) std::atomic<UINT64> mDequeue;
+    std::atomic<bool> mClosed;
+};
+
+#endif // !PIPESTREAM_H__
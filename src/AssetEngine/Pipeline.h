@@ -0,0 +1,198 @@
+#ifndef PIPELINE_H__
+#define PIPELINE_H__
+
+// Stream stages composed at compile time for the bulk loops (extract, validate,
+// compact): Pipeline<Source, Stages...> pulls a chunk from the source, then hands it
+// to every stage in order, e.g.
+//     Pipeline pipeline{ StreamSource(archive), XorStage(key), Crc32Stage(), StreamSink(output) };
+// No virtual call per stage: the compiler sees every Process and can inline the
+// whole chunk loop, and each chunk goes through all stages while it is in cache.
+// Stream decorators (StreamChain.h) remain for chains only known at run time.
+//
+// Source: UINT64 Pull(UINT8* buffer, UINT64 size), 0 at the end
+// Stage:  bool Process(UINT8* data, UINT64 size), false stops the run
+
+// === Sources ===
+
+class StreamSource
+{
+public:
+    explicit StreamSource(Stream& stream) : mpStream(&stream) {}
+    UINT64 Pull(UINT8* buffer, UINT64 size) { return mpStream->Read(buffer, size, 1); }
+
+private:
+    Stream* mpStream;
+};
+
+class MemorySource
+{
+public:
+    MemorySource(const UINT8* pData, UINT64 size) : mpData(pData), mSize(size), mPosition(0) {}
+
+    UINT64 Pull(UINT8* buffer, UINT64 size)
+    {
+        UINT64 amount = (std::min)(size, mSize - mPosition);
+        memcpy(buffer, mpData + mPosition, amount);
+        mPosition += amount;
+        return amount;
+    }
+
+private:
+    const UINT8* mpData;
+    UINT64 mSize;
+    UINT64 mPosition;
+};
+
+// Plain fread on a file of its own (no keystream, no block cache)
+class FileSource
+{
+public:
+    explicit FileSource(const std::string& path) : mpFile(nullptr) { fopen_s(&mpFile, path.c_str(), "rb"); }
+    ~FileSource() { if (mpFile != nullptr) fclose(mpFile); }
+
+    FileSource(FileSource&& other) noexcept : mpFile(other.mpFile) { other.mpFile = nullptr; }
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    bool IsOpen() const { return mpFile != nullptr; }
+    UINT64 Pull(UINT8* buffer, UINT64 size) { return (mpFile != nullptr) ? fread(buffer, 1, size, mpFile) : 0; }
+
+private:
+    std::FILE* mpFile;
+};
+
+// === Stages ===
+
+class Crc32Stage
+{
+public:
+    Crc32Stage() : mCrc(0) {}
+    bool Process(UINT8* data, UINT64 size) { mCrc = SafeFormat::UpdateCRC32(mCrc, data, size); return true; }
+    UINT32 GetCRC32() const { return mCrc; }
+
+private:
+    UINT32 mCrc;
+};
+
+// Same keystream as CipherStream: restarts every period bytes from the first byte seen.
+// The key is repeated into a run of at least RUN_MIN bytes, applied in straight spans
+// (no per-byte modulo) that the compiler can vectorize.
+class XorStage
+{
+public:
+    static const UINT64 RUN_MIN = 256;
+
+    explicit XorStage(const std::string& key, UINT64 period = MAX_BUFFER_SIZE) :
+        mPeriod(period > 0 ? period : MAX_BUFFER_SIZE), mPhase(0)
+    {
+        // A whole number of keys: run[phase % run size] == key[phase % key size]
+        if (!key.empty())
+        {
+            while (mRun.size() < RUN_MIN)
+                mRun.insert(mRun.end(), key.begin(), key.end());
+        }
+    }
+
+    bool Process(UINT8* data, UINT64 size)
+    {
+        if (mRun.empty())
+            return true;
+
+        const UINT64 runLength = mRun.size();
+        const UINT8* run = mRun.data();
+        while (size > 0)
+        {
+            UINT64 offset = mPhase % runLength;
+            UINT64 span = (std::min)((std::min)(size, runLength - offset), mPeriod - mPhase);
+            for (UINT64 i = 0; i < span; i++)
+                data[i] ^= run[offset + i];
+
+            data += span;
+            size -= span;
+            mPhase += span;
+            if (mPhase == mPeriod)
+                mPhase = 0;
+        }
+        return true;
+    }
+
+private:
+    std::vector<UINT8> mRun;
+    UINT64 mPeriod;
+    UINT64 mPhase;
+};
+
+// === Sinks ===
+
+class StreamSink
+{
+public:
+    explicit StreamSink(Stream& stream) : mpStream(&stream) {}
+    bool Process(UINT8* data, UINT64 size) { return mpStream->Write(data, size, 1) == size; }
+
+private:
+    Stream* mpStream;
+};
+
+class BlobSink
+{
+public:
+    explicit BlobSink(Blob& blob) : mpBlob(&blob) {}
+    bool Process(UINT8* data, UINT64 size) { return mpBlob->Append(data, size); }
+
+private:
+    Blob* mpBlob;
+};
+
+// === Pipeline ===
+
+template <typename Source, typename... Stages>
+class Pipeline
+{
+public:
+    explicit Pipeline(Source source, Stages... stages) :
+        mSource(std::move(source)), mStages(std::move(stages)...) {}
+
+    //Moves up to size bytes through the stages, in chunks of chunkSize (IoBuffer::GetChunkSize()
+    //if 0); returns the bytes that went all the way. Stops early at the end of the source or
+    //when a stage fails (see IsComplete)
+    UINT64 Run(UINT64 size = ~0ull, UINT64 chunkSize = 0)
+    {
+        mFailed = false;
+        if (size == 0)
+            return 0;
+
+        IoBuffer buffer((std::min)(size, chunkSize > 0 ? chunkSize : IoBuffer::GetChunkSize()));
+        UINT64 done = 0;
+        while (done < size)
+        {
+            UINT64 pulled = mSource.Pull(buffer.GetData(), (std::min)(size - done, buffer.GetSize()));
+            if (pulled == 0)
+                break;
+
+            UINT8* data = buffer.GetData();
+            bool passed = std::apply([data, pulled](auto&... stage) { return (stage.Process(data, pulled) && ...); }, mStages);
+            if (!passed)
+            {
+                mFailed = true;
+                break;
+            }
+            done += pulled;
+        }
+        return done;
+    }
+
+    //No stage refused a chunk during the last Run
+    bool IsComplete() const { return !mFailed; }
+
+    Source& GetSource() { return mSource; }
+    template <size_t Index>
+    auto& GetStage() { return std::get<Index>(mStages); }
+
+private:
+    Source mSource;
+    std::tuple<Stages...> mStages;
+    bool mFailed = false;
+};
+
+#endif // !PIPELINE_H__
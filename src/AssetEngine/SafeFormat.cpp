@@ -35,12 +35,149 @@ const UINT32 SafeFormat::CRC32_TABLE[256] = {
     0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
 };
 
+namespace
+{
+    UINT32 Gf2MatrixTimes(const UINT32* matrix, UINT32 vector)
+    {
+        UINT32 sum = 0;
+        for (; vector != 0; vector >>= 1, matrix++)
+        {
+            if (vector & 1)
+                sum ^= *matrix;
+        }
+        return sum;
+    }
+
+    void Gf2MatrixSquare(UINT32* square, const UINT32* matrix)
+    {
+        for (int n = 0; n < 32; n++)
+            square[n] = Gf2MatrixTimes(matrix, matrix[n]);
+    }
+
+    // Slice-by-8: table[k][b] is the CRC of byte b followed by k zero bytes, so eight
+    // input bytes are folded with eight independent lookups instead of a chain of eight
+    struct Crc32Slices
+    {
+        UINT32 table[8][256];
+
+        Crc32Slices()
+        {
+            for (UINT32 i = 0; i < 256; i++)
+            {
+                UINT32 crc = i;
+                for (int bit = 0; bit < 8; bit++)
+                    crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+                table[0][i] = crc;
+            }
+            for (int k = 1; k < 8; k++)
+            {
+                for (UINT32 i = 0; i < 256; i++)
+                    table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    };
+
+    const Crc32Slices& GetCrc32Slices()
+    {
+        static const Crc32Slices slices;
+        return slices;
+    }
+}
+
 UINT32 SafeFormat::CalculateCRC32(const UINT8* data, UINT64 size)
 {
     if (data == nullptr || size == 0)
         return 0;
 
-    UINT32 crc = 0xFFFFFFFF;
+    ThreadPool& pool = ThreadPool::Get();
+    if (size < 2 * PARALLEL_CRC_SLICE || pool.GetConcurrency() == 1)
+        return CalculateCRC32Serial(data, size);
+
+    UINT64 sliceCount = (size + PARALLEL_CRC_SLICE - 1) / PARALLEL_CRC_SLICE;
+    std::vector<UINT32> crcs(sliceCount);
+
+    pool.ParallelFor(sliceCount, [&](UINT64 i)
+    {
+        UINT64 offset = i * PARALLEL_CRC_SLICE;
+        UINT64 length = (size - offset < PARALLEL_CRC_SLICE) ? size - offset : PARALLEL_CRC_SLICE;
+        crcs[i] = CalculateCRC32Serial(data + offset, length);
+    });
+
+    UINT32 crc = crcs[0];
+    for (UINT64 i = 1; i < sliceCount; i++)
+    {
+        UINT64 offset = i * PARALLEL_CRC_SLICE;
+        UINT64 length = (size - offset < PARALLEL_CRC_SLICE) ? size - offset : PARALLEL_CRC_SLICE;
+        crc = CombineCRC32(crc, crcs[i], length);
+    }
+    return crc;
+}
+
+// Same approach as zlib's crc32_combine: apply sizeB zero bytes to crcA
+// through repeated squaring of the CRC shift operator
+UINT32 SafeFormat::CombineCRC32(UINT32 crcA, UINT32 crcB, UINT64 sizeB)
+{
+    if (sizeB == 0)
+        return crcA;
+
+    UINT32 even[32];
+    UINT32 odd[32];
+
+    odd[0] = 0xEDB88320;
+    UINT32 row = 1;
+    for (int n = 1; n < 32; n++)
+    {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    Gf2MatrixSquare(even, odd);
+    Gf2MatrixSquare(odd, even);
+
+    do
+    {
+        Gf2MatrixSquare(even, odd);
+        if (sizeB & 1)
+            crcA = Gf2MatrixTimes(even, crcA);
+        sizeB >>= 1;
+
+        if (sizeB == 0)
+            break;
+
+        Gf2MatrixSquare(odd, even);
+        if (sizeB & 1)
+            crcA = Gf2MatrixTimes(odd, crcA);
+        sizeB >>= 1;
+    } while (sizeB != 0);
+
+    return crcA ^ crcB;
+}
+
+UINT32 SafeFormat::CalculateCRC32Serial(const UINT8* data, UINT64 size)
+{
+    return UpdateCRC32(0, data, size);
+}
+
+UINT32 SafeFormat::UpdateCRC32(UINT32 crc, const UINT8* data, UINT64 size)
+{
+    if (data == nullptr || size == 0)
+        return crc;
+
+    crc = ~crc;
+
+    // Little-endian words: the first byte of the stream is the low byte
+    const UINT32 (*table)[256] = GetCrc32Slices().table;
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        UINT32 low;
+        UINT32 high;
+        memcpy(&low, data, sizeof(UINT32));
+        memcpy(&high, data + 4, sizeof(UINT32));
+        low ^= crc;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+    }
+
     for (UINT64 i = 0; i < size; i++)
     {
         UINT8 index = (crc ^ data[i]) & 0xFF;
@@ -49,6 +186,92 @@ UINT32 SafeFormat::CalculateCRC32(const UINT8* data, UINT64 size)
     return ~crc;
 }
 
+namespace
+{
+    const UINT32 SHA256_K[64] = {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+        0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+        0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+        0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+        0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+        0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+    };
+
+    inline UINT32 RotateRight(UINT32 value, UINT32 count)
+    {
+        return (value >> count) | (value << (32 - count));
+    }
+
+    void Sha256Block(UINT32 state[8], const UINT8* block)
+    {
+        UINT32 w[64];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (static_cast<UINT32>(block[i * 4]) << 24) | (static_cast<UINT32>(block[i * 4 + 1]) << 16) |
+                   (static_cast<UINT32>(block[i * 4 + 2]) << 8) | static_cast<UINT32>(block[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            UINT32 s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            UINT32 s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        UINT32 a = state[0], b = state[1], c = state[2], d = state[3];
+        UINT32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i++)
+        {
+            UINT32 s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+            UINT32 choice = (e & f) ^ (~e & g);
+            UINT32 t1 = h + s1 + choice + SHA256_K[i] + w[i];
+            UINT32 s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+            UINT32 majority = (a & b) ^ (a & c) ^ (b & c);
+            UINT32 t2 = s0 + majority;
+
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+void SafeFormat::CalculateSHA256(const UINT8* data, UINT64 size, UINT8 outHash[SHA256_SIZE])
+{
+    UINT32 state[8] = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+
+    UINT64 full = size - (size % 64);
+    for (UINT64 offset = 0; offset < full; offset += 64)
+        Sha256Block(state, data + offset);
+
+    // Last partial block, the 0x80 terminator and the bit length (one or two blocks)
+    UINT8 tail[128] = { 0 };
+    UINT64 rest = size - full;
+    if (rest > 0)
+        memcpy(tail, data + full, rest);
+    tail[rest] = 0x80;
+
+    UINT64 tailSize = (rest < 56) ? 64 : 128;
+    UINT64 bits = size * 8;
+    for (int i = 0; i < 8; i++)
+        tail[tailSize - 1 - i] = static_cast<UINT8>(bits >> (i * 8));
+
+    for (UINT64 offset = 0; offset < tailSize; offset += 64)
+        Sha256Block(state, tail + offset);
+
+    for (int i = 0; i < 8; i++)
+    {
+        outHash[i * 4] = static_cast<UINT8>(state[i] >> 24);
+        outHash[i * 4 + 1] = static_cast<UINT8>(state[i] >> 16);
+        outHash[i * 4 + 2] = static_cast<UINT8>(state[i] >> 8);
+        outHash[i * 4 + 3] = static_cast<UINT8>(state[i]);
+    }
+}
+
 bool SafeFormat::Validate(const std::string& filename, Stream::Header& outHeader, Blob& outData)
 {
     FILE* file = nullptr;
@@ -71,26 +294,32 @@ bool SafeFormat::Validate(const std::string& filename, Stream::Header& outHeader
     }
 
     fseek(file, 0, SEEK_END);
-    UINT64 fileSize = ftell(file);
+    long fileEnd = ftell(file);
     fseek(file, sizeof(Stream::Header), SEEK_SET);
 
-    UINT64 expectedSize = sizeof(Stream::Header) + outHeader.dataSize;
-    if (fileSize != expectedSize)
+    // Compared without adding to dataSize, so a forged size can't wrap around to the file size
+    if (fileEnd < static_cast<long>(sizeof(Stream::Header)) ||
+        outHeader.dataSize != static_cast<UINT64>(fileEnd) - sizeof(Stream::Header))
     {
         fclose(file);
         return false;
     }
 
-    outData.Clear();
-    outData.Reserve(outHeader.dataSize);
+    // Straight into outData, one IoBuffer chunk per fread
+    if (!outData.Resize(outHeader.dataSize))
+    {
+        fclose(file);
+        return false;
+    }
 
-    UINT8 buffer[MAX_BUFFER_SIZE];
+    const UINT64 maxChunk = IoBuffer::GetChunkSize();
     UINT64 remainingBytes = outHeader.dataSize;
+    UINT64 offset = 0;
 
     while (remainingBytes > 0)
     {
-        UINT64 chunkSize = (remainingBytes > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remainingBytes;
-        size_t bytesRead = fread(buffer, 1, chunkSize, file);
+        UINT64 chunkSize = (remainingBytes > maxChunk) ? maxChunk : remainingBytes;
+        size_t bytesRead = fread(outData.GetData() + offset, 1, chunkSize, file);
 
         if (bytesRead == 0)
         {
@@ -98,7 +327,7 @@ bool SafeFormat::Validate(const std::string& filename, Stream::Header& outHeader
             return false;
         }
 
-        outData.Append(buffer, bytesRead);
+        offset += bytesRead;
         remainingBytes -= bytesRead;
     }
 
@@ -175,12 +404,13 @@ bool SafeFormat::WriteSafeFile(const std::string& filename, const UINT8* data, U
         return false;
     }
 
+    const UINT64 maxChunk = IoBuffer::GetChunkSize();
     UINT64 remainingBytes = size;
     UINT64 offset = 0;
 
     while (remainingBytes > 0)
     {
-        UINT64 chunkSize = (remainingBytes > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : remainingBytes;
+        UINT64 chunkSize = (remainingBytes > maxChunk) ? maxChunk : remainingBytes;
         size_t bytesWritten = fwrite(data + offset, 1, chunkSize, file);
 
         if (bytesWritten != chunkSize)
@@ -5,7 +5,16 @@ class SafeFormat
 {
 public:
     // === CRC32 Utilities ===
+    //Large buffers are split across the ThreadPool and the slices combined
     static UINT32 CalculateCRC32(const UINT8* data, UINT64 size);
+    //CRC32 of A+B from CRC32(A), CRC32(B) and the size of B
+    static UINT32 CombineCRC32(UINT32 crcA, UINT32 crcB, UINT64 sizeB);
+    //Running CRC32: the CRC32 of the bytes before, extended with data (start from 0)
+    static UINT32 UpdateCRC32(UINT32 crc, const UINT8* data, UINT64 size);
+
+    // === Content Hash ===
+    static const UINT32 SHA256_SIZE = 32;
+    static void CalculateSHA256(const UINT8* data, UINT64 size, UINT8 outHash[SHA256_SIZE]);
 
     // === SAFE File Validation ===
     static bool Validate(const std::string& filename, Stream::Header& outHeader, Blob& outData);
@@ -14,6 +23,9 @@ public:
     static bool WriteSafeFile(const std::string& filename, const UINT8* data, UINT64 size, UINT32 version = 1);
 
 private:
+    static UINT32 CalculateCRC32Serial(const UINT8* data, UINT64 size);
+
+    static const UINT64 PARALLEL_CRC_SLICE = 4 * 1024 * 1024;
     static const UINT32 CRC32_TABLE[256];
 };
 
@@ -0,0 +1,96 @@
+#include "pch.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SharedBlob::SharedBlob(Blob&& blob) :
+    mpData(nullptr),
+    mSize(0)
+{
+    std::shared_ptr<Blob> owner = std::make_shared<Blob>(std::move(blob));
+    mpData = owner->GetData();
+    mSize = owner->GetSize();
+    mOwner = std::move(owner);
+}
+
+SharedBlob::SharedBlob(const UINT8* pData, UINT64 size, std::function<void()> release) :
+    mOwner(pData, [release](const void*) { if (release) release(); }),
+    mpData(pData),
+    mSize(size)
+{
+}
+
+SharedBlob SharedBlob::Copy(const UINT8* pData, UINT64 size)
+{
+    // Handles may outlive any allocator scope
+    Blob blob(Allocator::GetHeap());
+    if (!blob.Resize(size))
+        return SharedBlob();
+    if (size > 0)
+        memcpy(blob.GetData(), pData, size);
+    return SharedBlob(std::move(blob));
+}
+
+// The mapping outlives the handles
+SharedBlob SharedBlob::MapFile(const std::string& path)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return SharedBlob();
+
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+        return SharedBlob();
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr)
+        return SharedBlob();
+
+    return SharedBlob(static_cast<const UINT8*>(view), static_cast<UINT64>(size.QuadPart),
+                      [view]() { UnmapViewOfFile(view); });
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return SharedBlob();
+
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+        return SharedBlob();
+
+    size_t viewSize = static_cast<size_t>(info.st_size);
+    return SharedBlob(static_cast<const UINT8*>(view), static_cast<UINT64>(viewSize),
+                      [view, viewSize]() { munmap(view, viewSize); });
+#endif
+}
+
+SharedBlob SharedBlob::Slice(UINT64 offset, UINT64 size) const
+{
+    if (offset > mSize)
+        offset = mSize;
+    if (size > mSize - offset)
+        size = mSize - offset;
+
+    SharedBlob slice;
+    slice.mOwner = mOwner;
+    slice.mpData = mpData + offset;
+    slice.mSize = size;
+    return slice;
+}
@@ -0,0 +1,35 @@
+#ifndef SHAREDBLOB_H__
+#define SHAREDBLOB_H__
+
+// Immutable bytes shared by reference count. Copies and slices are O(1) and point
+// into the same storage, which is released with the last reference: a Blob taken
+// over without copying, or a region owned elsewhere (e.g. a mapped file).
+class SharedBlob
+{
+public:
+    SharedBlob() : mpData(nullptr), mSize(0) {}
+    //Takes the Blob's block (inline bytes are the only copy)
+    explicit SharedBlob(Blob&& blob);
+    //release runs once the last reference is gone
+    SharedBlob(const UINT8* pData, UINT64 size, std::function<void()> release);
+
+    static SharedBlob Copy(const UINT8* pData, UINT64 size);
+    //Whole file mapped read-only (empty on failure or for an empty file)
+    static SharedBlob MapFile(const std::string& path);
+
+    const UINT8* GetData() const { return mpData; }
+    UINT64 GetSize() const { return mSize; }
+    bool IsEmpty() const { return mSize == 0; }
+
+    //[offset, offset + size) clamped to this one, sharing its storage
+    SharedBlob Slice(UINT64 offset, UINT64 size = ~0ull) const;
+    //References to the storage (0 for an empty SharedBlob)
+    long GetUseCount() const { return mOwner.use_count(); }
+
+private:
+    std::shared_ptr<const void> mOwner;
+    const UINT8* mpData;
+    UINT64 mSize;
+};
+
+#endif // !SHAREDBLOB_H__
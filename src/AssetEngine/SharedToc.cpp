@@ -0,0 +1,215 @@
+#include "pch.h"
+
+namespace
+{
+    UINT64 HashName(const char* name, UINT64 length)
+    {
+        UINT64 hash = 0xCBF29CE484222325ull;
+        for (UINT64 i = 0; i < length; i++)
+        {
+            hash ^= static_cast<UINT8>(name[i]);
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+}
+
+SharedToc::~SharedToc()
+{
+    Detach();
+}
+
+bool SharedToc::GetArchiveStamp(const std::string& archivePath, UINT64& outSize, INT64& outWriteTime)
+{
+    std::error_code error;
+    outSize = std::filesystem::file_size(archivePath, error);
+    if (error)
+        return false;
+
+    auto writeTime = std::filesystem::last_write_time(archivePath, error);
+    if (error)
+        return false;
+
+    outWriteTime = writeTime.time_since_epoch().count();
+    return true;
+}
+
+bool SharedToc::Publish(const std::string& archivePath, UINT32 fileCount, UINT64 dataOffset,
+                        const std::unordered_map<std::string, UINT64>& names, const std::unordered_map<UINT64, UINT64>& ids)
+{
+    TocHeader header = {};
+    memcpy(header.magic, "ATOC", 4);
+    header.version = VERSION;
+    header.fileCount = fileCount;
+    header.dataOffset = dataOffset;
+    if (!GetArchiveStamp(archivePath, header.archiveSize, header.archiveWriteTime))
+        return false;
+
+    std::vector<TocNameEntry> nameEntries;
+    nameEntries.reserve(names.size());
+    std::string pool;
+    for (const auto& [name, offset] : names)
+    {
+        TocNameEntry entry;
+        entry.hash = HashName(name.c_str(), name.size());
+        entry.offset = offset;
+        entry.nameOffset = static_cast<UINT32>(pool.size());
+        entry.nameLength = static_cast<UINT32>(name.size());
+        nameEntries.push_back(entry);
+        pool += name;
+    }
+
+    std::sort(nameEntries.begin(), nameEntries.end(), [&pool](const TocNameEntry& a, const TocNameEntry& b)
+    {
+        if (a.hash != b.hash)
+            return a.hash < b.hash;
+        return pool.compare(a.nameOffset, a.nameLength, pool, b.nameOffset, b.nameLength) < 0;
+    });
+
+    std::vector<TocIdEntry> idEntries;
+    idEntries.reserve(ids.size());
+    for (const auto& [id, offset] : ids)
+        idEntries.push_back({ id, offset });
+    std::sort(idEntries.begin(), idEntries.end(), [](const TocIdEntry& a, const TocIdEntry& b) { return a.id < b.id; });
+
+    header.nameCount = nameEntries.size();
+    header.idCount = idEntries.size();
+    header.poolSize = pool.size();
+
+    // Written aside, then renamed over the old one: a reader never maps a partial index
+    std::random_device rd;
+    std::string tocPath = GetPath(archivePath);
+    std::string tempPath = tocPath + "." + std::to_string(rd()) + ".tmp";
+
+    File file;
+    if (!file.OpenWrite(tempPath))
+        return false;
+
+    bool written = file.Write((const UINT8*)&header, sizeof(TocHeader), 1) == sizeof(TocHeader);
+    if (written && !nameEntries.empty())
+        written = file.Write((const UINT8*)nameEntries.data(), nameEntries.size() * sizeof(TocNameEntry), 1) == nameEntries.size() * sizeof(TocNameEntry);
+    if (written && !idEntries.empty())
+        written = file.Write((const UINT8*)idEntries.data(), idEntries.size() * sizeof(TocIdEntry), 1) == idEntries.size() * sizeof(TocIdEntry);
+    if (written && !pool.empty())
+        written = file.Write((const UINT8*)pool.data(), pool.size(), 1) == pool.size();
+    file.Close();
+
+    std::error_code error;
+    if (written)
+        std::filesystem::rename(tempPath, tocPath, error);
+    if (!written || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool SharedToc::Attach(const std::string& archivePath, UINT32 fileCount, UINT64 dataOffset)
+{
+    Detach();
+
+    UINT64 archiveSize;
+    INT64 archiveWriteTime;
+    if (!GetArchiveStamp(archivePath, archiveSize, archiveWriteTime))
+        return false;
+
+    SharedBlob mapped = SharedBlob::MapFile(GetPath(archivePath));
+    if (mapped.IsEmpty())
+        return false;
+
+    const UINT8* view = mapped.GetData();
+    UINT64 viewSize = mapped.GetSize();
+    const TocHeader* header = reinterpret_cast<const TocHeader*>(view);
+    bool valid = viewSize >= sizeof(TocHeader) &&
+        memcmp(header->magic, "ATOC", 4) == 0 && header->version == VERSION &&
+        header->archiveSize == archiveSize && header->archiveWriteTime == archiveWriteTime &&
+        header->fileCount == fileCount && header->dataOffset == dataOffset;
+
+    // Sizes come from the file: check them before trusting any offset
+    if (valid)
+    {
+        UINT64 available = viewSize - sizeof(TocHeader);
+        valid = header->nameCount <= available / sizeof(TocNameEntry);
+        if (valid)
+        {
+            available -= header->nameCount * sizeof(TocNameEntry);
+            valid = header->idCount <= available / sizeof(TocIdEntry);
+        }
+        if (valid)
+        {
+            available -= header->idCount * sizeof(TocIdEntry);
+            valid = header->poolSize == available;
+        }
+    }
+
+    if (!valid)
+        return false;
+
+    mView = std::move(mapped);
+    mHeader = header;
+    mNames = reinterpret_cast<const TocNameEntry*>(view + sizeof(TocHeader));
+    mIDs = reinterpret_cast<const TocIdEntry*>(mNames + header->nameCount);
+    mPool = reinterpret_cast<const char*>(mIDs + header->idCount);
+    return true;
+}
+
+void SharedToc::Detach()
+{
+    if (mView.IsEmpty())
+        return;
+
+    mView = SharedBlob();
+    mHeader = nullptr;
+    mNames = nullptr;
+    mIDs = nullptr;
+    mPool = nullptr;
+}
+
+bool SharedToc::FindName(const std::string& name, UINT64& outOffset) const
+{
+    if (mView.IsEmpty())
+        return false;
+
+    UINT64 hash = HashName(name.c_str(), name.size());
+    const TocNameEntry* end = mNames + mHeader->nameCount;
+    const TocNameEntry* it = std::lower_bound(mNames, end, hash,
+        [](const TocNameEntry& entry, UINT64 value) { return entry.hash < value; });
+
+    for (; it != end && it->hash == hash; ++it)
+    {
+        if (static_cast<UINT64>(it->nameOffset) + it->nameLength > mHeader->poolSize)
+            return false;
+
+        if (it->nameLength == name.size() && memcmp(mPool + it->nameOffset, name.data(), name.size()) == 0)
+        {
+            outOffset = it->offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SharedToc::FindID(UINT64 id, UINT64& outOffset) const
+{
+    if (mView.IsEmpty())
+        return false;
+
+    const TocIdEntry* end = mIDs + mHeader->idCount;
+    const TocIdEntry* it = std::lower_bound(mIDs, end, id,
+        [](const TocIdEntry& entry, UINT64 value) { return entry.id < value; });
+
+    if (it == end || it->id != id)
+        return false;
+
+    outOffset = it->offset;
+    return true;
+}
+
+std::string SharedToc::GetName(UINT64 index) const
+{
+    const TocNameEntry& entry = mNames[index];
+    if (static_cast<UINT64>(entry.nameOffset) + entry.nameLength > mHeader->poolSize)
+        return std::string();
+    return std::string(mPool + entry.nameOffset, entry.nameLength);
+}
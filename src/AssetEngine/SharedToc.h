@@ -0,0 +1,75 @@
+#ifndef SHAREDTOC_H__
+#define SHAREDTOC_H__
+
+// Sidecar file (archive path + ".toc") holding the decoded maps of an archive, sorted
+// for lookups in place. Every process maps it read-only, so the pages are shared.
+struct TocHeader
+{
+    char     magic[4];          // "ATOC"
+    UINT32   version;
+    // Archive the index was built from: any change to the file makes it stale
+    UINT64   archiveSize;
+    INT64    archiveWriteTime;
+    UINT32   fileCount;
+    UINT32   padding;
+    UINT64   dataOffset;
+
+    UINT64   nameCount;
+    UINT64   idCount;
+    UINT64   poolSize;
+};
+
+struct TocNameEntry
+{
+    UINT64   hash;              // FNV-1a of the name, entries sorted by (hash, name)
+    UINT64   offset;
+    UINT32   nameOffset;        // in the name pool
+    UINT32   nameLength;
+};
+
+struct TocIdEntry
+{
+    UINT64   id;
+    UINT64   offset;
+};
+
+class SharedToc
+{
+public:
+    static const UINT32 VERSION = 1;
+
+    SharedToc() : mHeader(nullptr), mNames(nullptr), mIDs(nullptr), mPool(nullptr) {}
+    ~SharedToc();
+
+    SharedToc(const SharedToc&) = delete;
+    SharedToc& operator=(const SharedToc&) = delete;
+
+    static std::string GetPath(const std::string& archivePath) { return archivePath + ".toc"; }
+
+    //Writes the index of archivePath, replacing the previous one in a single rename
+    static bool Publish(const std::string& archivePath, UINT32 fileCount, UINT64 dataOffset,
+                        const std::unordered_map<std::string, UINT64>& names, const std::unordered_map<UINT64, UINT64>& ids);
+
+    //Maps the index if it was built from the archive as it is on disk now
+    bool Attach(const std::string& archivePath, UINT32 fileCount, UINT64 dataOffset);
+    void Detach();
+    bool IsAttached() const { return !mView.IsEmpty(); }
+
+    bool FindName(const std::string& name, UINT64& outOffset) const;
+    bool FindID(UINT64 id, UINT64& outOffset) const;
+
+    UINT64 GetNameCount() const { return mHeader != nullptr ? mHeader->nameCount : 0; }
+    std::string GetName(UINT64 index) const;
+    UINT64 GetNameOffset(UINT64 index) const { return mNames[index].offset; }
+
+private:
+    static bool GetArchiveStamp(const std::string& archivePath, UINT64& outSize, INT64& outWriteTime);
+
+    SharedBlob          mView;
+    const TocHeader*    mHeader;
+    const TocNameEntry* mNames;
+    const TocIdEntry*   mIDs;
+    const char*         mPool;
+};
+
+#endif // !SHAREDTOC_H__
@@ -1,3 +1,29 @@
 ﻿#include "pch.h"
 
+std::string Stream::GetKey() const
+{
+    return mKey;
+}
 
+void Stream::SetKey(const std::string& key)
+{
+    mKey = key;
+}
+
+void Stream::EncryptBuffer(UINT8* buffer, UINT64 size)
+{
+    if (mKey.empty() || buffer == nullptr || size == 0)
+        return;
+
+    const UINT64 keyLength = mKey.size();
+
+    for (UINT64 i = 0; i < size; ++i)
+    {
+        buffer[i] ^= static_cast<UINT8>(mKey[i % keyLength]);
+    }
+}
+
+void Stream::DecryptBuffer(UINT8* buffer, UINT64 size)
+{
+    EncryptBuffer(buffer, size);    // ff c'est du XOR ;)
+}
@@ -5,7 +5,7 @@
 class Stream
 {
 public:
-    Stream() : mpFile(nullptr) {}
+    Stream() : mpFile(nullptr), mIsEncrypted(false) {}
     virtual ~Stream() = default;
 
     virtual UINT64  Read(UINT8 *buffer, UINT64 size, UINT64 count = 1) = 0;
@@ -16,6 +16,14 @@ public:
     virtual void    Close() = 0;
     virtual UINT64  GetSize() = 0;
 
+    //XOR keystream, restarted every MAX_BUFFER_SIZE bytes of each Read / Write call
+    std::string     GetKey() const;
+    void            SetKey(const std::string& key);
+    void            EncryptBuffer(UINT8* buffer, UINT64 size);
+    void            DecryptBuffer(UINT8* buffer, UINT64 size);
+    void            EnableEncryption(bool enable) { mIsEncrypted = enable; }
+    bool            IsEncryptionEnabled() const { return mIsEncrypted; }
+
     std::FILE       *mpFile;
 
     struct Header
@@ -32,8 +40,14 @@ public:
     {
         NONE       = 0x0000,
         COMPRESSED = 0x0001,
-        ENCRYPTED  = 0x0002
+        ENCRYPTED  = 0x0002,
+        BLOCKED    = 0x0004,
+        DICTIONARY = 0x0008
     };
+
+protected:
+    std::string     mKey;
+    bool            mIsEncrypted;
 };
 
 #endif // !STREAM_H__
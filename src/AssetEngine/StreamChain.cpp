@@ -0,0 +1,408 @@
+#include "pch.h"
+
+// === BufferedStream ===
+
+BufferedStream::BufferedStream(Stream* inner, UINT64 bufferSize) :
+    StreamDecorator(inner),
+    mReadPos(0),
+    mReadEnd(0),
+    mWriteCount(0)
+{
+    mBuffer.Resize(bufferSize > 0 ? bufferSize : DEFAULT_BUFFER_SIZE);
+}
+
+BufferedStream::~BufferedStream()
+{
+    Flush();
+}
+
+bool BufferedStream::Flush()
+{
+    if (mWriteCount == 0)
+        return true;
+
+    UINT64 written = mpInner->Write(mBuffer.GetData(), mWriteCount, 1);
+    bool flushed = (written == mWriteCount);
+    mWriteCount = 0;
+    return flushed;
+}
+
+void BufferedStream::DropReadAhead()
+{
+    if (mReadEnd > mReadPos)
+        mpInner->Seek(-(INT64)(mReadEnd - mReadPos), SEEK_CUR);
+    mReadPos = 0;
+    mReadEnd = 0;
+}
+
+UINT64 BufferedStream::Read(UINT8* buffer, UINT64 size, UINT64 count)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+    if (!Flush())
+        return 0;
+
+    UINT64 totalBytes = size * count;
+    UINT64 bytesRead = 0;
+    while (bytesRead < totalBytes)
+    {
+        if (mReadPos < mReadEnd)
+        {
+            UINT64 amount = (std::min)(totalBytes - bytesRead, mReadEnd - mReadPos);
+            memcpy(buffer + bytesRead, mBuffer.GetData() + mReadPos, amount);
+            mReadPos += amount;
+            bytesRead += amount;
+            continue;
+        }
+
+        // Large reads skip the copy
+        UINT64 remaining = totalBytes - bytesRead;
+        if (remaining >= mBuffer.GetSize())
+        {
+            bytesRead += mpInner->Read(buffer + bytesRead, remaining, 1);
+            break;
+        }
+
+        mReadPos = 0;
+        mReadEnd = mpInner->Read(mBuffer.GetData(), mBuffer.GetSize(), 1);
+        if (mReadEnd == 0)
+            break;
+    }
+    return bytesRead;
+}
+
+UINT64 BufferedStream::Write(const UINT8* buffer, UINT64 size, UINT64 count)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+
+    DropReadAhead();
+
+    UINT64 totalBytes = size * count;
+    if (mWriteCount + totalBytes > mBuffer.GetSize())
+    {
+        if (!Flush())
+            return 0;
+        if (totalBytes >= mBuffer.GetSize())
+            return mpInner->Write(buffer, totalBytes, 1);
+    }
+
+    memcpy(mBuffer.GetData() + mWriteCount, buffer, totalBytes);
+    mWriteCount += totalBytes;
+    return totalBytes;
+}
+
+INT64 BufferedStream::Seek(INT64 offset, int origin)
+{
+    Flush();
+    DropReadAhead();
+    return mpInner->Seek(offset, origin);
+}
+
+void BufferedStream::Close()
+{
+    Flush();
+    mReadPos = 0;
+    mReadEnd = 0;
+    mpInner->Close();
+}
+
+UINT64 BufferedStream::GetSize()
+{
+    Flush();
+    return mpInner->GetSize();
+}
+
+// === CrcStream ===
+
+UINT64 CrcStream::Read(UINT8* buffer, UINT64 size, UINT64 count)
+{
+    UINT64 bytesRead = mpInner->Read(buffer, size, count);
+    mCrc = SafeFormat::UpdateCRC32(mCrc, buffer, bytesRead);
+    mCount += bytesRead;
+    return bytesRead;
+}
+
+UINT64 CrcStream::Write(const UINT8* buffer, UINT64 size, UINT64 count)
+{
+    UINT64 written = mpInner->Write(buffer, size, count);
+    mCrc = SafeFormat::UpdateCRC32(mCrc, buffer, written);
+    mCount += written;
+    return written;
+}
+
+// === LockedStream ===
+
+UINT64 LockedStream::Read(UINT8* buffer, UINT64 size, UINT64 count)
+{
+    std::lock_guard<std::mutex> lock(*mpMutex);
+    if (mpInner->Seek(mPosition, SEEK_SET) != mPosition)
+        return 0;
+
+    UINT64 bytesRead = mpInner->Read(buffer, size, count);
+    mPosition += bytesRead;
+    return bytesRead;
+}
+
+UINT64 LockedStream::Write(const UINT8*, UINT64, UINT64)
+{
+    return 0;
+}
+
+INT64 LockedStream::Seek(INT64 offset, int origin)
+{
+    INT64 base = 0;
+    if (origin == SEEK_CUR)
+        base = mPosition;
+    else if (origin == SEEK_END)
+        base = static_cast<INT64>(GetSize());
+
+    if (base + offset < 0)
+        return -1;
+    mPosition = base + offset;
+    return mPosition;
+}
+
+UINT64 LockedStream::GetSize()
+{
+    std::lock_guard<std::mutex> lock(*mpMutex);
+    return mpInner->GetSize();
+}
+
+// === CipherStream ===
+
+CipherStream::CipherStream(Stream* inner, const std::string& key, UINT64 period) :
+    StreamDecorator(inner),
+    mPeriod(period > 0 ? period : MAX_BUFFER_SIZE),
+    mOrigin(inner->Seek(0, SEEK_CUR)),
+    mOffset(0)
+{
+    mKey = key;
+    mIsEncrypted = !key.empty();
+}
+
+void CipherStream::Apply(UINT8* buffer, UINT64 size, UINT64 offset) const
+{
+    if (!mIsEncrypted)
+        return;
+
+    const UINT64 keyLength = mKey.size();
+    UINT64 phase = offset % mPeriod;
+    for (UINT64 i = 0; i < size; i++)
+    {
+        buffer[i] ^= static_cast<UINT8>(mKey[phase % keyLength]);
+        if (++phase == mPeriod)
+            phase = 0;
+    }
+}
+
+UINT64 CipherStream::Read(UINT8* buffer, UINT64 size, UINT64 count)
+{
+    UINT64 bytesRead = mpInner->Read(buffer, size, count);
+    Apply(buffer, bytesRead, mOffset);
+    mOffset += bytesRead;
+    return bytesRead;
+}
+
+UINT64 CipherStream::Write(const UINT8* buffer, UINT64 size, UINT64 count)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+
+    UINT64 totalBytes = size * count;
+    if (!mIsEncrypted)
+    {
+        UINT64 written = mpInner->Write(buffer, totalBytes, 1);
+        mOffset += written;
+        return written;
+    }
+
+    IoBuffer scratch;
+    UINT64 written = 0;
+    while (written < totalBytes)
+    {
+        UINT64 amount = (std::min)(totalBytes - written, scratch.GetSize());
+        memcpy(scratch.GetData(), buffer + written, amount);
+        Apply(scratch.GetData(), amount, mOffset);
+
+        UINT64 done = mpInner->Write(scratch.GetData(), amount, 1);
+        mOffset += done;
+        written += done;
+        if (done != amount)
+            break;
+    }
+    return written;
+}
+
+INT64 CipherStream::Seek(INT64 offset, int origin)
+{
+    INT64 position = mpInner->Seek(offset, origin);
+    if (position >= mOrigin)
+        mOffset = static_cast<UINT64>(position - mOrigin);
+    return position;
+}
+
+// === CodecStream ===
+
+CodecStream::CodecStream(Stream* inner, UINT8 codec, const Codec::Dictionary* dictionary) :
+    StreamDecorator(inner),
+    mCodec(codec),
+    mpDictionary(dictionary),
+    mStarted(false),
+    mCorrupt(false),
+    mHeader(),
+    mTable(),
+    mNextBlock(0),
+    mBlockPos(0),
+    mDelivered(0)
+{
+}
+
+// Grown chunk by chunk as the bytes arrive: a forged size runs out of input long before
+// it can claim the memory it announces
+bool CodecStream::ReadInner(Blob& outData, UINT64 size)
+{
+    outData.Clear();
+    while (outData.GetSize() < size)
+    {
+        UINT64 done = outData.GetSize();
+        UINT64 amount = (std::min)(size - done, IoBuffer::GetChunkSize());
+        if (!outData.Resize(done + amount) || mpInner->Read(outData.GetData() + done, amount, 1) != amount)
+            return false;
+    }
+    return true;
+}
+
+// Header and seek table; a single stream is decoded whole right away
+bool CodecStream::Start()
+{
+    mStarted = true;
+    mCorrupt = true;
+
+    if (!Codec::IsSupported(mCodec) || mpInner->Read((UINT8*)&mHeader, sizeof(mHeader), 1) != sizeof(mHeader))
+        return false;
+    if (mHeader.magic[0] != 'S' || mHeader.magic[1] != 'A' || mHeader.magic[2] != 'F' || mHeader.magic[3] != 'E' ||
+        !(mHeader.flags & Stream::COMPRESSED) || mHeader.originalSize > mHeader.dataSize * Codec::MAX_RATIO)
+        return false;
+
+    if (!(mHeader.flags & Stream::BLOCKED))
+    {
+        if ((mHeader.flags & Stream::DICTIONARY) && mpDictionary == nullptr)
+            return false;
+        if (!ReadInner(mStored, mHeader.dataSize))
+            return false;
+
+        if (!mBlock.Resize(mHeader.originalSize))
+            return false;
+        UINT64 decodedSize = Codec::Decode(mCodec, mStored.GetData(), mStored.GetSize(), mBlock.GetData(), mHeader.originalSize,
+                                           (mHeader.flags & Stream::DICTIONARY) ? mpDictionary : nullptr);
+        mStored.Clear();
+        if (decodedSize != mHeader.originalSize)
+            return false;
+
+        mCorrupt = false;
+        return true;
+    }
+
+    if (mHeader.dataSize < sizeof(BlockTableHeader) ||
+        mpInner->Read((UINT8*)&mTable, sizeof(mTable), 1) != sizeof(mTable))
+        return false;
+
+    UINT64 tableSize = Codec::GetBlockTableSize(mTable.blockCount);
+    if (mTable.blockSize == 0 || tableSize > mHeader.dataSize ||
+        (mHeader.originalSize + mTable.blockSize - 1) / mTable.blockSize != mTable.blockCount)
+        return false;
+
+    mBounds.resize(static_cast<UINT64>(mTable.blockCount) + 1);
+    if (mpInner->Read((UINT8*)mBounds.data(), mBounds.size() * sizeof(UINT64), 1) != mBounds.size() * sizeof(UINT64))
+        return false;
+
+    // Blocks are read in order, so they must follow each other
+    UINT64 blocksSize = mHeader.dataSize - tableSize;
+    if (mBounds[0] != 0 || mBounds.back() > blocksSize)
+        return false;
+    for (UINT32 i = 0; i < mTable.blockCount; i++)
+    {
+        if (mBounds[i] > mBounds[i + 1])
+            return false;
+    }
+
+    mCorrupt = false;
+    return true;
+}
+
+bool CodecStream::NextBlock()
+{
+    if (!(mHeader.flags & Stream::BLOCKED) || mNextBlock >= mTable.blockCount)
+        return false;
+
+    UINT64 rawOffset = static_cast<UINT64>(mNextBlock) * mTable.blockSize;
+    UINT64 rawSize = (std::min)(mHeader.originalSize - rawOffset, (UINT64)mTable.blockSize);
+    UINT64 storedSize = mBounds[mNextBlock + 1] - mBounds[mNextBlock];
+
+    // The stored bytes are there: only then is the block sized from them
+    if (!ReadInner(mStored, storedSize) || rawSize > storedSize * Codec::MAX_RATIO || !mBlock.Resize(rawSize) ||
+        !Codec::DecodeBlock(mStored.GetData(), storedSize, mBlock.GetData(), rawSize, mCodec))
+    {
+        mCorrupt = true;
+        return false;
+    }
+
+    mNextBlock++;
+    mBlockPos = 0;
+    return true;
+}
+
+UINT64 CodecStream::Read(UINT8* buffer, UINT64 size, UINT64 count)
+{
+    if (buffer == nullptr || size == 0)
+        return 0;
+    if (!mStarted && !Start())
+    {
+        std::cerr << "[ERROR][CODEC] Malformed payload" << std::endl;
+        return 0;
+    }
+    if (mCorrupt)
+        return 0;
+
+    UINT64 totalBytes = size * count;
+    UINT64 bytesRead = 0;
+    while (bytesRead < totalBytes)
+    {
+        if (mBlockPos == mBlock.GetSize() && !NextBlock())
+            break;
+
+        UINT64 amount = (std::min)(totalBytes - bytesRead, mBlock.GetSize() - mBlockPos);
+        memcpy(buffer + bytesRead, mBlock.GetData() + mBlockPos, amount);
+        mBlockPos += amount;
+        bytesRead += amount;
+    }
+
+    if (mCorrupt)
+        std::cerr << "[ERROR][CODEC] Block " << mNextBlock << " failed to decode" << std::endl;
+
+    mDelivered += bytesRead;
+    return bytesRead;
+}
+
+UINT64 CodecStream::Write(const UINT8*, UINT64, UINT64)
+{
+    std::cerr << "[ERROR][CODEC] CodecStream only decodes (see Codec::Pack)" << std::endl;
+    return 0;
+}
+
+INT64 CodecStream::Seek(INT64 offset, int origin)
+{
+    if (offset == 0 && origin == SEEK_CUR)
+        return static_cast<INT64>(mDelivered);
+
+    std::cerr << "[ERROR][CODEC] CodecStream can't seek" << std::endl;
+    return -1;
+}
+
+UINT64 CodecStream::GetSize()
+{
+    if (!mStarted)
+        Start();
+    return mCorrupt ? 0 : mHeader.originalSize;
+}
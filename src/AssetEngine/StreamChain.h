@@ -0,0 +1,150 @@
+#ifndef STREAMCHAIN_H__
+#define STREAMCHAIN_H__
+
+// Streams wrapping another Stream (not owned), stacked so that an entry is read,
+// deciphered, decoded and checked in one pass, e.g.
+//     CipherStream cipher(file, key);  CodecStream codec(&cipher);  CrcStream crc(&codec);
+// Close() closes the wrapped stream too; destroying a decorator only detaches it.
+class StreamDecorator : public Stream
+{
+public:
+    explicit StreamDecorator(Stream* inner) : mpInner(inner) {}
+
+    INT64   Seek(INT64 offset, int origin = SEEK_SET) override { return mpInner->Seek(offset, origin); }
+    bool    IsOpen() const override { return mpInner != nullptr && mpInner->IsOpen(); }
+    void    Close() override { mpInner->Close(); }
+    UINT64  GetSize() override { return mpInner->GetSize(); }
+
+    Stream* GetInner() const { return mpInner; }
+
+protected:
+    Stream* mpInner;
+};
+
+// Small reads and writes served from one buffer: the wrapped stream only sees
+// calls of bufferSize bytes (larger ones go straight through)
+class BufferedStream : public StreamDecorator
+{
+public:
+    static const UINT64 DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    explicit BufferedStream(Stream* inner, UINT64 bufferSize = DEFAULT_BUFFER_SIZE);
+    //Flushes pending writes
+    ~BufferedStream() override;
+
+    UINT64  Read(UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    UINT64  Write(const UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    INT64   Seek(INT64 offset, int origin = SEEK_SET) override;
+    void    Close() override;
+    UINT64  GetSize() override;
+
+    bool    Flush();
+
+private:
+    //Gives back the read-ahead: the wrapped stream moves back to the caller's position
+    void    DropReadAhead();
+
+    Blob mBuffer;
+    UINT64 mReadPos;      // read-ahead: [mReadPos, mReadEnd) not consumed yet
+    UINT64 mReadEnd;
+    UINT64 mWriteCount;   // pending writes
+};
+
+// Running CRC32 of every byte read or written through it
+class CrcStream : public StreamDecorator
+{
+public:
+    explicit CrcStream(Stream* inner) : StreamDecorator(inner), mCrc(0), mCount(0) {}
+
+    UINT64  Read(UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    UINT64  Write(const UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+
+    UINT32  GetCRC32() const { return mCrc; }
+    UINT64  GetCount() const { return mCount; }
+    void    Reset() { mCrc = 0; mCount = 0; }
+
+private:
+    UINT32 mCrc;
+    UINT64 mCount;
+};
+
+// A cursor of its own on a stream shared between threads: each Read seeks the wrapped
+// stream to it and reads under the mutex, so a reader holds the lock for its I/O only.
+// Read-only; starts at 0, and Close() leaves the shared stream open.
+class LockedStream : public StreamDecorator
+{
+public:
+    LockedStream(Stream* inner, std::mutex& mutex) : StreamDecorator(inner), mpMutex(&mutex), mPosition(0) {}
+
+    UINT64  Read(UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    UINT64  Write(const UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    INT64   Seek(INT64 offset, int origin = SEEK_SET) override;
+    void    Close() override {}
+    UINT64  GetSize() override;
+
+private:
+    std::mutex* mpMutex;
+    INT64 mPosition;
+};
+
+// XOR keystream tied to the position: the key restarts every period bytes counted
+// from where the CipherStream was created. With the default period, bytes match the
+// ones Stream::EncryptBuffer gives for MAX_BUFFER_SIZE calls from the same start,
+// at any call size and after any Seek.
+class CipherStream : public StreamDecorator
+{
+public:
+    CipherStream(Stream* inner, const std::string& key, UINT64 period = MAX_BUFFER_SIZE);
+
+    UINT64  Read(UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    //The caller's bytes are not touched: they go out through a borrowed IoBuffer
+    UINT64  Write(const UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    INT64   Seek(INT64 offset, int origin = SEEK_SET) override;
+
+private:
+    void    Apply(UINT8* buffer, UINT64 size, UINT64 offset) const;
+
+    UINT64 mPeriod;
+    INT64 mOrigin;
+    UINT64 mOffset;       // from mOrigin
+};
+
+// Decodes a Codec::Pack payload (Stream::Header, then a single stream or blocks)
+// as it is read: a BLOCKED payload holds one block in memory at a time. Read-only
+// and forward-only; CRC32 checks are left to a CrcStream on top.
+class CodecStream : public StreamDecorator
+{
+public:
+    explicit CodecStream(Stream* inner, UINT8 codec = CODEC_LZ, const Codec::Dictionary* dictionary = nullptr);
+
+    //0 at the end of the payload, or once it turns out malformed (see IsCorrupt)
+    UINT64  Read(UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    UINT64  Write(const UINT8* buffer, UINT64 size, UINT64 count = 1) override;
+    //Only Seek(0, SEEK_CUR): decoded bytes handed out so far
+    INT64   Seek(INT64 offset, int origin = SEEK_SET) override;
+    bool    IsOpen() const override { return !mCorrupt && StreamDecorator::IsOpen(); }
+    //Decoded size (reads the payload header if not done yet)
+    UINT64  GetSize() override;
+
+    bool    IsCorrupt() const { return mCorrupt; }
+
+private:
+    bool    Start();
+    bool    NextBlock();
+    bool    ReadInner(Blob& outData, UINT64 size);
+
+    UINT8 mCodec;
+    const Codec::Dictionary* mpDictionary;
+    bool mStarted;
+    bool mCorrupt;
+    Stream::Header mHeader;
+    BlockTableHeader mTable;
+    std::vector<UINT64> mBounds;
+    UINT32 mNextBlock;
+    Blob mStored;
+    Blob mBlock;          // decoded bytes of the current block
+    UINT64 mBlockPos;
+    UINT64 mDelivered;
+};
+
+#endif // !STREAMCHAIN_H__
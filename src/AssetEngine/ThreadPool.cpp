@@ -0,0 +1,128 @@
+#include "pch.h"
+
+namespace
+{
+    struct ParallelJob
+    {
+        const std::function<void(UINT64)>* task;
+        UINT64 count;
+        std::atomic<UINT64> next;
+        std::atomic<UINT64> done;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        // Claims items until none are left; returns when this thread has nothing more to do
+        void Run()
+        {
+            UINT64 index;
+            while ((index = next.fetch_add(1)) < count)
+            {
+                (*task)(index);
+
+                if (done.fetch_add(1) + 1 == count)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        }
+    };
+}
+
+ThreadPool::ThreadPool(UINT32 threadCount) :
+    mStop(false)
+{
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    for (UINT32 i = 1; i < threadCount; i++)
+        mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+
+    for (auto& thread : mThreads)
+        thread.join();
+}
+
+ThreadPool*& ThreadPool::Current()
+{
+    thread_local ThreadPool* current = nullptr;
+    return current;
+}
+
+ThreadPool& ThreadPool::Get()
+{
+    ThreadPool* current = Current();
+    if (current != nullptr)
+        return *current;
+
+    static ThreadPool pool;
+    return pool;
+}
+
+UINT32 ThreadPool::GetConcurrency() const
+{
+    return static_cast<UINT32>(mThreads.size()) + 1;
+}
+
+void ThreadPool::ParallelFor(UINT64 count, const std::function<void(UINT64)>& task)
+{
+    if (count == 0)
+        return;
+
+    if (count == 1 || mThreads.empty())
+    {
+        for (UINT64 i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    // Helpers may be dequeued after the caller returned: they share ownership of the job
+    auto job = std::make_shared<ParallelJob>();
+    job->task = &task;
+    job->count = count;
+    job->next = 0;
+    job->done = 0;
+
+    UINT64 helpers = (count - 1 < mThreads.size()) ? count - 1 : mThreads.size();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (UINT64 i = 0; i < helpers; i++)
+            mTasks.push_back([job]() { job->Run(); });
+    }
+    mWake.notify_all();
+
+    job->Run();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job]() { return job->done.load() == job->count; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+    ThreadPoolScope scope(*this);
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+
+            if (mStop && mTasks.empty())
+                return;
+
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef THREADPOOL_H__
+#define THREADPOOL_H__
+
+class ThreadPool
+{
+public:
+    //threadCount = 0: one worker per hardware thread (the caller counts as one)
+    explicit ThreadPool(UINT32 threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Pool of this thread's ThreadPoolScope, else the process-wide pool shared by the codecs
+    static ThreadPool& Get();
+
+    //Workers + calling thread
+    UINT32 GetConcurrency() const;
+
+    //Runs task(i) for every i in [0, count) and returns once all are done.
+    //The calling thread takes part, so nested calls from a task are safe.
+    void ParallelFor(UINT64 count, const std::function<void(UINT64)>& task);
+
+private:
+    friend class ThreadPoolScope;
+    static ThreadPool*& Current();
+
+    void WorkerLoop();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    bool mStop;
+};
+
+// Makes pool the one ThreadPool::Get() returns on this thread until the scope ends
+// (tasks running on a pool's workers nest on that pool)
+class ThreadPoolScope
+{
+public:
+    explicit ThreadPoolScope(ThreadPool& pool) : mpPrevious(ThreadPool::Current()) { ThreadPool::Current() = &pool; }
+    ~ThreadPoolScope() { ThreadPool::Current() = mpPrevious; }
+
+    ThreadPoolScope(const ThreadPoolScope&) = delete;
+    ThreadPoolScope& operator=(const ThreadPoolScope&) = delete;
+
+private:
+    ThreadPool* mpPrevious;
+};
+
+#endif // !THREADPOOL_H__
@@ -6,6 +6,7 @@
 
 #define MODE_CLI       // CLI Production (default)
 // #define MODE_TESTS  // Unit Tests (Memory + Archive)
+// #define MODE_BENCH  // Throughput / latency benchmarks
 
 // ============================================================================
 
@@ -63,8 +64,8 @@ void PrintUsage()
     std::cout << "  AssetEngine.exe -help | --help | help\n\n";
 
     std::cout << "Commands:\n";
-    std::cout << "  create <archive> <file1> [file2] ...    Create new archive from files\n";
-    std::cout << "  add <archive> <file1> [file2] ...       Add files to existing archive\n";
+    std::cout << "  create <archive> [options] <file1> ...  Create new archive from files\n";
+    std::cout << "  add <archive> [options] <file1> ...     Add files to existing archive\n";
     std::cout << "  list <archive>                          Display archive contents\n";
     std::cout << "  extract <archive> <filename> <output>   Extract specific file\n";
     std::cout << "  extractall <archive> <outputdir>        Extract all files\n";
@@ -72,14 +73,87 @@ void PrintUsage()
     std::cout << "  remove <archive> <filename>             Remove file (soft delete)\n";
     std::cout << "  removeall <archive>                     Remove all files (empty archive)\n";
     std::cout << "  rename <archive> <oldname> <newname>    Rename file in archive\n";
-    std::cout << "  compact <archive>                       Compact archive (reclaim space)\n\n";
+    std::cout << "  compact <archive>                       Compact archive (reclaim space)\n";
+    std::cout << "  serve <socket> [options] <archive1> ... Serve the archives to local processes\n";
+    std::cout << "                                          (type 'stats' or 'quit' on stdin)\n";
+    std::cout << "  get <socket> <filename> <output>        Fetch a file from a running server\n\n";
+
+    std::cout << "Options (create / add):\n";
+    std::cout << "  --compress                              LZ-compress entries (incompressible ones stay raw)\n";
+    std::cout << "  --block-size <KB>                       Compress large entries in independent blocks\n";
+    std::cout << "                                          (default 256, 0 = single stream)\n";
+    std::cout << "  --decode-budget <MB/s>                  Only use codecs that decode at least this fast\n";
+    std::cout << "                                          (default 0 = best ratio; stores if none fits)\n";
+    std::cout << "  --filter <.ext|file>=<filter>:<width>   Pre-filter before compression: shuffle, delta or\n";
+    std::cout << "                                          shuffle+delta, width = element size in bytes\n";
+    std::cout << "  --dedup                                 Store byte-identical files once (shared extent)\n";
+    std::cout << "  --chunk                                 Split files of 1 MB or more in content-defined chunks,\n";
+    std::cout << "                                          chunks already in the archive are not stored again\n";
+    std::cout << "  --dictionary                            create only: train a shared dictionary on small\n";
+    std::cout << "                                          entries and compress them with it (implies --compress)\n";
+    std::cout << "  --solid                                 create only: pack runs of small files of a directory\n";
+    std::cout << "                                          as one compressed stream (solid group)\n";
+    std::cout << "  --solid-group <list.txt>                create only: pack the files listed (one per line)\n";
+    std::cout << "                                          as one solid group\n\n";
+
+    std::cout << "Options (all commands):\n";
+    std::cout << "  --io-buffer <KB>                        Size of each read / write of the bulk copies, and stdio\n";
+    std::cout << "                                          buffer of the files (default 1024, up to 65536)\n\n";
+
+    std::cout << "Options (serve):\n";
+    std::cout << "  --workers <N>                           Connections served at once (default: one per core)\n";
+    std::cout << "  --cache <MB>                            Block cache and decoded entry cache of each archive\n";
+    std::cout << "                                          (default 64)\n\n";
 
     std::cout << "Examples:\n";
     std::cout << "  AssetEngine.exe create game.asset textures/*.png sounds/*.wav\n";
+    std::cout << "  AssetEngine.exe create game.asset --compress config/ meshes/\n";
+    std::cout << "  AssetEngine.exe create game.asset --compress --decode-budget 1000 streaming/\n";
+    std::cout << "  AssetEngine.exe create game.asset --compress --filter .vb=shuffle+delta:32 meshes/\n";
+    std::cout << "  AssetEngine.exe create game.asset --dictionary materials/\n";
+    std::cout << "  AssetEngine.exe create level1.asset --solid-group level1_files.txt\n";
     std::cout << "  AssetEngine.exe list game.asset\n";
     std::cout << "  AssetEngine.exe validate game.asset\n";
     std::cout << "  AssetEngine.exe extract game.asset logo.png extracted_logo.png\n";
-    std::cout << "  AssetEngine.exe extractall game.asset output_folder\n\n";
+    std::cout << "  AssetEngine.exe extractall game.asset output_folder\n";
+    std::cout << "  AssetEngine.exe validate huge.asset --io-buffer 4096\n";
+    std::cout << "  AssetEngine.exe serve assets.sock --workers 8 base.asset dlc1.asset\n";
+    std::cout << "  AssetEngine.exe get assets.sock logo.png fetched_logo.png\n\n";
+}
+
+// Decimal integer in [minValue, maxValue], nothing else on the argument
+bool ParseNumberOption(const char* text, UINT64 minValue, UINT64 maxValue, UINT64& outValue)
+{
+    if (text == nullptr || *text < '0' || *text > '9')
+        return false;
+
+    // Out of range saturates to ULLONG_MAX, above any maxValue given here
+    char* end = nullptr;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (*end != '\0' || value < minValue || value > maxValue)
+        return false;
+
+    outValue = value;
+    return true;
+}
+
+// "<.ext|file>=<filter>:<width>"
+bool ApplyFilterOption(Archive& archive, const std::string& option)
+{
+    size_t equals = option.find('=');
+    FilterSpec filter;
+    if (equals == std::string::npos || equals == 0 || !Filter::Parse(option.substr(equals + 1), filter))
+    {
+        std::cerr << "[WARNING] Invalid filter (skipped): " << option << "\n";
+        return false;
+    }
+
+    std::string target = option.substr(0, equals);
+    if (target[0] == '.')
+        archive.SetFilter(target.substr(1), filter);
+    else
+        archive.SetEntryFilter(target, filter);
+    return true;
 }
 
 int main(int argc, const char* argv[])
@@ -94,6 +168,32 @@ int main(int argc, const char* argv[])
         return 1;
     }
 
+    // Global option, taken out before the command reads its arguments
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) != "--io-buffer")
+            continue;
+
+        UINT64 kilobytes = 0;
+        if (!ParseNumberOption(argv[i + 1], 1, IoBuffer::MAX_CHUNK_SIZE / 1024, kilobytes))
+        {
+            std::cerr << "[ERROR] Usage: --io-buffer <KB> (1 to " << IoBuffer::MAX_CHUNK_SIZE / 1024 << ")\n";
+            return 1;
+        }
+
+        IoBuffer::SetChunkSize(kilobytes * 1024);
+        IoBuffer::SetFileBufferSize(IoBuffer::GetChunkSize());
+        std::copy(argv + i + 2, argv + argc, argv + i);
+        argc -= 2;
+        break;
+    }
+
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
     std::string command = argv[1];
 
     // HELP
@@ -109,7 +209,7 @@ int main(int argc, const char* argv[])
     {
         if (argc < 3)
         {
-            std::cerr << "[ERROR] Usage: create <archive> [file1|dir] ...\n";
+            std::cerr << "[ERROR] Usage: create <archive> [--compress] [--block-size <KB>] [--decode-budget <MB/s>] [--filter <.ext|file>=<filter>:<width>] [--dedup] [--chunk] [--dictionary] [--solid] [--solid-group <list>] [file1|dir] ...\n";
             std::cerr << "[HELP] Examples:\n";
             std::cerr << "  create game.asset file1.txt file2.txt\n";
             std::cerr << "  create game.asset assets/\n";
@@ -119,11 +219,111 @@ int main(int argc, const char* argv[])
 
         std::string archivePath = argv[2];
         std::vector<std::string> filePaths;
+        bool compress = false;
+        bool dedup = false;
+        bool chunk = false;
+        bool dictionary = false;
+        bool solid = false;
+        std::vector<std::vector<std::string>> solidGroups;
+        UINT32 blockSize = Codec::DEFAULT_BLOCK_SIZE;
+        UINT32 decodeBudget = 0;
+        std::vector<std::string> filters;
 
         for (int i = 3; i < argc; i++)
         {
             std::string arg = argv[i];
 
+            if (arg == "--compress")
+            {
+                compress = true;
+                continue;
+            }
+
+            if (arg == "--dedup")
+            {
+                dedup = true;
+                continue;
+            }
+
+            if (arg == "--chunk")
+            {
+                chunk = true;
+                continue;
+            }
+
+            if (arg == "--dictionary")
+            {
+                compress = true;
+                dictionary = true;
+                continue;
+            }
+
+            if (arg == "--solid")
+            {
+                solid = true;
+                continue;
+            }
+
+            if (arg == "--solid-group" && i + 1 < argc)
+            {
+                std::ifstream list(argv[++i]);
+                if (!list)
+                {
+                    std::cerr << "[WARNING] Solid group list not found (skipped): " << argv[i] << "\n";
+                    continue;
+                }
+
+                std::vector<std::string> group;
+                std::string line;
+                while (std::getline(list, line))
+                {
+                    if (!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    if (line.empty())
+                        continue;
+
+                    if (!fs::exists(line))
+                    {
+                        std::cerr << "[WARNING] File not found (skipped): " << line << "\n";
+                        continue;
+                    }
+                    group.push_back(line);
+                    filePaths.push_back(line);
+                }
+                solidGroups.push_back(group);
+                continue;
+            }
+
+            if (arg == "--block-size" && i + 1 < argc)
+            {
+                UINT64 kilobytes = 0;
+                if (!ParseNumberOption(argv[++i], 0, UINT32_MAX / 1024, kilobytes))
+                {
+                    std::cerr << "[ERROR] Usage: --block-size <KB> (0 to " << UINT32_MAX / 1024 << ")\n";
+                    return 1;
+                }
+                blockSize = static_cast<UINT32>(kilobytes * 1024);
+                continue;
+            }
+
+            if (arg == "--decode-budget" && i + 1 < argc)
+            {
+                UINT64 budget = 0;
+                if (!ParseNumberOption(argv[++i], 0, UINT32_MAX, budget))
+                {
+                    std::cerr << "[ERROR] Usage: --decode-budget <MB/s> (0 to " << UINT32_MAX << ")\n";
+                    return 1;
+                }
+                decodeBudget = static_cast<UINT32>(budget);
+                continue;
+            }
+
+            if (arg == "--filter" && i + 1 < argc)
+            {
+                filters.push_back(argv[++i]);
+                continue;
+            }
+
             if (fs::is_directory(arg))
             {
                 auto dirFiles = CollectFilesFromDirectory(arg);
@@ -149,12 +349,26 @@ int main(int argc, const char* argv[])
         }
 
         Archive archive;
+        archive.EnableCompression(compress);
+        archive.EnableDeduplication(dedup);
+        archive.EnableChunking(chunk);
+        archive.EnableDictionary(dictionary);
+        archive.EnableSolidGroups(solid);
+        for (const auto& group : solidGroups)
+            archive.AddSolidGroup(group);
+        archive.SetBlockSize(blockSize);
+        archive.SetDecodeBudget(decodeBudget);
+        for (const auto& filter : filters)
+            ApplyFilterOption(archive, filter);
         if (!archive.Create(filePaths))
         {
             std::cerr << "[ERROR] Failed to create archive\n";
             return 1;
         }
 
+        if (compress || dedup || chunk || solid || !solidGroups.empty())
+            archive.PrintPackSummary();
+
         remove(archivePath.c_str());
         rename("temp_archive.asset", archivePath.c_str());
 
@@ -179,17 +393,62 @@ int main(int argc, const char* argv[])
     {
         if (argc < 4)
         {
-            std::cerr << "[ERROR] Usage: add <archive> <file1> [file2] ...\n";
+            std::cerr << "[ERROR] Usage: add <archive> [--compress] [--block-size <KB>] [--decode-budget <MB/s>] [--filter <.ext|file>=<filter>:<width>] [--dedup] [--chunk] <file1> [file2] ...\n";
             return 1;
         }
 
         std::string archivePath = argv[2];
         std::vector<std::string> filePaths;
+        bool compress = false;
+        bool dedup = false;
+        bool chunk = false;
+        UINT32 blockSize = Codec::DEFAULT_BLOCK_SIZE;
+        UINT32 decodeBudget = 0;
+        std::vector<std::string> filters;
 
         for (int i = 3; i < argc; i++)
-            filePaths.push_back(argv[i]);
+        {
+            std::string arg = argv[i];
+            if (arg == "--compress")
+                compress = true;
+            else if (arg == "--dedup")
+                dedup = true;
+            else if (arg == "--chunk")
+                chunk = true;
+            else if (arg == "--block-size" && i + 1 < argc)
+            {
+                UINT64 kilobytes = 0;
+                if (!ParseNumberOption(argv[++i], 0, UINT32_MAX / 1024, kilobytes))
+                {
+                    std::cerr << "[ERROR] Usage: --block-size <KB> (0 to " << UINT32_MAX / 1024 << ")\n";
+                    return 1;
+                }
+                blockSize = static_cast<UINT32>(kilobytes * 1024);
+            }
+            else if (arg == "--decode-budget" && i + 1 < argc)
+            {
+                UINT64 budget = 0;
+                if (!ParseNumberOption(argv[++i], 0, UINT32_MAX, budget))
+                {
+                    std::cerr << "[ERROR] Usage: --decode-budget <MB/s> (0 to " << UINT32_MAX << ")\n";
+                    return 1;
+                }
+                decodeBudget = static_cast<UINT32>(budget);
+            }
+            else if (arg == "--filter" && i + 1 < argc)
+                filters.push_back(argv[++i]);
+            else
+                filePaths.push_back(arg);
+        }
 
         Archive archive;
+        archive.EnableCompression(compress);
+        archive.EnableDeduplication(dedup);
+        archive.EnableChunking(chunk);
+        archive.SetBlockSize(blockSize);
+        archive.SetDecodeBudget(decodeBudget);
+        for (const auto& filter : filters)
+            ApplyFilterOption(archive, filter);
         if (!archive.Open(archivePath, Mode::WRITE))
         {
             std::cerr << "[ERROR] Failed to open archive: " << archivePath << "\n";
@@ -207,6 +466,8 @@ int main(int argc, const char* argv[])
             std::cout << "[OK] Added: " << file << "\n";
         }
 
+        if (compress || dedup || chunk)
+            archive.PrintPackSummary();
         archive.Close();
         std::cout << "[OK] All files added\n";
         std::cout.flush();
@@ -457,6 +718,107 @@ int main(int argc, const char* argv[])
         return 0;
     }
 
+    // SERVE
+    if (command == "serve")
+    {
+        if (argc < 4)
+        {
+            std::cerr << "[ERROR] Usage: serve <socket> [options] <archive1> ...\n";
+            return 1;
+        }
+
+        std::string socketPath = argv[2];
+        AssetServer server;
+        UINT64 cacheBytes = 64ull * 1024 * 1024;
+        std::vector<std::string> archivePaths;
+
+        for (int i = 3; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--workers" && i + 1 < argc)
+                server.SetWorkerCount(static_cast<UINT32>(std::stoul(argv[++i])));
+            else if (arg == "--cache" && i + 1 < argc)
+                cacheBytes = std::stoull(argv[++i]) * 1024 * 1024;
+            else
+                archivePaths.push_back(arg);
+        }
+
+        BlockCache::Get().SetBudget(cacheBytes);
+        server.SetEntryCacheBudget(cacheBytes);
+
+        for (const auto& archivePath : archivePaths)
+        {
+            if (!server.Mount(archivePath))
+                return 1;
+        }
+
+        if (!server.Start(socketPath))
+            return 1;
+
+        std::cout << "[OK] Serving " << archivePaths.size() << " archive(s) on " << socketPath << "\n";
+
+        std::string line;
+        while (std::getline(std::cin, line) && line != "quit")
+        {
+            if (line != "stats")
+                continue;
+
+            ServerStats stats = server.GetStats();
+            BlockCacheStats blocks = BlockCache::Get().GetStats();
+            std::cout << "Connections: " << stats.connections << ", requests: " << stats.requests
+                      << " (" << stats.found << " found, " << stats.notFound << " not found, " << stats.errors << " errors)\n";
+            std::cout << "Served: " << stats.bytesServed << " bytes, " << stats.sharedPayloads << " shared payloads\n";
+            std::cout << "Block cache: " << blocks.hits << " hits, " << blocks.misses << " misses, " << blocks.bytes << " bytes\n";
+        }
+
+        server.Stop();
+        std::cout << "[OK] Server stopped\n";
+        std::cout.flush();
+        return 0;
+    }
+
+    // GET
+    if (command == "get")
+    {
+        if (argc < 5)
+        {
+            std::cerr << "[ERROR] Usage: get <socket> <filename> <output>\n";
+            return 1;
+        }
+
+        std::string socketPath = argv[2];
+        std::string filename = argv[3];
+        std::string outputPath = argv[4];
+
+        AssetClient client;
+        if (!client.Connect(socketPath))
+        {
+            std::cerr << "[ERROR] Failed to connect to server: " << socketPath << "\n";
+            return 1;
+        }
+
+        // Written from the server's mapping: no copy on this side
+        SharedBlob data;
+        if (!client.GetByName(filename, data))
+        {
+            std::cerr << "[ERROR] Failed to get file: " << filename
+                      << (client.GetLastStatus() == SERVER_NOT_FOUND ? " (not found)" : "") << "\n";
+            return 1;
+        }
+
+        File outputFile;
+        if (!outputFile.OpenWrite(outputPath) || outputFile.Write(data.GetData(), data.GetSize(), 1) != data.GetSize())
+        {
+            std::cerr << "[ERROR] Failed to write output file: " << outputPath << "\n";
+            return 1;
+        }
+        outputFile.Close();
+
+        std::cout << "[OK] Fetched: " << filename << " -> " << outputPath << " (" << data.GetSize() << " bytes)\n";
+        std::cout.flush();
+        return 0;
+    }
+
     // Unknown command
     std::cerr << "[ERROR] Unknown command: " << command << "\n\n";
     std::cerr << "Try 'AssetEngine.exe -help' for more information.\n\n";
@@ -1275,52 +1637,2828 @@ void Test15_Archive_Encryption()
     PrintSuccess("Test 15 PASSED\n");
 }
 
-// ============================================================================
-// MAIN - TEST RUNNER
-// ============================================================================
+void Test16_Archive_Compression()
+{
+    PrintTitle("Test 16: Archive Compression (LZ)");
 
-int main(int argc, char* argv[])
+    std::string text;
+    for (int i = 0; i < 200; i++)
+        text += "{ \"material\": \"stone_" + std::to_string(i % 7) + "\", \"roughness\": 0.5 }\n";
+
+    File f1, f2;
+    f1.OpenWrite("compress_text.json");
+    f1.Write((const UINT8*)text.c_str(), text.size(), 1);
+    f1.Close();
+
+    UINT8 noise[4096];
+    GenerateRandomData(noise, sizeof(noise));
+    f2.OpenWrite("compress_noise.bin");
+    f2.Write(noise, sizeof(noise), 1);
+    f2.Close();
+
+    std::vector<std::string> files = { "compress_text.json", "compress_noise.bin" };
+    Archive arc;
+    arc.EnableCompression(true);
+
+    if (!arc.Create(files))
+    {
+        PrintError("Failed to create compressed archive");
+        return;
+    }
+
+    remove("test_compressed.asset");
+    rename("temp_archive.asset", "test_compressed.asset");
+
+    arc.Open("test_compressed.asset", Mode::READ);
+    arc.List();
+
+    if (!arc.Validate())
+    {
+        PrintError("Validation failed");
+        arc.Close();
+        return;
+    }
+
+    if (!arc.ExtractByName("compress_text.json", "decompressed_text.json") ||
+        !arc.ExtractByName("compress_noise.bin", "decompressed_noise.bin"))
+    {
+        PrintError("Failed to extract compressed files");
+        arc.Close();
+        return;
+    }
+    arc.Close();
+
+    File check;
+    check.OpenRead("decompressed_text.json");
+    Blob extracted;
+    extracted.Resize(check.GetSize());
+    check.Read(extracted.GetData(), extracted.GetSize(), 1);
+    check.Close();
+
+    if (extracted.GetSize() == text.size() && CompareData(extracted.GetData(), (const UINT8*)text.c_str(), text.size()))
+        PrintSuccess("Text round-trip: OK");
+    else
+        PrintError("Text round-trip: FAILED");
+
+    // A forged originalSize must not size the output buffer (single stream and blocks)
+    bool forgedOk = true;
+    for (UINT32 blockSize : { 0u, 4096u })
+    {
+        Blob payload, unpacked;
+        forgedOk = forgedOk && Codec::Pack((const UINT8*)text.c_str(), text.size(), payload, blockSize);
+        for (UINT64 forgedSize : { 1ull << 50, (UINT64)text.size() * 2 })
+        {
+            Stream::Header header;
+            memcpy(&header, payload.GetData(), sizeof(header));
+            header.originalSize = forgedSize;
+            memcpy(payload.GetData(), &header, sizeof(header));
+            forgedOk = forgedOk && !Codec::Unpack(payload.GetData(), payload.GetSize(), unpacked);
+        }
+    }
+
+    // The bound leaves room for the best ratio either codec can reach
+    std::vector<UINT8> zeros(4 * 1024 * 1024, 0);
+    for (UINT8 codec : { (UINT8)CODEC_LZ, (UINT8)CODEC_LZH })
+    {
+        for (UINT32 blockSize : { 0u, Codec::DEFAULT_BLOCK_SIZE })
+        {
+            Blob payload, unpacked;
+            forgedOk = forgedOk && Codec::Pack(zeros.data(), zeros.size(), payload, blockSize, nullptr, codec) &&
+                Codec::Unpack(payload.GetData(), payload.GetSize(), unpacked, nullptr, codec) &&
+                unpacked.GetSize() == zeros.size() && CompareData(unpacked.GetData(), zeros.data(), zeros.size());
+        }
+    }
+
+    if (forgedOk)
+        PrintSuccess("Forged original size rejected: OK");
+    else
+        PrintError("Forged original size rejected: FAILED");
+
+    PrintSuccess("Test 16 PASSED\n");
+}
+
+void Test17_Archive_Blocks_RangedRead()
 {
-    std::cout << "========================================\n";
-    std::cout << "Asset Engine - Complete Test Suite\n";
-    std::cout << "========================================\n\n";
+    PrintTitle("Test 17: Archive Compressed Blocks (Ranged Read)");
 
-    // Run ALL tests
-    try
+    Blob source;
+    source.Resize(300 * 1024);
+    for (UINT64 i = 0; i < source.GetSize(); i++)
+        source.GetData()[i] = (i % 1000 < 700) ? (UINT8)("block data "[i % 11]) : (UINT8)(rand() % 256);
+
+    File f;
+    f.OpenWrite("blocks_source.bin");
+    f.Write(source.GetData(), source.GetSize(), 1);
+    f.Close();
+
+    std::vector<std::string> files = { "blocks_source.bin" };
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.SetBlockSize(64 * 1024);
+
+    if (!arc.Create(files))
     {
-        // Memory Tests
-        Test1_Memory_Basic_Text();
-        Test1_Memory_Basic_Binary();
-        Test2_Memory_ExternalBlob_Text();
-        Test2_Memory_ExternalBlob_Binary();
-        Test3_Memory_To_File_Text();
-        Test3_Memory_To_File_Binary();
+        PrintError("Failed to create block-compressed archive");
+        return;
+    }
 
-        // Archive Tests
-        Test4_Archive_Create_Empty();
-        Test5_Archive_Create_Files();
-        Test6_Archive_Add_Files();
-        Test7_Archive_Add_Duplicates();
-        Test8_Archive_Remove_File();
-        Test9_Archive_Rename_File();
-        Test10_Archive_Compact();
-        Test11_Archive_RemoveAll();
-        Test12_Archive_Validate();
-        Test13_Archive_Extract();
-        Test14_Archive_ExtractAll();
-        Test15_Archive_Encryption();
+    remove("test_blocks.asset");
+    rename("temp_archive.asset", "test_blocks.asset");
 
-        std::cout << "\n========================================\n";
-        std::cout << "ALL TESTS PASSED!\n";
-        std::cout << "========================================\n";
+    arc.Open("test_blocks.asset", Mode::READ);
+    arc.List();
+
+    const UINT64 ranges[][2] = { { 0, 100 }, { 65530, 20 }, { 100000, 150000 }, { 300 * 1024 - 10, 100 } };
+    bool allMatch = true;
+
+    for (const auto& range : ranges)
+    {
+        Blob part;
+        if (!arc.ReadRangeByName("blocks_source.bin", range[0], range[1], part))
+        {
+            allMatch = false;
+            continue;
+        }
+
+        UINT64 expected = (range[0] + range[1] > source.GetSize()) ? source.GetSize() - range[0] : range[1];
+        std::cout << "  Range [" << range[0] << ", +" << range[1] << "] -> " << part.GetSize() << " bytes\n";
+
+        if (part.GetSize() != expected || !CompareData(part.GetData(), source.GetData() + range[0], expected))
+            allMatch = false;
     }
-    catch (const std::exception& e)
+
+    if (allMatch)
+        PrintSuccess("Ranged reads: OK");
+    else
+        PrintError("Ranged reads: FAILED");
+
+    if (arc.Validate())
+        PrintSuccess("Full extract path: OK");
+
+    arc.Close();
+
+    // A forged block table (one huge block for a 1-byte entry) must not size the block buffers
+    std::vector<UINT8> bytes(std::filesystem::file_size("test_blocks.asset"));
+    FILE* handle = nullptr;
+    fopen_s(&handle, "test_blocks.asset", "r+b");
+    bool forgedOk = handle != nullptr && fread(bytes.data(), 1, bytes.size(), handle) == bytes.size();
+    const std::string name = "blocks_source.bin";
+    UINT64 headerStart = 0;
+    for (auto found = bytes.begin(); forgedOk && headerStart == 0; ++found)
     {
-        std::cerr << "\n[EXCEPTION] " << e.what() << "\n";
-        return 1;
+        found = std::search(found, bytes.end(), name.begin(), name.end());
+        if (found == bytes.end())
+            break;
+        UINT64 start = (found - bytes.begin()) - offsetof(FileHeader, filename);
+        if ((UINT64)(found - bytes.begin()) >= offsetof(FileHeader, filename) && memcmp(&bytes[start], "FILE", 4) == 0)
+            headerStart = start;
+    }
+    forgedOk = forgedOk && headerStart != 0;
+    if (forgedOk)
+    {
+        UINT64 streamStart = headerStart + sizeof(FileHeader);
+        UINT64 originalSize = 1;
+        BlockTableHeader table = { 0xFFFFFFFF, 1 };
+        fseek(handle, static_cast<long>(streamStart + offsetof(Stream::Header, originalSize)), SEEK_SET);
+        fwrite(&originalSize, sizeof(originalSize), 1, handle);
+        fseek(handle, static_cast<long>(streamStart + sizeof(Stream::Header)), SEEK_SET);
+        fwrite(&table, sizeof(table), 1, handle);
     }
+    if (handle != nullptr)
+        fclose(handle);
 
-    return 0;
+    Archive forged;
+    Blob forgedPart;
+    forgedOk = forgedOk && forged.Open("test_blocks.asset", Mode::READ) &&
+        !forged.ReadRangeByName("blocks_source.bin", 0, 1, forgedPart);
+    forged.Close();
+
+    if (forgedOk)
+        PrintSuccess("Forged block table rejected: OK");
+    else
+        PrintError("Forged block table rejected: FAILED");
+
+    PrintSuccess("Test 17 PASSED\n");
 }
 
-#endif // MODE_TESTS
+void Test18_Archive_Dictionary()
+{
+    PrintTitle("Test 18: Archive Trained Dictionary (Small Entries)");
+
+    std::vector<std::string> files;
+    for (int i = 0; i < 40; i++)
+    {
+        std::string name = "dict_material_" + std::to_string(i) + ".json";
+        std::string json = "{\n  \"material\": \"mat_" + std::to_string(i * 37) + "\",\n"
+            "  \"shader\": \"standard_lit\",\n  \"albedo\": [" + std::to_string(i % 7) + ", 0.5, 0.25, 1.0],\n"
+            "  \"roughness\": 0." + std::to_string(i % 10) + ",\n  \"metallic\": 0.0,\n"
+            "  \"textures\": { \"diffuse\": \"tex_" + std::to_string(i) + "_d.png\", \"normal\": \"tex_" + std::to_string(i) + "_n.png\" },\n"
+            "  \"flags\": [\"cast_shadows\", \"receive_shadows\", \"double_sided\"]\n}\n";
+
+        File f;
+        f.OpenWrite(name);
+        f.Write((const UINT8*)json.c_str(), json.size(), 1);
+        f.Close();
+        files.push_back(name);
+    }
+
+    Archive plain;
+    plain.EnableCompression(true);
+    plain.Create(files);
+    remove("test_nodict.asset");
+    rename("temp_archive.asset", "test_nodict.asset");
+
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.EnableDictionary(true);
+    if (!arc.Create(files))
+    {
+        PrintError("Failed to create dictionary archive");
+        return;
+    }
+    remove("test_dict.asset");
+    rename("temp_archive.asset", "test_dict.asset");
+
+    std::cout << "  Without dictionary: " << std::filesystem::file_size("test_nodict.asset") << " bytes\n";
+    std::cout << "  With dictionary:    " << std::filesystem::file_size("test_dict.asset") << " bytes\n";
+
+    arc.Open("test_dict.asset", Mode::READ);
+    if (arc.HasDictionary())
+        PrintSuccess("Dictionary loaded at Open: OK");
+    else
+        PrintError("Dictionary loaded at Open: FAILED");
+
+    if (arc.Validate())
+        PrintSuccess("Validate: OK");
+    else
+        PrintError("Validate: FAILED");
+    arc.Close();
+
+    // Compact rewrites the archive: the dictionary must follow
+    arc.Open("test_dict.asset", Mode::WRITE);
+    arc.RemoveFileByName("dict_material_3.json");
+    arc.Compact();
+    arc.Close();
+
+    arc.Open("test_dict.asset", Mode::READ);
+    if (arc.HasDictionary() && arc.Validate() && arc.ExtractByName("dict_material_7.json", "dict_extracted.json"))
+        PrintSuccess("Dictionary kept by Compact: OK");
+    else
+        PrintError("Dictionary kept by Compact: FAILED");
+    arc.Close();
+
+    PrintSuccess("Test 18 PASSED\n");
+}
+
+void Test19_Archive_Solid_Groups()
+{
+    PrintTitle("Test 19: Archive Solid Groups");
+
+    _mkdir("solid_dir");
+
+    std::vector<std::string> files;
+    for (int i = 0; i < 20; i++)
+    {
+        std::string path = "solid_dir/level_chunk_" + std::to_string(i) + ".txt";
+        std::string content = "level chunk " + std::to_string(i) + " spawn points, triggers and nav data\n";
+        for (int r = 0; r < i; r++)
+            content += "entity_" + std::to_string(r) + " position 0 0 0\n";
+
+        File f;
+        f.OpenWrite(path);
+        f.Write((const UINT8*)content.c_str(), content.size(), 1);
+        f.Close();
+        files.push_back(path);
+    }
+
+    std::string manifest = "manifest for the explicit group\n";
+    File m;
+    m.OpenWrite("solid_manifest.txt");
+    m.Write((const UINT8*)manifest.c_str(), manifest.size(), 1);
+    m.Close();
+    files.push_back("solid_manifest.txt");
+
+    Archive arc;
+    arc.EnableSolidGroups(true);
+    arc.AddSolidGroup({ "solid_manifest.txt", "solid_dir/level_chunk_19.txt" });
+    if (!arc.Create(files))
+    {
+        PrintError("Failed to create solid archive");
+        return;
+    }
+    remove("test_solid.asset");
+    rename("temp_archive.asset", "test_solid.asset");
+
+    arc.Open("test_solid.asset", Mode::READ);
+    arc.List();
+
+    if (arc.Validate())
+        PrintSuccess("Validate (sequential, cached groups): OK");
+    else
+        PrintError("Validate (sequential, cached groups): FAILED");
+
+    Blob part;
+    if (arc.ReadRangeByName("level_chunk_5.txt", 6, 7, part) && part.GetSize() == 7 &&
+        CompareData(part.GetData(), (const UINT8*)"chunk 5", 7))
+        PrintSuccess("Ranged read in group: OK");
+    else
+        PrintError("Ranged read in group: FAILED");
+    arc.Close();
+
+    // Compact relocates the groups; adding files past the map space rebuilds the archive
+    arc.Open("test_solid.asset", Mode::WRITE);
+    arc.RemoveFileByName("level_chunk_3.txt");
+    arc.Compact();
+    arc.AddFile("solid_manifest.txt");
+    arc.Close();
+
+    arc.Open("test_solid.asset", Mode::READ);
+    if (arc.Validate() && arc.ExtractByName("level_chunk_19.txt", "solid_extracted.txt"))
+        PrintSuccess("Groups kept by Compact / rebuild: OK");
+    else
+        PrintError("Groups kept by Compact / rebuild: FAILED");
+    arc.Close();
+
+    PrintSuccess("Test 19 PASSED\n");
+}
+
+void Test20_Archive_Adaptive_Codec()
+{
+    PrintTitle("Test 20: Archive Adaptive Codec Selection");
+
+    std::string text;
+    for (int i = 0; i < 300; i++)
+        text += "[entity_" + std::to_string(i) + "] mesh=props/crate_" + std::to_string(i % 11) + ".mesh scale=1.0\n";
+
+    Blob noise;
+    noise.Resize(64 * 1024);
+    GenerateRandomData(noise.GetData(), noise.GetSize());
+
+    // Text content under an image extension: the name alone must keep it raw
+    File f1, f2, f3;
+    f1.OpenWrite("adaptive_scene.txt");
+    f1.Write((const UINT8*)text.c_str(), text.size(), 1);
+    f1.Close();
+    f2.OpenWrite("adaptive_noise.bin");
+    f2.Write(noise.GetData(), noise.GetSize(), 1);
+    f2.Close();
+    f3.OpenWrite("adaptive_icon.PNG");
+    f3.Write((const UINT8*)text.c_str(), text.size(), 1);
+    f3.Close();
+
+    std::vector<std::string> files = { "adaptive_scene.txt", "adaptive_noise.bin", "adaptive_icon.PNG" };
+
+    Archive arc;
+    arc.EnableCompression(true);
+    if (!arc.Create(files))
+    {
+        PrintError("Failed to create adaptive archive");
+        return;
+    }
+    arc.PrintPackSummary();
+
+    const PackSummary& summary = arc.GetPackSummary();
+    if (summary.counts[PACK_HIGH_RATIO] == 1 && summary.counts[PACK_STORED_ENTROPY] == 1 &&
+        summary.counts[PACK_STORED_PRECOMPRESSED] == 1 && summary.storedBytes < summary.rawBytes)
+        PrintSuccess("Text -> lzh, noise and .PNG stored: OK");
+    else
+        PrintError("Text -> lzh, noise and .PNG stored: FAILED");
+
+    remove("test_adaptive.asset");
+    rename("temp_archive.asset", "test_adaptive.asset");
+
+    arc.Open("test_adaptive.asset", Mode::READ);
+    arc.List();
+    if (arc.Validate())
+        PrintSuccess("Validate (mixed codecs): OK");
+    else
+        PrintError("Validate (mixed codecs): FAILED");
+    arc.Close();
+
+    // A budget above the high-ratio codec's decode speed falls back to the fast one
+    Archive fast;
+    fast.EnableCompression(true);
+    fast.SetDecodeBudget(Codec::GetDecodeSpeed(CODEC_LZ));
+    fast.Create({ "adaptive_scene.txt" });
+
+    if (fast.GetPackSummary().counts[PACK_FAST] == 1)
+        PrintSuccess("Decode budget -> lz: OK");
+    else
+        PrintError("Decode budget -> lz: FAILED");
+
+    remove("test_adaptive_fast.asset");
+    rename("temp_archive.asset", "test_adaptive_fast.asset");
+
+    fast.Open("test_adaptive_fast.asset", Mode::READ);
+    if (fast.Validate())
+        PrintSuccess("Validate (budgeted): OK");
+    else
+        PrintError("Validate (budgeted): FAILED");
+    fast.Close();
+
+    PrintSuccess("Test 20 PASSED\n");
+}
+
+void Test21_Archive_Filters()
+{
+    PrintTitle("Test 21: Archive Pre-filters (Shuffle / Delta)");
+
+    // Grid mesh: position, normal, uv as floats (32-byte vertices)
+    std::vector<float> vertices;
+    for (int z = 0; z < 64; z++)
+    {
+        for (int x = 0; x < 64; x++)
+        {
+            float height = std::sin(x * 0.1f) * std::cos(z * 0.1f) * 4.0f;
+            float vertex[8] = { x * 0.5f, height, z * 0.5f, 0.0f, 1.0f, 0.0f, x / 63.0f, z / 63.0f };
+            vertices.insert(vertices.end(), vertex, vertex + 8);
+        }
+    }
+    UINT64 size = vertices.size() * sizeof(float);
+
+    File f;
+    f.OpenWrite("filter_terrain.vb");
+    f.Write((const UINT8*)vertices.data(), size, 1);
+    f.Close();
+
+    Archive plain;
+    plain.EnableCompression(true);
+    plain.SetBlockSize(16 * 1024);
+    plain.Create({ "filter_terrain.vb" });
+    UINT64 plainSize = plain.GetPackSummary().storedBytes;
+    remove("temp_archive.asset");
+
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.SetBlockSize(16 * 1024);
+    // Width = vertex stride: each plane holds one byte of one attribute, vertex after vertex
+    arc.SetFilter("VB", { FILTER_SHUFFLE | FILTER_DELTA, 32 });
+    if (!arc.Create({ "filter_terrain.vb" }))
+    {
+        PrintError("Failed to create filtered archive");
+        return;
+    }
+    UINT64 filteredSize = arc.GetPackSummary().storedBytes;
+    std::cout << "Vertex buffer: " << size << " bytes, " << plainSize << " compressed, "
+              << filteredSize << " shuffled + delta\n";
+
+    if (filteredSize < plainSize)
+        PrintSuccess("Filter improves ratio: OK");
+    else
+        PrintError("Filter improves ratio: FAILED");
+
+    remove("test_filtered.asset");
+    rename("temp_archive.asset", "test_filtered.asset");
+
+    arc.Open("test_filtered.asset", Mode::READ);
+    arc.List();
+
+    if (arc.Validate())
+        PrintSuccess("Validate (filter reverted): OK");
+    else
+        PrintError("Validate (filter reverted): FAILED");
+
+    // Straddles a block boundary: each block is reverted on its own
+    Blob part;
+    UINT64 offset = 16 * 1024 - 10;
+    if (arc.ReadRangeByName("filter_terrain.vb", offset, 100, part) && part.GetSize() == 100 &&
+        CompareData(part.GetData(), (const UINT8*)vertices.data() + offset, 100))
+        PrintSuccess("Ranged read across filtered blocks: OK");
+    else
+        PrintError("Ranged read across filtered blocks: FAILED");
+    arc.Close();
+
+    PrintSuccess("Test 21 PASSED\n");
+}
+
+void Test22_Archive_Deduplication()
+{
+    PrintTitle("Test 22: Archive Content Deduplication");
+
+    std::string shader;
+    for (int i = 0; i < 400; i++)
+        shader += "float4 sample_" + std::to_string(i) + " = tex2D(s" + std::to_string(i % 7) + ", uv * " + std::to_string(i) + ".0);\n";
+    std::string other = shader;
+    other[100] = '#';
+
+    // Same content twice (a copy in another folder), plus a same-size different file
+    _mkdir("dedup_copy");
+    File f1, f2, f3;
+    f1.OpenWrite("dedup_shader.hlsl");
+    f1.Write((const UINT8*)shader.c_str(), shader.size(), 1);
+    f1.Close();
+    f2.OpenWrite("dedup_copy/dedup_shader_copy.hlsl");
+    f2.Write((const UINT8*)shader.c_str(), shader.size(), 1);
+    f2.Close();
+    f3.OpenWrite("dedup_variant.hlsl");
+    f3.Write((const UINT8*)other.c_str(), other.size(), 1);
+    f3.Close();
+
+    std::vector<std::string> files = { "dedup_shader.hlsl", "dedup_copy/dedup_shader_copy.hlsl", "dedup_variant.hlsl" };
+
+    Archive plain;
+    plain.EnableCompression(true);
+    plain.Create(files);
+    UINT64 plainSize = std::filesystem::file_size("temp_archive.asset");
+    remove("temp_archive.asset");
+
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.EnableDeduplication(true);
+    if (!arc.Create(files))
+    {
+        PrintError("Failed to create deduplicated archive");
+        return;
+    }
+    arc.PrintPackSummary();
+    remove("test_dedup.asset");
+    rename("temp_archive.asset", "test_dedup.asset");
+
+    UINT64 dedupSize = std::filesystem::file_size("test_dedup.asset");
+    std::cout << "Archive: " << plainSize << " bytes, " << dedupSize << " deduplicated\n";
+
+    // The extent counts the SharedEntry records written for it
+    std::vector<UINT8> image(dedupSize);
+    File imageFile;
+    SharedExtentHeader extent = {};
+    bool imageRead = imageFile.OpenRead("test_dedup.asset") && imageFile.Read(image.data(), image.size(), 1) == image.size();
+    imageFile.Close();
+    const char magic[] = { 'S', 'H', 'R', 'D' };
+    auto extentStart = std::search(image.begin(), image.end(), magic, magic + 4);
+    if (imageRead && (UINT64)(image.end() - extentStart) >= sizeof(SharedExtentHeader))
+        memcpy(&extent, &*extentStart, sizeof(SharedExtentHeader));
+
+    if (arc.GetPackSummary().counts[PACK_DEDUPLICATED] == 1 && dedupSize < plainSize && extent.refCount == 2)
+        PrintSuccess("Identical files stored once: OK");
+    else
+        PrintError("Identical files stored once: FAILED");
+
+    // Adding the variant again turns its plain entry into a shared one
+    arc.Open("test_dedup.asset", Mode::WRITE);
+    arc.AddFile("dedup_variant.hlsl");
+    arc.AddFile("dedup_shader.hlsl");
+    arc.Close();
+
+    arc.Open("test_dedup.asset", Mode::READ);
+    arc.List();
+
+    Blob part;
+    if (arc.Validate() && arc.ReadRangeByName("dedup_shader_copy.hlsl", 0, 16, part) &&
+        part.GetSize() == 16 && CompareData(part.GetData(), (const UINT8*)shader.c_str(), 16))
+        PrintSuccess("Validate / ranged read (shared): OK");
+    else
+        PrintError("Validate / ranged read (shared): FAILED");
+    arc.Close();
+
+    // The extent outlives the removed entry and survives Compact
+    arc.Open("test_dedup.asset", Mode::WRITE);
+    arc.RemoveFileByName("dedup_shader.hlsl");
+    arc.RemoveFileByName("dedup_variant.hlsl");
+    arc.Compact();
+    arc.Close();
+
+    arc.Open("test_dedup.asset", Mode::READ);
+    Blob extracted;
+    bool extractedOK = arc.ExtractByName("dedup_shader_copy.hlsl", "dedup_extracted.hlsl") &&
+        arc.ReadRangeByName("dedup_shader_copy.hlsl", 0, shader.size(), extracted) &&
+        extracted.GetSize() == shader.size() && CompareData(extracted.GetData(), (const UINT8*)shader.c_str(), shader.size());
+    if (arc.Validate() && extractedOK)
+        PrintSuccess("Remove + Compact keep shared data: OK");
+    else
+        PrintError("Remove + Compact keep shared data: FAILED");
+    arc.Close();
+
+    PrintSuccess("Test 22 PASSED\n");
+}
+
+void Test23_Archive_Chunking()
+{
+    PrintTitle("Test 23: Archive Content-Defined Chunking");
+
+    // Two builds of a level: the second edits a few bytes and inserts a line in the middle
+    std::string build1;
+    UINT32 seed = 12345;
+    for (int i = 0; build1.size() < 3 * 1024 * 1024; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        build1 += "node " + std::to_string(i) + " pos " + std::to_string(seed % 10007) + " " +
+                  std::to_string((seed >> 8) % 4099) + " mat m" + std::to_string((seed >> 16) % 64) + "\n";
+    }
+    std::string build2 = build1;
+    build2.replace(700000, 5, "EDIT!");
+    build2.insert(2000000, "node inserted pos 0 0 mat m0\n");
+
+    File f1, f2;
+    f1.OpenWrite("chunk_level.dat");
+    f1.Write((const UINT8*)build1.c_str(), build1.size(), 1);
+    f1.Close();
+    f2.OpenWrite("chunk_level_v2.dat");
+    f2.Write((const UINT8*)build2.c_str(), build2.size(), 1);
+    f2.Close();
+
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.EnableChunking(true);
+    if (!arc.Create({ "chunk_level.dat" }))
+    {
+        PrintError("Failed to create chunked archive");
+        return;
+    }
+    remove("test_chunked.asset");
+    rename("temp_archive.asset", "test_chunked.asset");
+    UINT64 size1 = std::filesystem::file_size("test_chunked.asset");
+
+    arc.Open("test_chunked.asset", Mode::WRITE);
+    arc.AddFile("chunk_level_v2.dat");
+    arc.PrintPackSummary();
+    const PackSummary& summary = arc.GetPackSummary();
+    UINT32 newChunks = summary.chunks - summary.reusedChunks;
+    arc.Close();
+
+    UINT64 size2 = std::filesystem::file_size("test_chunked.asset");
+    std::cout << "Build 1: " << size1 << " bytes, with build 2: " << size2 << " bytes ("
+              << newChunks << " new chunk(s) of " << summary.chunks << ")\n";
+
+    if (newChunks <= 3 && size2 - size1 < size1 / 4)
+        PrintSuccess("Unchanged chunks shared between builds: OK");
+    else
+        PrintError("Unchanged chunks shared between builds: FAILED");
+
+    arc.Open("test_chunked.asset", Mode::READ);
+    arc.List();
+
+    Blob part;
+    UINT64 offset = 2000000 - 50;
+    if (arc.Validate() && arc.ReadRangeByName("chunk_level_v2.dat", offset, 100, part) && part.GetSize() == 100 &&
+        CompareData(part.GetData(), (const UINT8*)build2.c_str() + offset, 100))
+        PrintSuccess("Validate / ranged read (chunked): OK");
+    else
+        PrintError("Validate / ranged read (chunked): FAILED");
+    arc.Close();
+
+    // Removing build 1 keeps the chunks build 2 still uses
+    arc.Open("test_chunked.asset", Mode::WRITE);
+    arc.RemoveFileByName("chunk_level.dat");
+    arc.Compact();
+    arc.Close();
+
+    arc.Open("test_chunked.asset", Mode::READ);
+    Blob extracted;
+    if (arc.Validate() && arc.ReadRangeByName("chunk_level_v2.dat", 0, build2.size(), extracted) &&
+        extracted.GetSize() == build2.size() && CompareData(extracted.GetData(), (const UINT8*)build2.c_str(), build2.size()))
+        PrintSuccess("Remove + Compact keep shared chunks: OK");
+    else
+        PrintError("Remove + Compact keep shared chunks: FAILED");
+    arc.Close();
+
+    PrintSuccess("Test 23 PASSED\n");
+}
+
+void Test24_Archive_Entry_Cache()
+{
+    PrintTitle("Test 24: Archive Decoded Entry Cache");
+
+    const char* names[3] = { "cache_font.txt", "cache_atlas.txt", "cache_level.txt" };
+    const UINT64 sizes[3] = { 40 * 1024, 60 * 1024, 200 * 1024 };
+    std::string contents[3];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int line = 0; contents[i].size() < sizes[i]; line++)
+            contents[i] += std::string(names[i]) + " line " + std::to_string(line * 7919 % 10007) + "\n";
+        contents[i].resize(sizes[i]);
+
+        File f;
+        f.OpenWrite(names[i]);
+        f.Write((const UINT8*)contents[i].c_str(), contents[i].size(), 1);
+        f.Close();
+    }
+
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.Create({ names[0], names[1], names[2] });
+    remove("test_cache.asset");
+    rename("temp_archive.asset", "test_cache.asset");
+
+    arc.Open("test_cache.asset", Mode::READ);
+    arc.SetEntryCacheBudget(128 * 1024);
+
+    // atlas twice, font once, level is larger than the whole budget
+    Blob data;
+    bool allRead = arc.ReadFileByName(names[1], data) && arc.ReadFileByName(names[1], data) &&
+        arc.ReadFileByName(names[0], data) && arc.ReadFileByName(names[2], data) &&
+        arc.ReadFileByName(names[1], data) &&
+        data.GetSize() == sizes[1] && CompareData(data.GetData(), (const UINT8*)contents[1].c_str(), sizes[1]);
+
+    EntryCacheStats stats = arc.GetEntryCacheStats();
+    std::cout << "Hits: " << stats.hits << ", misses: " << stats.misses << ", evictions: " << stats.evictions
+              << ", " << stats.entries << " entries / " << stats.bytes << " bytes\n";
+
+    if (allRead && stats.hits == 2 && stats.misses == 3 && stats.entries == 2 && stats.bytes == sizes[0] + sizes[1])
+        PrintSuccess("Hits served, oversized entry not cached: OK");
+    else
+        PrintError("Hits served, oversized entry not cached: FAILED");
+
+    // A budget for one of them: the least recently used one goes
+    arc.SetEntryCacheBudget(64 * 1024);
+    arc.ReadFileByName(names[1], data);
+    arc.ReadFileByName(names[0], data);
+    arc.ReadFileByName(names[0], data);
+    stats = arc.GetEntryCacheStats();
+
+    Blob part;
+    bool rangeFromCache = arc.ReadRangeByName(names[0], 100, 50, part) && part.GetSize() == 50 &&
+        CompareData(part.GetData(), (const UINT8*)contents[0].c_str() + 100, 50);
+
+    if (stats.evictions == 1 && stats.hits == 1 && stats.entries == 1 && rangeFromCache &&
+        arc.GetEntryCacheStats().hits == 2)
+        PrintSuccess("LRU eviction within budget: OK");
+    else
+        PrintError("LRU eviction within budget: FAILED");
+
+    // Concurrent readers, hits and misses mixed (readers missing the same entry at once both decode it)
+    arc.SetEntryCacheBudget(512 * 1024);
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++)
+    {
+        readers.emplace_back([&, t]()
+        {
+            Blob local;
+            for (int i = 0; i < 50; i++)
+            {
+                int index = (t + i) % 3;
+                if (!arc.ReadFileByName(names[index], local) || local.GetSize() != sizes[index] ||
+                    !CompareData(local.GetData(), (const UINT8*)contents[index].c_str(), sizes[index]))
+                    mismatches++;
+            }
+        });
+    }
+    for (auto& reader : readers)
+        reader.join();
+
+    stats = arc.GetEntryCacheStats();
+    if (mismatches == 0 && stats.hits + stats.misses == 200 && stats.misses >= 3 && stats.entries == 3)
+        PrintSuccess("Concurrent readers: OK");
+    else
+        PrintError("Concurrent readers: FAILED");
+    arc.Close();
+
+    PrintSuccess("Test 24 PASSED\n");
+}
+
+void Test25_File_Block_Cache()
+{
+    PrintTitle("Test 25: Shared File Block Cache");
+
+    const char* names[3] = { "block_shader.txt", "block_mesh.txt", "block_scene.txt" };
+    const UINT64 sizes[3] = { 3 * 1024, 20 * 1024, 90 * 1024 };
+    std::string contents[3];
+    for (int i = 0; i < 3; i++)
+    {
+        for (int line = 0; contents[i].size() < sizes[i]; line++)
+            contents[i] += std::string(names[i]) + " row " + std::to_string(line * 104729 % 7919) + "\n";
+        contents[i].resize(sizes[i]);
+
+        File f;
+        f.OpenWrite(names[i]);
+        f.Write((const UINT8*)contents[i].c_str(), contents[i].size(), 1);
+        f.Close();
+    }
+
+    // Encrypted, so cached reads also go through the keystream
+    Archive arc;
+    arc.EnableEncryption(true);
+    arc.SetEncryptionKey("BlockCacheKey");
+    arc.Create({ names[0], names[1], names[2] });
+    arc.Close();
+    remove("test_blockcache.asset");
+    rename("temp_archive.asset", "test_blockcache.asset");
+
+    BlockCache::Get().SetBudget(4 * 1024 * 1024);
+
+    Archive first, second;
+    first.Open("test_blockcache.asset", Mode::READ);
+    first.SetEncryptionKey("BlockCacheKey");
+    second.Open("test_blockcache.asset", Mode::READ);
+    second.SetEncryptionKey("BlockCacheKey");
+
+    auto readAll = [&](Archive& archive)
+    {
+        Blob data;
+        for (int i = 0; i < 3; i++)
+        {
+            if (!archive.ReadFileByName(names[i], data) || data.GetSize() != sizes[i] ||
+                !CompareData(data.GetData(), (const UINT8*)contents[i].c_str(), sizes[i]))
+                return false;
+        }
+        return true;
+    };
+
+    bool firstRead = readAll(first);
+    BlockCacheStats afterFirst = BlockCache::Get().GetStats();
+    bool secondRead = readAll(second);
+    BlockCacheStats afterSecond = BlockCache::Get().GetStats();
+
+    std::cout << "First archive: " << afterFirst.misses << " misses, " << afterFirst.hits << " hits\n";
+    std::cout << "Second archive: " << afterSecond.hits - afterFirst.hits << " hits, "
+              << afterSecond.misses - afterFirst.misses << " misses, " << afterSecond.blocks << " blocks / "
+              << afterSecond.bytes << " bytes cached\n";
+
+    if (firstRead && secondRead && afterFirst.misses > 0 && afterSecond.misses == afterFirst.misses &&
+        afterSecond.hits > afterFirst.hits)
+        PrintSuccess("Second archive served from the shared cache: OK");
+    else
+        PrintError("Second archive served from the shared cache: FAILED");
+    first.Close();
+    second.Close();
+
+    // Writing the archive drops its blocks
+    Archive writer;
+    writer.Open("test_blockcache.asset", Mode::WRITE);
+    writer.RenameFileByName(names[0], "block_renamed.txt");
+    writer.Close();
+    bool dropped = BlockCache::Get().GetStats().blocks == 0;
+
+    Archive reopened;
+    reopened.Open("test_blockcache.asset", Mode::READ);
+    reopened.SetEncryptionKey("BlockCacheKey");
+    Blob data;
+    bool renamedRead = dropped && reopened.ReadFileByName("block_renamed.txt", data) && data.GetSize() == sizes[0] &&
+        CompareData(data.GetData(), (const UINT8*)contents[0].c_str(), sizes[0]);
+    reopened.Close();
+
+    if (renamedRead)
+        PrintSuccess("Invalidated after write: OK");
+    else
+        PrintError("Invalidated after write: FAILED");
+
+    BlockCache::Get().SetBudget(0);
+
+    PrintSuccess("Test 25 PASSED\n");
+}
+
+void Test26_Archive_Shared_Toc()
+{
+    PrintTitle("Test 26: Shared Table of Contents");
+
+    std::vector<std::string> files;
+    std::vector<std::string> contents;
+    for (int i = 0; i < 40; i++)
+    {
+        files.push_back("toc_asset_" + std::to_string(i) + ".txt");
+        contents.push_back("Asset " + std::to_string(i) + " payload " + std::string(i * 37 % 500, 'a' + i % 26));
+
+        File f;
+        f.OpenWrite(files.back());
+        f.Write((const UINT8*)contents.back().c_str(), contents.back().size(), 1);
+        f.Close();
+    }
+
+    Archive arc;
+    arc.Create(files);
+    arc.Close();
+    remove("test_toc.asset");
+    remove(SharedToc::GetPath("test_toc.asset").c_str());
+    rename("temp_archive.asset", "test_toc.asset");
+
+    auto readAll = [&](Archive& archive)
+    {
+        Blob data;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (!archive.ReadFileByName(files[i], data) || data.GetSize() != contents[i].size() ||
+                !CompareData(data.GetData(), (const UINT8*)contents[i].c_str(), contents[i].size()))
+                return false;
+        }
+        return !archive.ReadFileByName("toc_missing.txt", data);
+    };
+
+    // The first reader decodes the maps and publishes them, the others map the index
+    Archive publisher, reader;
+    publisher.EnableSharedToc(true);
+    reader.EnableSharedToc(true);
+    publisher.Open("test_toc.asset", Mode::READ);
+    bool published = !publisher.IsTocShared() && std::filesystem::exists(SharedToc::GetPath("test_toc.asset"));
+    reader.Open("test_toc.asset", Mode::READ);
+
+    if (published && reader.IsTocShared() && readAll(publisher) && readAll(reader))
+        PrintSuccess("Second reader served from the mapped index: OK");
+    else
+        PrintError("Second reader served from the mapped index: FAILED");
+    publisher.Close();
+    reader.Close();
+
+    // A writer removes the index; the next reader publishes a fresh one
+    Archive writer;
+    writer.Open("test_toc.asset", Mode::WRITE);
+    writer.RenameFileByName(files[0], "toc_renamed.txt");
+    writer.Close();
+    bool removed = !std::filesystem::exists(SharedToc::GetPath("test_toc.asset"));
+    files[0] = "toc_renamed.txt";
+
+    publisher.Open("test_toc.asset", Mode::READ);
+    reader.Open("test_toc.asset", Mode::READ);
+    if (removed && !publisher.IsTocShared() && reader.IsTocShared() && readAll(reader))
+        PrintSuccess("Index rebuilt after a write: OK");
+    else
+        PrintError("Index rebuilt after a write: FAILED");
+    publisher.Close();
+    reader.Close();
+
+    // An index left behind by a writer that didn't remove it is never mapped
+    std::string tocPath = SharedToc::GetPath("test_toc.asset");
+    std::filesystem::copy_file(tocPath, tocPath + ".old", std::filesystem::copy_options::overwrite_existing);
+    Archive stale;
+    stale.Open("test_toc.asset", Mode::WRITE);
+    stale.RenameFileByName(files[1], "toc_stale.txt");
+    stale.Close();
+    files[1] = "toc_stale.txt";
+    std::filesystem::rename(tocPath + ".old", tocPath);
+
+    reader.Open("test_toc.asset", Mode::READ);
+    if (!reader.IsTocShared() && readAll(reader))
+        PrintSuccess("Stale index ignored: OK");
+    else
+        PrintError("Stale index ignored: FAILED");
+    reader.Close();
+
+    PrintSuccess("Test 26 PASSED\n");
+}
+
+void Test27_Asset_Server()
+{
+    PrintTitle("Test 27: Local Asset Server");
+
+    // One file under the shared payload threshold, one above it
+    const char* names[2] = { "served_config.txt", "served_texture.bin" };
+    std::string contents[2];
+    contents[0] = "resolution=1920x1080\nvsync=1\n";
+    std::mt19937 rng(27);
+    for (int i = 0; i < 300 * 1024; i++)
+        contents[1] += static_cast<char>(rng() % 16);
+
+    for (int i = 0; i < 2; i++)
+    {
+        File f;
+        f.OpenWrite(names[i]);
+        f.Write((const UINT8*)contents[i].c_str(), contents[i].size(), 1);
+        f.Close();
+    }
+
+    Archive arc;
+    arc.EnableCompression(true);
+    arc.Create({ names[0], names[1] });
+    arc.Close();
+    remove("test_served.asset");
+    rename("temp_archive.asset", "test_served.asset");
+
+    AssetServer server;
+    server.SetWorkerCount(2);
+    server.SetEntryCacheBudget(1024 * 1024);
+    if (!server.Mount("test_served.asset") || !server.Start("test_assets.sock"))
+    {
+        PrintError("Failed to start server");
+        return;
+    }
+
+    AssetClient client;
+    Blob data, part;
+    bool fetched = client.Connect("test_assets.sock") &&
+        client.GetByName(names[0], data) && data.GetSize() == contents[0].size() &&
+        CompareData(data.GetData(), (const UINT8*)contents[0].c_str(), contents[0].size()) &&
+        client.GetByName(names[1], data) && data.GetSize() == contents[1].size() &&
+        CompareData(data.GetData(), (const UINT8*)contents[1].c_str(), contents[1].size()) &&
+        client.GetRange(names[1], 1000, 500, part) && part.GetSize() == 500 &&
+        CompareData(part.GetData(), (const UINT8*)contents[1].c_str() + 1000, 500);
+    bool missing = !client.GetByName("served_missing.txt", data) && client.GetLastStatus() == SERVER_NOT_FOUND;
+
+    ServerStats stats;
+    if (fetched && missing && client.GetStats(stats) && stats.found == 3 && stats.notFound == 1 && stats.sharedPayloads == 1)
+        PrintSuccess("Get by name, ranged get, large payload shared: OK");
+    else
+        PrintError("Get by name, ranged get, large payload shared: FAILED");
+
+    // The shared payload is the client's view of the section it was decoded into (a cache hit now),
+    // and stays valid after the next requests; a small one arrives through the socket
+    SharedBlob mapped, small, mappedRange;
+    bool mappedOk = client.GetByName(names[1], mapped) && mapped.GetSize() == contents[1].size() && mapped.GetUseCount() == 1 &&
+        client.GetByName(names[0], small) && small.GetSize() == contents[0].size() &&
+        CompareData(small.GetData(), (const UINT8*)contents[0].c_str(), contents[0].size()) &&
+        client.GetRange(names[1], 4096, 128 * 1024, mappedRange) && mappedRange.GetSize() == 128 * 1024 &&
+        CompareData(mappedRange.GetData(), (const UINT8*)contents[1].c_str() + 4096, 128 * 1024) &&
+        CompareData(mapped.GetData(), (const UINT8*)contents[1].c_str(), contents[1].size()) &&
+        client.GetStats(stats) && stats.sharedPayloads == 3;
+
+    if (mappedOk)
+        PrintSuccess("Shared payloads handed out as the mapping: OK");
+    else
+        PrintError("Shared payloads handed out as the mapping: FAILED");
+    client.Close();
+
+    // Several clients at once, more than there are workers
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; t++)
+    {
+        clients.emplace_back([&, t]()
+        {
+            AssetClient local;
+            Blob localData;
+            if (!local.Connect("test_assets.sock"))
+            {
+                mismatches++;
+                return;
+            }
+            for (int i = 0; i < 10; i++)
+            {
+                int index = (t + i) % 2;
+                if (!local.GetByName(names[index], localData) || localData.GetSize() != contents[index].size() ||
+                    !CompareData(localData.GetData(), (const UINT8*)contents[index].c_str(), contents[index].size()))
+                    mismatches++;
+            }
+        });
+    }
+    for (auto& thread : clients)
+        thread.join();
+
+    stats = server.GetStats();
+    std::cout << "Connections: " << stats.connections << ", requests: " << stats.requests
+              << ", served: " << stats.bytesServed << " bytes (" << stats.sharedPayloads << " shared)\n";
+
+    if (mismatches == 0 && stats.connections == 5 && stats.found == 46)
+        PrintSuccess("Concurrent clients: OK");
+    else
+        PrintError("Concurrent clients: FAILED");
+
+    server.Stop();
+    if (!client.Connect("test_assets.sock"))
+        PrintSuccess("Stopped: OK");
+    else
+        PrintError("Stopped: FAILED");
+
+    PrintSuccess("Test 27 PASSED\n");
+}
+
+void Test28_Archive_Set_Overlay()
+{
+    PrintTitle("Test 28: Mounted Archive Overlay");
+
+    // Each layer ships its own version of some files
+    auto buildLayer = [](const std::string& layer, const std::vector<std::string>& names, const std::string& tombstones)
+    {
+        std::filesystem::create_directories("vfs_" + layer);
+        std::vector<std::string> paths;
+        for (const auto& name : names)
+        {
+            paths.push_back("vfs_" + layer + "/" + name);
+            std::string content = layer + ":" + name;
+            if (name == ArchiveSet::TOMBSTONE_LIST)
+                content = tombstones;
+
+            File f;
+            f.OpenWrite(paths.back());
+            f.Write((const UINT8*)content.c_str(), content.size(), 1);
+            f.Close();
+        }
+
+        Archive arc;
+        arc.Create(paths);
+        arc.Close();
+        std::string archivePath = "test_vfs_" + layer + ".asset";
+        remove(archivePath.c_str());
+        rename("temp_archive.asset", archivePath.c_str());
+        return archivePath;
+    };
+
+    std::string base = buildLayer("base", { "hero.txt", "level.txt", "intro.txt" }, "");
+    std::string dlc = buildLayer("dlc", { "level.txt", "bonus.txt" }, "");
+    std::string patch = buildLayer("patch", { "hero.txt", ArchiveSet::TOMBSTONE_LIST }, "intro.txt\r\nbonus.txt\n");
+    std::string extra = buildLayer("extra", { "intro.txt", "extra.txt" }, "");
+
+    auto owner = [](const ArchiveSet& set, const std::string& name)
+    {
+        Blob data;
+        if (!set.ReadFile(name, data))
+            return std::string("-");
+        std::string content(reinterpret_cast<const char*>(data.GetData()), data.GetSize());
+        return content.substr(0, content.find(':'));
+    };
+
+    ArchiveSet set;
+    set.Mount(base, 0);
+    UINT32 patchLayer = set.Mount(patch, 20);
+    UINT32 dlcLayer = set.Mount(dlc, 10);
+    // Below the patch: its intro.txt stays hidden
+    set.Mount(extra, -5);
+
+    std::cout << "Layers: " << set.GetLayerCount() << ", visible files: " << set.GetFileCount() << "\n";
+    if (set.GetFileCount() == 3 && owner(set, "hero.txt") == "patch" && owner(set, "level.txt") == "dlc" &&
+        owner(set, "extra.txt") == "extra" && !set.Contains("intro.txt") && !set.Contains("bonus.txt") &&
+        !set.Contains(ArchiveSet::TOMBSTONE_LIST))
+        PrintSuccess("Higher layers win, tombstones hide lower entries: OK");
+    else
+        PrintError("Higher layers win, tombstones hide lower entries: FAILED");
+
+    set.Unmount(patchLayer);
+    bool afterPatch = set.GetFileCount() == 5 && owner(set, "hero.txt") == "base" &&
+        owner(set, "intro.txt") == "base" && owner(set, "bonus.txt") == "dlc";
+    set.Unmount(dlcLayer);
+    bool afterDlc = set.GetFileCount() == 4 && owner(set, "level.txt") == "base" && !set.Contains("bonus.txt");
+
+    Blob part;
+    bool ranged = set.ReadRange("level.txt", 5, 5, part) && part.GetSize() == 5 && CompareData(part.GetData(), (const UINT8*)"level", 5);
+
+    if (afterPatch && afterDlc && ranged && set.GetLayerCount() == 2)
+        PrintSuccess("Unmount restores lower entries: OK");
+    else
+        PrintError("Unmount restores lower entries: FAILED");
+
+    set.UnmountAll();
+
+    PrintSuccess("Test 28 PASSED\n");
+}
+
+void Test29_Blob_Inline_Growth()
+{
+    PrintTitle("Test 29: Blob Inline Storage and Growth");
+
+    const char* shortText = "fits inline";
+    std::string longText(1000, 'x');
+
+    Blob small;
+    bool inlineOk = !small.IsHeapAllocated() && small.Append((const UINT8*)shortText, strlen(shortText)) &&
+        !small.IsHeapAllocated() && CompareData(small.GetData(), (const UINT8*)shortText, strlen(shortText));
+
+    // A moved Blob keeps its bytes, the moved-from one is empty and usable
+    Blob moved(std::move(small));
+    bool moveOk = moved.GetSize() == strlen(shortText) && !moved.IsHeapAllocated() &&
+        CompareData(moved.GetData(), (const UINT8*)shortText, strlen(shortText)) &&
+        small.GetSize() == 0 && small.Append((const UINT8*)longText.c_str(), longText.size()) &&
+        small.IsHeapAllocated() && small.GetSize() == longText.size();
+
+    if (inlineOk && moveOk)
+        PrintSuccess("Inline storage, append after move: OK");
+    else
+        PrintError("Inline storage, append after move: FAILED");
+
+    // One byte at a time: geometric growth, few reallocations
+    Blob grown;
+    UINT32 reallocations = 0;
+    UINT64 capacity = grown.GetCapacity();
+    for (UINT32 i = 0; i < 100000; i++)
+    {
+        UINT8 byte = static_cast<UINT8>(i);
+        grown.Append(&byte);
+        if (grown.GetCapacity() != capacity)
+        {
+            capacity = grown.GetCapacity();
+            reallocations++;
+        }
+    }
+
+    bool grownOk = grown.GetSize() == 100000 && *grown.At(99999) == static_cast<UINT8>(99999) && reallocations < 30;
+    grown.Resize(10);
+    bool shrunk = grown.Shrink() && !grown.IsHeapAllocated() && *grown.At(9) == 9;
+
+    std::cout << "Reallocations for 100000 appends: " << reallocations << "\n";
+    if (grownOk && shrunk)
+        PrintSuccess("Geometric growth, shrink back inline: OK");
+    else
+        PrintError("Geometric growth, shrink back inline: FAILED");
+
+    PrintSuccess("Test 29 PASSED\n");
+}
+
+void Test30_Blob_Allocators()
+{
+    PrintTitle("Test 30: Blob Allocators (Pool, Arena)");
+
+    // A freed block serves the next request of its size class
+    PoolAllocator pool;
+    {
+        Blob first(pool);
+        first.Resize(10000);
+        memset(first.GetData(), 0xAB, first.GetSize());
+    }
+    AllocatorStats afterFirst = pool.GetStats();
+
+    Blob second(pool);
+    second.Resize(9000);
+    AllocatorStats afterSecond = pool.GetStats();
+
+    bool poolOk = afterFirst.outstanding == 0 && afterFirst.cached == 16384 &&
+        afterSecond.reused == 1 && afterSecond.outstanding == 16384 && afterSecond.cached == 0 &&
+        afterSecond.peak == 16384 && &second.GetAllocator() == &pool;
+
+    // The allocator moves with the block
+    Blob moved(std::move(second));
+    poolOk = poolOk && &moved.GetAllocator() == &pool && moved.GetSize() == 9000;
+    moved.Resize(0);
+    moved.Shrink();
+    pool.Trim();
+    poolOk = poolOk && pool.GetStats().outstanding == 0 && pool.GetStats().cached == 0;
+
+    if (poolOk)
+        PrintSuccess("Pool reuse, outstanding and peak bytes: OK");
+    else
+        PrintError("Pool reuse, outstanding and peak bytes: FAILED");
+
+    // Blobs built in a scope take its allocator
+    ArenaAllocator arena(64 * 1024);
+    bool arenaOk = true;
+    {
+        AllocatorScope scope(arena);
+        std::vector<Blob> blobs;
+        for (int i = 0; i < 16; i++)
+        {
+            Blob blob;
+            blob.Resize(1000 + i);
+            memset(blob.GetData(), i, blob.GetSize());
+            blobs.push_back(std::move(blob));
+        }
+        for (int i = 0; i < 16; i++)
+            arenaOk = arenaOk && &blobs[i].GetAllocator() == &arena && *blobs[i].At(999) == i;
+    }
+    Blob outside;
+    AllocatorStats arenaStats = arena.GetStats();
+    arenaOk = arenaOk && &outside.GetAllocator() == &Allocator::GetHeap() &&
+        arenaStats.allocations == 16 && arenaStats.outstanding == 0 && arenaStats.peak >= 16 * 1000;
+    arena.Reset();
+
+    if (arenaOk)
+        PrintSuccess("Arena scope: OK");
+    else
+        PrintError("Arena scope: FAILED");
+
+    // Bulk operations recycle their per-entry buffers
+    std::vector<std::string> files;
+    for (int i = 0; i < 8; i++)
+    {
+        std::string path = "alloc_file" + std::to_string(i) + ".bin";
+        std::string content(20000 + i * 100, static_cast<char>('a' + i));
+        File f;
+        f.OpenWrite(path);
+        f.Write((const UINT8*)content.c_str(), content.size(), 1);
+        f.Close();
+        files.push_back(path);
+    }
+
+    Archive arc;
+    arc.Create(files);
+    remove("test_allocators.asset");
+    rename("temp_archive.asset", "test_allocators.asset");
+
+    // Raw entries stream through the thread's IoBuffer scratch: no block per entry
+    UINT64 scratchBefore = AlignedAllocator::GetPage().GetStats().allocations;
+    bool bulkOk = arc.Open("test_allocators.asset", Mode::READ) && arc.Validate() &&
+        arc.ExtractAll("extracted_allocators_output");
+    arc.Close();
+
+    UINT64 scratchAllocations = AlignedAllocator::GetPage().GetStats().allocations - scratchBefore;
+    AllocatorStats shared = PoolAllocator::Get().GetStats();
+    std::cout << "Scratch blocks allocated: " << scratchAllocations << ", pool peak: " << shared.peak << " bytes\n";
+    if (bulkOk && scratchAllocations <= 1)
+        PrintSuccess("Pooled Validate / ExtractAll: OK");
+    else
+        PrintError("Pooled Validate / ExtractAll: FAILED");
+
+    // Classes the cache can't hold are not rounded up
+    PoolAllocator small(1024 * 1024);
+    UINT64 exactCapacity = 0;
+    void* large = small.Allocate(3 * 1024 * 1024 + 5, exactCapacity);
+    small.Free(large, exactCapacity);
+    UINT64 classCapacity = 0;
+    void* fits = small.Allocate(600 * 1024, classCapacity);
+    small.Free(fits, classCapacity);
+
+    if (exactCapacity == 3 * 1024 * 1024 + 5 && classCapacity == 1024 * 1024 && small.GetStats().cached == 1024 * 1024)
+        PrintSuccess("Sizes above the pool cap served exactly: OK");
+    else
+        PrintError("Sizes above the pool cap served exactly: FAILED");
+
+    // Caches outlive allocator scopes: what they keep must not come from the scope
+    BlockCache::Get().SetBudget(4 * 1024 * 1024);
+    Archive cachedArc;
+    cachedArc.SetEntryCacheBudget(1024 * 1024);
+    bool cacheOk = cachedArc.Open("test_allocators.asset", Mode::READ);
+    ChunkedBlob chunks(4096);
+    ArenaAllocator scoped(64 * 1024);
+    {
+        AllocatorScope scope(scoped);
+        Blob copy;
+        SharedBlob shared;
+        File cachedFile;
+        cachedFile.EnableBlockCache(true);
+        UINT8 head[64];
+        cacheOk = cacheOk && cachedArc.ReadFileByName("alloc_file0.bin", copy) &&
+            cachedArc.ReadFileByName("alloc_file1.bin", shared) &&
+            cachedFile.OpenRead("alloc_file2.bin") && cachedFile.Read(head, sizeof(head)) == sizeof(head) &&
+            chunks.Append(copy.GetData(), copy.GetSize());
+    }
+    cacheOk = cacheOk && scoped.GetStats().outstanding == 0;
+    scoped.Reset();
+
+    // Served again from the caches, after the arena is gone
+    SharedBlob again0, again1;
+    File cachedFile;
+    cachedFile.EnableBlockCache(true);
+    UINT8 head[64];
+    cacheOk = cacheOk && cachedArc.ReadFileByName("alloc_file0.bin", again0) && *again0.GetData() == 'a' &&
+        cachedArc.ReadFileByName("alloc_file1.bin", again1) && again1.GetData()[again1.GetSize() - 1] == 'b' &&
+        cachedFile.OpenRead("alloc_file2.bin") && cachedFile.Read(head, sizeof(head)) == sizeof(head) && head[63] == 'c' &&
+        chunks.GetSize() == again0.GetSize();
+    cachedFile.Close();
+    cachedArc.Close();
+    BlockCache::Get().SetBudget(0);
+
+    if (cacheOk)
+        PrintSuccess("Block, entry and chunked caches keep heap blocks: OK");
+    else
+        PrintError("Block, entry and chunked caches keep heap blocks: FAILED");
+
+    PrintSuccess("Test 30 PASSED\n");
+}
+
+void Test31_Blob_Aligned_Allocations()
+{
+    PrintTitle("Test 31: Blob Aligned and Huge Page Allocations");
+
+    auto isAligned = [](const void* p, UINT64 alignment) { return (reinterpret_cast<UINT64>(p) & (alignment - 1)) == 0; };
+
+    // Even a few bytes get an aligned block
+    Blob small(AlignedAllocator::GetCacheLine());
+    small.Append((const UINT8*)"simd", 4);
+    Blob grown(AlignedAllocator::GetCacheLine());
+    bool alignedOk = small.IsHeapAllocated() && isAligned(small.GetData(), 64) && CompareData(small.GetData(), (const UINT8*)"simd", 4);
+    for (UINT32 i = 0; i < 5000; i++)
+    {
+        UINT8 byte = static_cast<UINT8>(i);
+        grown.Append(&byte);
+        alignedOk = alignedOk && isAligned(grown.GetData(), 64);
+    }
+    alignedOk = alignedOk && grown.GetSize() == 5000 && *grown.At(4999) == static_cast<UINT8>(4999);
+
+    if (alignedOk)
+        PrintSuccess("64 B alignment through growth: OK");
+    else
+        PrintError("64 B alignment through growth: FAILED");
+
+    // An existing Blob moves to page-aligned storage, content kept
+    std::string text(3000, 'p');
+    Blob moved((const UINT8*)text.c_str(), text.size());
+    AlignedAllocator pageAligned(AlignedAllocator::PAGE_SIZE);
+    bool reserveOk = moved.Reserve(8192, pageAligned) && &moved.GetAllocator() == &pageAligned &&
+        isAligned(moved.GetData(), 4096) && moved.GetCapacity() == 8192 && moved.GetSize() == text.size() &&
+        CompareData(moved.GetData(), (const UINT8*)text.c_str(), text.size());
+
+    if (reserveOk)
+        PrintSuccess("Reserve into 4 KB aligned block: OK");
+    else
+        PrintError("Reserve into 4 KB aligned block: FAILED");
+
+    // Above the threshold: mapped, huge page aligned, pre-faulted
+    const UINT64 hugeSize = 5 * 1024 * 1024;
+    AlignedAllocator huge(AlignedAllocator::PAGE_SIZE, 4 * 1024 * 1024, true);
+    bool hugeOk = true;
+    {
+        Blob big(huge);
+        big.Resize(hugeSize);
+        hugeOk = isAligned(big.GetData(), AlignedAllocator::HUGE_PAGE_SIZE) && big.GetCapacity() == 6 * 1024 * 1024;
+        for (UINT64 i = 0; hugeOk && i < hugeSize; i += 4096)
+            hugeOk = big.GetData()[i] == 0;
+        memset(big.GetData(), 0x5A, hugeSize);
+        hugeOk = hugeOk && big.GetData()[hugeSize - 1] == 0x5A;
+    }
+    AllocatorStats stats = huge.GetStats();
+    hugeOk = hugeOk && stats.outstanding == 0 && stats.peak == 6 * 1024 * 1024;
+
+    if (hugeOk)
+        PrintSuccess("Huge page mapping with pre-faulting: OK");
+    else
+        PrintError("Huge page mapping with pre-faulting: FAILED");
+
+    PrintSuccess("Test 31 PASSED\n");
+}
+
+void Test32_Shared_Blob()
+{
+    PrintTitle("Test 32: SharedBlob (Refcounted Slices)");
+
+    // Taken over without a copy; slices share the storage
+    std::string text(5000, 'a');
+    for (size_t i = 0; i < text.size(); i++)
+        text[i] = static_cast<char>('a' + i % 26);
+
+    Blob blob((const UINT8*)text.c_str(), text.size());
+    const UINT8* block = blob.GetData();
+    SharedBlob shared(std::move(blob));
+
+    SharedBlob slice = shared.Slice(100, 50);
+    SharedBlob clamped = slice.Slice(40, 1000);
+    bool shareOk = shared.GetData() == block && shared.GetSize() == text.size() &&
+        slice.GetData() == block + 100 && slice.GetSize() == 50 && shared.GetUseCount() == 3 &&
+        clamped.GetSize() == 10 && CompareData(clamped.GetData(), (const UINT8*)text.c_str() + 140, 10);
+
+    // The storage lives as long as a slice does
+    shared = SharedBlob();
+    shareOk = shareOk && slice.GetUseCount() == 2 && CompareData(slice.GetData(), (const UINT8*)text.c_str() + 100, 50);
+
+    if (shareOk)
+        PrintSuccess("Zero-copy take over and slicing: OK");
+    else
+        PrintError("Zero-copy take over and slicing: FAILED");
+
+    // Mapped file read through a read-only Memory
+    File f;
+    f.OpenWrite("shared_blob_source.bin");
+    f.Write((const UINT8*)text.c_str(), text.size(), 1);
+    f.Close();
+
+    bool mappedOk = false;
+    {
+        SharedBlob mapped = SharedBlob::MapFile("shared_blob_source.bin");
+        Memory memory(mapped.Slice(1000));
+        UINT8 buffer[26];
+        mappedOk = mapped.GetSize() == text.size() && memory.IsReadOnly() && memory.GetSize() == text.size() - 1000 &&
+            memory.Read(buffer, sizeof(buffer)) == sizeof(buffer) && CompareData(buffer, (const UINT8*)text.c_str() + 1000, 26) &&
+            memory.Seek(-4, SEEK_END) == (INT64)(text.size() - 1004) && memory.Read(buffer, sizeof(buffer)) == 4 &&
+            memory.Write((const UINT8*)"no", 2) == 0;
+    }
+
+    if (mappedOk)
+        PrintSuccess("Mapped file, read-only Memory: OK");
+    else
+        PrintError("Mapped file, read-only Memory: FAILED");
+
+    // Cache hits hand out the cached bytes themselves
+    std::vector<std::string> files = { "shared_blob_source.bin" };
+    Archive arc;
+    arc.Create(files);
+    remove("test_shared_blob.asset");
+    rename("temp_archive.asset", "test_shared_blob.asset");
+
+    arc.SetEntryCacheBudget(1024 * 1024);
+    SharedBlob first, second;
+    bool cacheOk = arc.Open("test_shared_blob.asset", Mode::READ) &&
+        arc.ReadFileByName("shared_blob_source.bin", first) && arc.ReadFileByName("shared_blob_source.bin", second) &&
+        first.GetData() == second.GetData() && first.GetSize() == text.size() &&
+        CompareData(second.GetData(), (const UINT8*)text.c_str(), text.size());
+
+    EntryCacheStats stats = arc.GetEntryCacheStats();
+    cacheOk = cacheOk && stats.hits == 1 && stats.misses == 1;
+
+    // Still readable once the cache let go of it
+    arc.ClearEntryCache();
+    arc.Close();
+    cacheOk = cacheOk && first.GetUseCount() == 2 && CompareData(first.GetData(), (const UINT8*)text.c_str(), text.size());
+
+    if (cacheOk)
+        PrintSuccess("Archive load shared with the entry cache: OK");
+    else
+        PrintError("Archive load shared with the entry cache: FAILED");
+
+    PrintSuccess("Test 32 PASSED\n");
+}
+
+void Test33_Memory_ReadOnly_Span()
+{
+    PrintTitle("Test 33: Read-Only Memory over External Bytes");
+
+    // Bytes of a network buffer, read in place
+    UINT8 packet[64];
+    for (int i = 0; i < 64; i++)
+        packet[i] = static_cast<UINT8>(i * 3);
+
+    Memory span(packet, sizeof(packet));
+    UINT8 buffer[16];
+    bool spanOk = span.IsOpen() && span.IsReadOnly() && span.GetBlob() == nullptr && span.GetSize() == 64 &&
+        span.Seek(8) == 8 && span.Read(buffer, sizeof(buffer)) == 16 && CompareData(buffer, packet + 8, 16) &&
+        span.Write(buffer, 4) == 0 && packet[40] == 120 && span.Seek(0, SEEK_END) == 64 && span.Read(buffer, 1) == 0;
+
+    if (spanOk)
+        PrintSuccess("Read, seek, write refused: OK");
+    else
+        PrintError("Read, seek, write refused: FAILED");
+
+    // An archive opened straight from its mapping
+    File f1, f2;
+    const char* content1 = "Mapped archive entry one";
+    std::string content2(3000, 'm');
+    f1.OpenWrite("span_file1.txt");
+    f1.Write((const UINT8*)content1, strlen(content1), 1);
+    f1.Close();
+    f2.OpenWrite("span_file2.txt");
+    f2.Write((const UINT8*)content2.c_str(), content2.size(), 1);
+    f2.Close();
+
+    std::vector<std::string> files = { "span_file1.txt", "span_file2.txt" };
+    Archive builder;
+    builder.Create(files);
+    remove("test_span.asset");
+    rename("temp_archive.asset", "test_span.asset");
+
+    SharedBlob mapped = SharedBlob::MapFile("test_span.asset");
+    Memory stream(mapped.GetData(), mapped.GetSize());
+
+    Archive arc;
+    Blob data1, data2;
+    bool archiveOk = arc.OpenStream(&stream) &&
+        arc.ReadFileByName("span_file1.txt", data1) && data1.GetSize() == strlen(content1) &&
+        CompareData(data1.GetData(), (const UINT8*)content1, strlen(content1)) &&
+        arc.ReadFileByName("span_file2.txt", data2) && data2.GetSize() == content2.size() &&
+        CompareData(data2.GetData(), (const UINT8*)content2.c_str(), content2.size());
+    arc.Close();
+
+    if (archiveOk)
+        PrintSuccess("Archive::OpenStream over a mapping: OK");
+    else
+        PrintError("Archive::OpenStream over a mapping: FAILED");
+
+    PrintSuccess("Test 33 PASSED\n");
+}
+
+void Test34_Archive_In_Memory()
+{
+    PrintTitle("Test 34: RAM-Resident Archive Build and Load");
+
+    const char* content1 = "Built without touching the disk";
+    std::string content2(5000, 'r');
+    const char* content3 = "Encrypted, added in memory";
+    File f1, f2, f3;
+    f1.OpenWrite("ram_file1.txt");
+    f1.Write((const UINT8*)content1, strlen(content1), 1);
+    f1.Close();
+    f2.OpenWrite("ram_file2.txt");
+    f2.Write((const UINT8*)content2.c_str(), content2.size(), 1);
+    f2.Close();
+    f3.OpenWrite("ram_file3.txt");
+    f3.Write((const UINT8*)content3, strlen(content3), 1);
+    f3.Close();
+
+    // Create, AddFile, RemoveFile and Compact on a Memory
+    remove("temp_archive.asset");
+    Memory image;
+    Archive builder;
+    std::vector<std::string> files = { "ram_file1.txt", "ram_file2.txt" };
+    bool buildOk = builder.OpenStream(&image, Mode::WRITE) && builder.Create(files) &&
+        !std::filesystem::exists("temp_archive.asset") && image.GetSize() > 0;
+
+    buildOk = buildOk && builder.OpenStream(&image, Mode::WRITE) && builder.IsInMemory() &&
+        builder.RemoveFileByName("ram_file2.txt");
+
+    UINT64 sizeBeforeCompact = image.GetSize();
+    buildOk = buildOk && builder.Compact() && image.GetSize() < sizeBeforeCompact && builder.Contains("ram_file1.txt");
+
+    builder.EnableEncryption(true);
+    builder.SetEncryptionKey("ram-key");
+    buildOk = buildOk && builder.AddFile("ram_file3.txt") && builder.Contains("ram_file3.txt");
+
+    Blob data;
+    buildOk = buildOk && builder.ReadFileByName("ram_file3.txt", data) && data.GetSize() == strlen(content3) &&
+        CompareData(data.GetData(), (const UINT8*)content3, strlen(content3));
+
+    remove("test_ram.asset");
+    buildOk = buildOk && builder.Save("test_ram.asset");
+    builder.Close();
+
+    if (buildOk)
+        PrintSuccess("Build, remove, compact, add (encrypted) in RAM, one write: OK");
+    else
+        PrintError("Build, remove, compact, add (encrypted) in RAM, one write: FAILED");
+
+    // The saved file is a regular archive, and loads back with one read
+    Archive onDisk;
+    onDisk.SetEncryptionKey("ram-key");
+    Blob data1, data3;
+    bool diskOk = onDisk.Open("test_ram.asset", Mode::READ) && !onDisk.IsInMemory() &&
+        !onDisk.Contains("ram_file2.txt") &&
+        onDisk.ReadFileByName("ram_file1.txt", data1) && CompareData(data1.GetData(), (const UINT8*)content1, strlen(content1)) &&
+        onDisk.ReadFileByName("ram_file3.txt", data3) && CompareData(data3.GetData(), (const UINT8*)content3, strlen(content3));
+    onDisk.Close();
+
+    Archive loaded;
+    loaded.SetEncryptionKey("ram-key");
+    Blob loaded1;
+    bool loadOk = loaded.Load("test_ram.asset", Mode::WRITE) && loaded.IsInMemory() &&
+        loaded.ReadFileByName("ram_file1.txt", loaded1) && CompareData(loaded1.GetData(), (const UINT8*)content1, strlen(content1)) &&
+        loaded.AddFile("ram_file2.txt") && loaded.Contains("ram_file2.txt") && loaded.Save("test_ram_patched.asset");
+    loaded.Close();
+
+    Archive patched;
+    Blob patched2;
+    loadOk = loadOk && patched.Open("test_ram_patched.asset", Mode::READ) &&
+        patched.ReadFileByName("ram_file2.txt", patched2) && patched2.GetSize() == content2.size() &&
+        CompareData(patched2.GetData(), (const UINT8*)content2.c_str(), content2.size());
+    patched.Close();
+
+    if (diskOk && loadOk)
+        PrintSuccess("Saved archive on disk, Load / patch / Save: OK");
+    else
+        PrintError("Saved archive on disk, Load / patch / Save: FAILED");
+
+    PrintSuccess("Test 34 PASSED\n");
+}
+
+void Test35_Chunked_Blob()
+{
+    PrintTitle("Test 35: Chunked Blob for Large Payloads");
+
+    // Appends never move a filled segment
+    ChunkedBlob chunks(4096);
+    std::string model;
+    std::string block(1500, 'a');
+    for (int i = 0; i < 10; i++)
+    {
+        block.assign(1500, static_cast<char>('a' + i));
+        chunks.Append((const UINT8*)block.c_str(), block.size());
+        model += block;
+    }
+
+    std::vector<ChunkedBlob::Piece> pieces;
+    chunks.GetPieces(pieces);
+    const UINT8* firstSegment = pieces[0].data;
+    chunks.Append((const UINT8*)block.c_str(), block.size());
+    model += block;
+    chunks.GetPieces(pieces);
+
+    bool appendOk = chunks.GetSize() == model.size() && chunks.GetSegmentCount() == 5 && pieces[0].data == firstSegment;
+
+    // Inserts in the middle: one that fits its segment, one that splits it
+    std::string small(100, 'S');
+    std::string large(9000, 'L');
+    chunks.Truncate(14000);
+    model.resize(14000);
+    bool insertOk = chunks.Insert(4500, (const UINT8*)small.c_str(), small.size()) &&
+        chunks.Insert(6000, (const UINT8*)large.c_str(), large.size());
+    model.insert(4500, small);
+    model.insert(6000, large);
+
+    chunks.GetPieces(pieces);
+    UINT64 pieceBytes = 0;
+    for (const ChunkedBlob::Piece& piece : pieces)
+        pieceBytes += piece.size;
+
+    Blob flat;
+    insertOk = insertOk && chunks.GetSize() == model.size() && pieceBytes == model.size() && chunks.Flatten(flat) &&
+        CompareData(flat.GetData(), (const UINT8*)model.c_str(), model.size());
+
+    std::string window(3000, 0);
+    insertOk = insertOk && chunks.Read(5000, (UINT8*)&window[0], window.size()) == window.size() &&
+        window == model.substr(5000, 3000);
+
+    // Blob::Add shifts the tail in place
+    Blob blob;
+    blob.Append((const UINT8*)"HeadTail", 8);
+    insertOk = insertOk && blob.Add((const UINT8*)"--", 4, 2) && blob.GetSize() == 10 &&
+        CompareData(blob.GetData(), (const UINT8*)"Head--Tail", 10);
+
+    if (appendOk && insertOk)
+        PrintSuccess("Stable segments, mid inserts, pieces: OK");
+    else
+        PrintError("Stable segments, mid inserts, pieces: FAILED");
+
+    // Segments hold about what they carry: a small payload, split pieces and tails don't take full segments
+    std::string payload(ChunkedBlob::DEFAULT_SEGMENT_SIZE + 1000, 'p');
+    std::string inserted(300 * 1024, 'i');
+    UINT64 splitAt = ChunkedBlob::DEFAULT_SEGMENT_SIZE - 1000;
+    UINT64 smallUsed = 0;
+    UINT64 insertUsed = 0;
+    bool sparseOk = true;
+    {
+        UINT64 heapBefore = Allocator::GetHeap().GetStats().outstanding;
+        ChunkedBlob sparse;
+        sparseOk = sparse.Append((const UINT8*)payload.c_str(), 1000);
+        smallUsed = Allocator::GetHeap().GetStats().outstanding - heapBefore;
+
+        sparseOk = sparseOk && sparse.Append((const UINT8*)payload.c_str(), payload.size());
+        heapBefore = Allocator::GetHeap().GetStats().outstanding;
+        sparseOk = sparseOk && sparse.Insert(splitAt, (const UINT8*)inserted.c_str(), inserted.size());
+        insertUsed = Allocator::GetHeap().GetStats().outstanding - heapBefore;
+
+        Blob sparseFlat;
+        std::string sparseModel(payload.c_str(), 1000);
+        sparseModel += payload;
+        sparseModel.insert(splitAt, inserted);
+        sparseOk = sparseOk && sparse.Flatten(sparseFlat) && sparseFlat.GetSize() == sparseModel.size() &&
+            CompareData(sparseFlat.GetData(), (const UINT8*)sparseModel.c_str(), sparseModel.size());
+    }
+    std::cout << "Small payload: " << smallUsed << " bytes, split insert of " << inserted.size() << ": " << insertUsed << " bytes\n";
+
+    if (sparseOk && smallUsed < 4096 && insertUsed < inserted.size() + 4096)
+        PrintSuccess("Segments sized to their content: OK");
+    else
+        PrintError("Segments sized to their content: FAILED");
+
+    // An archive built in segments and saved one segment at a time
+    const char* content1 = "Stored across segments";
+    std::string content2(20000, 'c');
+    File f1, f2;
+    f1.OpenWrite("chunked_file1.txt");
+    f1.Write((const UINT8*)content1, strlen(content1), 1);
+    f1.Close();
+    f2.OpenWrite("chunked_file2.txt");
+    f2.Write((const UINT8*)content2.c_str(), content2.size(), 1);
+    f2.Close();
+
+    ChunkedBlob image(8192);
+    Memory stream(&image);
+    Archive builder;
+    std::vector<std::string> files = { "chunked_file1.txt", "chunked_file2.txt" };
+    Blob data1, data2;
+    bool archiveOk = builder.OpenStream(&stream, Mode::WRITE) && builder.Create(files) &&
+        image.GetSize() > content2.size() && image.GetSegmentCount() > 1 && stream.GetBytes() == nullptr &&
+        builder.OpenStream(&stream, Mode::READ) &&
+        builder.ReadFileByName("chunked_file2.txt", data2) && data2.GetSize() == content2.size() &&
+        CompareData(data2.GetData(), (const UINT8*)content2.c_str(), content2.size());
+
+    remove("test_chunked.asset");
+    archiveOk = archiveOk && builder.Save("test_chunked.asset");
+    builder.Close();
+
+    Archive onDisk;
+    archiveOk = archiveOk && onDisk.Open("test_chunked.asset", Mode::READ) &&
+        onDisk.ReadFileByName("chunked_file1.txt", data1) && data1.GetSize() == strlen(content1) &&
+        CompareData(data1.GetData(), (const UINT8*)content1, strlen(content1));
+    onDisk.Close();
+
+    if (archiveOk)
+        PrintSuccess("Archive over a chunked Memory, saved per segment: OK");
+    else
+        PrintError("Archive over a chunked Memory, saved per segment: FAILED");
+
+    PrintSuccess("Test 35 PASSED\n");
+}
+
+void Test36_Pipe_Stream()
+{
+    PrintTitle("Test 36: Lock-Free Pipe Stream");
+
+    // SPSC: a small ring, odd write and read sizes on both sides
+    std::vector<UINT8> source(3 * 1024 * 1024 + 17);
+    for (size_t i = 0; i < source.size(); i++)
+        source[i] = static_cast<UINT8>((i * 31) ^ (i >> 11));
+
+    PipeStream pipe(4096);
+    std::thread producer([&]()
+    {
+        UINT64 sent = 0;
+        UINT64 step = 1;
+        while (sent < source.size())
+        {
+            UINT64 amount = (std::min)(step, (UINT64)source.size() - sent);
+            sent += pipe.Write(source.data() + sent, amount);
+            step = (step * 7) % 9000 + 1;
+        }
+        pipe.Close();
+    });
+
+    std::vector<UINT8> received(source.size());
+    UINT64 got = 0;
+    UINT64 step = 3;
+    for (;;)
+    {
+        UINT64 amount = (std::min)(step, (UINT64)received.size() - got);
+        if (amount == 0)
+            break;
+        UINT64 n = pipe.Read(received.data() + got, amount);
+        got += n;
+        if (n < amount)
+            break;
+        step = (step * 5) % 7000 + 1;
+    }
+    producer.join();
+
+    UINT8 byte = 0;
+    bool spscOk = got == source.size() && CompareData(received.data(), source.data(), source.size()) &&
+        pipe.Read(&byte, 1) == 0 && pipe.IsEof() && !pipe.IsOpen() && pipe.Seek(0, SEEK_CUR) == (INT64)source.size();
+
+    if (spscOk)
+        PrintSuccess("SPSC transfer, Close as end of data: OK");
+    else
+        PrintError("SPSC transfer, Close as end of data: FAILED");
+
+    // Non-blocking sides
+    PipeStream small(64);
+    UINT8 buffer[100] = { 0 };
+    bool tryOk = small.TryRead(buffer, 10) == 0 && small.TryWrite(source.data(), 100) == 64 &&
+        small.TryWrite(source.data(), 1) == 0 && small.GetSize() == 64 &&
+        small.TryRead(buffer, 100) == 64 && CompareData(buffer, source.data(), 64) && small.Seek(10) == -1;
+
+    if (tryOk)
+        PrintSuccess("TryRead / TryWrite never wait: OK");
+    else
+        PrintError("TryRead / TryWrite never wait: FAILED");
+
+    // MPMC: 3 producers, 2 consumers, every record delivered exactly once
+    const UINT32 producers = 3;
+    const UINT32 records = 2000;
+    PipeStream shared(8 * PipeStream::CHUNK_SIZE, PipeStream::Kind::MPMC);
+    std::atomic<UINT32> producing(producers);
+    std::vector<std::thread> threads;
+    for (UINT32 p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&, p]()
+        {
+            UINT32 record[64];
+            for (UINT32 r = 0; r < records; r++)
+            {
+                for (UINT32 i = 0; i < 64; i++)
+                    record[i] = p * records + r;
+                shared.Write((const UINT8*)record, sizeof(record));
+            }
+            if (producing.fetch_sub(1) == 1)
+                shared.Close();
+        });
+    }
+
+    std::vector<std::atomic<UINT32>> seen(producers * records);
+    std::atomic<bool> recordsOk(true);
+    for (UINT32 c = 0; c < 2; c++)
+    {
+        threads.emplace_back([&]()
+        {
+            std::vector<UINT8> chunk(PipeStream::CHUNK_SIZE);
+            UINT64 n = 0;
+            while ((n = shared.Read(chunk.data(), chunk.size())) > 0)
+            {
+                if (n % 256 != 0)
+                    recordsOk = false;
+                for (UINT64 offset = 0; offset < n; offset += 256)
+                {
+                    const UINT32* record = (const UINT32*)(chunk.data() + offset);
+                    if (record[0] >= seen.size() || record[63] != record[0])
+                        recordsOk = false;
+                    else
+                        seen[record[0]]++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    bool mpmcOk = recordsOk && shared.IsEof();
+    for (std::atomic<UINT32>& count : seen)
+        mpmcOk = mpmcOk && count == 1;
+
+    if (mpmcOk)
+        PrintSuccess("MPMC records, each read once: OK");
+    else
+        PrintError("MPMC records, each read once: FAILED");
+
+    // Any Stream code on either end: a file copied through a pipe stage into a Memory
+    File input;
+    input.OpenWrite("pipe_input.bin");
+    input.Write(source.data(), 200000, 1);
+    input.Close();
+
+    PipeStream stage(16 * 1024);
+    std::thread reader([&]()
+    {
+        File file;
+        file.Open("pipe_input.bin", Mode::READ);
+        UINT8 block[MAX_BUFFER_SIZE];
+        UINT64 n = 0;
+        while ((n = file.Read(block, 1, sizeof(block))) > 0)
+            stage.Write(block, n);
+        file.Close();
+        stage.Close();
+    });
+
+    Memory output;
+    UINT8 block[5000];
+    UINT64 n = 0;
+    while ((n = stage.Read(block, sizeof(block))) > 0)
+        output.Write(block, n);
+    reader.join();
+
+    bool streamOk = output.GetSize() == 200000 && CompareData(output.GetBytes(), source.data(), 200000);
+    if (streamOk)
+        PrintSuccess("File -> pipe -> Memory: OK");
+    else
+        PrintError("File -> pipe -> Memory: FAILED");
+
+    PrintSuccess("Test 36 PASSED\n");
+}
+
+void Test37_Stream_Chain()
+{
+    PrintTitle("Test 37: Stream Decorators (Buffer, CRC, Cipher, Codec)");
+
+    std::vector<UINT8> data(600000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<UINT8>((i / 97) % 13 + (i % 7));
+
+    // Small writes reach the Memory only on Flush, then come back through small reads
+    Memory backing;
+    bool bufferedOk = true;
+    {
+        BufferedStream buffered(&backing, 4096);
+        UINT64 written = 0;
+        for (UINT64 step = 1; written < data.size(); step = step % 300 + 1)
+        {
+            UINT64 amount = (std::min)(step, (UINT64)data.size() - written);
+            written += buffered.Write(data.data() + written, amount);
+        }
+        bufferedOk = backing.GetSize() < data.size();
+        bufferedOk = bufferedOk && buffered.Flush() && backing.GetSize() == data.size();
+
+        std::vector<UINT8> back(data.size());
+        buffered.Seek(0);
+        UINT64 got = 0;
+        for (UINT64 step = 5; got < back.size(); step = step % 500 + 5)
+            got += buffered.Read(back.data() + got, (std::min)(step, (UINT64)back.size() - got));
+        bufferedOk = bufferedOk && CompareData(back.data(), data.data(), data.size());
+    }
+
+    CrcStream crc(&backing);
+    backing.Seek(0);
+    std::vector<UINT8> scratch(7777);
+    while (crc.Read(scratch.data(), scratch.size()) > 0) {}
+    bool crcOk = crc.GetCount() == data.size() && crc.GetCRC32() == SafeFormat::CalculateCRC32(data.data(), data.size());
+
+    if (bufferedOk && crcOk)
+        PrintSuccess("BufferedStream, running CrcStream: OK");
+    else
+        PrintError("BufferedStream, running CrcStream: FAILED");
+
+    // Same bytes as the Stream keystream, whatever the call sizes and seeks
+    Memory reference;
+    reference.SetKey("chain-key");
+    reference.EnableEncryption(true);
+    reference.Write(data.data(), 10000);
+
+    Memory ciphered;
+    CipherStream cipher(&ciphered, "chain-key");
+    for (UINT64 done = 0; done < 10000; done += 333)
+        cipher.Write(data.data() + done, (std::min)((UINT64)333, 10000 - done));
+
+    UINT8 window[500];
+    cipher.Seek(3001);
+    bool cipherOk = ciphered.GetSize() == 10000 && CompareData(ciphered.GetBytes(), reference.GetBytes(), 10000) &&
+        cipher.Read(window, sizeof(window)) == sizeof(window) && CompareData(window, data.data() + 3001, sizeof(window));
+
+    if (cipherOk)
+        PrintSuccess("CipherStream keystream and seeks: OK");
+    else
+        PrintError("CipherStream keystream and seeks: FAILED");
+
+    // Blocked and single-stream payloads decoded on the fly
+    bool codecOk = true;
+    for (UINT32 blockSize : { 64u * 1024u, 0u })
+    {
+        Blob payload;
+        codecOk = codecOk && Codec::Pack(data.data(), data.size(), payload, blockSize);
+
+        Memory packed(&payload);
+        CodecStream codec(&packed);
+        CrcStream checked(&codec);
+        std::vector<UINT8> decoded(data.size() + 10);
+        UINT64 got = 0;
+        UINT64 n = 0;
+        while ((n = checked.Read(decoded.data() + got, (std::min)((UINT64)12345, (UINT64)decoded.size() - got))) > 0)
+            got += n;
+
+        codecOk = codecOk && !codec.IsCorrupt() && codec.GetSize() == data.size() && got == data.size() &&
+            CompareData(decoded.data(), data.data(), data.size()) &&
+            checked.GetCRC32() == SafeFormat::CalculateCRC32(data.data(), data.size());
+    }
+
+    // Forged sizes end the stream as corrupt instead of sizing its buffers
+    for (int field = 0; field < 2; field++)
+    {
+        Blob payload;
+        codecOk = codecOk && Codec::Pack(data.data(), data.size(), payload, 0);
+
+        Stream::Header header;
+        memcpy(&header, payload.GetData(), sizeof(header));
+        (field == 0 ? header.dataSize : header.originalSize) = 1ull << 50;
+        memcpy(payload.GetData(), &header, sizeof(header));
+
+        Memory packed(&payload);
+        CodecStream codec(&packed);
+        UINT8 sample[256];
+        codecOk = codecOk && codec.Read(sample, sizeof(sample)) == 0 && codec.IsCorrupt();
+    }
+
+    if (codecOk)
+        PrintSuccess("CodecStream over blocked and single payloads: OK");
+    else
+        PrintError("CodecStream over blocked and single payloads: FAILED");
+
+    // Archive entries streamed out: encrypted + compressed, and plain
+    File source;
+    source.OpenWrite("chain_source.bin");
+    source.Write(data.data(), data.size(), 1);
+    source.Close();
+
+    File plain;
+    plain.OpenWrite("chain_plain.bin");
+    plain.Write(data.data(), 70000, 1);
+    plain.Close();
+
+    Archive builder;
+    std::vector<std::string> files = { "chain_plain.bin" };
+    builder.Create(files);
+    remove("test_chain.asset");
+    rename("temp_archive.asset", "test_chain.asset");
+
+    builder.EnableCompression(true);
+    builder.EnableEncryption(true);
+    builder.SetEncryptionKey("entry-key");
+    UINT64 sourceID = 0;
+    bool archiveOk = builder.Open("test_chain.asset", Mode::WRITE) && builder.AddFile("chain_source.bin", sourceID);
+    builder.Close();
+
+    Archive reader;
+    reader.SetEncryptionKey("entry-key");
+    Blob extracted, ranged;
+    Memory streamed;
+    archiveOk = archiveOk && reader.Open("test_chain.asset", Mode::READ) &&
+        reader.ExtractByName("chain_source.bin", "chain_output.bin") &&
+        reader.ExtractByName("chain_plain.bin", "chain_plain_output.bin") &&
+        reader.ExtractTo(sourceID, streamed) && streamed.GetSize() == data.size() &&
+        CompareData(streamed.GetBytes(), data.data(), data.size());
+
+    File output;
+    archiveOk = archiveOk && output.Open("chain_output.bin", Mode::READ);
+    if (archiveOk)
+    {
+        extracted.Resize(output.GetSize());
+        archiveOk = output.Read(extracted.GetData(), extracted.GetSize(), 1) == data.size() &&
+            CompareData(extracted.GetData(), data.data(), data.size());
+        output.Close();
+    }
+    archiveOk = archiveOk && reader.ReadRangeByName("chain_source.bin", 1500, 3000, ranged) &&
+        CompareData(ranged.GetData(), data.data() + 1500, 3000);
+    reader.Close();
+
+    Archive wrongKey;
+    wrongKey.SetEncryptionKey("not-the-key");
+    archiveOk = archiveOk && wrongKey.Open("test_chain.asset", Mode::READ) &&
+        !wrongKey.ExtractByName("chain_source.bin", "chain_wrong.bin") && !std::filesystem::exists("chain_wrong.bin");
+    wrongKey.Close();
+
+    if (archiveOk)
+        PrintSuccess("Extract in one pass (cipher + codec + CRC32), bad key rejected: OK");
+    else
+        PrintError("Extract in one pass (cipher + codec + CRC32), bad key rejected: FAILED");
+
+    PrintSuccess("Test 37 PASSED\n");
+}
+
+void Test38_Stream_Pipelines()
+{
+    PrintTitle("Test 38: Compile-Time Stream Pipelines");
+
+    std::vector<UINT8> data(300000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<UINT8>((i * 31) ^ (i >> 9));
+
+    // Same bytes and CRC32 as the decorator chain, with chunks not aligned on the keystream period
+    Memory decorated;
+    CipherStream cipher(&decorated, "pipe-key");
+    CrcStream crc(&cipher);
+    crc.Write(data.data(), data.size());
+
+    Blob piped;
+    Pipeline pipeline{ MemorySource(data.data(), data.size()), Crc32Stage(), XorStage("pipe-key"), BlobSink(piped) };
+    UINT64 moved = pipeline.Run(~0ull, 1000);
+
+    bool chainOk = moved == data.size() && pipeline.IsComplete() && piped.GetSize() == data.size() &&
+        CompareData(piped.GetData(), decorated.GetBytes(), data.size()) &&
+        pipeline.GetStage<0>().GetCRC32() == crc.GetCRC32() &&
+        crc.GetCRC32() == SafeFormat::CalculateCRC32(data.data(), data.size());
+
+    // Deciphering through a StreamSource gives the original back
+    decorated.Seek(0);
+    Memory restored;
+    Pipeline back{ StreamSource(decorated), XorStage("pipe-key"), StreamSink(restored) };
+    chainOk = chainOk && back.Run() == data.size() && CompareData(restored.GetBytes(), data.data(), data.size());
+
+    if (chainOk)
+        PrintSuccess("Pipeline matches CipherStream + CrcStream: OK");
+    else
+        PrintError("Pipeline matches CipherStream + CrcStream: FAILED");
+
+    // A stage refusing a chunk stops the run
+    struct LimitStage
+    {
+        UINT64 room;
+        bool Process(UINT8*, UINT64 size)
+        {
+            if (size > room)
+                return false;
+            room -= size;
+            return true;
+        }
+    };
+
+    Pipeline limited{ MemorySource(data.data(), data.size()), LimitStage{ 5000 } };
+    UINT64 limitedMoved = limited.Run(~0ull, 2048);
+    Pipeline bounded{ MemorySource(data.data(), data.size()), Crc32Stage() };
+    UINT64 boundedMoved = bounded.Run(12345, 4096);
+
+    if (limitedMoved == 4096 && !limited.IsComplete() && boundedMoved == 12345 && bounded.IsComplete() &&
+        bounded.GetStage<0>().GetCRC32() == SafeFormat::CalculateCRC32(data.data(), 12345))
+        PrintSuccess("Failing stage stops the run, size bound respected: OK");
+    else
+        PrintError("Failing stage stops the run, size bound respected: FAILED");
+
+    // Validate / ExtractAll / Compact stream raw entries through pipelines
+    File raw;
+    raw.OpenWrite("pipeline_raw.bin");
+    raw.Write(data.data(), data.size(), 1);
+    raw.Close();
+
+    std::string text(200000, 'p');
+    File packed;
+    packed.OpenWrite("pipeline_packed.txt");
+    packed.Write((const UINT8*)text.data(), text.size(), 1);
+    packed.Close();
+
+    Archive archive;
+    std::vector<std::string> files = { "pipeline_raw.bin" };
+    archive.Create(files);
+    remove("test_pipeline.asset");
+    rename("temp_archive.asset", "test_pipeline.asset");
+
+    archive.EnableCompression(true);
+    bool archiveOk = archive.Open("test_pipeline.asset", Mode::WRITE) && archive.AddFile("pipeline_packed.txt") &&
+        archive.Compact() && archive.Validate() && archive.ExtractAll("pipeline_out");
+    archive.Close();
+
+    File extracted;
+    Blob extractedData;
+    archiveOk = archiveOk && extracted.Open("pipeline_out/pipeline_raw.bin", Mode::READ);
+    if (archiveOk)
+    {
+        extractedData.Resize(extracted.GetSize());
+        archiveOk = extracted.Read(extractedData.GetData(), extractedData.GetSize(), 1) == data.size() &&
+            CompareData(extractedData.GetData(), data.data(), data.size());
+        extracted.Close();
+    }
+    archiveOk = archiveOk && std::filesystem::file_size("pipeline_out/pipeline_packed.txt") == text.size();
+
+    if (archiveOk)
+        PrintSuccess("Compact, Validate, ExtractAll: OK");
+    else
+        PrintError("Compact, Validate, ExtractAll: FAILED");
+
+    // One flipped byte in the raw entry: caught, and no output left behind
+    std::vector<UINT8> bytes(std::filesystem::file_size("test_pipeline.asset"));
+    FILE* handle = nullptr;
+    fopen_s(&handle, "test_pipeline.asset", "r+b");
+    bool corruptOk = handle != nullptr && fread(bytes.data(), 1, bytes.size(), handle) == bytes.size();
+    auto found = std::search(bytes.begin(), bytes.end(), data.begin(), data.begin() + 4096);
+    corruptOk = corruptOk && found != bytes.end();
+    if (corruptOk)
+    {
+        UINT8 flipped = static_cast<UINT8>(data[100000] ^ 0xFF);
+        fseek(handle, static_cast<long>((found - bytes.begin()) + 100000), SEEK_SET);
+        fwrite(&flipped, 1, 1, handle);
+    }
+    if (handle != nullptr)
+        fclose(handle);
+
+    std::filesystem::remove_all("pipeline_bad");
+    Archive damaged;
+    corruptOk = corruptOk && damaged.Open("test_pipeline.asset", Mode::READ) && !damaged.Validate() &&
+        damaged.ExtractAll("pipeline_bad") && !std::filesystem::exists("pipeline_bad/pipeline_raw.bin") &&
+        std::filesystem::exists("pipeline_bad/pipeline_packed.txt");
+    damaged.Close();
+
+    if (corruptOk)
+        PrintSuccess("Corrupted raw entry detected in the fused CRC32 pass: OK");
+    else
+        PrintError("Corrupted raw entry detected in the fused CRC32 pass: FAILED");
+
+    PrintSuccess("Test 38 PASSED\n");
+}
+
+void Test39_Io_Buffer_Policy()
+{
+    PrintTitle("Test 39: I/O Buffer Policy");
+
+    // Chunk sizes stay whole multiples of the keystream period
+    IoBuffer::SetChunkSize(1500);
+    UINT64 rounded = IoBuffer::GetChunkSize();
+    IoBuffer::SetChunkSize(1);
+    UINT64 smallest = IoBuffer::GetChunkSize();
+    IoBuffer::SetChunkSize(1ull << 40);
+    UINT64 largest = IoBuffer::GetChunkSize();
+
+    if (rounded == 2048 && smallest == MAX_BUFFER_SIZE && largest == IoBuffer::MAX_CHUNK_SIZE)
+        PrintSuccess("Chunk size rounded and clamped: OK");
+    else
+        PrintError("Chunk size rounded and clamped: FAILED");
+
+    // Page aligned, distinct when nested, reused once given back
+    IoBuffer::SetChunkSize(64 * 1024);
+    UINT8* first = nullptr;
+    bool scratchOk = true;
+    {
+        IoBuffer outer;
+        IoBuffer inner(100);
+        first = outer.GetData();
+        scratchOk = outer.GetSize() == 64 * 1024 && inner.GetSize() == 100 && outer.GetData() != inner.GetData() &&
+            reinterpret_cast<uintptr_t>(outer.GetData()) % AlignedAllocator::PAGE_SIZE == 0 &&
+            reinterpret_cast<uintptr_t>(inner.GetData()) % AlignedAllocator::PAGE_SIZE == 0;
+    }
+    {
+        IoBuffer again;
+        IoBuffer second;
+        scratchOk = scratchOk && (again.GetData() == first || second.GetData() == first);
+    }
+
+    if (scratchOk)
+        PrintSuccess("Per-thread aligned scratch buffers: OK");
+    else
+        PrintError("Per-thread aligned scratch buffers: FAILED");
+
+    // Encrypted entries read back the same whatever the chunk size
+    std::vector<UINT8> data(700000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<UINT8>((i * 7) ^ (i >> 11));
+
+    File source;
+    source.SetBufferSize(16 * 1024);
+    source.OpenWrite("iobuffer_source.bin");
+    source.Write(data.data(), data.size(), 1);
+    source.Close();
+
+    Archive builder;
+    std::vector<std::string> none;
+    builder.Create(none);
+    remove("test_iobuffer.asset");
+    rename("temp_archive.asset", "test_iobuffer.asset");
+
+    IoBuffer::SetChunkSize(3 * 1024);
+    builder.EnableEncryption(true);
+    builder.SetEncryptionKey("io-key");
+    UINT64 sourceID = 0;
+    bool archiveOk = builder.Open("test_iobuffer.asset", Mode::WRITE) && builder.AddFile("iobuffer_source.bin", sourceID);
+    builder.Close();
+
+    bool readsOk = archiveOk;
+    for (UINT64 chunkSize : { (UINT64)MAX_BUFFER_SIZE, (UINT64)(5 * 1024), (UINT64)(4 * 1024 * 1024) })
+    {
+        IoBuffer::SetChunkSize(chunkSize);
+        IoBuffer::SetFileBufferSize(chunkSize);
+
+        Archive reader;
+        reader.SetEncryptionKey("io-key");
+        Blob loaded;
+        Memory extracted;
+        readsOk = readsOk && reader.Open("test_iobuffer.asset", Mode::READ) &&
+            reader.ExtractTo(sourceID, extracted) && extracted.GetSize() == data.size() &&
+            CompareData(extracted.GetBytes(), data.data(), data.size()) &&
+            reader.ReadRangeByName("iobuffer_source.bin", 123456, 5000, loaded) &&
+            CompareData(loaded.GetData(), data.data() + 123456, 5000);
+        reader.Close();
+    }
+    IoBuffer::SetChunkSize(IoBuffer::DEFAULT_CHUNK_SIZE);
+    IoBuffer::SetFileBufferSize(0);
+
+    if (readsOk)
+        PrintSuccess("Encrypted entry identical across chunk and stdio buffer sizes: OK");
+    else
+        PrintError("Encrypted entry identical across chunk and stdio buffer sizes: FAILED");
+
+    // SafeFormat files written and checked in chunks
+    Stream::Header header;
+    Blob safeData;
+    IoBuffer::SetChunkSize(2 * 1024);
+    bool safeOk = SafeFormat::WriteSafeFile("iobuffer.safe", data.data(), data.size(), 1) &&
+        SafeFormat::Validate("iobuffer.safe", header, safeData) && safeData.GetSize() == data.size() &&
+        CompareData(safeData.GetData(), data.data(), data.size());
+    IoBuffer::SetChunkSize(IoBuffer::DEFAULT_CHUNK_SIZE);
+
+    if (safeOk)
+        PrintSuccess("SafeFormat write / validate in chunks: OK");
+    else
+        PrintError("SafeFormat write / validate in chunks: FAILED");
+
+    // A forged entry size is refused, not read into a buffer that could not grow
+    File forgedSource;
+    forgedSource.OpenWrite("iobuffer_forged.bin");
+    forgedSource.Write(data.data(), 7000, 1);
+    forgedSource.Close();
+
+    Archive forgedBuilder;
+    std::vector<std::string> forgedFiles = { "iobuffer_forged.bin" };
+    forgedBuilder.Create(forgedFiles);
+    remove("test_iobuffer_forged.asset");
+    rename("temp_archive.asset", "test_iobuffer_forged.asset");
+
+    std::vector<UINT8> bytes(std::filesystem::file_size("test_iobuffer_forged.asset"));
+    FILE* handle = nullptr;
+    fopen_s(&handle, "test_iobuffer_forged.asset", "r+b");
+    bool forgedOk = handle != nullptr && fread(bytes.data(), 1, bytes.size(), handle) == bytes.size();
+    // The entry header: "FILE", then the name at its place (the name map comes first)
+    const std::string name = "iobuffer_forged.bin";
+    UINT64 headerStart = 0;
+    for (auto found = bytes.begin(); forgedOk && headerStart == 0; ++found)
+    {
+        found = std::search(found, bytes.end(), name.begin(), name.end());
+        if (found == bytes.end())
+            break;
+        UINT64 start = (found - bytes.begin()) - offsetof(FileHeader, filename);
+        if ((UINT64)(found - bytes.begin()) >= offsetof(FileHeader, filename) && memcmp(&bytes[start], "FILE", 4) == 0)
+            headerStart = start;
+    }
+    forgedOk = forgedOk && headerStart != 0;
+    if (forgedOk)
+    {
+        UINT64 forgedSize = 1ull << 50;
+        fseek(handle, static_cast<long>(headerStart + offsetof(FileHeader, dataSize)), SEEK_SET);
+        fwrite(&forgedSize, sizeof(forgedSize), 1, handle);
+    }
+    if (handle != nullptr)
+        fclose(handle);
+
+    Archive forged;
+    Blob forgedData;
+    forgedOk = forgedOk && forged.Open("test_iobuffer_forged.asset", Mode::READ) &&
+        !forged.ReadFileByName("iobuffer_forged.bin", forgedData) && forgedData.GetSize() == 0;
+    forged.Close();
+
+    if (forgedOk)
+        PrintSuccess("Forged entry size rejected: OK");
+    else
+        PrintError("Forged entry size rejected: FAILED");
+
+    PrintSuccess("Test 39 PASSED\n");
+}
+
+void Test40_Parallel_Blocks()
+{
+    PrintTitle("Test 40: Parallel Block Pack / Unpack");
+
+    // Compressible runs and noise, so blocks take different paths (compressed and raw)
+    Blob source;
+    source.Resize(5 * 1024 * 1024 + 4321);
+    UINT32 seed = 2024;
+    for (UINT64 i = 0; i < source.GetSize(); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        source.GetData()[i] = ((i / 40000) % 3 == 2) ? (UINT8)(seed >> 16) : (UINT8)("parallel blocks "[i % 16]);
+    }
+
+    // The same payload whatever the number of threads
+    ThreadPool serial(1);
+    ThreadPool wide(4);
+    bool identicalOk = serial.GetConcurrency() == 1 && wide.GetConcurrency() == 4;
+    const UINT8 codecs[] = { CODEC_LZ, CODEC_LZH };
+    for (UINT8 codec : codecs)
+    {
+        Blob single, parallel, shared, decoded, decodedSingle;
+        {
+            ThreadPoolScope scope(serial);
+            identicalOk = identicalOk && Codec::Pack(source.GetData(), source.GetSize(), single, 64 * 1024, nullptr, codec);
+        }
+        {
+            ThreadPoolScope scope(wide);
+            identicalOk = identicalOk && Codec::Pack(source.GetData(), source.GetSize(), parallel, 64 * 1024, nullptr, codec) &&
+                Codec::Unpack(single.GetData(), single.GetSize(), decoded, nullptr, codec);
+        }
+        identicalOk = identicalOk && Codec::Pack(source.GetData(), source.GetSize(), shared, 64 * 1024, nullptr, codec);
+        {
+            ThreadPoolScope scope(serial);
+            identicalOk = identicalOk && Codec::Unpack(parallel.GetData(), parallel.GetSize(), decodedSingle, nullptr, codec);
+        }
+
+        identicalOk = identicalOk && single.GetSize() == parallel.GetSize() && single.GetSize() == shared.GetSize() &&
+            CompareData(single.GetData(), parallel.GetData(), single.GetSize()) &&
+            CompareData(single.GetData(), shared.GetData(), single.GetSize()) &&
+            decoded.GetSize() == source.GetSize() && CompareData(decoded.GetData(), source.GetData(), source.GetSize()) &&
+            decodedSingle.GetSize() == source.GetSize() && CompareData(decodedSingle.GetData(), source.GetData(), source.GetSize());
+        std::cout << "  " << Codec::GetName(codec) << ": " << source.GetSize() << " -> " << single.GetSize() << " bytes\n";
+    }
+
+    if (identicalOk)
+        PrintSuccess("Parallel output identical to single-threaded: OK");
+    else
+        PrintError("Parallel output identical to single-threaded: FAILED");
+
+    // Tasks that fan out again (on the pool they run on) neither deadlock nor lose items
+    std::atomic<UINT64> visited(0);
+    std::vector<Blob> nestedPayloads(6);
+    bool nestedOk = true;
+    wide.ParallelFor(8, [&](UINT64 i)
+    {
+        ThreadPool::Get().ParallelFor(16, [&](UINT64)
+        {
+            wide.ParallelFor(4, [&](UINT64) { visited++; });
+        });
+        if (i < nestedPayloads.size())
+            Codec::Pack(source.GetData() + i * 4096, 1024 * 1024, nestedPayloads[i], 64 * 1024);
+    });
+    for (UINT64 i = 0; i < nestedPayloads.size(); i++)
+    {
+        Blob expected, decoded;
+        nestedOk = nestedOk && Codec::Pack(source.GetData() + i * 4096, 1024 * 1024, expected, 64 * 1024) &&
+            expected.GetSize() == nestedPayloads[i].GetSize() &&
+            CompareData(expected.GetData(), nestedPayloads[i].GetData(), expected.GetSize());
+    }
+
+    if (nestedOk && visited == 8 * 16 * 4)
+        PrintSuccess("Nested ParallelFor: OK");
+    else
+        PrintError("Nested ParallelFor: FAILED");
+
+    // Combined slice CRCs against one pass over the whole buffer
+    Blob large;
+    large.Resize(9 * 1024 * 1024 + 77);
+    for (UINT64 i = 0; i < large.GetSize(); i++)
+        large.GetData()[i] = source.GetData()[(i * 7) % source.GetSize()];
+    UINT32 onePass = SafeFormat::UpdateCRC32(0, large.GetData(), large.GetSize());
+
+    bool crcOk = true;
+    {
+        ThreadPoolScope scope(wide);
+        crcOk = SafeFormat::CalculateCRC32(large.GetData(), large.GetSize()) == onePass;
+    }
+    const UINT64 splits[] = { 0, 1, 4096, 1234567, large.GetSize() - 1, large.GetSize() };
+    for (UINT64 split : splits)
+    {
+        UINT32 head = SafeFormat::UpdateCRC32(0, large.GetData(), split);
+        UINT32 tail = SafeFormat::UpdateCRC32(0, large.GetData() + split, large.GetSize() - split);
+        crcOk = crcOk && SafeFormat::CombineCRC32(head, tail, large.GetSize() - split) == onePass;
+    }
+
+    if (crcOk)
+        PrintSuccess("CombineCRC32 against a one-pass CRC32: OK");
+    else
+        PrintError("CombineCRC32 against a one-pass CRC32: FAILED");
+
+    PrintSuccess("Test 40 PASSED\n");
+}
+
+// ============================================================================
+// MAIN - TEST RUNNER
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+    std::cout << "========================================\n";
+    std::cout << "Asset Engine - Complete Test Suite\n";
+    std::cout << "========================================\n\n";
+
+    // Run ALL tests
+    try
+    {
+        // Memory Tests
+        Test1_Memory_Basic_Text();
+        Test1_Memory_Basic_Binary();
+        Test2_Memory_ExternalBlob_Text();
+        Test2_Memory_ExternalBlob_Binary();
+        Test3_Memory_To_File_Text();
+        Test3_Memory_To_File_Binary();
+
+        // Archive Tests
+        Test4_Archive_Create_Empty();
+        Test5_Archive_Create_Files();
+        Test6_Archive_Add_Files();
+        Test7_Archive_Add_Duplicates();
+        Test8_Archive_Remove_File();
+        Test9_Archive_Rename_File();
+        Test10_Archive_Compact();
+        Test11_Archive_RemoveAll();
+        Test12_Archive_Validate();
+        Test13_Archive_Extract();
+        Test14_Archive_ExtractAll();
+        Test15_Archive_Encryption();
+        Test16_Archive_Compression();
+        Test17_Archive_Blocks_RangedRead();
+        Test18_Archive_Dictionary();
+        Test19_Archive_Solid_Groups();
+        Test20_Archive_Adaptive_Codec();
+        Test21_Archive_Filters();
+        Test22_Archive_Deduplication();
+        Test23_Archive_Chunking();
+        Test24_Archive_Entry_Cache();
+        Test25_File_Block_Cache();
+        Test26_Archive_Shared_Toc();
+        Test27_Asset_Server();
+        Test28_Archive_Set_Overlay();
+        Test29_Blob_Inline_Growth();
+        Test30_Blob_Allocators();
+        Test31_Blob_Aligned_Allocations();
+        Test32_Shared_Blob();
+        Test33_Memory_ReadOnly_Span();
+        Test34_Archive_In_Memory();
+        Test35_Chunked_Blob();
+        Test36_Pipe_Stream();
+        Test37_Stream_Chain();
+        Test38_Stream_Pipelines();
+        Test39_Io_Buffer_Policy();
+        Test40_Parallel_Blocks();
+
+        std::cout << "\n========================================\n";
+        std::cout << "ALL TESTS PASSED!\n";
+        std::cout << "========================================\n";
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "\n[EXCEPTION] " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif // MODE_TESTS
+
+// ============================================================================
+
+#ifdef MODE_BENCH
+
+// ============================================================================
+// BENCH MODE - THROUGHPUT / LATENCY (build in Release)
+// ============================================================================
+
+// DebugUtils is compiled out of Release builds
+void PrintBenchTitle(const std::string& title)
+{
+    std::cout << "\n=== " << title << " ===\n";
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PrintRate(const std::string& label, UINT64 bytes, double seconds)
+{
+    std::cout << "  " << std::left << std::setw(40) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << (bytes / (1024.0 * 1024.0)) / seconds << " MB/s\n";
+}
+
+// ============================================================================
+// PIPE STREAM
+// ============================================================================
+
+void BenchPipeThroughput(PipeStream::Kind kind, UINT32 producers, UINT32 consumers, UINT64 writeSize)
+{
+    const UINT64 total = 1024ull * 1024 * 1024;
+    PipeStream pipe(PipeStream::DEFAULT_CAPACITY, kind);
+    std::atomic<UINT32> producing(producers);
+    std::atomic<UINT64> received(0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (UINT32 p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&]()
+        {
+            std::vector<UINT8> block(writeSize, 0x5A);
+            for (UINT64 sent = 0; sent < total / producers; sent += writeSize)
+                pipe.Write(block.data(), writeSize);
+            if (producing.fetch_sub(1) == 1)
+                pipe.Close();
+        });
+    }
+    for (UINT32 c = 0; c < consumers; c++)
+    {
+        threads.emplace_back([&]()
+        {
+            std::vector<UINT8> block((std::max)(writeSize, (UINT64)PipeStream::CHUNK_SIZE));
+            UINT64 n = 0;
+            while ((n = pipe.Read(block.data(), block.size())) > 0)
+                received += n;
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::string label = std::string(kind == PipeStream::Kind::SPSC ? "SPSC" : "MPMC") + " " +
+        std::to_string(producers) + "x" + std::to_string(consumers) + ", writes of " + std::to_string(writeSize / 1024) + " KB";
+    PrintRate(label, received, SecondsSince(start));
+}
+
+void BenchPipeLatency()
+{
+    const UINT32 roundTrips = 200000;
+    PipeStream ping(4096), pong(4096);
+
+    std::thread echo([&]()
+    {
+        UINT64 value = 0;
+        while (ping.Read((UINT8*)&value, sizeof(value)) == sizeof(value))
+            pong.Write((const UINT8*)&value, sizeof(value));
+        pong.Close();
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (UINT64 i = 0; i < roundTrips; i++)
+    {
+        UINT64 value = i;
+        ping.Write((const UINT8*)&value, sizeof(value));
+        pong.Read((UINT8*)&value, sizeof(value));
+    }
+    double seconds = SecondsSince(start);
+    ping.Close();
+    echo.join();
+
+    std::cout << "  " << std::left << std::setw(40) << "SPSC one-way latency (ping-pong / 2)" << std::right
+              << std::fixed << std::setprecision(0) << std::setw(10) << seconds * 1e9 / roundTrips / 2 << " ns\n";
+}
+
+void BenchPipe()
+{
+    PrintBenchTitle("PipeStream (1 GB, 1 MB ring)");
+    BenchPipeThroughput(PipeStream::Kind::SPSC, 1, 1, 4 * 1024);
+    BenchPipeThroughput(PipeStream::Kind::SPSC, 1, 1, 64 * 1024);
+    BenchPipeThroughput(PipeStream::Kind::SPSC, 1, 1, 256 * 1024);
+    BenchPipeThroughput(PipeStream::Kind::MPMC, 1, 1, 64 * 1024);
+    BenchPipeThroughput(PipeStream::Kind::MPMC, 2, 2, 64 * 1024);
+    BenchPipeThroughput(PipeStream::Kind::MPMC, 4, 4, 64 * 1024);
+    BenchPipeLatency();
+}
+
+// ============================================================================
+// STREAM PIPELINES
+// ============================================================================
+
+void BenchPipelines()
+{
+    const UINT64 total = 256ull * 1024 * 1024;
+    std::vector<UINT8> source(total);
+    for (UINT64 i = 0; i < total; i++)
+        source[i] = static_cast<UINT8>(i * 2654435761u >> 24);
+
+    PrintBenchTitle("Decipher + CRC32 (256 MB in memory)");
+    UINT32 reference = 0;
+
+    for (UINT64 readSize : { (UINT64)MAX_BUFFER_SIZE, (UINT64)(256 * 1024) })
+    {
+        Memory input(source.data(), total);
+        CipherStream cipher(&input, "bench-key");
+        CrcStream crc(&cipher);
+        std::vector<UINT8> buffer(readSize);
+
+        auto start = std::chrono::steady_clock::now();
+        while (crc.Read(buffer.data(), readSize) > 0) {}
+        PrintRate("Decorators, reads of " + std::to_string(readSize / 1024) + " KB", total, SecondsSince(start));
+        reference = crc.GetCRC32();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Pipeline pipeline{ MemorySource(source.data(), total), XorStage("bench-key"), Crc32Stage() };
+    pipeline.Run();
+    PrintRate("Pipeline, chunks of 256 KB", total, SecondsSince(start));
+
+    if (pipeline.GetStage<1>().GetCRC32() != reference)
+        std::cout << "  [MISMATCH] pipeline CRC32 differs from the decorators\n";
+
+    PrintBenchTitle("Read + CRC32 from disk (256 MB)");
+    {
+        File output;
+        output.OpenWrite("bench_pipeline.bin");
+        output.Write(source.data(), total, 1);
+        output.Close();
+    }
+
+    {
+        File input;
+        input.OpenRead("bench_pipeline.bin");
+        CrcStream crc(&input);
+        UINT8 buffer[MAX_BUFFER_SIZE];
+
+        start = std::chrono::steady_clock::now();
+        while (crc.Read(buffer, sizeof(buffer)) > 0) {}
+        PrintRate("File + CrcStream, reads of 1 KB", total, SecondsSince(start));
+        input.Close();
+    }
+
+    start = std::chrono::steady_clock::now();
+    Pipeline fromDisk{ FileSource("bench_pipeline.bin"), Crc32Stage() };
+    fromDisk.Run();
+    PrintRate("Pipeline<FileSource>, chunks of 256 KB", total, SecondsSince(start));
+
+    remove("bench_pipeline.bin");
+}
+
+// ============================================================================
+// I/O BUFFER SIZE
+// ============================================================================
+
+void BenchIoBuffer()
+{
+    const UINT64 total = 512ull * 1024 * 1024;
+    PrintBenchTitle("File read / write against chunk size (512 MB)");
+
+    {
+        IoBuffer pattern(IoBuffer::MAX_CHUNK_SIZE);
+        memset(pattern.GetData(), 0x3C, pattern.GetSize());
+        File output;
+        output.OpenWrite("bench_iobuffer.bin");
+        for (UINT64 written = 0; written < total; written += pattern.GetSize())
+            output.Write(pattern.GetData(), pattern.GetSize(), 1);
+        output.Close();
+    }
+
+    for (UINT64 chunkSize = MAX_BUFFER_SIZE; chunkSize <= 16ull * 1024 * 1024; chunkSize *= 4)
+    {
+        IoBuffer::SetChunkSize(chunkSize);
+        IoBuffer::SetFileBufferSize(chunkSize);
+        IoBuffer buffer;
+        std::string size = (chunkSize < 1024 * 1024) ? std::to_string(chunkSize / 1024) + " KB" : std::to_string(chunkSize / (1024 * 1024)) + " MB";
+
+        File input;
+        input.OpenRead("bench_iobuffer.bin");
+        auto start = std::chrono::steady_clock::now();
+        UINT64 bytesRead = 0;
+        UINT64 n = 0;
+        while ((n = input.Read(buffer.GetData(), buffer.GetSize())) > 0)
+            bytesRead += n;
+        PrintRate("Read, chunks of " + size, bytesRead, SecondsSince(start));
+        input.Close();
+
+        File output;
+        output.OpenWrite("bench_iobuffer_out.bin");
+        start = std::chrono::steady_clock::now();
+        for (UINT64 written = 0; written < total; written += buffer.GetSize())
+            output.Write(buffer.GetData(), buffer.GetSize());
+        output.Close();
+        PrintRate("Write, chunks of " + size, total, SecondsSince(start));
+    }
+
+    IoBuffer::SetChunkSize(IoBuffer::DEFAULT_CHUNK_SIZE);
+    IoBuffer::SetFileBufferSize(0);
+    remove("bench_iobuffer.bin");
+    remove("bench_iobuffer_out.bin");
+}
+
+// ============================================================================
+// PARALLEL BLOCKS
+// ============================================================================
+
+void BenchParallelPack()
+{
+    const UINT64 total = 128ull * 1024 * 1024;
+    PrintBenchTitle("Codec::Pack / Unpack against thread count (128 MB, blocks of 256 KB)");
+
+    Blob source;
+    source.Resize(total);
+    UINT32 seed = 7;
+    for (UINT64 i = 0; i < total; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        source.GetData()[i] = ((i / 65536) % 4 == 3) ? (UINT8)(seed >> 16) : (UINT8)("asset block data "[i % 17]);
+    }
+
+    UINT32 hardware = ThreadPool::Get().GetConcurrency();
+    std::vector<UINT32> threadCounts = { 1, 2, 4 };
+    if (hardware > 4)
+        threadCounts.push_back(hardware);
+
+    Blob reference;
+    for (UINT32 threads : threadCounts)
+    {
+        ThreadPool pool(threads);
+        ThreadPoolScope scope(pool);
+        const UINT8 codecs[] = { CODEC_LZ, CODEC_LZH };
+        for (UINT8 codec : codecs)
+        {
+            std::string label = std::string(Codec::GetName(codec)) + ", " + std::to_string(threads) + " thread(s)";
+            Blob payload, decoded;
+
+            auto start = std::chrono::steady_clock::now();
+            Codec::Pack(source.GetData(), total, payload, Codec::DEFAULT_BLOCK_SIZE, nullptr, codec);
+            PrintRate("Pack " + label, total, SecondsSince(start));
+
+            start = std::chrono::steady_clock::now();
+            Codec::Unpack(payload.GetData(), payload.GetSize(), decoded, nullptr, codec);
+            PrintRate("Unpack " + label, total, SecondsSince(start));
+
+            if (decoded.GetSize() != total || memcmp(decoded.GetData(), source.GetData(), total) != 0)
+                std::cout << "  [MISMATCH] " << label << " does not round-trip\n";
+            if (codec == CODEC_LZ && reference.GetSize() == 0)
+                reference = std::move(payload);
+            else if (codec == CODEC_LZ && (payload.GetSize() != reference.GetSize() || memcmp(payload.GetData(), reference.GetData(), payload.GetSize()) != 0))
+                std::cout << "  [MISMATCH] " << label << " differs from the single-threaded payload\n";
+        }
+    }
+}
+
+// ============================================================================
+// MAIN - BENCH RUNNER
+// ============================================================================
+
+int main(int argc, char* argv[])
+{
+    std::cout << "========================================\n";
+    std::cout << "Asset Engine - Benchmarks\n";
+    std::cout << "========================================\n\n";
+
+    BenchPipe();
+    BenchPipelines();
+    BenchIoBuffer();
+    BenchParallelPack();
+
+    return 0;
+}
+
+#endif // MODE_BENCH
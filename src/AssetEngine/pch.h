@@ -13,18 +13,31 @@
 
 #include <iostream>   
 #include <iomanip>      
+#include <fstream>
 #include <cstdio>   
 #include <string>      
 
 #include <vector>    
+#include <deque>
+#include <list>
 #include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <memory>
+#include <tuple>
 
 #include <algorithm>   
+#include <cmath>
 #include <random>       
 #include <chrono>      
 
 #include <cstdint>     
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
 #include <cassert>     
 
 // ----------------------------------------------------------------------------
@@ -43,11 +56,26 @@
 // Project Includes
 // ----------------------------------------------------------------------------
 #include "Types.hpp"       
+#include "ThreadPool.h"
 #include "File.h"        
+#include "Allocator.h"
 #include "Blob.h"          
+#include "SharedBlob.h"
+#include "ChunkedBlob.h"
+#include "IoBuffer.h"
 #include "Memory.h"       
+#include "PipeStream.h"
+#include "BlockCache.h"
 #include "SafeFormat.h"  
+#include "Codec.h"
+#include "StreamChain.h"
+#include "Pipeline.h"
+#include "Filter.h"
+#include "Chunker.h"
+#include "SharedToc.h"
 #include "Archive.h"      
+#include "ArchiveSet.h"
+#include "AssetServer.h"
 #include "DebugUtils.hpp"   
 
 #endif // PCH_H